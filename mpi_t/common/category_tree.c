@@ -0,0 +1,235 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory.
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * category_tree.c
+ *
+ * MPI_T category hierarchy and variable bitsets, see category_tree.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "category_tree.h"
+
+#define CATEGORY_NAME_SZ 1024
+#define CATEGORY_DESC_SZ 4097
+#define WORD_BITS 64
+#define NUM_WORDS(bits) (((bits) + WORD_BITS - 1) / WORD_BITS)
+
+void bitset_init(BITSET *b, int num_bits){
+	b->num_bits = num_bits;
+	b->words = (unsigned long long int*)calloc(NUM_WORDS(num_bits) + 1, sizeof(unsigned long long int));
+}
+
+/**
+ * Change the number of bits, new bits are cleared.
+ */
+void bitset_resize(BITSET *b, int num_bits){
+	int old_words = NUM_WORDS(b->num_bits) + 1;
+	int new_words = NUM_WORDS(num_bits) + 1;
+	if(new_words > old_words){
+		b->words = (unsigned long long int*)realloc(b->words, sizeof(unsigned long long int) * new_words);
+		memset(b->words + old_words, 0, sizeof(unsigned long long int) * (new_words - old_words));
+	}
+	b->num_bits = num_bits;
+}
+
+void bitset_set(BITSET *b, int bit){
+	if(bit >= 0 && bit < b->num_bits)
+		b->words[bit / WORD_BITS] |= 1ULL << (bit % WORD_BITS);
+}
+
+void bitset_clear(BITSET *b, int bit){
+	if(bit >= 0 && bit < b->num_bits)
+		b->words[bit / WORD_BITS] &= ~(1ULL << (bit % WORD_BITS));
+}
+
+int bitset_test(BITSET *b, int bit){
+	if(bit < 0 || bit >= b->num_bits)
+		return 0;
+	return (b->words[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1;
+}
+
+void bitset_or(BITSET *dst, BITSET *src){
+	int i, n = NUM_WORDS(dst->num_bits < src->num_bits ? dst->num_bits : src->num_bits);
+	for(i = 0; i < n; i++)
+		dst->words[i] |= src->words[i];
+}
+
+/**
+ * @return the first set bit at or after from, -1 if there is none
+ */
+int bitset_next(BITSET *b, int from){
+	int w, bit;
+	unsigned long long int word;
+	if(from < 0)
+		from = 0;
+	for(w = from / WORD_BITS; w < NUM_WORDS(b->num_bits); w++){
+		word = b->words[w];
+		if(w == from / WORD_BITS)
+			word &= ~0ULL << (from % WORD_BITS);
+		if(word == 0)
+			continue;
+		bit = w * WORD_BITS + __builtin_ctzll(word);
+		return (bit < b->num_bits) ? bit : -1;
+	}
+	return -1;
+}
+
+int bitset_count(BITSET *b){
+	int w, n = 0;
+	for(w = 0; w < NUM_WORDS(b->num_bits); w++)
+		n += __builtin_popcountll(b->words[w]);
+	return n;
+}
+
+void bitset_free(BITSET *b){
+	free(b->words);
+	b->words = NULL;
+	b->num_bits = 0;
+}
+
+/**
+ * Query all categories and their members.
+ * @return number of categories, -1 on error
+ */
+int category_tree_load(CATEGORY_TREE *tree){
+	char name[CATEGORY_NAME_SZ];
+	char *desc;
+	int i, j, namelen, desclen, num_cvars, num_pvars, num_sub;
+	int *indices = NULL;
+	int max_indices = 0;
+	CATEGORY *c;
+
+	memset(tree, 0, sizeof(CATEGORY_TREE));
+	/* take the stamp first so that changes during loading are noticed later */
+	if(MPI_T_category_changed(&tree->stamp) != MPI_SUCCESS ||
+			MPI_T_category_get_num(&tree->num) != MPI_SUCCESS ||
+			MPI_T_cvar_get_num(&tree->num_cvars) != MPI_SUCCESS ||
+			MPI_T_pvar_get_num(&tree->num_pvars) != MPI_SUCCESS){
+		tree->num = 0;
+		return -1;
+	}
+	tree->categories = (CATEGORY*)calloc(tree->num + 1, sizeof(CATEGORY));
+	bitset_init(&tree->is_sub, tree->num);
+	desc = (char*)malloc(CATEGORY_DESC_SZ);
+
+	for(i = 0; i < tree->num; i++){
+		c = &tree->categories[i];
+		bitset_init(&c->cvars, tree->num_cvars);
+		bitset_init(&c->pvars, tree->num_pvars);
+		namelen = CATEGORY_NAME_SZ;
+		desclen = CATEGORY_DESC_SZ;
+		if(MPI_T_category_get_info(i, name, &namelen, desc, &desclen,
+				&num_cvars, &num_pvars, &num_sub) != MPI_SUCCESS){
+			c->name = strdup("");
+			c->desc = strdup("");
+			continue;
+		}
+		c->name = strdup(name);
+		c->desc = strdup(desc);
+
+		if(num_cvars > max_indices || num_pvars > max_indices || num_sub > max_indices){
+			max_indices = num_cvars;
+			if(num_pvars > max_indices) max_indices = num_pvars;
+			if(num_sub > max_indices) max_indices = num_sub;
+			indices = (int*)realloc(indices, sizeof(int) * max_indices);
+		}
+		if(num_cvars > 0 && MPI_T_category_get_cvars(i, num_cvars, indices) == MPI_SUCCESS)
+			for(j = 0; j < num_cvars; j++)
+				bitset_set(&c->cvars, indices[j]);
+		if(num_pvars > 0 && MPI_T_category_get_pvars(i, num_pvars, indices) == MPI_SUCCESS)
+			for(j = 0; j < num_pvars; j++)
+				bitset_set(&c->pvars, indices[j]);
+		if(num_sub > 0 && MPI_T_category_get_categories(i, num_sub, indices) == MPI_SUCCESS){
+			c->sub = (int*)malloc(sizeof(int) * num_sub);
+			for(j = 0; j < num_sub; j++){
+				if(indices[j] < 0 || indices[j] >= tree->num)
+					continue;
+				c->sub[c->num_sub++] = indices[j];
+				bitset_set(&tree->is_sub, indices[j]);
+			}
+		}
+	}
+	free(indices);
+	free(desc);
+	return tree->num;
+}
+
+/**
+ * @return the index of the category with this name, -1 if there is none
+ */
+int category_tree_find(CATEGORY_TREE *tree, const char *name){
+	int i;
+	for(i = 0; i < tree->num; i++)
+		if(strcmp(tree->categories[i].name, name) == 0)
+			return i;
+	return -1;
+}
+
+static void collect_members(CATEGORY_TREE *tree, int cat, BITSET *visited,
+		BITSET *cvars, BITSET *pvars){
+	CATEGORY *c = &tree->categories[cat];
+	int i;
+	if(bitset_test(visited, cat))
+		return;
+	bitset_set(visited, cat);
+	if(cvars != NULL)
+		bitset_or(cvars, &c->cvars);
+	if(pvars != NULL)
+		bitset_or(pvars, &c->pvars);
+	for(i = 0; i < c->num_sub; i++)
+		collect_members(tree, c->sub[i], visited, cvars, pvars);
+}
+
+/**
+ * Add all variables of a category and its subcategories to the given
+ * bitsets, either of which may be NULL.
+ */
+void category_tree_members(CATEGORY_TREE *tree, int cat, BITSET *cvars, BITSET *pvars){
+	BITSET visited;
+	if(cat < 0 || cat >= tree->num)
+		return;
+	bitset_init(&visited, tree->num);
+	collect_members(tree, cat, &visited, cvars, pvars);
+	bitset_free(&visited);
+}
+
+/**
+ * @return nonzero if categories or variables changed since the tree was loaded
+ */
+int category_tree_changed(CATEGORY_TREE *tree){
+	int stamp;
+	if(MPI_T_category_changed(&stamp) != MPI_SUCCESS)
+		return 0;
+	return stamp != tree->stamp;
+}
+
+void category_tree_free(CATEGORY_TREE *tree){
+	int i;
+	for(i = 0; i < tree->num; i++){
+		free(tree->categories[i].name);
+		free(tree->categories[i].desc);
+		free(tree->categories[i].sub);
+		bitset_free(&tree->categories[i].cvars);
+		bitset_free(&tree->categories[i].pvars);
+	}
+	free(tree->categories);
+	bitset_free(&tree->is_sub);
+	memset(tree, 0, sizeof(CATEGORY_TREE));
+}
@@ -0,0 +1,72 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory.
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * category_tree.h
+ *
+ * MPI_T category hierarchy shared by varlist and Gyan. All categories
+ * are queried once; the member variables of each category are kept as
+ * bitsets over the cvar and pvar indices so that selections can be
+ * combined and tested without further MPI_T calls. The tree remembers
+ * the MPI_T_category_changed stamp it was built from, a newer stamp
+ * means variables or categories were added since.
+ */
+#include <mpi.h>
+
+#ifndef CATEGORY_TREE_H_
+#define CATEGORY_TREE_H_
+
+typedef struct{
+	int num_bits;
+	unsigned long long int *words;
+}BITSET;
+
+void bitset_init(BITSET *b, int num_bits);
+void bitset_resize(BITSET *b, int num_bits);
+void bitset_set(BITSET *b, int bit);
+void bitset_clear(BITSET *b, int bit);
+int bitset_test(BITSET *b, int bit);
+void bitset_or(BITSET *dst, BITSET *src);
+int bitset_next(BITSET *b, int from);
+int bitset_count(BITSET *b);
+void bitset_free(BITSET *b);
+
+typedef struct{
+	char *name;
+	char *desc;
+	BITSET cvars; // direct members only
+	BITSET pvars;
+	int num_sub;
+	int *sub; // indices of subcategories
+}CATEGORY;
+
+typedef struct{
+	int num;
+	CATEGORY *categories;
+	int num_cvars;
+	int num_pvars;
+	int stamp;
+	BITSET is_sub; // categories contained in another category
+}CATEGORY_TREE;
+
+int category_tree_load(CATEGORY_TREE *tree);
+int category_tree_find(CATEGORY_TREE *tree, const char *name);
+void category_tree_members(CATEGORY_TREE *tree, int cat, BITSET *cvars, BITSET *pvars);
+int category_tree_changed(CATEGORY_TREE *tree);
+void category_tree_free(CATEGORY_TREE *tree);
+#endif /* CATEGORY_TREE_H_ */
@@ -0,0 +1,229 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory.
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * enum_cache.c
+ *
+ * Cache of decoded MPI_T enumerations, see enum_cache.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "enum_cache.h"
+
+#define ENUM_NAME_SZ 1024
+#define ENUM_DENSE_SLACK 16 // value ranges up to 2 * num + slack are indexed directly
+#define CACHE_MIN_SLOTS 64
+
+typedef struct{
+	MPI_T_enum handle;
+	char *name;
+	int num;
+	int min_value;
+	int range; // > 0: dense table of size range indexed by value - min_value
+	int mask; // sparse: hash table of size mask + 1
+	int *values;
+	char **names; // dense: indexed by value, sparse: parallel to values
+}ENUM_TABLE;
+
+static ENUM_TABLE **cache_slots;
+static int cache_mask = -1;
+static int cache_num;
+
+static unsigned long long int hash_bits(unsigned long long int h){
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static unsigned long long int hash_handle(MPI_T_enum handle){
+	unsigned long long int bits = 0;
+	memcpy(&bits, &handle, sizeof(handle) < sizeof(bits) ? sizeof(handle) : sizeof(bits));
+	return hash_bits(bits);
+}
+
+/**
+ * Query all items of an enum and build its lookup table.
+ */
+static ENUM_TABLE *decode_enum(MPI_T_enum handle){
+	ENUM_TABLE *t;
+	char name[ENUM_NAME_SZ];
+	int *values;
+	char **names;
+	int i, len, num, value, min_value, max_value, slot;
+
+	len = ENUM_NAME_SZ;
+	if(MPI_T_enum_get_info(handle, &num, name, &len) != MPI_SUCCESS)
+		return NULL;
+	t = (ENUM_TABLE*)calloc(1, sizeof(ENUM_TABLE));
+	t->handle = handle;
+	t->name = strdup(name);
+	t->num = num;
+	values = (int*)malloc(sizeof(int) * (num + 1));
+	names = (char**)malloc(sizeof(char*) * (num + 1));
+
+	min_value = max_value = 0;
+	for(i = 0; i < num; i++){
+		len = ENUM_NAME_SZ;
+		if(MPI_T_enum_get_item(handle, i, &value, name, &len) != MPI_SUCCESS){
+			names[i] = NULL;
+			continue;
+		}
+		values[i] = value;
+		names[i] = strdup(name);
+		if(i == 0 || value < min_value)
+			min_value = value;
+		if(i == 0 || value > max_value)
+			max_value = value;
+	}
+
+	if(num > 0 && (long long)max_value - min_value < 2LL * num + ENUM_DENSE_SLACK){
+		t->min_value = min_value;
+		t->range = max_value - min_value + 1;
+		t->names = (char**)calloc(t->range, sizeof(char*));
+		for(i = 0; i < num; i++){
+			if(names[i] == NULL)
+				continue;
+			if(t->names[values[i] - min_value] == NULL) // first item wins for duplicate values
+				t->names[values[i] - min_value] = names[i];
+			else
+				free(names[i]);
+		}
+		free(values);
+		free(names);
+		return t;
+	}
+
+	/* sparse values: open addressing with linear probing */
+	for(t->mask = 1; t->mask < 2 * num; t->mask <<= 1);
+	t->values = (int*)malloc(sizeof(int) * t->mask);
+	t->names = (char**)calloc(t->mask, sizeof(char*));
+	t->mask--;
+	for(i = 0; i < num; i++){
+		if(names[i] == NULL)
+			continue;
+		slot = hash_bits((unsigned int)values[i]) & t->mask;
+		while(t->names[slot] != NULL && t->values[slot] != values[i])
+			slot = (slot + 1) & t->mask;
+		if(t->names[slot] == NULL){
+			t->values[slot] = values[i];
+			t->names[slot] = names[i];
+		}
+		else
+			free(names[i]);
+	}
+	free(values);
+	free(names);
+	return t;
+}
+
+static void grow_cache(){
+	ENUM_TABLE **old = cache_slots;
+	int old_size = cache_mask + 1;
+	int i, slot;
+
+	cache_mask = (old_size == 0) ? CACHE_MIN_SLOTS - 1 : 2 * old_size - 1;
+	cache_slots = (ENUM_TABLE**)calloc(cache_mask + 1, sizeof(ENUM_TABLE*));
+	for(i = 0; i < old_size; i++){
+		if(old[i] == NULL)
+			continue;
+		slot = hash_handle(old[i]->handle) & cache_mask;
+		while(cache_slots[slot] != NULL)
+			slot = (slot + 1) & cache_mask;
+		cache_slots[slot] = old[i];
+	}
+	free(old);
+}
+
+/**
+ * Find the table of an enum, decoding it on first use.
+ * @return the table or NULL if the enum cannot be queried
+ */
+static ENUM_TABLE *get_table(MPI_T_enum handle){
+	int slot;
+
+	if(handle == MPI_T_ENUM_NULL)
+		return NULL;
+	if(2 * (cache_num + 1) > cache_mask + 1)
+		grow_cache();
+	slot = hash_handle(handle) & cache_mask;
+	while(cache_slots[slot] != NULL){
+		if(cache_slots[slot]->handle == handle)
+			return cache_slots[slot];
+		slot = (slot + 1) & cache_mask;
+	}
+	cache_slots[slot] = decode_enum(handle);
+	if(cache_slots[slot] != NULL)
+		cache_num++;
+	return cache_slots[slot];
+}
+
+/**
+ * Name of the enum item with the given value.
+ * @return the name or NULL if the value is not part of the enum
+ */
+const char *enum_cache_lookup(MPI_T_enum enumtype, int value){
+	ENUM_TABLE *t = get_table(enumtype);
+	int slot;
+
+	if(t == NULL)
+		return NULL;
+	if(t->range > 0){
+		if(value < t->min_value || value - t->min_value >= t->range)
+			return NULL;
+		return t->names[value - t->min_value];
+	}
+	slot = hash_bits((unsigned int)value) & t->mask;
+	while(t->names[slot] != NULL){
+		if(t->values[slot] == value)
+			return t->names[slot];
+		slot = (slot + 1) & t->mask;
+	}
+	return NULL;
+}
+
+/**
+ * Name of the enumeration itself.
+ */
+const char *enum_cache_name(MPI_T_enum enumtype){
+	ENUM_TABLE *t = get_table(enumtype);
+	return (t == NULL) ? NULL : t->name;
+}
+
+void enum_cache_free(){
+	int i, j, size;
+	ENUM_TABLE *t;
+
+	for(i = 0; i <= cache_mask; i++){
+		t = cache_slots[i];
+		if(t == NULL)
+			continue;
+		size = (t->range > 0) ? t->range : t->mask + 1;
+		for(j = 0; j < size; j++)
+			free(t->names[j]);
+		free(t->names);
+		free(t->values);
+		free(t->name);
+		free(t);
+	}
+	free(cache_slots);
+	cache_slots = NULL;
+	cache_mask = -1;
+	cache_num = 0;
+}
@@ -0,0 +1,38 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory.
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * enum_cache.h
+ *
+ * Cache of decoded MPI_T enumerations shared by varlist and Gyan. Each
+ * enum is queried once through MPI_T_enum_get_info/MPI_T_enum_get_item;
+ * afterwards the name of a value is found in constant time, either by
+ * direct indexing (dense enums) or through a small hash table.
+ *
+ * Enum handles are only valid while MPI_T is initialized, so
+ * enum_cache_free() must be called before MPI_T_finalize().
+ */
+#include <mpi.h>
+
+#ifndef ENUM_CACHE_H_
+#define ENUM_CACHE_H_
+
+const char *enum_cache_lookup(MPI_T_enum enumtype, int value);
+const char *enum_cache_name(MPI_T_enum enumtype);
+void enum_cache_free();
+#endif /* ENUM_CACHE_H_ */
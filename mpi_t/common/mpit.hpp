@@ -0,0 +1,369 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * mpit.hpp
+ *
+ * Header-only C++ layer over the MPI_T C interface, for C++ applications
+ * that sample their own MPI library. MPI_T itself, pvar sessions and
+ * handles are owned by objects that release them when they go out of
+ * scope. PvarHandle<T> and CvarHandle<T> fix the element type at compile
+ * time: the MPI datatype of the variable is checked once when the handle
+ * is allocated, so read() is a single MPI_T call into storage of the right
+ * type, without a switch over datatypes or a temporary buffer.
+ * PvarBatch<T> reads many pvars of one type into one contiguous array.
+ *
+ * Errors are reported by throwing mpit::Error with the MPI_T error code.
+ * Handles must be destroyed before their Session, and all objects before
+ * the Library.
+ *
+ *	mpit::Library mpit;
+ *	mpit::Session session;
+ *	mpit::PvarHandle<unsigned long long> sent(session, "pml_ob1_bytes_sent");
+ *	unsigned long long bytes = sent.read();
+ */
+#include <mpi.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef MPIT_HPP_
+#define MPIT_HPP_
+
+#define MPIT_STR_SZ 256
+
+namespace mpit {
+
+class Error : public std::runtime_error{
+public:
+	Error(const std::string &what, int code)
+		: std::runtime_error(what + ": MPI_T error " + std::to_string(code)), code_(code){}
+	int code() const{ return code_; }
+private:
+	int code_;
+};
+
+inline void check(int err, const char *what){
+	if(err != MPI_SUCCESS)
+		throw Error(what, err);
+}
+
+/**
+ * The MPI datatypes an element type T stands for; variables of other
+ * datatypes cannot be bound to a handle of T.
+ */
+template<typename T> struct Datatype;
+template<> struct Datatype<int>{
+	static bool matches(MPI_Datatype d){ return d == MPI_INT; }
+};
+template<> struct Datatype<unsigned>{
+	static bool matches(MPI_Datatype d){ return d == MPI_UNSIGNED; }
+};
+template<> struct Datatype<unsigned long>{
+	static bool matches(MPI_Datatype d){ return d == MPI_UNSIGNED_LONG; }
+};
+template<> struct Datatype<unsigned long long>{
+	static bool matches(MPI_Datatype d){ return d == MPI_UNSIGNED_LONG_LONG; }
+};
+template<> struct Datatype<long long>{
+	static bool matches(MPI_Datatype d){ return d == MPI_COUNT || d == MPI_LONG_LONG; }
+};
+template<> struct Datatype<double>{
+	static bool matches(MPI_Datatype d){ return d == MPI_DOUBLE; }
+};
+template<> struct Datatype<char>{
+	static bool matches(MPI_Datatype d){ return d == MPI_CHAR; }
+};
+
+/**
+ * MPI_T from construction to destruction; nests like MPI_T_init_thread.
+ */
+class Library{
+public:
+	explicit Library(int required = MPI_THREAD_SINGLE){
+		check(MPI_T_init_thread(required, &provided_), "MPI_T_init_thread");
+	}
+	~Library(){ MPI_T_finalize(); }
+	Library(const Library&) = delete;
+	Library &operator=(const Library&) = delete;
+	int provided() const{ return provided_; }
+private:
+	int provided_;
+};
+
+struct PvarInfo{
+	int index;
+	std::string name;
+	std::string desc;
+	int verbosity;
+	int var_class;
+	MPI_Datatype datatype;
+	MPI_T_enum enumtype;
+	int bind;
+	int readonly;
+	int continuous;
+	int atomic;
+};
+
+struct CvarInfo{
+	int index;
+	std::string name;
+	std::string desc;
+	int verbosity;
+	MPI_Datatype datatype;
+	MPI_T_enum enumtype;
+	int bind;
+	int scope;
+};
+
+inline int num_pvars(){
+	int num;
+	check(MPI_T_pvar_get_num(&num), "MPI_T_pvar_get_num");
+	return num;
+}
+
+inline int num_cvars(){
+	int num;
+	check(MPI_T_cvar_get_num(&num), "MPI_T_cvar_get_num");
+	return num;
+}
+
+inline PvarInfo pvar_info(int index){
+	char name[MPIT_STR_SZ], desc[MPIT_STR_SZ];
+	int name_len = MPIT_STR_SZ, desc_len = MPIT_STR_SZ;
+	PvarInfo info;
+
+	check(MPI_T_pvar_get_info(index, name, &name_len, &info.verbosity, &info.var_class,
+			&info.datatype, &info.enumtype, desc, &desc_len, &info.bind, &info.readonly,
+			&info.continuous, &info.atomic), "MPI_T_pvar_get_info");
+	info.index = index;
+	info.name = name;
+	info.desc = desc;
+	return info;
+}
+
+inline CvarInfo cvar_info(int index){
+	char name[MPIT_STR_SZ], desc[MPIT_STR_SZ];
+	int name_len = MPIT_STR_SZ, desc_len = MPIT_STR_SZ;
+	CvarInfo info;
+
+	check(MPI_T_cvar_get_info(index, name, &name_len, &info.verbosity, &info.datatype,
+			&info.enumtype, desc, &desc_len, &info.bind, &info.scope), "MPI_T_cvar_get_info");
+	info.index = index;
+	info.name = name;
+	info.desc = desc;
+	return info;
+}
+
+/**
+ * Index of the pvar called name, of class var_class unless it is -1.
+ * Works with MPI 3.0 libraries, which lack MPI_T_pvar_get_index.
+ */
+inline int find_pvar(const std::string &name, int var_class = -1){
+	int i, num = num_pvars();
+
+	for(i = 0; i < num; i++){
+		PvarInfo info = pvar_info(i);
+		if(info.name == name && (var_class == -1 || info.var_class == var_class))
+			return i;
+	}
+	throw Error("no pvar " + name, MPI_T_ERR_INVALID_NAME);
+}
+
+inline int find_cvar(const std::string &name){
+	int i, num = num_cvars();
+
+	for(i = 0; i < num; i++)
+		if(cvar_info(i).name == name)
+			return i;
+	throw Error("no cvar " + name, MPI_T_ERR_INVALID_NAME);
+}
+
+class Session{
+public:
+	Session(){ check(MPI_T_pvar_session_create(&session_), "MPI_T_pvar_session_create"); }
+	~Session(){
+		if(session_ != MPI_T_PVAR_SESSION_NULL)
+			MPI_T_pvar_session_free(&session_);
+	}
+	Session(const Session&) = delete;
+	Session &operator=(const Session&) = delete;
+	Session(Session &&other) noexcept : session_(other.session_){
+		other.session_ = MPI_T_PVAR_SESSION_NULL;
+	}
+	MPI_T_pvar_session get() const{ return session_; }
+private:
+	MPI_T_pvar_session session_;
+};
+
+/**
+ * A started pvar handle with elements of type T. Pvars that are not
+ * continuous are started on allocation and stopped on destruction.
+ */
+template<typename T>
+class PvarHandle{
+public:
+	PvarHandle(Session &session, int index, void *obj_handle = nullptr)
+		: session_(session.get()), handle_(MPI_T_PVAR_HANDLE_NULL), started_(false){
+		PvarInfo info = pvar_info(index);
+		if(!Datatype<T>::matches(info.datatype))
+			throw Error("pvar " + info.name + " has another datatype", MPI_T_ERR_INVALID);
+		check(MPI_T_pvar_handle_alloc(session_, index, obj_handle, &handle_, &count_),
+				"MPI_T_pvar_handle_alloc");
+		if(!info.continuous){
+			int err = MPI_T_pvar_start(session_, handle_);
+			if(err != MPI_SUCCESS){
+				MPI_T_pvar_handle_free(session_, &handle_);
+				throw Error("MPI_T_pvar_start", err);
+			}
+			started_ = true;
+		}
+	}
+	PvarHandle(Session &session, const std::string &name, int var_class = -1, void *obj_handle = nullptr)
+		: PvarHandle(session, find_pvar(name, var_class), obj_handle){}
+	~PvarHandle(){
+		if(handle_ == MPI_T_PVAR_HANDLE_NULL)
+			return;
+		if(started_)
+			MPI_T_pvar_stop(session_, handle_);
+		MPI_T_pvar_handle_free(session_, &handle_);
+	}
+	PvarHandle(const PvarHandle&) = delete;
+	PvarHandle &operator=(const PvarHandle&) = delete;
+	PvarHandle(PvarHandle &&other) noexcept
+		: session_(other.session_), handle_(other.handle_), count_(other.count_), started_(other.started_){
+		other.handle_ = MPI_T_PVAR_HANDLE_NULL;
+	}
+
+	/* elements of the pvar */
+	int count() const{ return count_; }
+
+	/* read all count() elements into values */
+	void read(T *values) const{
+		check(MPI_T_pvar_read(session_, handle_, values), "MPI_T_pvar_read");
+	}
+
+	/* value of a pvar with a single element */
+	T read() const{
+		T value;
+		if(count_ != 1)
+			throw Error("pvar has " + std::to_string(count_) + " elements", MPI_T_ERR_INVALID);
+		read(&value);
+		return value;
+	}
+
+	void reset(){ check(MPI_T_pvar_reset(session_, handle_), "MPI_T_pvar_reset"); }
+	MPI_T_pvar_handle get() const{ return handle_; }
+private:
+	MPI_T_pvar_session session_;
+	MPI_T_pvar_handle handle_;
+	int count_;
+	bool started_;
+};
+
+/**
+ * A cvar handle with elements of type T.
+ */
+template<typename T>
+class CvarHandle{
+public:
+	explicit CvarHandle(int index, void *obj_handle = nullptr) : handle_(MPI_T_CVAR_HANDLE_NULL){
+		CvarInfo info = cvar_info(index);
+		if(!Datatype<T>::matches(info.datatype))
+			throw Error("cvar " + info.name + " has another datatype", MPI_T_ERR_INVALID);
+		check(MPI_T_cvar_handle_alloc(index, obj_handle, &handle_, &count_), "MPI_T_cvar_handle_alloc");
+	}
+	explicit CvarHandle(const std::string &name, void *obj_handle = nullptr)
+		: CvarHandle(find_cvar(name), obj_handle){}
+	~CvarHandle(){
+		if(handle_ != MPI_T_CVAR_HANDLE_NULL)
+			MPI_T_cvar_handle_free(&handle_);
+	}
+	CvarHandle(const CvarHandle&) = delete;
+	CvarHandle &operator=(const CvarHandle&) = delete;
+	CvarHandle(CvarHandle &&other) noexcept : handle_(other.handle_), count_(other.count_){
+		other.handle_ = MPI_T_CVAR_HANDLE_NULL;
+	}
+
+	int count() const{ return count_; }
+
+	void read(T *values) const{
+		check(MPI_T_cvar_read(handle_, values), "MPI_T_cvar_read");
+	}
+
+	T read() const{
+		T value;
+		if(count_ != 1)
+			throw Error("cvar has " + std::to_string(count_) + " elements", MPI_T_ERR_INVALID);
+		read(&value);
+		return value;
+	}
+
+	void write(const T *values){
+		check(MPI_T_cvar_write(handle_, values), "MPI_T_cvar_write");
+	}
+
+	void write(const T &value){ write(&value); }
+	MPI_T_cvar_handle get() const{ return handle_; }
+private:
+	MPI_T_cvar_handle handle_;
+	int count_;
+};
+
+/**
+ * Pvars of element type T read together into one contiguous array, the
+ * elements of each pvar at its offset. The array is sized as pvars are
+ * added and not touched by read(), so values() stays valid between adds.
+ */
+template<typename T>
+class PvarBatch{
+public:
+	explicit PvarBatch(Session &session) : session_(session){}
+
+	/* add a pvar, returns the offset of its first element */
+	size_t add(int index, void *obj_handle = nullptr){
+		size_t offset = values_.size();
+		handles_.emplace_back(session_, index, obj_handle);
+		offsets_.push_back(offset);
+		values_.resize(offset + handles_.back().count());
+		return offset;
+	}
+
+	/* read all pvars, in the order they were added */
+	void read(){
+		size_t i;
+		for(i = 0; i < handles_.size(); i++)
+			handles_[i].read(values_.data() + offsets_[i]);
+	}
+
+	size_t size() const{ return handles_.size(); }
+	size_t offset(size_t i) const{ return offsets_[i]; }
+	int count(size_t i) const{ return handles_[i].count(); }
+	const T *values() const{ return values_.data(); }
+	size_t num_values() const{ return values_.size(); }
+private:
+	Session &session_;
+	std::vector<PvarHandle<T>> handles_;
+	std::vector<size_t> offsets_;
+	std::vector<T> values_;
+};
+
+} // namespace mpit
+#endif /* MPIT_HPP_ */
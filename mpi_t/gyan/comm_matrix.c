@@ -0,0 +1,348 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * comm_matrix.c
+ *
+ * Per-thread communication matrix rows and their CSR export, see
+ * comm_matrix.h.
+ */
+
+#include "comm_matrix.h"
+
+#define FALSE 0
+#define TRUE 1
+#define INITIAL_CAPACITY 64 // hash slots, a power of two
+#define FREED_SLOTS_LOG 10
+
+static int world_size = 0;
+static int dense_limit = DEFAULT_COMM_MATRIX_DENSE;
+static unsigned int freed[1 << FREED_SLOTS_LOG]; // MPI_Comm_free calls per handle hash
+
+typedef struct{
+	int64_t col;
+	uint64_t messages, bytes;
+}ENTRY;
+
+void comm_matrix_setup(int num_ranks, int limit){
+	world_size = num_ranks;
+	dense_limit = limit;
+}
+
+static unsigned int freed_slot(MPI_Comm comm){
+	uint64_t key = 0;
+	memcpy(&key, &comm, (sizeof(comm) < sizeof(key)) ? sizeof(comm) : sizeof(key));
+	return (unsigned int)((key * 0x9E3779B97F4A7C15ull) >> (64 - FREED_SLOTS_LOG));
+}
+
+/**
+ * The handle of a freed communicator may be reused, so the groups the
+ * threads cached for it have to be resolved again. Called before the
+ * communicator is freed.
+ */
+void comm_matrix_comm_freed(MPI_Comm comm){
+	__atomic_add_fetch(&freed[freed_slot(comm)], 1, __ATOMIC_RELAXED);
+}
+
+static int stale(COMM_GROUP *g){
+	return g->world != NULL && g->epoch != __atomic_load_n(&freed[g->slot], __ATOMIC_RELAXED);
+}
+
+static void allocate(COMM_MATRIX *m, int capacity, int dense){
+	m->capacity = capacity;
+	m->used = 0;
+	m->dest = NULL;
+	if(!dense){
+		m->dest = (int*)malloc(sizeof(int) * capacity);
+		memset(m->dest, -1, sizeof(int) * capacity);
+	}
+	m->messages = (unsigned long long int*)calloc(capacity, sizeof(unsigned long long int));
+	m->bytes = (unsigned long long int*)calloc(capacity, sizeof(unsigned long long int));
+}
+
+static unsigned int slot_of(int dest, int capacity){
+	return ((unsigned int)dest * 2654435761u) & (unsigned int)(capacity - 1);
+}
+
+static void add(COMM_MATRIX *m, int dest, unsigned long long int messages, unsigned long long int bytes);
+
+/**
+ * Double the hash table and reinsert its entries.
+ */
+static void grow(COMM_MATRIX *m){
+	COMM_MATRIX old = *m;
+	int i;
+
+	allocate(m, 2 * old.capacity, FALSE);
+	for(i = 0; i < old.capacity; i++)
+		if(old.dest[i] >= 0)
+			add(m, old.dest[i], old.messages[i], old.bytes[i]);
+	free(old.dest);
+	free(old.messages);
+	free(old.bytes);
+}
+
+static void add(COMM_MATRIX *m, int dest, unsigned long long int messages, unsigned long long int bytes){
+	unsigned int i, mask;
+
+	if(m->capacity == 0){
+		if(world_size <= dense_limit)
+			allocate(m, world_size, TRUE);
+		else
+			allocate(m, INITIAL_CAPACITY, FALSE);
+	}
+	if(m->dest == NULL){
+		m->messages[dest] += messages;
+		m->bytes[dest] += bytes;
+		return;
+	}
+	mask = (unsigned int)(m->capacity - 1);
+	for(i = slot_of(dest, m->capacity); m->dest[i] != dest; i = (i + 1) & mask){
+		if(m->dest[i] >= 0)
+			continue;
+		if(10 * (m->used + 1) > 7 * m->capacity){
+			grow(m);
+			add(m, dest, messages, bytes);
+			return;
+		}
+		m->dest[i] = dest;
+		m->used++;
+		break;
+	}
+	m->messages[i] += messages;
+	m->bytes[i] += bytes;
+}
+
+static void expand_group(COMM_MATRIX *m, COMM_GROUP *g);
+
+/**
+ * Group of comm as seen by this thread, resolved on the first call on the
+ * communicator and then taken from the cache. An entry whose handle was
+ * freed since is flushed into the row and resolved again in place.
+ */
+static COMM_GROUP *resolve(COMM_MATRIX *m, MPI_Comm comm){
+	COMM_GROUP *g = m->last;
+	MPI_Group group, world_group;
+	int i, *ranks;
+
+	if(g != NULL && g->comm == comm && !stale(g))
+		return g;
+	for(g = m->groups; g != NULL && g->comm != comm; g = g->next)
+		;
+	if(g != NULL && !stale(g))
+		return (m->last = g);
+
+	if(g == NULL){
+		g = (COMM_GROUP*)calloc(1, sizeof(COMM_GROUP));
+		g->comm = comm;
+		g->slot = freed_slot(comm);
+		g->next = m->groups;
+		m->groups = g;
+	}
+	else{
+		expand_group(m, g);
+		free(g->world);
+		g->world = NULL;
+	}
+	g->epoch = __atomic_load_n(&freed[g->slot], __ATOMIC_RELAXED);
+	PMPI_Comm_test_inter(comm, &g->inter);
+	if(g->inter)
+		PMPI_Comm_remote_group(comm, &group);
+	else
+		PMPI_Comm_group(comm, &group);
+	PMPI_Group_size(group, &g->size);
+	PMPI_Comm_rank(comm, &g->my_rank);
+	if(comm != MPI_COMM_WORLD){
+		ranks = (int*)malloc(sizeof(int) * g->size);
+		g->world = (int*)malloc(sizeof(int) * g->size);
+		for(i = 0; i < g->size; i++)
+			ranks[i] = i;
+		PMPI_Comm_group(MPI_COMM_WORLD, &world_group);
+		PMPI_Group_translate_ranks(group, g->size, ranks, world_group, g->world);
+		PMPI_Group_free(&world_group);
+		free(ranks);
+	}
+	PMPI_Group_free(&group);
+	return (m->last = g);
+}
+
+/**
+ * Count one point-to-point message to rank dest of comm.
+ */
+void comm_matrix_send(COMM_MATRIX *m, MPI_Comm comm, int dest, int count, MPI_Datatype datatype){
+	COMM_GROUP *g;
+	int size;
+
+	if(dest == MPI_PROC_NULL || dest < 0)
+		return;
+	if(comm != MPI_COMM_WORLD){
+		g = resolve(m, comm);
+		if(dest >= g->size)
+			return;
+		dest = g->world[dest];
+	}
+	if(dest < 0 || dest >= world_size) // not in MPI_COMM_WORLD
+		return;
+	PMPI_Type_size(datatype, &size);
+	add(m, dest, 1, (unsigned long long int)count * size);
+}
+
+/**
+ * Count a rooted (root >= 0) or all-to-all (root < 0) collective on comm.
+ */
+void comm_matrix_collective(COMM_MATRIX *m, MPI_Comm comm, int root, int count, MPI_Datatype datatype){
+	COMM_GROUP *g = resolve(m, comm);
+	int size;
+
+	if(g->inter || (root >= 0 && root != g->my_rank))
+		return;
+	PMPI_Type_size(datatype, &size);
+	g->coll_messages++;
+	g->coll_bytes += (unsigned long long int)count * size;
+}
+
+/**
+ * Turn the collectives counted on one communicator into row entries.
+ */
+static void expand_group(COMM_MATRIX *m, COMM_GROUP *g){
+	int i, dest;
+
+	if(g->coll_messages == 0)
+		return;
+	for(i = 0; i < g->size; i++){
+		dest = (g->world != NULL) ? g->world[i] : i;
+		if(i != g->my_rank && dest >= 0 && dest < world_size)
+			add(m, dest, g->coll_messages, g->coll_bytes);
+	}
+	g->coll_messages = g->coll_bytes = 0;
+}
+
+static void expand_groups(COMM_MATRIX *m){
+	COMM_GROUP *g;
+	for(g = m->groups; g != NULL; g = g->next)
+		expand_group(m, g);
+}
+
+/**
+ * Add the row of another thread to into.
+ */
+void comm_matrix_merge(COMM_MATRIX *into, COMM_MATRIX *from){
+	int i;
+
+	expand_groups(from);
+	for(i = 0; i < from->capacity; i++){
+		if(from->dest != NULL && from->dest[i] >= 0)
+			add(into, from->dest[i], from->messages[i], from->bytes[i]);
+		else if(from->dest == NULL && from->messages[i] > 0)
+			add(into, i, from->messages[i], from->bytes[i]);
+	}
+}
+
+static int compare_entries(const void *a, const void *b){
+	int64_t ca = ((const ENTRY*)a)->col, cb = ((const ENTRY*)b)->col;
+	return (ca > cb) - (ca < cb);
+}
+
+/**
+ * Write the rows of all processes of comm into file, the row of each
+ * process at its rank. Collective over comm.
+ * @return MPI_SUCCESS or the error of MPI_File_open
+ */
+int comm_matrix_write(COMM_MATRIX *m, char *file, MPI_Comm comm){
+	COMM_MATRIX_HEADER header;
+	MPI_File fh;
+	MPI_Offset base;
+	ENTRY *entries;
+	int64_t nnz = 0, offset = 0, total, ptr[2];
+	int64_t *col;
+	uint64_t *messages, *bytes;
+	int i, rank, size, err;
+
+	expand_groups(m);
+	entries = (ENTRY*)malloc(sizeof(ENTRY) * (m->capacity + 1));
+	for(i = 0; i < m->capacity; i++){
+		if(m->dest != NULL ? (m->dest[i] < 0) : (m->messages[i] == 0))
+			continue;
+		entries[nnz].col = (m->dest != NULL) ? m->dest[i] : i;
+		entries[nnz].messages = m->messages[i];
+		entries[nnz].bytes = m->bytes[i];
+		nnz++;
+	}
+	qsort(entries, nnz, sizeof(ENTRY), compare_entries);
+	col = (int64_t*)malloc(sizeof(int64_t) * (nnz + 1));
+	messages = (uint64_t*)malloc(sizeof(uint64_t) * (nnz + 1));
+	bytes = (uint64_t*)malloc(sizeof(uint64_t) * (nnz + 1));
+	for(i = 0; i < nnz; i++){
+		col[i] = entries[i].col;
+		messages[i] = entries[i].messages;
+		bytes[i] = entries[i].bytes;
+	}
+	free(entries);
+
+	PMPI_Comm_rank(comm, &rank);
+	PMPI_Comm_size(comm, &size);
+	PMPI_Exscan(&nnz, &offset, 1, MPI_INT64_T, MPI_SUM, comm);
+	if(rank == 0)
+		offset = 0;
+	PMPI_Allreduce(&nnz, &total, 1, MPI_INT64_T, MPI_SUM, comm);
+	err = PMPI_File_open(comm, file, MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &fh);
+	if(err == MPI_SUCCESS){
+		PMPI_File_set_size(fh, 0);
+		if(rank == 0){
+			memcpy(header.magic, COMM_MATRIX_MAGIC, sizeof(header.magic));
+			header.num_ranks = size;
+			header.nnz = total;
+			PMPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+		}
+		/* every rank writes its row pointer, the last one the end as well */
+		ptr[0] = offset;
+		ptr[1] = offset + nnz;
+		base = sizeof(header);
+		PMPI_File_write_at_all(fh, base + (MPI_Offset)sizeof(int64_t) * rank, ptr, (rank == size - 1) ? 2 : 1,
+				MPI_INT64_T, MPI_STATUS_IGNORE);
+		base += (MPI_Offset)sizeof(int64_t) * (size + 1);
+		PMPI_File_write_at_all(fh, base + (MPI_Offset)sizeof(int64_t) * offset, col, (int)nnz,
+				MPI_INT64_T, MPI_STATUS_IGNORE);
+		base += (MPI_Offset)sizeof(int64_t) * total;
+		PMPI_File_write_at_all(fh, base + (MPI_Offset)sizeof(uint64_t) * offset, messages, (int)nnz,
+				MPI_UINT64_T, MPI_STATUS_IGNORE);
+		base += (MPI_Offset)sizeof(uint64_t) * total;
+		PMPI_File_write_at_all(fh, base + (MPI_Offset)sizeof(uint64_t) * offset, bytes, (int)nnz,
+				MPI_UINT64_T, MPI_STATUS_IGNORE);
+		PMPI_File_close(&fh);
+	}
+	free(col);
+	free(messages);
+	free(bytes);
+	return err;
+}
+
+void comm_matrix_free(COMM_MATRIX *m){
+	COMM_GROUP *g, *next;
+	for(g = m->groups; g != NULL; g = next){
+		next = g->next;
+		free(g->world);
+		free(g);
+	}
+	free(m->dest);
+	free(m->messages);
+	free(m->bytes);
+	memset(m, 0, sizeof(COMM_MATRIX));
+}
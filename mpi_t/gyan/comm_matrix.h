@@ -0,0 +1,76 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * comm_matrix.h
+ *
+ * Rank-to-rank communication matrix, enabled by MPIT_COMM_MATRIX=<file>.
+ * Every thread counts the messages and bytes it sends per destination
+ * (MPI_COMM_WORLD rank) in its own COMM_MATRIX: a dense row when the job
+ * has at most MPIT_COMM_MATRIX_DENSE ranks (default 1024), otherwise an
+ * open-addressing hash table that only grows when it gets 70% full.
+ * Recording a message is one table update and never allocates.
+ *
+ * Collectives are attributed logically: MPI_Bcast counts one message from
+ * the root to every other rank, MPI_Allreduce one message from every rank
+ * to every other rank. They are accumulated per communicator and expanded
+ * into the row only in MPI_Finalize, or when a freed handle is reused.
+ * MPI_Comm_free invalidates only the cached groups of the freed handle;
+ * their entries are resolved again in place on the next call.
+ *
+ * The matrix is written in MPI_Finalize with MPI-IO as one compressed
+ * sparse row file, see comm_matrix_layout.h.
+ */
+#include "utility.h"
+#include "comm_matrix_layout.h"
+
+#ifndef COMM_MATRIX_H_
+#define COMM_MATRIX_H_
+
+#define DEFAULT_COMM_MATRIX_DENSE 1024
+
+/* a communicator seen by one thread, with its ranks in MPI_COMM_WORLD */
+typedef struct comm_group{
+	MPI_Comm comm;
+	unsigned int slot; // of comm in the table of freed handles
+	unsigned int epoch; // frees counted in that slot when it was resolved
+	int size, my_rank;
+	int inter; // TRUE for intercommunicators, ranks refer to the remote group
+	int *world; // NULL for MPI_COMM_WORLD
+	unsigned long long int coll_messages, coll_bytes; // to every other member
+	struct comm_group *next;
+}COMM_GROUP;
+
+typedef struct{
+	int capacity; // slots, num_ranks when dense
+	int used;
+	int *dest; // hash keys, -1 for empty slots; NULL when dense
+	unsigned long long int *messages, *bytes;
+	COMM_GROUP *groups, *last;
+}COMM_MATRIX;
+
+void comm_matrix_setup(int num_ranks, int dense_limit);
+void comm_matrix_send(COMM_MATRIX *m, MPI_Comm comm, int dest, int count, MPI_Datatype datatype);
+void comm_matrix_collective(COMM_MATRIX *m, MPI_Comm comm, int root, int count, MPI_Datatype datatype);
+void comm_matrix_comm_freed(MPI_Comm comm);
+void comm_matrix_merge(COMM_MATRIX *into, COMM_MATRIX *from);
+int comm_matrix_write(COMM_MATRIX *m, char *file, MPI_Comm comm);
+void comm_matrix_free(COMM_MATRIX *m);
+#endif /* COMM_MATRIX_H_ */
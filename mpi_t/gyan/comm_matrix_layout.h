@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * comm_matrix_layout.h
+ *
+ * Layout of the communication matrix file Gyan writes with
+ * MPIT_COMM_MATRIX. It does not depend on MPI so that offline tools such
+ * as gyan_place can read it without linking MPI.
+ *
+ * The file is in compressed sparse row form, all integers in the byte
+ * order of the machine that wrote it:
+ *
+ *   COMM_MATRIX_HEADER  magic "GYANCSR1", num_ranks, nnz
+ *   int64  row_ptr[num_ranks + 1]   entries of rank r: [row_ptr[r], row_ptr[r+1])
+ *   int64  col[nnz]                 destination ranks, ascending in a row
+ *   uint64 messages[nnz]
+ *   uint64 bytes[nnz]
+ *
+ * Row r holds what MPI_COMM_WORLD rank r sent.
+ */
+#include <stdint.h>
+
+#ifndef COMM_MATRIX_LAYOUT_H_
+#define COMM_MATRIX_LAYOUT_H_
+
+#define COMM_MATRIX_MAGIC "GYANCSR1"
+
+typedef struct{
+	char magic[8];
+	int64_t num_ranks;
+	int64_t nnz;
+}COMM_MATRIX_HEADER;
+#endif /* COMM_MATRIX_LAYOUT_H_ */
@@ -0,0 +1,290 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * controller.c
+ *
+ * Pvar-driven cvar feedback controller, see controller.h.
+ */
+
+#include <sys/time.h>
+#include "controller.h"
+#include "tuning_db.h"
+
+#define FALSE 0
+#define TRUE 1
+#define MAX_RULES 32
+#define NUM_RULE_FIELDS 6
+#define LOG_NAME_SZ 256
+
+#define STATE_UNSET 0
+#define STATE_LOW 1
+#define STATE_HIGH 2
+
+typedef struct{
+	char pvar[TUNING_DB_NAME_SZ];
+	int watched; // index into Gyan's watched pvars
+	unsigned long long int high, low;
+	char cvar[TUNING_DB_NAME_SZ];
+	MPI_T_cvar_handle handle;
+	MPI_Datatype datatype;
+	int scope;
+	int sync; // TRUE if all ranks have to agree on the value
+	char value_str[3][TUNING_DB_VALUE_SZ]; // indexed by STATE_*, STATE_UNSET holds the initial value
+	double value[3];
+	int state;
+}CONTROL_RULE;
+
+static CONTROL_RULE rules[MAX_RULES];
+static int num_rules = 0;
+static int num_sync_rules = 0;
+static int *votes_in, *votes_out;
+static int my_rank, num_ranks;
+static double start_time;
+static FILE *log_fp;
+
+static int setup_cvar(CONTROL_RULE *r){
+	int index, namelen, desclen, verb, bind, count, err;
+	char name[TUNING_DB_NAME_SZ];
+	char desc[256];
+	MPI_T_enum enumtype;
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	index = cvar_get_index_by_name(r->cvar);
+	if(index < 0)
+		return -1;
+	namelen = TUNING_DB_NAME_SZ;
+	desclen = sizeof(desc);
+	MPI_T_cvar_get_info(index, name, &namelen, &verb, &r->datatype, &enumtype,
+			desc, &desclen, &bind, &r->scope);
+	if(r->scope == MPI_T_SCOPE_CONSTANT || r->scope == MPI_T_SCOPE_READONLY ||
+			r->datatype == MPI_CHAR)
+		return -1;
+	if(cvar_parse_string(r->datatype, enumtype, r->value_str[STATE_HIGH], &r->value[STATE_HIGH]) != MPI_SUCCESS ||
+			cvar_parse_string(r->datatype, enumtype, r->value_str[STATE_LOW], &r->value[STATE_LOW]) != MPI_SUCCESS)
+		return -1;
+	if(bind == MPI_T_BIND_NO_OBJECT)
+		err = MPI_T_cvar_handle_alloc(index, NULL, &r->handle, &count);
+	else if(bind == MPI_T_BIND_MPI_COMM)
+		err = MPI_T_cvar_handle_alloc(index, &comm, &r->handle, &count);
+	else
+		err = MPI_T_ERR_INVALID;
+	if(err != MPI_SUCCESS || count != 1)
+		return -1;
+	cvar_read_string(r->handle, r->datatype, r->value_str[STATE_UNSET], TUNING_DB_VALUE_SZ);
+	r->sync = (r->scope != MPI_T_SCOPE_LOCAL);
+	return 0;
+}
+
+static int parse_rule(char *spec, CONTROL_RULE *r){
+	char *field[NUM_RULE_FIELDS];
+	char *save;
+	int n = 0;
+
+	for(field[n] = strtok_r(spec, ":", &save); field[n] != NULL && n < NUM_RULE_FIELDS - 1; )
+		field[++n] = strtok_r(NULL, ":", &save);
+	if(n != NUM_RULE_FIELDS - 1 || field[n] == NULL)
+		return -1;
+	memset(r, 0, sizeof(CONTROL_RULE));
+	strncpy(r->pvar, field[0], TUNING_DB_NAME_SZ - 1);
+	r->high = strtoull(field[1], NULL, 0);
+	r->low = strtoull(field[2], NULL, 0);
+	strncpy(r->cvar, field[3], TUNING_DB_NAME_SZ - 1);
+	strncpy(r->value_str[STATE_HIGH], field[4], TUNING_DB_VALUE_SZ - 1);
+	strncpy(r->value_str[STATE_LOW], field[5], TUNING_DB_VALUE_SZ - 1);
+	r->state = STATE_UNSET;
+	return (r->high > r->low) ? 0 : -1;
+}
+
+/**
+ * Parse the rule list and bind every rule to a watched pvar and a
+ * writable cvar. Pvar and cvar availability is per process, so the ranks
+ * agree on the rule set with one allreduce over a usable mask in spec
+ * order: a rule that cannot be bound on some rank is dropped everywhere.
+ * Must be called by all ranks.
+ * @return number of active rules
+ */
+int controller_init(char *spec, int rank, controller_resolve_fn resolve){
+	char *p, *save, *log_prefix;
+	char *copy = strdup(spec);
+	char log_name[LOG_NAME_SZ];
+	int usable_in[MAX_RULES], usable_out[MAX_RULES];
+	int i, num_specs = 0;
+	CONTROL_RULE *r;
+
+	my_rank = rank;
+	PMPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+	start_time = PMPI_Wtime();
+
+	for(p = strtok_r(copy, ";", &save); p != NULL && num_specs < MAX_RULES; p = strtok_r(NULL, ";", &save)){
+		r = &rules[num_specs];
+		usable_in[num_specs++] = FALSE;
+		if(parse_rule(p, r) != 0){
+			if(!rank)
+				printf("Controller: ignoring malformed rule %s\n", p);
+			continue;
+		}
+		r->watched = resolve(r->pvar);
+		if(r->watched < 0){
+			if(!rank)
+				printf("Controller: pvar %s is not watched, rule ignored\n", r->pvar);
+			continue;
+		}
+		if(setup_cvar(r) != 0){
+			if(!rank)
+				printf("Controller: cvar %s is not writable or values are invalid, rule ignored\n", r->cvar);
+			continue;
+		}
+		usable_in[num_specs - 1] = TRUE;
+	}
+	free(copy);
+
+	if(num_specs > 0)
+		PMPI_Allreduce(usable_in, usable_out, num_specs, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	for(i = 0; i < num_specs; i++){
+		if(!usable_out[i]){
+			if(usable_in[i]){
+				if(!rank)
+					printf("Controller: rule on %s is not usable on every rank, rule ignored\n", rules[i].cvar);
+				MPI_T_cvar_handle_free(&rules[i].handle);
+			}
+			continue;
+		}
+		rules[num_rules] = rules[i];
+		if(rules[num_rules].sync)
+			num_sync_rules++;
+		num_rules++;
+	}
+
+	if(num_sync_rules > 0){
+		votes_in = (int*)malloc(sizeof(int) * 2 * num_rules);
+		votes_out = (int*)malloc(sizeof(int) * 2 * num_rules);
+	}
+
+	log_prefix = getenv("MPIT_CONTROLLER_LOG");
+	log_fp = NULL;
+	if(log_prefix != NULL && strlen(log_prefix) > 0){
+		snprintf(log_name, sizeof(log_name), "%s.%d", log_prefix, rank);
+		log_fp = fopen(log_name, "w");
+	}
+	if(log_fp == NULL)
+		log_fp = stderr;
+
+	if(!rank){
+		printf("Controller: %d rules active (%d require agreement across ranks)\n", num_rules, num_sync_rules);
+		print_filled("",88,'-');
+	}
+	return num_rules;
+}
+
+int controller_has_sync_rules(){
+	return (num_sync_rules > 0);
+}
+
+/**
+ * Hysteresis: propose a new state from the current value.
+ * @return the proposed state or STATE_UNSET if nothing changes
+ */
+static int propose(CONTROL_RULE *r, unsigned long long int v){
+	if(v > r->high && r->state != STATE_HIGH)
+		return STATE_HIGH;
+	if(v < r->low && r->state != STATE_LOW)
+		return STATE_LOW;
+	return STATE_UNSET;
+}
+
+static void adjust(CONTROL_RULE *r, int state, unsigned long long int v){
+	struct timeval tv;
+	int err = MPI_T_cvar_write(r->handle, &r->value[state]);
+
+	gettimeofday(&tv, NULL);
+	fprintf(log_fp, "[gyan-controller] %ld.%06ld t=%.6lf rank=%d %s=%llu %s %s: %s -> %s%s\n",
+			(long)tv.tv_sec, (long)tv.tv_usec, PMPI_Wtime() - start_time, my_rank,
+			r->pvar, v, (state == STATE_HIGH) ? "above" : "below", r->cvar,
+			r->value_str[r->state], r->value_str[state],
+			(err == MPI_SUCCESS) ? "" : " (write failed)");
+	if(err == MPI_SUCCESS)
+		r->state = state;
+}
+
+/**
+ * Evaluate the rules on LOCAL cvars. Called from Gyan's sampling path
+ * right after the pvars were read; never communicates.
+ */
+void controller_evaluate_local(controller_value_fn value){
+	int i, state;
+	unsigned long long int v;
+	for(i = 0; i < num_rules; i++){
+		if(rules[i].sync)
+			continue;
+		v = value(rules[i].watched);
+		state = propose(&rules[i], v);
+		if(state != STATE_UNSET)
+			adjust(&rules[i], state, v);
+	}
+}
+
+/**
+ * Evaluate the rules that need agreement with one allreduce over
+ * MPI_COMM_WORLD. A change is made only if a majority of the ranks
+ * proposes it, and then by all ranks. Must be called by all ranks at the
+ * same point of execution.
+ */
+void controller_evaluate_sync(controller_value_fn value){
+	int i, state;
+	unsigned long long int v;
+
+	if(num_sync_rules == 0)
+		return;
+	for(i = 0; i < num_rules; i++){
+		votes_in[2 * i] = votes_in[2 * i + 1] = 0;
+		if(!rules[i].sync)
+			continue;
+		state = propose(&rules[i], value(rules[i].watched));
+		if(state == STATE_HIGH)
+			votes_in[2 * i] = 1;
+		else if(state == STATE_LOW)
+			votes_in[2 * i + 1] = 1;
+	}
+	PMPI_Allreduce(votes_in, votes_out, 2 * num_rules, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+	for(i = 0; i < num_rules; i++){
+		if(!rules[i].sync)
+			continue;
+		v = value(rules[i].watched);
+		if(2 * votes_out[2 * i] > num_ranks && rules[i].state != STATE_HIGH)
+			adjust(&rules[i], STATE_HIGH, v);
+		else if(2 * votes_out[2 * i + 1] > num_ranks && rules[i].state != STATE_LOW)
+			adjust(&rules[i], STATE_LOW, v);
+	}
+}
+
+void controller_finalize(){
+	int i;
+	for(i = 0; i < num_rules; i++)
+		MPI_T_cvar_handle_free(&rules[i].handle);
+	num_rules = 0;
+	num_sync_rules = 0;
+	free(votes_in);
+	free(votes_out);
+	votes_in = votes_out = NULL;
+	if(log_fp != NULL && log_fp != stderr)
+		fclose(log_fp);
+	log_fp = NULL;
+}
@@ -0,0 +1,52 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * controller.h
+ *
+ * Feedback controller that adjusts writable cvars from sampled pvar
+ * values. Rules are read from MPIT_CONTROLLER, separated by ';':
+ *
+ *   <pvar>:<high>:<low>:<cvar>:<value above high>:<value below low>
+ *
+ * A rule switches its cvar to the "high" value once the pvar exceeds
+ * <high> and back to the "low" value once it drops below <low>; values in
+ * between keep the current setting (hysteresis).
+ *
+ * Rules on cvars with LOCAL scope are evaluated by every rank on its own
+ * samples. Rules on cvars whose scope requires agreement (GROUP, GROUP_EQ,
+ * ALL, ALL_EQ) are decided by majority vote with one allreduce, and only
+ * from wrappers of collectives on MPI_COMM_WORLD where all ranks are known
+ * to arrive in the same order.
+ */
+#include "utility.h"
+
+#ifndef CONTROLLER_H_
+#define CONTROLLER_H_
+
+typedef int (*controller_resolve_fn)(char *pvar_name);
+typedef unsigned long long int (*controller_value_fn)(int watched_index);
+
+int controller_init(char *spec, int rank, controller_resolve_fn resolve);
+int controller_has_sync_rules();
+void controller_evaluate_local(controller_value_fn value);
+void controller_evaluate_sync(controller_value_fn value);
+void controller_finalize();
+#endif /* CONTROLLER_H_ */
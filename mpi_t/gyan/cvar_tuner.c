@@ -0,0 +1,471 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * cvar_tuner.c
+ *
+ * Sweeps writable control variables over a set of values, runs the OSU
+ * bandwidth or collective latency kernel in-process for every combination
+ * and records the best combination per message size in a tuning database.
+ */
+
+#include <getopt.h>
+#include <limits.h>
+#include "tuning_db.h"
+
+#define FALSE 0
+#define TRUE 1
+#define MAX_VALUES 64
+#define MAX_SIZES 32
+#define DEFAULT_MAX_MSG_SIZE (1 << 20)
+#define DEFAULT_DB_FILE "gyan_tuning.db"
+#define WINDOW_SIZE 64
+#define SKIP 10
+
+#define KERNEL_BW 0
+#define KERNEL_BCAST 1
+#define KERNEL_ALLREDUCE 2
+
+typedef struct{
+	char name[TUNING_DB_NAME_SZ];
+	int index;
+	MPI_Datatype datatype;
+	MPI_T_enum enumtype;
+	int bind;
+	int scope;
+	MPI_T_cvar_handle handle;
+	char original[TUNING_DB_VALUE_SZ];
+	int num_values;
+	char values[MAX_VALUES][TUNING_DB_VALUE_SZ];
+}TUNED_CVAR;
+
+static TUNED_CVAR tuned[TUNING_DB_MAX_CVARS];
+static int num_tuned = 0;
+static int rank = 0;
+static int num_mpi_tasks;
+static int kernel = KERNEL_BCAST;
+static char *kernel_name[] = { "bw", "bcast", "allreduce" };
+static unsigned long long int max_msg_size = DEFAULT_MAX_MSG_SIZE;
+static int iterations = 100;
+static char *db_file = DEFAULT_DB_FILE;
+static char *s_buf, *r_buf;
+static MPI_Request request[WINDOW_SIZE];
+
+static void usage(int e){
+	if(rank == 0){
+		printf("Usage: cvar_tuner -c <cvar>=<values> [-c ...] [-k <kernel>] [-m <size>] [-i <iter>] [-o <file>]\n");
+		printf("    -c = Control variable and the values to sweep, given as a list\n");
+		printf("         (name=1,2,3), a linear range (name=lo:hi:step) or a\n");
+		printf("         geometric range (name=lo:hi:x2). Up to %d cvars.\n", TUNING_DB_MAX_CVARS);
+		printf("    -k = Kernel to run: bw, bcast or allreduce (default bcast)\n");
+		printf("    -m = Maximum message size in bytes, up to %d (default %d)\n", INT_MAX, DEFAULT_MAX_MSG_SIZE);
+		printf("    -i = Iterations per message size (default 100)\n");
+		printf("    -o = Tuning database to update (default %s)\n", DEFAULT_DB_FILE);
+		printf("    -h = This help text\n");
+	}
+	PMPI_Finalize();
+	exit(e);
+}
+
+/**
+ * Parse "name=values" into a TUNED_CVAR.
+ * @return 0 on success, -1 on a malformed specification
+ */
+static int parse_cvar_spec(char *spec, TUNED_CVAR *cv){
+	char *eq = strchr(spec, '=');
+	char *p, *save;
+	unsigned long long int lo, hi, step;
+	int geometric;
+
+	if(eq == NULL)
+		return -1;
+	*eq = 0;
+	strncpy(cv->name, spec, TUNING_DB_NAME_SZ - 1);
+	cv->num_values = 0;
+	p = eq + 1;
+
+	if(strchr(p, ':') != NULL){
+		char *c1 = strchr(p, ':');
+		char *c2 = strchr(c1 + 1, ':');
+		lo = strtoull(p, NULL, 0);
+		hi = strtoull(c1 + 1, NULL, 0);
+		step = 1;
+		geometric = FALSE;
+		if(c2 != NULL){
+			if(c2[1] == 'x' || c2[1] == '*'){
+				geometric = TRUE;
+				step = strtoull(c2 + 2, NULL, 0);
+			}
+			else
+				step = strtoull(c2 + 1, NULL, 0);
+		}
+		if(step == 0 || (geometric && (step < 2 || lo == 0)))
+			return -1;
+		while(lo <= hi && cv->num_values < MAX_VALUES){
+			snprintf(cv->values[cv->num_values++], TUNING_DB_VALUE_SZ, "%llu", lo);
+			lo = geometric ? lo * step : lo + step;
+		}
+	}
+	else{
+		for(p = strtok_r(p, ",", &save); p != NULL && cv->num_values < MAX_VALUES;
+				p = strtok_r(NULL, ",", &save))
+			strncpy(cv->values[cv->num_values++], p, TUNING_DB_VALUE_SZ - 1);
+	}
+	return (cv->num_values > 0) ? 0 : -1;
+}
+
+/**
+ * Look up the cvar, check it can be written and allocate its handle.
+ */
+static int setup_cvar(TUNED_CVAR *cv){
+	int namelen, desclen, verb, count, err;
+	char name[TUNING_DB_NAME_SZ];
+	char desc[256];
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	cv->index = cvar_get_index_by_name(cv->name);
+	if(cv->index < 0){
+		if(rank == 0)
+			printf("ERROR: control variable %s not found\n", cv->name);
+		return -1;
+	}
+	namelen = TUNING_DB_NAME_SZ;
+	desclen = sizeof(desc);
+	MPI_T_cvar_get_info(cv->index, name, &namelen, &verb, &cv->datatype, &cv->enumtype,
+			desc, &desclen, &cv->bind, &cv->scope);
+	if(cv->scope == MPI_T_SCOPE_CONSTANT || cv->scope == MPI_T_SCOPE_READONLY){
+		if(rank == 0)
+			printf("ERROR: control variable %s is read-only\n", cv->name);
+		return -1;
+	}
+	if(cv->bind == MPI_T_BIND_NO_OBJECT)
+		err = MPI_T_cvar_handle_alloc(cv->index, NULL, &cv->handle, &count);
+	else if(cv->bind == MPI_T_BIND_MPI_COMM)
+		err = MPI_T_cvar_handle_alloc(cv->index, &comm, &cv->handle, &count);
+	else
+		err = MPI_T_ERR_INVALID;
+	if(err != MPI_SUCCESS ||
+			(cv->datatype == MPI_CHAR ? count >= TUNING_DB_VALUE_SZ : count != 1)){
+		if(rank == 0)
+			printf("ERROR: control variable %s cannot be tuned (error %d)\n", cv->name, err);
+		return -1;
+	}
+	if(cv->datatype == MPI_CHAR)
+		err = MPI_T_cvar_read(cv->handle, cv->original);
+	else
+		err = cvar_read_string(cv->handle, cv->datatype, cv->original, TUNING_DB_VALUE_SZ);
+	return (err == MPI_SUCCESS) ? 0 : -1;
+}
+
+/**
+ * Apply one combination on every rank.
+ * @return TRUE if all ranks accepted all writes
+ */
+static int apply_combination(int *choice){
+	int i, err, ok = TRUE, all_ok;
+	for(i = 0; i < num_tuned; i++){
+		err = cvar_write_string(tuned[i].handle, tuned[i].datatype, tuned[i].enumtype,
+				tuned[i].values[choice[i]]);
+		if(err != MPI_SUCCESS)
+			ok = FALSE;
+	}
+	PMPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+	return all_ok;
+}
+
+static void restore_cvars(){
+	int i;
+	for(i = 0; i < num_tuned; i++){
+		cvar_write_string(tuned[i].handle, tuned[i].datatype, tuned[i].enumtype, tuned[i].original);
+		MPI_T_cvar_handle_free(&tuned[i].handle);
+	}
+}
+
+/**
+ * OSU bandwidth kernel between ranks 0 and 1.
+ * @return bandwidth in MB/s on rank 0
+ */
+static double run_bw(int size){
+	int i, j;
+	double t_start = 0.0, elapsed;
+	int loop = (size > 8192) ? iterations / 5 + 1 : iterations;
+
+	if(rank == 0){
+		for(i = 0; i < loop + SKIP; i++){
+			if(i == SKIP)
+				t_start = PMPI_Wtime();
+			for(j = 0; j < WINDOW_SIZE; j++)
+				PMPI_Isend(s_buf, size, MPI_CHAR, 1, 100, MPI_COMM_WORLD, &request[j]);
+			PMPI_Waitall(WINDOW_SIZE, request, MPI_STATUSES_IGNORE);
+			PMPI_Recv(r_buf, 4, MPI_CHAR, 1, 101, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		}
+		elapsed = PMPI_Wtime() - t_start;
+		return ((double)size / 1e6 * loop * WINDOW_SIZE) / elapsed;
+	}
+	else if(rank == 1){
+		for(i = 0; i < loop + SKIP; i++){
+			for(j = 0; j < WINDOW_SIZE; j++)
+				PMPI_Irecv(r_buf, size, MPI_CHAR, 0, 100, MPI_COMM_WORLD, &request[j]);
+			PMPI_Waitall(WINDOW_SIZE, request, MPI_STATUSES_IGNORE);
+			PMPI_Send(s_buf, 4, MPI_CHAR, 0, 101, MPI_COMM_WORLD);
+		}
+	}
+	return 0.0;
+}
+
+/**
+ * OSU collective latency kernel.
+ * @return the maximum average latency over all ranks in us on rank 0
+ */
+static double run_collective(int size){
+	int i;
+	double t_start, timer = 0.0, latency, max_latency = 0.0;
+	int count = size / sizeof(float); // allreduce sizes start at one float
+
+	for(i = 0; i < iterations + SKIP; i++){
+		t_start = PMPI_Wtime();
+		if(kernel == KERNEL_BCAST)
+			PMPI_Bcast(s_buf, size, MPI_CHAR, 0, MPI_COMM_WORLD);
+		else
+			PMPI_Allreduce(s_buf, r_buf, count, MPI_FLOAT, MPI_SUM, MPI_COMM_WORLD);
+		if(i >= SKIP)
+			timer += PMPI_Wtime() - t_start;
+		PMPI_Barrier(MPI_COMM_WORLD);
+	}
+	latency = (timer * 1e6) / iterations;
+	PMPI_Reduce(&latency, &max_latency, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+	return max_latency;
+}
+
+/**
+ * Fill in the metric the kernel does not measure: the time per message
+ * of the bw kernel and the throughput of a collective.
+ */
+static void derive_metrics(int size, double *bandwidth, double *latency){
+	if(kernel == KERNEL_BW)
+		*latency = (*bandwidth > 0) ? size / *bandwidth : 0; // bytes / (MB/s) = us
+	else
+		*bandwidth = (*latency > 0) ? size / *latency : 0; // bytes / us = MB/s
+}
+
+static int better(double a, double b){
+	return (kernel == KERNEL_BW) ? (a > b) : (a < b);
+}
+
+static void print_combination(int *choice){
+	int i;
+	for(i = 0; i < num_tuned; i++)
+		printf("%s%s=%s", (i > 0) ? " " : "", tuned[i].name, tuned[i].values[choice[i]]);
+}
+
+int main(int argc, char *argv[]){
+	int opt, i, j, s, errarg = 0;
+	unsigned long long int size, first_size, buf_size;
+	int num_sizes, num_comb, comb, nodes;
+	int sizes[MAX_SIZES];
+	int choice[TUNING_DB_MAX_CVARS];
+	int *valid;
+	double *bandwidth, *latency, *metric;
+	int *best;
+	int threadsup;
+	char libversion[MPI_MAX_LIBRARY_VERSION_STRING];
+	int libversionlen;
+	TUNING_DB db;
+	TUNING_ENTRY entry;
+
+	PMPI_Init(&argc, &argv);
+	PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	PMPI_Comm_size(MPI_COMM_WORLD, &num_mpi_tasks);
+	MPI_T_init_thread(MPI_THREAD_SINGLE, &threadsup);
+
+	while((opt = getopt(argc, argv, "hc:k:m:i:o:")) != -1){
+		switch(opt){
+		case 'c':
+			if(num_tuned == TUNING_DB_MAX_CVARS || parse_cvar_spec(optarg, &tuned[num_tuned]) != 0)
+				errarg = 1;
+			else
+				num_tuned++;
+			break;
+		case 'k':
+			for(kernel = KERNEL_ALLREDUCE; kernel > KERNEL_BW; kernel--)
+				if(strcmp(optarg, kernel_name[kernel]) == 0)
+					break;
+			if(strcmp(optarg, kernel_name[kernel]) != 0)
+				errarg = 1;
+			break;
+		case 'm':
+			max_msg_size = strtoull(optarg, NULL, 0);
+			if(max_msg_size == 0 || max_msg_size > INT_MAX) // the kernels take an int count
+				errarg = 1;
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			if(iterations <= 0)
+				errarg = 1;
+			break;
+		case 'o':
+			db_file = optarg;
+			break;
+		case 'h':
+		default:
+			errarg = 1;
+			break;
+		}
+	}
+	if(errarg || num_tuned == 0)
+		usage(1);
+	first_size = (kernel == KERNEL_ALLREDUCE) ? sizeof(float) : 1;
+	if(max_msg_size < first_size){
+		if(rank == 0)
+			printf("ERROR: the allreduce kernel needs a maximum message size of at least %d bytes\n", (int)sizeof(float));
+		usage(1);
+	}
+	if(kernel == KERNEL_BW && num_mpi_tasks < 2){
+		if(rank == 0)
+			printf("ERROR: the bw kernel requires at least two processes\n");
+		usage(1);
+	}
+	for(i = 0; i < num_tuned; i++)
+		if(setup_cvar(&tuned[i]) != 0)
+			usage(1);
+
+	num_sizes = 0;
+	for(size = first_size; size <= max_msg_size && num_sizes < MAX_SIZES; size *= 2)
+		sizes[num_sizes++] = (int)size;
+	num_comb = 1;
+	for(i = 0; i < num_tuned; i++)
+		num_comb *= tuned[i].num_values;
+
+	/* room for the 4-byte acknowledgement of the bw kernel as well */
+	buf_size = (max_msg_size < sizeof(float)) ? sizeof(float) : max_msg_size;
+	s_buf = (char*)malloc(buf_size);
+	r_buf = (char*)malloc(buf_size);
+	memset(s_buf, 1, buf_size);
+	valid = (int*)malloc(sizeof(int) * num_comb);
+	bandwidth = (double*)malloc(sizeof(double) * num_comb * num_sizes);
+	latency = (double*)malloc(sizeof(double) * num_comb * num_sizes);
+	metric = (kernel == KERNEL_BW) ? bandwidth : latency; // what the best settings are picked by
+	best = (int*)malloc(sizeof(int) * num_sizes);
+	nodes = tuning_db_count_nodes(MPI_COMM_WORLD);
+
+	if(rank == 0){
+		print_filled("",88,'-');
+		printf("Tuning %d combinations with kernel %s on %d ranks, %d nodes\n",
+				num_comb, kernel_name[kernel], num_mpi_tasks, nodes);
+		print_filled("",88,'-');
+	}
+
+	/* Sweep all combinations in mixed-radix order */
+	memset(choice, 0, sizeof(choice));
+	for(comb = 0; comb < num_comb; comb++){
+		valid[comb] = apply_combination(choice);
+		if(rank == 0){
+			printf("[%4d/%d] ", comb + 1, num_comb);
+			print_combination(choice);
+			printf("%s\n", valid[comb] ? "" : " (rejected by the library)");
+			fflush(stdout);
+		}
+		if(valid[comb]){
+			PMPI_Barrier(MPI_COMM_WORLD);
+			for(s = 0; s < num_sizes; s++){
+				if(kernel == KERNEL_BW)
+					bandwidth[comb * num_sizes + s] = run_bw(sizes[s]);
+				else
+					latency[comb * num_sizes + s] = run_collective(sizes[s]);
+				derive_metrics(sizes[s], &bandwidth[comb * num_sizes + s], &latency[comb * num_sizes + s]);
+				if(rank == 0)
+					printf("           %12d bytes %12.2lf MB/s %12.2lf us\n", sizes[s],
+							bandwidth[comb * num_sizes + s], latency[comb * num_sizes + s]);
+			}
+		}
+		for(i = num_tuned - 1; i >= 0; i--){
+			if(++choice[i] < tuned[i].num_values)
+				break;
+			choice[i] = 0;
+		}
+	}
+	restore_cvars();
+
+	if(rank == 0){
+		/* Pick the best combination per message size */
+		for(s = 0; s < num_sizes; s++){
+			best[s] = -1;
+			for(comb = 0; comb < num_comb; comb++){
+				if(valid[comb] && (best[s] < 0 ||
+						better(metric[comb * num_sizes + s], metric[best[s] * num_sizes + s])))
+					best[s] = comb;
+			}
+		}
+
+		PMPI_Get_library_version(libversion, &libversionlen);
+		tuning_db_init(&db);
+		tuning_db_load(db_file, &db);
+		memset(&entry, 0, sizeof(entry));
+		entry.lib_hash = tuning_db_library_hash(libversion, libversionlen);
+		entry.nodes = nodes;
+		entry.ranks = num_mpi_tasks;
+		strcpy(entry.kernel, kernel_name[kernel]);
+		tuning_db_remove_key(&db, entry.lib_hash, nodes, num_mpi_tasks, entry.kernel);
+
+		printf("%-12s %-12s %12s %12s  %s\n", "Min Size", "Max Size", "MB/s", "Latency(us)", "Best settings");
+		print_filled("",88,'-');
+		/* Coalesce consecutive sizes with the same winner into one range */
+		for(s = 0; s < num_sizes; s = j){
+			for(j = s + 1; j < num_sizes && best[j] == best[s]; j++)
+				;
+			if(best[s] < 0)
+				continue;
+			entry.min_size = (s == 0) ? 0 : sizes[s];
+			entry.max_size = (j == num_sizes) ? max_msg_size : (unsigned long long int)(sizes[j] - 1);
+			entry.metric = metric[best[s] * num_sizes + s];
+			comb = best[s];
+			for(i = num_tuned - 1; i >= 0; i--){
+				choice[i] = comb % tuned[i].num_values;
+				comb /= tuned[i].num_values;
+			}
+			entry.num_settings = num_tuned;
+			for(i = 0; i < num_tuned; i++){
+				strcpy(entry.settings[i].name, tuned[i].name);
+				strcpy(entry.settings[i].value, tuned[i].values[choice[i]]);
+			}
+			tuning_db_add(&db, &entry);
+			printf("%-12llu %-12llu %12.2lf %12.2lf  ", entry.min_size, entry.max_size,
+					bandwidth[best[s] * num_sizes + s], latency[best[s] * num_sizes + s]);
+			print_combination(choice);
+			printf("\n");
+		}
+		print_filled("",88,'-');
+		if(tuning_db_save(db_file, &db, libversion) != 0)
+			printf("ERROR: cannot write tuning database %s\n", db_file);
+		else
+			printf("Tuning database written to %s\n", db_file);
+		tuning_db_free(&db);
+	}
+
+	free(s_buf);
+	free(r_buf);
+	free(valid);
+	free(bandwidth);
+	free(latency);
+	free(best);
+	MPI_T_finalize();
+	PMPI_Finalize();
+	return 0;
+}
@@ -0,0 +1,390 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * events.c
+ *
+ * MPI_T event capture into per-thread rings, see events.h.
+ */
+
+#include "events.h"
+
+#define FALSE 0
+#define TRUE 1
+#define STR_SZ 256
+#define LOG_NAME_SZ 256
+#define DEFAULT_RING_SIZE 1024 // slots per thread, power of two
+#define DEFAULT_NUM_RINGS 16 // threads that can record events
+#define EVENT_PAYLOAD_SZ 64 // payload bytes kept per event
+#define MAX_EVENT_ELEMENTS 16
+#define CACHE_LINE 64
+
+#if MPI_VERSION >= 4
+
+typedef struct{
+	int index;
+	char name[STR_SZ];
+	int num_elements;
+	MPI_Datatype datatypes[MAX_EVENT_ELEMENTS];
+	MPI_Aint displacements[MAX_EVENT_ELEMENTS];
+	int copy_size; // bytes written by MPI_T_event_copy
+	int num_kept; // elements that fit into the slot when copy_size is too large
+	MPI_T_event_registration registration;
+	unsigned long long int dropped_by_mpi; // reported by the dropped handler
+}EVENT_TYPE;
+
+typedef struct{
+	EVENT_TYPE *type;
+	MPI_Count timestamp;
+	int source;
+	int truncated;
+	char payload[EVENT_PAYLOAD_SZ];
+}EVENT_SLOT;
+
+/* Single producer (the owning thread), single consumer (the drain) */
+typedef struct{
+	unsigned long long int head; // written by the producer only
+	char pad0[CACHE_LINE - sizeof(unsigned long long int)];
+	unsigned long long int tail; // written by the consumer only
+	char pad1[CACHE_LINE - sizeof(unsigned long long int)];
+	unsigned long long int dropped; // ring full, written by the producer only
+	EVENT_SLOT *slots;
+}EVENT_RING;
+
+static EVENT_TYPE *event_types;
+static int num_event_types = 0;
+static EVENT_RING *rings;
+static int num_rings;
+static int next_ring = 0; // rings claimed so far, may exceed num_rings
+static unsigned long long int ring_mask;
+static unsigned long long int dropped_no_ring = 0;
+static int draining = 0;
+static unsigned long long int drained = 0;
+static int num_freed = 0; // registrations MPI has released
+static FILE *trace_fp;
+static int my_rank;
+
+/* initial-exec keeps the first access from a new thread free of allocation */
+static __thread EVENT_RING *thread_ring __attribute__((tls_model("initial-exec")));
+static EVENT_RING no_ring; // marks threads that found all rings taken
+
+/**
+ * Event callback. Runs on MPI's internal paths, possibly in signal
+ * context: only atomics and the MPI_T_event accessors are used.
+ */
+static void event_callback(MPI_T_event_instance instance, MPI_T_event_registration registration,
+		MPI_T_cb_safety safety, void *user_data){
+	EVENT_TYPE *type = (EVENT_TYPE*)user_data;
+	EVENT_RING *r = thread_ring;
+	EVENT_SLOT *slot;
+	unsigned long long int head, tail;
+	int i, id;
+
+	if(r == NULL){
+		id = __atomic_fetch_add(&next_ring, 1, __ATOMIC_RELAXED);
+		r = thread_ring = (id < num_rings) ? &rings[id] : &no_ring;
+	}
+	if(r == &no_ring){
+		__atomic_fetch_add(&dropped_no_ring, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	head = r->head;
+	tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	if(head - tail > ring_mask){
+		__atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+		return;
+	}
+	slot = &r->slots[head & ring_mask];
+	slot->type = type;
+	slot->truncated = (type->num_kept < type->num_elements);
+	MPI_T_event_get_timestamp(instance, &slot->timestamp);
+	if(MPI_T_event_get_source(instance, &slot->source) != MPI_SUCCESS)
+		slot->source = -1;
+	if(!slot->truncated)
+		MPI_T_event_copy(instance, slot->payload);
+	else
+		for(i = 0; i < type->num_kept; i++)
+			MPI_T_event_read(instance, i, slot->payload + type->displacements[i]);
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void event_dropped(MPI_Count count, MPI_T_event_registration registration,
+		int source, MPI_T_cb_safety safety, void *user_data){
+	EVENT_TYPE *type = (EVENT_TYPE*)user_data;
+	__atomic_fetch_add(&type->dropped_by_mpi, (unsigned long long int)count, __ATOMIC_RELAXED);
+}
+
+static void event_freed(MPI_T_event_registration registration, MPI_T_cb_safety safety, void *user_data){
+	if(user_data != NULL) // NULL for registrations whose callback was never set
+		__atomic_fetch_add(&num_freed, 1, __ATOMIC_RELEASE);
+}
+
+static int selected(char *spec, char *name){
+	char *copy, *p, *save;
+	int found = FALSE;
+	if(strcmp(spec, "all") == 0)
+		return TRUE;
+	copy = strdup(spec);
+	for(p = strtok_r(copy, ";", &save); p != NULL && !found; p = strtok_r(NULL, ";", &save))
+		found = (strcmp(p, name) == 0);
+	free(copy);
+	return found;
+}
+
+/**
+ * Query the layout of an event type and register the callback.
+ * @return 0 on success
+ */
+static int setup_event(EVENT_TYPE *type, int index, char *spec){
+	char desc[STR_SZ];
+	int namelen, desclen, verb, bind, num, size, i, end;
+	MPI_T_enum enumtype;
+	MPI_Info info;
+	MPI_Comm comm = MPI_COMM_WORLD;
+
+	namelen = STR_SZ;
+	desclen = STR_SZ;
+	num = MAX_EVENT_ELEMENTS; // returns the real number, even if larger
+	if(MPI_T_event_get_info(index, type->name, &namelen, &verb, type->datatypes, type->displacements,
+			&num, &enumtype, &info, desc, &desclen, &bind) != MPI_SUCCESS)
+		return -1;
+	if(info != MPI_INFO_NULL)
+		MPI_Info_free(&info);
+	if(!selected(spec, type->name) || num > MAX_EVENT_ELEMENTS)
+		return -1;
+
+	type->index = index;
+	type->num_elements = num;
+	type->copy_size = 0;
+	type->num_kept = 0;
+	for(i = 0; i < num; i++){
+		MPI_Type_size(type->datatypes[i], &size);
+		end = (int)type->displacements[i] + size;
+		if(end > type->copy_size)
+			type->copy_size = end;
+		if(end <= EVENT_PAYLOAD_SZ && type->num_kept == i)
+			type->num_kept = i + 1;
+	}
+	if(type->copy_size <= EVENT_PAYLOAD_SZ)
+		type->num_kept = num;
+
+	if(bind == MPI_T_BIND_NO_OBJECT){
+		if(MPI_T_event_handle_alloc(index, NULL, MPI_INFO_NULL, &type->registration) != MPI_SUCCESS)
+			return -1;
+	}
+	else if(bind == MPI_T_BIND_MPI_COMM){
+		if(MPI_T_event_handle_alloc(index, &comm, MPI_INFO_NULL, &type->registration) != MPI_SUCCESS)
+			return -1;
+	}
+	else
+		return -1;
+	if(MPI_T_event_register_callback(type->registration, MPI_T_CB_REQUIRE_ASYNC_SIGNAL_SAFE,
+			MPI_INFO_NULL, type, event_callback) != MPI_SUCCESS){
+		MPI_T_event_handle_free(type->registration, NULL, event_freed);
+		return -1;
+	}
+	MPI_T_event_set_dropped_handler(type->registration, event_dropped);
+	return 0;
+}
+
+static void write_sources(){
+	char name[STR_SZ], desc[STR_SZ];
+	int i, num, namelen, desclen;
+	MPI_T_source_order ordering;
+	MPI_Count ticks, max_ticks;
+	MPI_Info info;
+
+	if(MPI_T_source_get_num(&num) != MPI_SUCCESS)
+		return;
+	for(i = 0; i < num; i++){
+		namelen = desclen = STR_SZ;
+		if(MPI_T_source_get_info(i, name, &namelen, desc, &desclen, &ordering,
+				&ticks, &max_ticks, &info) != MPI_SUCCESS)
+			continue;
+		if(info != MPI_INFO_NULL)
+			MPI_Info_free(&info);
+		fprintf(trace_fp, "# source %d %s ticks_per_second=%lld %s\n", i, name, (long long)ticks,
+				(ordering == MPI_T_SOURCE_ORDERED) ? "ordered" : "unordered");
+	}
+}
+
+/**
+ * Enumerate event types, register callbacks for the selected ones and
+ * preallocate the rings.
+ * @return number of event types registered
+ */
+int events_init(char *spec, int rank){
+	int num, i;
+	char name[LOG_NAME_SZ];
+	char *prefix;
+
+	my_rank = rank;
+	if(MPI_T_event_get_num(&num) != MPI_SUCCESS || num <= 0){
+		if(!rank)
+			printf("Events: the MPI library exposes no event types\n");
+		return 0;
+	}
+
+	num_rings = DEFAULT_NUM_RINGS;
+	if(getenv("MPIT_EVENT_THREADS") != NULL && atoi(getenv("MPIT_EVENT_THREADS")) > 0)
+		num_rings = atoi(getenv("MPIT_EVENT_THREADS"));
+	ring_mask = DEFAULT_RING_SIZE;
+	if(getenv("MPIT_EVENT_RING_SIZE") != NULL && atoi(getenv("MPIT_EVENT_RING_SIZE")) > 0)
+		for(ring_mask = 1; ring_mask < (unsigned long long int)atoi(getenv("MPIT_EVENT_RING_SIZE")); ring_mask <<= 1);
+	rings = (EVENT_RING*)calloc(num_rings, sizeof(EVENT_RING));
+	for(i = 0; i < num_rings; i++)
+		rings[i].slots = (EVENT_SLOT*)calloc(ring_mask, sizeof(EVENT_SLOT));
+	ring_mask--;
+
+	prefix = getenv("MPIT_EVENT_TRACE");
+	snprintf(name, sizeof(name), "%s.%d", (prefix != NULL && strlen(prefix) > 0) ? prefix : "gyan_events", rank);
+	trace_fp = fopen(name, "w");
+	if(trace_fp == NULL)
+		trace_fp = stderr;
+	fprintf(trace_fp, "# Gyan MPI_T event trace, rank %d\n", rank);
+	fprintf(trace_fp, "# timestamp source event values...\n");
+	write_sources();
+
+	/* the rings must exist before the first callback can fire */
+	event_types = (EVENT_TYPE*)calloc(num, sizeof(EVENT_TYPE));
+	for(i = 0; i < num; i++)
+		if(setup_event(&event_types[num_event_types], i, spec) == 0)
+			num_event_types++;
+
+	if(!rank){
+		printf("Events: %d of %d event types registered, %d rings of %llu slots\n",
+				num_event_types, num, num_rings, ring_mask + 1);
+		print_filled("",88,'-');
+	}
+	return num_event_types;
+}
+
+static void write_element(MPI_Datatype datatype, char *p){
+	if(datatype == MPI_INT)
+		fprintf(trace_fp, " %d", *(int*)p);
+	else if(datatype == MPI_UNSIGNED)
+		fprintf(trace_fp, " %u", *(unsigned int*)p);
+	else if(datatype == MPI_UNSIGNED_LONG)
+		fprintf(trace_fp, " %lu", *(unsigned long*)p);
+	else if(datatype == MPI_UNSIGNED_LONG_LONG)
+		fprintf(trace_fp, " %llu", *(unsigned long long*)p);
+	else if(datatype == MPI_COUNT)
+		fprintf(trace_fp, " %lld", (long long)*(MPI_Count*)p);
+	else if(datatype == MPI_AINT)
+		fprintf(trace_fp, " %ld", (long)*(MPI_Aint*)p);
+	else if(datatype == MPI_DOUBLE)
+		fprintf(trace_fp, " %lf", *(double*)p);
+	else if(datatype == MPI_CHAR)
+		fprintf(trace_fp, " %c", *p);
+	else
+		fprintf(trace_fp, " ?");
+}
+
+/**
+ * Flush all rings to the trace. Only one thread drains at a time, a
+ * concurrent caller returns immediately.
+ */
+void events_drain(){
+	int i, j, n;
+	unsigned long long int head, tail;
+	EVENT_SLOT *slot;
+
+	if(num_event_types == 0 || __atomic_exchange_n(&draining, 1, __ATOMIC_ACQUIRE))
+		return;
+	n = __atomic_load_n(&next_ring, __ATOMIC_RELAXED);
+	if(n > num_rings)
+		n = num_rings;
+	for(i = 0; i < n; i++){
+		EVENT_RING *r = &rings[i];
+		tail = r->tail;
+		head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		for(; tail != head; tail++){
+			slot = &r->slots[tail & ring_mask];
+			fprintf(trace_fp, "%lld %d %s", (long long)slot->timestamp, slot->source, slot->type->name);
+			for(j = 0; j < slot->type->num_kept; j++)
+				write_element(slot->type->datatypes[j], slot->payload + slot->type->displacements[j]);
+			fprintf(trace_fp, slot->truncated ? " ...\n" : "\n");
+			drained++;
+		}
+		__atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&draining, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Free the registrations, drain what is left and report the totals.
+ * Collective over MPI_COMM_WORLD.
+ */
+void events_finalize(){
+	unsigned long long int local[3], total[3];
+	int i, num_registered;
+
+	for(i = 0; i < num_event_types; i++)
+		MPI_T_event_handle_free(event_types[i].registration, &event_types[i], event_freed);
+	events_drain();
+
+	local[0] = drained;
+	local[1] = dropped_no_ring;
+	local[2] = 0;
+	for(i = 0; i < num_rings; i++)
+		local[1] += rings[i].dropped;
+	for(i = 0; i < num_event_types; i++)
+		local[2] += event_types[i].dropped_by_mpi;
+	fprintf(trace_fp, "# recorded %llu dropped %llu dropped_by_mpi %llu\n", local[0], local[1], local[2]);
+	PMPI_Reduce(local, total, 3, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	if(!my_rank){
+		printf("Events: %llu recorded, %llu dropped (ring full), %llu dropped by MPI\n",
+				total[0], total[1], total[2]);
+		print_filled("",88,'-');
+	}
+
+	if(trace_fp != NULL && trace_fp != stderr)
+		fclose(trace_fp);
+	trace_fp = NULL;
+	num_registered = num_event_types;
+	num_event_types = 0;
+	/* callbacks may still run until MPI released every registration */
+	if(__atomic_load_n(&num_freed, __ATOMIC_ACQUIRE) < num_registered)
+		return;
+	for(i = 0; i < num_rings; i++)
+		free(rings[i].slots);
+	free(rings);
+	free(event_types);
+	rings = NULL;
+	event_types = NULL;
+}
+
+#else /* MPI_VERSION < 4 */
+
+int events_init(char *spec, int rank){
+	if(!rank){
+		printf("Events: MPI_T events need an MPI 4.0 library, MPIT_EVENTS ignored\n");
+		print_filled("",88,'-');
+	}
+	return 0;
+}
+
+void events_drain(){
+}
+
+void events_finalize(){
+}
+
+#endif /* MPI_VERSION */
@@ -0,0 +1,42 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * events.h
+ *
+ * Capture of MPI_T events (MPI 4.0). Event types named in MPIT_EVENTS
+ * (separated by ';', or "all") get a callback that copies the payload
+ * and the timestamp into a ring buffer owned by the calling thread. The
+ * callbacks never allocate, lock or block: rings are preallocated, each
+ * thread claims one with an atomic increment on its first event, and a
+ * full ring counts the event as dropped. Gyan drains all rings from its
+ * sampling path and in MPI_Finalize into <MPIT_EVENT_TRACE>.<rank>.
+ *
+ * With libraries implementing MPI 3.x this module compiles to stubs.
+ */
+#include "utility.h"
+
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+int events_init(char *spec, int rank);
+void events_drain();
+void events_finalize();
+#endif /* EVENTS_H_ */
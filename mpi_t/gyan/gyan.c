@@ -26,7 +26,23 @@
  *      Author: Tanzima Z. Islam, (islam3@llnl.gov)
  */
 
+#include <unistd.h>
+#include <stdarg.h>
 #include "utility.h"
+#include "tuning.h"
+#include "controller.h"
+#include "enum_cache.h"
+#include "category_tree.h"
+#include "events.h"
+#include "shm_export.h"
+#include "metrics.h"
+#include "report.h"
+#include "stats.h"
+#include "topk.h"
+#include "comm_matrix.h"
+#include "sampler.h"
+#include "wheel.h"
+#include "trace.h"
 
 #define THRESHOLD 0
 #define NOT_FOUND -1
@@ -35,16 +51,30 @@
 #define STR_SZ 100
 #define DEBUG 0
 #define NUM_PERF_VAR_SUPPORTED 50
-#define NEG_INF -10000000
-#define POS_INF 10000000
+#define DEFAULT_SAMPLE_INTERVAL 0.1 // seconds, used when the controller, events, the export or the series are enabled
+#define DEFAULT_CONTROLLER_SYNC 16
+#define DEFAULT_TOPK_THRESHOLD 128 // pvars with more elements are reduced as top-K lists
+#define DEFAULT_TOPK 10
 /* Global variables for tool */
 static MPI_T_pvar_session session;
 static MPI_T_pvar_handle *pvar_handles;
 static int *pvar_index;
 static int *pvar_count;
-static unsigned long long int **pvar_value_buffer; // cumulative values
-static void *read_value_buffer; // values are read into this buffer.
+static int *pvar_offset; // first element of each watched pvar in the value arrays
+static double *pvar_period; // seconds between reads from name@period in MPIT_VAR_TO_TRACE, 0 = sample_interval
+static int *pvar_size; // bytes per element, resolved once in watch_pvar; 0 for MPI_DOUBLE
+static int pvar_capacity; // watched pvars the per-pvar arrays have room for
+static int pvar_num_values; // elements of all watched pvars
+static unsigned long long int *report_values; // values of the dense reduced pvars, indexed by reduced_offset
+static int *reduced_offset; // first element of each reduced pvar in report_values, -1 if it is sparse
+static int *sparse_list; // top-K list of each reduced pvar, -1 if it is dense
+static int num_dense_values;
+static int num_sparse;
+static TOPK_ENTRY *topk_lists; // num_sparse lists of topk_size entries
+static int topk_threshold = DEFAULT_TOPK_THRESHOLD; // MPIT_TOPK_THRESHOLD
+static int topk_size = DEFAULT_TOPK; // MPIT_TOPK
 static int pvar_num_watched;
+static int pvar_num_reduced; // watched on all ranks, pvars added at runtime may differ
 static int total_num_of_var;
 static int max_num_of_state_per_pvar = -1; //  max_num_of_state_per_pvar = max(pvar_count[performance_variable]) for all performance_variables
 static int num_mpi_tasks;
@@ -66,23 +96,109 @@ typedef struct{
 }PERF_VAR;
 static PERF_VAR *perf_var_all;
 
-typedef struct{
-	int max_rank, min_rank; // max_rank : rank that resulted in this max value, min_rank: rank that resulted in this min value
-	unsigned long long int max, min; // the actual max and min values
-	unsigned long long int total; // summation of values across all MPI ranks for this particular variable
-	//	unsigned long long int freq; // how many ranks had this value?
-}STATISTICS;
-static STATISTICS **pvar_stat;
-
-typedef struct {
-	double value;
-	int rank;
-}mpi_data;
+static STATISTICS pvar_stat; // job statistics of the dense reduced pvars, indexed by reduced_offset, on rank 0
 
 static char *env_var_name;
+static char *tuning_db_file;
 static int tool_enabled = FALSE;
-static int num_send, num_isend, num_recv, num_irecv;
+static int controller_enabled = FALSE;
+static int events_enabled = FALSE;
+static int shm_enabled = FALSE;
+static int metrics_enabled = FALSE;
+static char *comm_matrix_file = NULL; // MPIT_COMM_MATRIX, NULL when disabled
+static double sample_interval = 0; // seconds between samples, 0 = sample only at MPI_Finalize
+static int controller_sync_period = DEFAULT_CONTROLLER_SYNC;
+static unsigned long long int world_collectives = 0;
+static int controller_busy = FALSE; // a thread is evaluating the local rules
+static int thread_level = MPI_THREAD_SINGLE;
 static int rank = 0;
+static double start_time; // MPI_Wtime at MPI_Init
+static int series_capacity = 0; // samples kept per thread, MPIT_SERIES
+static int series_width; // values per sample, those of the pvars watched at MPI_Init
+static int series_pvars; // pvars per sample
+static int adaptive_sampling = FALSE; // per-pvar intervals within MPIT_SAMPLE_BUDGET
+static int periods_given = FALSE; // a name@period in MPIT_VAR_TO_TRACE
+static int record_intervals = FALSE; // series rows carry the interval of every pvar
+static double wheel_tick = 0; // seconds per tick of the sampling timer wheel
+static int trace_enabled = FALSE; // per-rank traces, MPIT_TRACE
+static int num_threads = 0; // threads that called MPI, numbered in order
+
+/* Wrapped MPI calls, counted per thread */
+#define WRAP_SEND 0
+#define WRAP_ISEND 1
+#define WRAP_RECV 2
+#define WRAP_IRECV 3
+#define WRAP_BARRIER 4
+#define WRAP_BCAST 5
+#define WRAP_ALLREDUCE 6
+#define NUM_WRAPPED 7
+static const char *wrapped_name[NUM_WRAPPED] = {"MPI_Send", "MPI_Isend", "MPI_Recv",
+		"MPI_Irecv", "MPI_Barrier", "MPI_Bcast", "MPI_Allreduce"};
+
+/**
+ * Mutable state of one application thread. The wrappers touch only the
+ * shard of the calling thread, so they never share a lock or a cache line
+ * with other threads; MPI_Finalize merges the shards.
+ */
+typedef struct thread_shard{
+	unsigned long long int calls[NUM_WRAPPED];
+	double next_sample_time;
+	unsigned long long int *values; // latest sample, indexed by pvar_offset
+	int num_values;
+	void *read_buffer; // values are read into this buffer
+	int read_capacity;
+	int num_read; // watched pvars covered by the latest sample
+	COMM_MATRIX matrix; // messages sent by this thread, with MPIT_COMM_MATRIX
+	TIMER_WHEEL wheel; // when each watched pvar is read next
+	int *due; // pvars taken off the wheel at the current tick
+	int num_scheduled; // watched pvars put on the wheel
+	SAMPLER sampler; // per-pvar sampling intervals, with MPIT_SAMPLE_BUDGET
+	double *series_time; // ring of the last series_capacity samples
+	unsigned long long int *series_values;
+	double *series_intervals; // intervals of the series pvars, with record_intervals
+	int thread; // order of the thread's first MPI call
+	TRACE_BUFFER trace; // samples not yet written to the trace
+	int regions[TRACE_MAX_DEPTH]; // MPI_Pcontrol regions entered, innermost last
+	int region_depth;
+	unsigned long long int num_series; // samples recorded
+	struct thread_shard *next;
+}THREAD_SHARD;
+
+static THREAD_SHARD *shards = NULL; // all shards, pushed without locking
+static __thread THREAD_SHARD *my_shard __attribute__((tls_model("initial-exec")));
+
+/**
+ * Timer-wheel tick at time now.
+ */
+static unsigned long long int tick_at(double now){
+	if(wheel_tick <= 0 || now <= start_time)
+		return 0;
+	return (unsigned long long int)((now - start_time) / wheel_tick + 1e-9);
+}
+
+/**
+ * Shard of the calling thread, created on the thread's first MPI call.
+ */
+static THREAD_SHARD *get_shard(){
+	THREAD_SHARD *s = my_shard;
+	if(s != NULL)
+		return s;
+	s = (THREAD_SHARD*)calloc(1, sizeof(THREAD_SHARD));
+	s->next_sample_time = PMPI_Wtime() + sample_interval;
+	wheel_init(&s->wheel, tick_at(PMPI_Wtime()));
+	s->thread = __atomic_fetch_add(&num_threads, 1, __ATOMIC_RELAXED);
+	s->next = __atomic_load_n(&shards, __ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(&shards, &s->next, s, TRUE, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		;
+	my_shard = s;
+	return s;
+}
+
+static CATEGORY_TREE categories;
+static char **watched_categories; // category names given in MPIT_VAR_TO_TRACE
+static double *watched_category_period; // name@period of the categories, 0 without
+static int num_watched_categories = 0;
+static int watch_all = FALSE; // no list given, new pvars are watched as well
 
 static void stop_watching(){
 	int i;
@@ -142,48 +258,536 @@ static int get_watched_var_index( char *var_name){
 }
 
 /**
- * This function prints statistics of all performance variables monitored
- * @param none
- * @return none
+ * Symbolic name of a STATE pvar value, the number if the enum has no such item.
  */
+static const char *get_state_name(MPI_T_enum enumtype, unsigned long long int value){
+	static char number[32];
+	const char *name = enum_cache_lookup(enumtype, (int)value);
+	if(name != NULL)
+		return name;
+	snprintf(number, sizeof(number), "%llu", value);
+	return number;
+}
 
-static void print_pvar_buffer_all(){
-	int i;
-	int j;
-	int index;
+/**
+ * Number of values of the pvars watched on all ranks.
+ */
+static int reduced_values(){
+	if(pvar_num_reduced == 0)
+		return 0;
+	return pvar_offset[pvar_num_reduced - 1] + pvar_count[pvar_num_reduced - 1];
+}
 
-	printf("%-40s\tType   ", "Variable Name");
-	printf(" Minimum(Rank)    Maximum(Rank)       Average\n");
-	print_filled("",88,'-');
-	for(i = 0; i < pvar_num_watched; i++){
-		index = pvar_index[i];
-		if(perf_var_all[index].var_class != MPI_T_PVAR_CLASS_TIMER){
-			for(j = 0; j < pvar_count[i]; j++){ // asuuming that pvar_count[i] on all processes was the same
-				printf("%-40s\t", perf_var_all[index].name);
-				print_class(perf_var_all[index].var_class);
-				printf("\t%8llu(%3d)  %8llu(%3d)  %12.2lf\n", pvar_stat[i][j].min, pvar_stat[i][j].min_rank,
-						pvar_stat[i][j].max, pvar_stat[i][j].max_rank,
-						(pvar_stat[i][j].total / (double)num_mpi_tasks));
+/**
+ * Hand the reduced statistics to the report backend as contiguous arrays
+ * of pvar metadata and rows.
+ */
+static void report_stats(REPORT *r){
+	REPORT_INFO info;
+	REPORT_PVAR *pvars;
+	REPORT_ROW *rows;
+	PERF_VAR *pv;
+	int i, n, first;
+
+	pvars = (REPORT_PVAR*)calloc(pvar_num_reduced + 1, sizeof(REPORT_PVAR));
+	rows = (REPORT_ROW*)calloc(num_dense_values + 1, sizeof(REPORT_ROW));
+	for(i = 0; i < pvar_num_reduced; i++){
+		pv = &perf_var_all[pvar_index[i]];
+		strncpy(pvars[i].name, pv->name, REPORT_NAME_SZ - 1);
+		strncpy(pvars[i].var_class, get_pvar_class(pv->var_class), REPORT_CLASS_SZ - 1);
+		pvars[i].count = pvar_count[i]; // asuuming that pvar_count[i] on all processes was the same
+		pvars[i].offset = pvar_offset[i];
+		if((first = reduced_offset[i]) < 0)
+			continue;
+		for(n = first; n < first + pvar_count[i]; n++){
+			rows[n].pvar = i;
+			rows[n].element = n - first;
+			if(pv->var_class == MPI_T_PVAR_CLASS_STATE && pv->enumtype != MPI_T_ENUM_NULL){
+				strncpy(rows[n].min_label, get_state_name(pv->enumtype, pvar_stat.min[n]), REPORT_LABEL_SZ - 1);
+				strncpy(rows[n].max_label, get_state_name(pv->enumtype, pvar_stat.max[n]), REPORT_LABEL_SZ - 1);
 			}
 		}
 	}
+	for(n = 0; n < num_dense_values; n++){
+		rows[n].min = pvar_stat.min[n];
+		rows[n].max = pvar_stat.max[n];
+		rows[n].total = pvar_stat.total[n];
+		rows[n].min_rank = pvar_stat.min_rank[n];
+		rows[n].max_rank = pvar_stat.max_rank[n];
+		rows[n].average = pvar_stat.total[n] / (double)num_mpi_tasks;
+	}
+	info.num_ranks = num_mpi_tasks;
+	info.num_pvars = pvar_num_reduced;
+	info.num_values = reduced_values();
+	info.intervals = record_intervals;
+	info.sample_interval = sample_interval;
+	report_begin(r, &info);
+	report_pvars(r, pvars, pvar_num_reduced);
+	report_rows(r, rows, n);
+	free(pvars);
+	free(rows);
 }
 
-static void pvar_read_all(){
-	int i, j;
-	int size;
-	unsigned long long int zero = 0;
-	for(i = 0; i < pvar_num_watched; i++){
-		MPI_T_pvar_read(session, pvar_handles[i], read_value_buffer);
-		MPI_Type_size(perf_var_all[i].datatype, &size);
-		for(j = 0; j < pvar_count[j]; j++){
-			pvar_value_buffer[i][j] = 0;
-			memcpy(&(pvar_value_buffer[i][j]), read_value_buffer, size);
+/**
+ * Hand the merged top-K lists of the sparse pvars to the report backend.
+ */
+static void report_top_elements(REPORT *r){
+	REPORT_TOPK_ROW *rows;
+	TOPK_ENTRY *list;
+	int i, j, n = 0;
+
+	rows = (REPORT_TOPK_ROW*)calloc((size_t)num_sparse * topk_size + 1, sizeof(REPORT_TOPK_ROW));
+	for(i = 0; i < pvar_num_reduced; i++){
+		if(sparse_list[i] < 0)
+			continue;
+		list = topk_lists + (size_t)sparse_list[i] * topk_size;
+		for(j = 0; j < topk_length(list, topk_size); j++, n++){
+			rows[n].pvar = i;
+			rows[n].element = list[j].element;
+			rows[n].rank = list[j].rank;
+			rows[n].value = list[j].value;
 		}
 	}
+	report_topk(r, rows, n);
+	free(rows);
+}
+
+/**
+ * Split the pvars watched on all ranks into dense pvars, reduced element
+ * by element, and sparse pvars with more than topk_threshold elements, of
+ * which every rank only contributes its topk_size largest non-zero
+ * elements. Packs the dense values into report_values and selects the
+ * local top-K lists.
+ */
+static void layout_reduced(unsigned long long int *values){
+	int i;
+
+	reduced_offset = (int*)malloc(sizeof(int) * (pvar_num_reduced + 1));
+	sparse_list = (int*)malloc(sizeof(int) * (pvar_num_reduced + 1));
+	num_dense_values = num_sparse = 0;
+	for(i = 0; i < pvar_num_reduced; i++){
+		if(pvar_count[i] > topk_threshold){
+			reduced_offset[i] = -1;
+			sparse_list[i] = num_sparse++;
+			continue;
+		}
+		reduced_offset[i] = num_dense_values;
+		sparse_list[i] = -1;
+		num_dense_values += pvar_count[i];
+	}
+	report_values = (unsigned long long int*)malloc(sizeof(unsigned long long int) * (num_dense_values + 1));
+	topk_lists = (TOPK_ENTRY*)malloc(sizeof(TOPK_ENTRY) * ((size_t)num_sparse * topk_size + 1));
+	for(i = 0; i < pvar_num_reduced; i++){
+		if(reduced_offset[i] >= 0)
+			memcpy(report_values + reduced_offset[i], values + pvar_offset[i], sizeof(unsigned long long int) * pvar_count[i]);
+		else
+			topk_select(topk_lists + (size_t)sparse_list[i] * topk_size, topk_size,
+					values + pvar_offset[i], pvar_count[i], rank);
+	}
+}
+
+/**
+ * Size the buffers of a shard for the current watch list.
+ */
+static void shard_reserve(THREAD_SHARD *shard){
+	if(shard->num_values < pvar_num_values){
+		shard->values = (unsigned long long int*)stats_aligned_realloc(shard->values,
+				sizeof(unsigned long long int) * shard->num_values, sizeof(unsigned long long int) * pvar_num_values);
+		shard->num_values = pvar_num_values;
+	}
+	if(shard->wheel.capacity < pvar_num_watched){
+		wheel_reserve(&shard->wheel, pvar_capacity);
+		shard->due = (int*)realloc(shard->due, sizeof(int) * pvar_capacity);
+	}
+	if(shard->read_buffer == NULL || shard->read_capacity < max_num_of_state_per_pvar){
+		shard->read_buffer = realloc(shard->read_buffer, sizeof(unsigned long long int) * (max_num_of_state_per_pvar + 1));
+		shard->read_capacity = max_num_of_state_per_pvar;
+	}
+}
+
+/**
+ * Read watched pvar i into the shard's values; returns the sum of its
+ * elements. Pvars of 64-bit integers are read in place, the others
+ * through the read buffer and widened by the size found in watch_pvar.
+ */
+static double pvar_read(THREAD_SHARD *shard, int i){
+	int j;
+	int size = pvar_size[i];
+	double sum = 0;
+	unsigned long long int *values = shard->values + pvar_offset[i];
+
+	if(size == sizeof(unsigned long long int)){
+		MPI_T_pvar_read(session, pvar_handles[i], values);
+		for(j = 0; j < pvar_count[i]; j++)
+			sum += (double)values[j];
+		return sum;
+	}
+	MPI_T_pvar_read(session, pvar_handles[i], shard->read_buffer);
+	for(j = 0; j < pvar_count[i]; j++){
+		if(size == 0)
+			values[j] = (unsigned long long int)(((double*)shard->read_buffer)[j]);
+		else{
+			values[j] = 0;
+			memcpy(&(values[j]), (char*)shard->read_buffer + j * size, size);
+		}
+		sum += (double)values[j];
+	}
+	return sum;
+}
+
+static void pvar_read_all(THREAD_SHARD *shard){
+	int i;
+	int num = pvar_num_watched;
+
+	shard_reserve(shard);
+	for(i = 0; i < num; i++)
+		pvar_read(shard, i);
+	shard->num_read = num;
 	return;
 }
 
+/**
+ * Seconds between reads of watched pvar i by the shard's thread.
+ */
+static double pvar_interval(THREAD_SHARD *shard, int i){
+	if(adaptive_sampling)
+		return shard->sampler.interval[i];
+	return (pvar_period[i] > 0) ? pvar_period[i] : sample_interval;
+}
+
+/**
+ * Read the pvars the timer wheel has due at tick, and pvars watched
+ * since the previous tick, into shard->due. With adaptive sampling every
+ * read is timed for the overhead budget. Returns the number read.
+ */
+static int pvar_read_due(THREAD_SHARD *shard, double now, unsigned long long int tick){
+	int i, k, n;
+	int num = pvar_num_watched;
+	double value, t;
+
+	shard_reserve(shard);
+	n = wheel_expire(&shard->wheel, tick, shard->due);
+	if(adaptive_sampling)
+		sampler_reserve(&shard->sampler, num);
+	for(; shard->num_scheduled < num; shard->num_scheduled++){
+		i = shard->num_scheduled;
+		if(adaptive_sampling && pvar_period[i] > 0)
+			sampler_fix(&shard->sampler, i, pvar_period[i]);
+		shard->due[n++] = i;
+	}
+	for(k = 0; k < n; k++){
+		i = shard->due[k];
+		if(!adaptive_sampling){
+			pvar_read(shard, i);
+			continue;
+		}
+		t = PMPI_Wtime();
+		value = pvar_read(shard, i);
+		sampler_update(&shard->sampler, i, value, PMPI_Wtime() - t, now);
+	}
+	shard->num_read = num;
+	return n;
+}
+
+/**
+ * Put the n pvars read at tick back on the wheel. A pvar is due at the
+ * next multiple of its period in ticks, so pvars sharing a period stay in
+ * one slot and are read together.
+ */
+static void pvar_reschedule(THREAD_SHARD *shard, int n, unsigned long long int tick){
+	unsigned long long int period;
+	int k;
+
+	for(k = 0; k < n; k++){
+		period = (unsigned long long int)(pvar_interval(shard, shard->due[k]) / wheel_tick + 0.5);
+		if(period == 0)
+			period = 1;
+		wheel_insert(&shard->wheel, shard->due[k], (tick / period + 1) * period);
+	}
+}
+
+/**
+ * Map a pvar name (optionally name:class) to its index in the watch list.
+ */
+static int get_watched_index_by_name(char *var_name){
+	int index = get_watched_var_index(var_name);
+	if(index == NOT_FOUND)
+		return NOT_FOUND;
+	return perf_var_all[index].pvar_index;
+}
+
+/**
+ * Latest value of a watched pvar sampled by the calling thread, summed
+ * over its elements.
+ */
+static unsigned long long int get_watched_value(int watched){
+	int j;
+	unsigned long long int sum = 0;
+	unsigned long long int *values = get_shard()->values + pvar_offset[watched];
+	for(j = 0; j < pvar_count[watched]; j++)
+		sum += values[j];
+	return sum;
+}
+
+/**
+ * Query the info of pvars [first, last) into perf_var_all.
+ * @return total length of their names
+ */
+static int load_perf_var_info(int first, int last){
+	int i, err, namelen, verb, varclass, bind, desc_len;
+	int readonly, continuous, atomic;
+	int total_length_pvar_name = 0;
+	char name[STR_SZ + 1] = "";
+	char desc[STR_SZ + 1] = "";
+	MPI_Datatype datatype;
+	MPI_T_enum enumtype;
+
+	for(i = first; i < last; i++){
+		namelen = desc_len = STR_SZ;
+		err = MPI_T_pvar_get_info(i/*IN*/,
+				name /*OUT*/,
+				&namelen /*INOUT*/,
+				&verb /*OUT*/,
+				&varclass /*OUT*/,
+				&datatype /*OUT*/,
+				&enumtype /*OUT*/,
+				desc /*desc: OUT*/,
+				&desc_len /*desc_len: INOUT*/,
+				&bind /*OUT*/,
+				&readonly /*OUT*/,
+				&continuous /*OUT*/,
+				&atomic/*OUT*/);
+		if(err != MPI_SUCCESS)
+			name[0] = desc[0] = 0;
+		perf_var_all[i].pvar_index = -1; // gets setup later
+		perf_var_all[i].name_len = namelen;
+		perf_var_all[i].name = (char*)malloc(sizeof(char) * (namelen + 1));
+		strcpy(perf_var_all[i].name, name);
+		total_length_pvar_name += namelen;
+
+		perf_var_all[i].verbosity = verb;
+		perf_var_all[i].var_class = varclass;
+		perf_var_all[i].datatype = datatype;
+		perf_var_all[i].enumtype = enumtype;
+		perf_var_all[i].desc_len = desc_len;
+		perf_var_all[i].desc = (char*)malloc(sizeof(char) * (desc_len + 1));
+		strcpy(perf_var_all[i].desc, desc);
+		perf_var_all[i].binding = bind;
+		perf_var_all[i].readonly = readonly;
+		perf_var_all[i].continuous = continuous;
+		perf_var_all[i].atomic = atomic;
+	}
+	return total_length_pvar_name;
+}
+
+/**
+ * Size the info array for num pvars.
+ */
+static void allocate_pvar_arrays(int num){
+	perf_var_all = (PERF_VAR*)realloc(perf_var_all, sizeof(PERF_VAR) * (num + 1));
+}
+
+/**
+ * Make room in the per-pvar arrays for one more watched pvar; they grow
+ * with the watch list, not with the number of pvars the library exposes.
+ */
+static void reserve_watched(){
+	if(pvar_num_watched < pvar_capacity)
+		return;
+	pvar_capacity = (pvar_capacity == 0) ? 16 : 2 * pvar_capacity;
+	pvar_handles = (MPI_T_pvar_handle*)realloc(pvar_handles, sizeof(MPI_T_pvar_handle) * pvar_capacity);
+	pvar_index = (int*)realloc(pvar_index, sizeof(int) * pvar_capacity);
+	pvar_count = (int*)realloc(pvar_count, sizeof(int) * pvar_capacity);
+	pvar_offset = (int*)realloc(pvar_offset, sizeof(int) * pvar_capacity);
+	pvar_period = (double*)realloc(pvar_period, sizeof(double) * pvar_capacity);
+	pvar_size = (int*)realloc(pvar_size, sizeof(int) * pvar_capacity);
+}
+
+/**
+ * Allocate a handle for pvar index and start it. Pvars that are already
+ * watched or cannot be bound are skipped.
+ * @return MPI_SUCCESS unless the pvar could not be started
+ */
+static int watch_pvar(int index, double period){
+	int err;
+	int watched = perf_var_all[index].pvar_index;
+
+	if(watched != -1){
+		/* listed twice, the shortest period wins */
+		if(period > 0 && (pvar_period[watched] <= 0 || period < pvar_period[watched]))
+			pvar_period[watched] = period;
+		return MPI_SUCCESS;
+	}
+	reserve_watched();
+	err = MPI_T_pvar_handle_alloc(session, index, NULL, &pvar_handles[pvar_num_watched], &pvar_count[pvar_num_watched]);
+	if (err != MPI_SUCCESS)
+		return MPI_SUCCESS;
+	pvar_index[pvar_num_watched] = index;
+	pvar_period[pvar_num_watched] = period;
+	if(perf_var_all[index].datatype == MPI_DOUBLE)
+		pvar_size[pvar_num_watched] = 0;
+	else
+		MPI_Type_size(perf_var_all[index].datatype, &pvar_size[pvar_num_watched]);
+	perf_var_all[index].pvar_index = pvar_num_watched;
+	pvar_offset[pvar_num_watched] = pvar_num_values;
+	pvar_num_values += pvar_count[pvar_num_watched];
+	if(max_num_of_state_per_pvar < pvar_count[pvar_num_watched])
+		max_num_of_state_per_pvar = pvar_count[pvar_num_watched];
+
+	if(perf_var_all[index].continuous == 0){
+		err = MPI_T_pvar_start(session, pvar_handles[pvar_num_watched]);
+	}
+	pvar_num_watched++;
+	return err;
+}
+
+/**
+ * Watch all pvars of the requested categories, resolved through the
+ * category bitsets.
+ */
+static int watch_categories(){
+	BITSET members;
+	int i, index, err = MPI_SUCCESS;
+
+	for(i = 0; i < num_watched_categories && err == MPI_SUCCESS; i++){
+		bitset_init(&members, total_num_of_var);
+		category_tree_members(&categories, category_tree_find(&categories, watched_categories[i]), NULL, &members);
+		for(index = bitset_next(&members, 0); index >= 0 && index < total_num_of_var; index = bitset_next(&members, index + 1))
+			if((err = watch_pvar(index, watched_category_period[i])) != MPI_SUCCESS)
+				break;
+		bitset_free(&members);
+	}
+	return err;
+}
+
+/**
+ * Describe watched pvars [first, pvar_num_watched) in the shared-memory
+ * export.
+ */
+static void export_watched(int first){
+	int i;
+	if(!shm_enabled)
+		return;
+	for(i = first; i < pvar_num_watched; i++)
+		shm_export_pvar(i, perf_var_all[pvar_index[i]].name, get_pvar_class(perf_var_all[pvar_index[i]].var_class),
+				pvar_count[i], pvar_offset[i]);
+}
+
+/**
+ * Pick up pvars and categories the library added after MPI_Init, as
+ * reported by MPI_T_category_changed. New pvars are watched if they
+ * belong to a requested category, or in all cases when no list was given.
+ */
+static void refresh_watch_list(){
+	int num, index, first = pvar_num_watched;
+
+	if(!category_tree_changed(&categories))
+		return;
+	category_tree_free(&categories);
+	category_tree_load(&categories);
+	if(MPI_T_pvar_get_num(&num) != MPI_SUCCESS || num <= total_num_of_var)
+		return;
+	allocate_pvar_arrays(num);
+	load_perf_var_info(total_num_of_var, num);
+	index = total_num_of_var;
+	total_num_of_var = num;
+	if(watch_all){
+		for(; index < num; index++)
+			watch_pvar(index, 0);
+	}
+	else
+		watch_categories();
+	export_watched(first);
+}
+
+/**
+ * Keep the values of the pvars watched at MPI_Init in the time-series
+ * ring of the shard, with per-pvar periods or adaptive sampling also the
+ * interval each pvar is sampled at.
+ */
+static void record_sample(THREAD_SHARD *shard, double now){
+	unsigned long long int row;
+	int i;
+
+	if(shard->series_time == NULL){
+		shard->series_time = (double*)malloc(sizeof(double) * series_capacity);
+		shard->series_values = (unsigned long long int*)malloc(sizeof(unsigned long long int) *
+				((size_t)series_capacity * series_width + 1));
+		if(record_intervals)
+			shard->series_intervals = (double*)malloc(sizeof(double) * ((size_t)series_capacity * series_pvars + 1));
+	}
+	row = shard->num_series % series_capacity;
+	shard->series_time[row] = now - start_time;
+	memcpy(shard->series_values + row * series_width, shard->values, sizeof(unsigned long long int) * series_width);
+	for(i = 0; record_intervals && i < series_pvars; i++)
+		shard->series_intervals[row * series_pvars + i] = pvar_interval(shard, i);
+	shard->num_series++;
+}
+
+/**
+ * Innermost MPI_Pcontrol region of the shard's thread.
+ */
+static int current_region(THREAD_SHARD *shard){
+	if(shard->region_depth == 0)
+		return TRACE_NO_REGION;
+	if(shard->region_depth > TRACE_MAX_DEPTH)
+		return shard->regions[TRACE_MAX_DEPTH - 1];
+	return shard->regions[shard->region_depth - 1];
+}
+
+/**
+ * Sampling path, called from the MPI wrappers. Every thread reads the
+ * watched pvars into its own shard and feeds the controller. A tick only
+ * reads the pvars the timer wheel has due, each at its own period
+ * (name@period) or adaptive interval, and the next tick is when the
+ * wheel's next slot is due. world_sync is TRUE when called from a
+ * collective on MPI_COMM_WORLD, the only place where the controller may
+ * communicate.
+ * Nothing here waits for another thread: the local rules are skipped
+ * while another thread evaluates them, and the watch list only grows
+ * when at most one thread calls MPI at a time.
+ */
+static void sample_tick(THREAD_SHARD *shard, int world_sync){
+	double now, read_time;
+	unsigned long long int tick, next;
+	int num_due;
+	if(!tool_enabled || sample_interval <= 0)
+		return;
+	now = PMPI_Wtime();
+	if(now >= shard->next_sample_time){
+		if(thread_level != MPI_THREAD_MULTIPLE)
+			refresh_watch_list();
+		tick = tick_at(now);
+		read_time = PMPI_Wtime();
+		num_due = pvar_read_due(shard, now, tick);
+		read_time = PMPI_Wtime() - read_time;
+		if(series_capacity > 0)
+			record_sample(shard, now);
+		if(trace_enabled)
+			trace_sample(&shard->trace, now - start_time, shard->thread, current_region(shard), shard->values);
+		if(shm_enabled)
+			shm_export_publish(shard->values, shard->num_read, pvar_num_values);
+		if(controller_enabled && !__atomic_exchange_n(&controller_busy, TRUE, __ATOMIC_ACQUIRE)){
+			controller_evaluate_local(get_watched_value);
+			__atomic_store_n(&controller_busy, FALSE, __ATOMIC_RELEASE);
+		}
+		if(events_enabled)
+			events_drain();
+		if(adaptive_sampling)
+			sampler_balance(&shard->sampler, pvar_num_watched, now, PMPI_Wtime() - now - read_time);
+		pvar_reschedule(shard, num_due, tick);
+		next = wheel_next(&shard->wheel);
+		shard->next_sample_time = next ? start_time + next * wheel_tick : now + sample_interval;
+	}
+	/* collectives on MPI_COMM_WORLD are ordered by the application, so the
+	 * count matches across ranks whichever thread issues them */
+	if(world_sync && controller_enabled && controller_has_sync_rules() &&
+			(__atomic_add_fetch(&world_collectives, 1, __ATOMIC_RELAXED) % controller_sync_period) == 0){
+		if(shard->num_read < pvar_num_watched)
+			pvar_read_all(shard);
+		controller_evaluate_sync(get_watched_value);
+	}
+}
 
 static void clean_up_perf_var_all(int num_of_perf_var){
 	int i;
@@ -194,111 +798,322 @@ static void clean_up_perf_var_all(int num_of_perf_var){
 	free(perf_var_all);
 }
 
-static void clean_up_pvar_value_buffer(int num_of_var_watched){
-	int i;
-	for(i = 0; i < num_of_var_watched; i++){
-		free(pvar_value_buffer[i]);
+static void clean_up_shards(){
+	THREAD_SHARD *s, *next;
+	for(s = shards; s != NULL; s = next){
+		next = s->next;
+		free(s->series_time);
+		free(s->series_values);
+		free(s->series_intervals);
+		free(s->trace.data);
+		sampler_free(&s->sampler);
+		wheel_free(&s->wheel);
+		free(s->due);
+		free(s->values);
+		free(s->read_buffer);
+		comm_matrix_free(&s->matrix);
+		free(s);
 	}
-	free(pvar_value_buffer);
+	shards = NULL;
+	my_shard = NULL;
 }
 
 static void clean_up_the_rest(){
-	free(read_value_buffer);
+	free(pvar_offset);
+	free(pvar_period);
+	free(pvar_size);
 	free(pvar_handles);
 	free(pvar_index);
 	free(pvar_count);
+	free(reduced_offset);
+	free(sparse_list);
+	free(report_values);
+	free(topk_lists);
+	stats_free(&pvar_stat);
 }
 
-static void collect_sum_from_all_ranks(MPI_Op op){
-	int i;
-	int j;
-	int root = 0;
+static REPORT_NODE_ROW *node_rows; // per-node statistics, on rank 0 with MPIT_NODE_REPORT
+static int num_node_rows = 0;
 
-	unsigned long long int *value_in;
-	unsigned long long int *value_out;
-	value_in = (unsigned long long int*)malloc(sizeof(unsigned long long int) * ( max_num_of_state_per_pvar + 1));
-	if(rank == root)
-		value_out = (unsigned long long int*)malloc(sizeof(unsigned long long int) * ( max_num_of_state_per_pvar + 1));
+/**
+ * Combine the first width values of the ranks on this node. Every rank
+ * stores its row into a shared-memory window and the node leader reduces
+ * the rows with plain loads, so no rank data crosses the network here.
+ * Collective over node_comm.
+ * @return TRUE on the node leader, which gets the node statistics in ns
+ */
+static int collect_node(MPI_Comm node_comm, int width, STATISTICS *ns, int *num_ranks){
+	MPI_Win win;
+	MPI_Aint size;
+	int disp, node_rank, k;
+	unsigned long long int *base, *row;
 
-	for(i = 0; i < pvar_num_watched; i++){
-		for(j = 0; j < pvar_count[i]; j++){
-			value_in[j] = pvar_value_buffer[i][j];
+	PMPI_Comm_rank(node_comm, &node_rank);
+	PMPI_Comm_size(node_comm, num_ranks);
+	size = (node_rank == 0) ? (MPI_Aint)sizeof(unsigned long long int) * *num_ranks * (width + 1) : 0;
+	PMPI_Win_allocate_shared(size, sizeof(unsigned long long int), MPI_INFO_NULL, node_comm, &base, &win);
+	PMPI_Win_shared_query(win, 0, &size, &disp, &base);
+	PMPI_Win_fence(0, win);
+	row = base + (size_t)node_rank * (width + 1);
+	row[0] = rank;
+	memcpy(row + 1, report_values, sizeof(unsigned long long int) * width);
+	PMPI_Win_fence(0, win);
+	if(node_rank == 0){
+		/* rows are in world rank order, ties keep the lowest rank like MINLOC/MAXLOC */
+		stats_alloc(ns, width);
+		stats_set(ns, base + 1, (int)base[0]);
+		for(k = 1; k < *num_ranks; k++){
+			row = base + (size_t)k * (width + 1);
+			stats_add(ns, row + 1, (int)row[0]);
 		}
-		PMPI_Reduce(value_in, value_out, pvar_count[i] /*number_of_elements*/, MPI_UNSIGNED_LONG_LONG, op, root, MPI_COMM_WORLD);
-		if(root == rank){
-			/**
-			 * Populate these values into the pvar_stat array of rank 0.
-			 */
-			for(j = 0; j < pvar_count[i]; j++){
-				pvar_stat[i][j].total = value_out[j];
-			}
-		}// root is done extracting information from "out" to pvar_stat
 	}
-	free(value_in);
-	if(root == rank)
-		free(value_out);
+	PMPI_Win_free(&win);
+	return (node_rank == 0);
 }
 
-static void collect_range_with_loc_from_all_ranks(MPI_Op op){
-	int i;
-	int j;
-	int root = 0;
-	mpi_data *in;
-	mpi_data *out;
+/**
+ * Collect the statistics of every node on rank 0 as report rows.
+ * Collective over leader_comm.
+ */
+static void gather_node_stats(MPI_Comm leader_comm, int width, STATISTICS *ns, int num_ranks){
+	char *all_blocks = NULL, *all_hosts = NULL;
+	int *all_num_ranks = NULL;
+	char host[MPI_MAX_PROCESSOR_NAME];
+	size_t size = stats_block_size(width);
+	int num_nodes, len, n, i, k;
+	STATISTICS node;
+	REPORT_NODE_ROW *row;
 
-	/**
-	 * Pack all variables into a buffer
-	 */
-	/**
-	 * MPI_Reduce on each element. Each element here is a performance variable
-	 */
-	in = (mpi_data*)malloc(sizeof(mpi_data) * ( max_num_of_state_per_pvar + 1));
-	if(rank == root)
-		out = (mpi_data*)malloc(sizeof(mpi_data) * (max_num_of_state_per_pvar + 1));
-	for(i = 0; i < pvar_num_watched; i++){
-		for(j = 0; j < pvar_count[i]; j++){
-			in[j].value = 0;
-			in[j].value = (double)(pvar_value_buffer[i][j]);
-			in[j].rank = rank;
-		}
-		PMPI_Reduce(in, out, pvar_count[i] /*number_of_elements*/, MPI_DOUBLE_INT, op, root, MPI_COMM_WORLD);
-		//printout
-		if(root == rank){
-			for(j = 0; j < pvar_count[i]; j++){
-				if(op == MPI_MINLOC){
-					pvar_stat[i][j].min = (unsigned long long int)(out[j].value);
-					pvar_stat[i][j].min_rank = out[j].rank;
-				}
-				else if(op == MPI_MAXLOC){
-					pvar_stat[i][j].max = (unsigned long long int)(out[j].value);
-					pvar_stat[i][j].max_rank = out[j].rank;
+	PMPI_Comm_size(leader_comm, &num_nodes);
+	memset(host, 0, sizeof(host));
+	PMPI_Get_processor_name(host, &len);
+	if(rank == 0){
+		all_blocks = (char*)stats_aligned_realloc(NULL, 0, size * num_nodes);
+		all_num_ranks = (int*)malloc(sizeof(int) * num_nodes);
+		all_hosts = (char*)malloc(MPI_MAX_PROCESSOR_NAME * num_nodes);
+	}
+	PMPI_Gather(ns->block, (int)size, MPI_BYTE, all_blocks, (int)size, MPI_BYTE, 0, leader_comm);
+	PMPI_Gather(&num_ranks, 1, MPI_INT, all_num_ranks, 1, MPI_INT, 0, leader_comm);
+	PMPI_Gather(host, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, all_hosts, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, 0, leader_comm);
+	if(rank == 0){
+		node_rows = (REPORT_NODE_ROW*)calloc((size_t)num_nodes * width + 1, sizeof(REPORT_NODE_ROW));
+		for(n = 0; n < num_nodes; n++){
+			stats_view(&node, all_blocks + (size_t)n * size, width);
+			for(i = 0; i < pvar_num_reduced; i++){
+				if(reduced_offset[i] < 0)
+					continue;
+				for(k = reduced_offset[i]; k < reduced_offset[i] + pvar_count[i]; k++){
+					row = &node_rows[num_node_rows++];
+					strncpy(row->host, all_hosts + (size_t)n * MPI_MAX_PROCESSOR_NAME, REPORT_NAME_SZ - 1);
+					row->node = n;
+					row->num_ranks = all_num_ranks[n];
+					row->pvar = i;
+					row->element = k - reduced_offset[i];
+					row->min = node.min[k];
+					row->max = node.max[k];
+					row->total = node.total[k];
+					row->min_rank = node.min_rank[k];
+					row->max_rank = node.max_rank[k];
+					row->average = row->total / (double)row->num_ranks;
 				}
 			}
 		}
+		free(all_blocks);
+		free(all_num_ranks);
+		free(all_hosts);
 	}
-	free(in);
-	if(root == rank)
-		free(out);
 }
 
-int MPI_Init(int *argc, char ***argv){
+/**
+ * Two-level reduction of the watched values onto rank 0: ranks combine
+ * their values per node in shared memory, then the node leaders reduce
+ * the node statistics with one message each. The top-K lists of sparse
+ * pvars are merged along the same two levels. Collective over
+ * MPI_COMM_WORLD.
+ */
+static void collect_from_all_ranks(){
+	MPI_Comm node_comm, leader_comm;
+	STATISTICS ns;
+	TOPK_ENTRY *node_lists = NULL;
+	int width = num_dense_values;
+	int leader, num_ranks;
 
-	if(DEBUG)printf("********** Interception starts **********\n");
-	int err, num, i, namelen, verb, varclass, bind, threadsup;
-	int index;
-	int readonly, continuous, atomic;
-	char name[STR_SZ + 1] = "";
-	int desc_len;
-	char desc[STR_SZ + 1] = "";
-	int mpi_init_return;
-	MPI_Datatype datatype;
-	MPI_T_enum enumtype;
+	PMPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+	leader = collect_node(node_comm, width, &ns, &num_ranks);
+	if(leader)
+		node_lists = (TOPK_ENTRY*)malloc(sizeof(TOPK_ENTRY) * ((size_t)num_sparse * topk_size + 1));
+	topk_reduce(topk_lists, node_lists, num_sparse, topk_size, 0, node_comm);
+	PMPI_Comm_split(MPI_COMM_WORLD, leader ? 0 : MPI_UNDEFINED, rank, &leader_comm);
+	if(leader){
+		if(rank == 0)
+			stats_alloc(&pvar_stat, width);
+		stats_reduce(&ns, &pvar_stat, 0, leader_comm);
+		topk_reduce(node_lists, topk_lists, num_sparse, topk_size, 0, leader_comm);
+		free(node_lists);
+		if(getenv("MPIT_NODE_REPORT") != NULL)
+			gather_node_stats(leader_comm, width, &ns, num_ranks);
+		stats_free(&ns);
+		PMPI_Comm_free(&leader_comm);
+	}
+	PMPI_Comm_free(&node_comm);
+}
 
-	/* Run MPI Initialization */
-	mpi_init_return = PMPI_Init(argc, argv);
-	if (mpi_init_return != MPI_SUCCESS)
-		return mpi_init_return;
+typedef struct{
+	double time;
+	unsigned long long int *values;
+	double *intervals; // NULL without adaptive sampling
+}SERIES_ROW;
+
+static int compare_series_rows(const void *a, const void *b){
+	double ta = ((SERIES_ROW*)a)->time, tb = ((SERIES_ROW*)b)->time;
+	return (ta > tb) - (ta < tb);
+}
+
+/**
+ * Merge the series rings of all shards into contiguous arrays ordered by
+ * time, keeping the first width values and the intervals of the first
+ * num_pvars pvars of every sample.
+ * @return number of samples
+ */
+static int merge_series(double **time, unsigned long long int **values, int width,
+		double **intervals, int num_pvars){
+	THREAD_SHARD *s;
+	SERIES_ROW *rows;
+	unsigned long long int i, kept;
+	int num = 0, n;
 
+	for(s = shards; s != NULL; s = s->next)
+		num += (s->num_series < (unsigned long long int)series_capacity) ? s->num_series : series_capacity;
+	rows = (SERIES_ROW*)malloc(sizeof(SERIES_ROW) * (num + 1));
+	for(n = 0, s = shards; s != NULL; s = s->next){
+		kept = (s->num_series < (unsigned long long int)series_capacity) ? s->num_series : series_capacity;
+		for(i = 0; i < kept; i++, n++){
+			rows[n].time = s->series_time[i];
+			rows[n].values = s->series_values + i * series_width;
+			rows[n].intervals = record_intervals ? s->series_intervals + i * series_pvars : NULL;
+		}
+	}
+	qsort(rows, num, sizeof(SERIES_ROW), compare_series_rows);
+	*time = (double*)malloc(sizeof(double) * (num + 1));
+	*values = (unsigned long long int*)malloc(sizeof(unsigned long long int) * ((size_t)num * width + 1));
+	*intervals = (double*)malloc(sizeof(double) * ((size_t)num * num_pvars + 1));
+	for(n = 0; n < num; n++){
+		(*time)[n] = rows[n].time;
+		memcpy(*values + (size_t)n * width, rows[n].values, sizeof(unsigned long long int) * width);
+		if(num_pvars > 0)
+			memcpy(*intervals + (size_t)n * num_pvars, rows[n].intervals, sizeof(double) * num_pvars);
+	}
+	free(rows);
+	return num;
+}
+
+/**
+ * Pass the series of every rank to the report on rank 0, one rank at a
+ * time. Collective over MPI_COMM_WORLD.
+ */
+static void report_all_series(REPORT *r){
+	MPI_Comm comm;
+	double *time, *intervals;
+	unsigned long long int *values;
+	int head[3], src;
+
+	head[1] = (series_width < reduced_values()) ? series_width : reduced_values();
+	head[2] = 0;
+	if(record_intervals)
+		head[2] = (series_pvars < pvar_num_reduced) ? series_pvars : pvar_num_reduced;
+	head[0] = merge_series(&time, &values, head[1], &intervals, head[2]);
+	PMPI_Comm_dup(MPI_COMM_WORLD, &comm);
+	if(rank == 0){
+		report_series(r, 0, time, (uint64_t*)values, head[0], head[1], record_intervals ? intervals : NULL, head[2]);
+		for(src = 1; src < num_mpi_tasks; src++){
+			free(time);
+			free(values);
+			free(intervals);
+			PMPI_Recv(head, 3, MPI_INT, src, 0, comm, MPI_STATUS_IGNORE);
+			time = (double*)malloc(sizeof(double) * (head[0] + 1));
+			values = (unsigned long long int*)malloc(sizeof(unsigned long long int) * ((size_t)head[0] * head[1] + 1));
+			intervals = (double*)malloc(sizeof(double) * ((size_t)head[0] * head[2] + 1));
+			PMPI_Recv(time, head[0], MPI_DOUBLE, src, 0, comm, MPI_STATUS_IGNORE);
+			PMPI_Recv(values, head[0] * head[1], MPI_UNSIGNED_LONG_LONG, src, 0, comm, MPI_STATUS_IGNORE);
+			PMPI_Recv(intervals, head[0] * head[2], MPI_DOUBLE, src, 0, comm, MPI_STATUS_IGNORE);
+			report_series(r, src, time, (uint64_t*)values, head[0], head[1], record_intervals ? intervals : NULL, head[2]);
+		}
+	}
+	else{
+		PMPI_Send(head, 3, MPI_INT, 0, 0, comm);
+		PMPI_Send(time, head[0], MPI_DOUBLE, 0, 0, comm);
+		PMPI_Send(values, head[0] * head[1], MPI_UNSIGNED_LONG_LONG, 0, 0, comm);
+		PMPI_Send(intervals, head[0] * head[2], MPI_DOUBLE, 0, 0, comm);
+	}
+	free(time);
+	free(values);
+	free(intervals);
+	PMPI_Comm_free(&comm);
+}
+
+/**
+ * Merge the communication matrix rows of all threads and write the
+ * matrix of the job. Collective over MPI_COMM_WORLD.
+ */
+static void write_comm_matrix(){
+	COMM_MATRIX row;
+	THREAD_SHARD *s;
+
+	memset(&row, 0, sizeof(COMM_MATRIX));
+	for(s = shards; s != NULL; s = s->next)
+		comm_matrix_merge(&row, &s->matrix);
+	if(comm_matrix_write(&row, comm_matrix_file, MPI_COMM_WORLD) != MPI_SUCCESS && rank == 0)
+		printf("Cannot write the communication matrix to %s\n", comm_matrix_file);
+	comm_matrix_free(&row);
+}
+
+/**
+ * Sum the per-thread call counters. calls[NUM_WRAPPED] receives the
+ * number of threads that called MPI.
+ */
+static void merge_shards(unsigned long long int *calls){
+	THREAD_SHARD *s;
+	int i;
+	memset(calls, 0, sizeof(unsigned long long int) * (NUM_WRAPPED + 1));
+	for(s = __atomic_load_n(&shards, __ATOMIC_ACQUIRE); s != NULL; s = s->next){
+		for(i = 0; i < NUM_WRAPPED; i++)
+			calls[i] += s->calls[i];
+		calls[NUM_WRAPPED]++;
+	}
+}
+
+/**
+ * Print the intercepted calls summed over all ranks and the largest
+ * per-rank count. Collective over MPI_COMM_WORLD.
+ */
+static void print_calls(unsigned long long int *calls){
+	unsigned long long int total[NUM_WRAPPED + 1], max[NUM_WRAPPED + 1];
+	int i;
+
+	PMPI_Reduce(calls, total, NUM_WRAPPED + 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	PMPI_Reduce(calls, max, NUM_WRAPPED + 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+	if(rank != 0)
+		return;
+	printf("%-40s\t%12s  %12s\n", "Intercepted call", "Total", "Max per rank");
+	print_filled("",88,'-');
+	for(i = 0; i < NUM_WRAPPED; i++)
+		if(total[i] > 0)
+			printf("%-40s\t%12llu  %12llu\n", wrapped_name[i], total[i], max[i]);
+	printf("%-40s\t%12llu  %12llu\n", "Threads calling MPI", total[NUM_WRAPPED], max[NUM_WRAPPED]);
+	print_filled("",88,'-');
+}
+
+/**
+ * Tool setup shared by MPI_Init and MPI_Init_thread, run right after MPI
+ * is initialized. MPI_T is initialized at the thread level MPI provides.
+ */
+static void gyan_init(){
+	int err, num, i, threadsup;
+	int index;
+	char *shm_name;
+	char default_shm_name[STR_SZ];
+
+	start_time = PMPI_Wtime();
 	/* get global rank */
 	PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
@@ -306,9 +1121,12 @@ int MPI_Init(int *argc, char ***argv){
 	PMPI_Comm_size(MPI_COMM_WORLD, &num_mpi_tasks);
 
 	/* Run MPI_T Initialization */
-	err = MPI_T_init_thread(MPI_THREAD_SINGLE, &threadsup);
+	PMPI_Query_thread(&thread_level);
+	err = MPI_T_init_thread(thread_level, &threadsup);
 	if (err != MPI_SUCCESS)
-		return mpi_init_return;
+		return;
+	if(threadsup < thread_level)
+		thread_level = threadsup;
 
 	/* Print thread support for MPI */
 	if(!rank) {
@@ -333,10 +1151,15 @@ int MPI_Init(int *argc, char ***argv){
 	}
 
 
+	/* Apply the tuning database before the application communicates */
+	tuning_db_file = getenv("MPIT_TUNING_DB");
+	if(tuning_db_file != NULL && strlen(tuning_db_file) > 0)
+		tuning_init(tuning_db_file, rank);
+
 	/* Create a session */
 	err = MPI_T_pvar_session_create(&session);
 	if (err != MPI_SUCCESS)
-		return mpi_init_return;
+		return;
 
 	/* get number of variables */
 	err = MPI_T_pvar_get_num(&num);
@@ -346,7 +1169,7 @@ int MPI_Init(int *argc, char ***argv){
 	}
 
 	if (err != MPI_SUCCESS)
-		return mpi_init_return;
+		return;
 	total_num_of_var = num;
 	// Get the name of the environment variable to look for
 	env_var_name = getenv("MPIT_VAR_TO_TRACE");
@@ -362,48 +1185,15 @@ int MPI_Init(int *argc, char ***argv){
 	}
 
 	/* Allocate handles for all performance variables*/
-	pvar_handles = (MPI_T_pvar_handle*)malloc(sizeof(MPI_T_pvar_handle) * (num + 1));
-	pvar_index = (int*)malloc(sizeof(int) * (num + 1));
-	pvar_count = (int*)malloc(sizeof(int) * (num + 1));
-	memset(pvar_count, 0, sizeof(int) * (num + 1));
-	perf_var_all = (PERF_VAR*)malloc(sizeof(PERF_VAR) * (num + 1));
-	pvar_stat = (STATISTICS**)malloc(sizeof(STATISTICS*) * (num + 1));
-	int total_length_pvar_name = 0;
-	for(i = 0; i < num; i++){
-		namelen = desc_len = STR_SZ;
-		err = MPI_T_pvar_get_info(i/*IN*/,
-				name /*OUT*/,
-				&namelen /*INOUT*/,
-				&verb /*OUT*/,
-				&varclass /*OUT*/,
-				&datatype /*OUT*/,
-				&enumtype /*OUT*/,
-				desc /*desc: OUT*/,
-				&desc_len /*desc_len: INOUT*/,
-				&bind /*OUT*/,
-				&readonly /*OUT*/,
-				&continuous /*OUT*/,
-				&atomic/*OUT*/);
-		perf_var_all[i].pvar_index = -1; // gets setup later
-		perf_var_all[i].name_len = namelen;
-		perf_var_all[i].name = (char*)malloc(sizeof(char) * (namelen + 1));
-		strcpy(perf_var_all[i].name, name);
-		total_length_pvar_name += namelen;
+	pvar_num_watched = 0;
+	allocate_pvar_arrays(num);
+	int total_length_pvar_name = load_perf_var_info(0, num);
 
-		perf_var_all[i].verbosity = verb;
-		perf_var_all[i].var_class = varclass;
-		perf_var_all[i].datatype = datatype;
-		perf_var_all[i].enumtype = enumtype;
-		perf_var_all[i].desc_len = desc_len;
-		perf_var_all[i].desc = (char*)malloc(sizeof(char) * (desc_len + 1));
-		strcpy(perf_var_all[i].desc, desc);
-		perf_var_all[i].binding = bind;
-		perf_var_all[i].readonly = readonly;
-		perf_var_all[i].continuous = continuous;
-		perf_var_all[i].atomic = atomic;
-	}
+	/* Category membership is resolved once here and refreshed on MPI_T_category_changed */
+	category_tree_load(&categories);
 
 	if(set_default == 1){
+		watch_all = TRUE;
 		/*By default, watch all variables in the list.*/
 		//env_var_name = get_pvars_name_list();
 		/* Allocate string buffers */
@@ -427,77 +1217,323 @@ int MPI_Init(int *argc, char ***argv){
 	}
 
 	/* Now, start session for those variables in the watchlist*/
-	pvar_num_watched = 0;
+	watched_categories = (char**)malloc(sizeof(char*) * (strlen(env_var_name) / 2 + 1));
+	watched_category_period = (double*)malloc(sizeof(double) * (strlen(env_var_name) / 2 + 1));
 	char *p = strtok(env_var_name, ";");
-	pvar_value_buffer = (unsigned long long int**)malloc(sizeof(unsigned long long int*) * (num + 1));
-	int max_count = -1;
-	int k;
 	while(p != NULL){
+		/* name@seconds samples the pvar (or category) at its own period */
+		double period = 0;
+		if(strchr(p, '@') != NULL){
+			period = atof(strchr(p, '@') + 1);
+			*strchr(p, '@') = 0;
+			if(period > 0)
+				periods_given = TRUE;
+		}
+		if(category_tree_find(&categories, p) >= 0){
+			/* a category name stands for all pvars in it and its subcategories */
+			watched_category_period[num_watched_categories] = period;
+			watched_categories[num_watched_categories++] = strdup(p);
+			p = strtok(NULL, ";");
+			continue;
+		}
 		index = get_watched_var_index(p);
 		if(index != NOT_FOUND){
-			pvar_index[pvar_num_watched] = index;
-			perf_var_all[index].pvar_index = pvar_num_watched;
-			err = MPI_T_pvar_handle_alloc(session, index, NULL, &pvar_handles[pvar_num_watched], &pvar_count[pvar_num_watched]);
-			if (err == MPI_SUCCESS){
-				pvar_value_buffer[pvar_num_watched] = (unsigned long long int*)malloc(sizeof(unsigned long long int) * (pvar_count[pvar_num_watched] + 1));
-				pvar_stat[pvar_num_watched] = (STATISTICS*)malloc(sizeof(STATISTICS) * (pvar_count[pvar_num_watched] + 1));
-				memset(pvar_value_buffer[pvar_num_watched], 0, sizeof(unsigned long long int) * pvar_count[pvar_num_watched]);
-				for(k = 0; k < pvar_count[pvar_num_watched]; k++){
-					pvar_value_buffer[pvar_num_watched][k] = 0;
-					pvar_stat[pvar_num_watched][k].max = NEG_INF;
-					pvar_stat[pvar_num_watched][k].min = POS_INF;
-					pvar_stat[pvar_num_watched][k].total = 0;
-
-				}
-				if(max_count < pvar_count[pvar_num_watched])
-					max_count = pvar_count[pvar_num_watched];
-
-				if(perf_var_all[index].continuous == 0){
-					err = MPI_T_pvar_start(session, pvar_handles[pvar_num_watched]);
-				}
-				if (err != MPI_SUCCESS) {
-					return mpi_init_return;
-				}
-				pvar_num_watched++;
+			if (watch_pvar(index, period) != MPI_SUCCESS) {
+				return;
 			}
 		}
 		p = strtok(NULL, ";");
 	}
-	read_value_buffer = (void*)malloc(sizeof(unsigned long long int) * (max_count + 1));
-	max_num_of_state_per_pvar = max_count;
+	if(watch_categories() != MPI_SUCCESS)
+		return;
+
+	/* Periodic sampling and the optional cvar feedback controller */
+	if(getenv("MPIT_SAMPLE_INTERVAL") != NULL)
+		sample_interval = atof(getenv("MPIT_SAMPLE_INTERVAL"));
+	if(periods_given && sample_interval <= 0)
+		sample_interval = DEFAULT_SAMPLE_INTERVAL;
+	if(getenv("MPIT_CONTROLLER_SYNC") != NULL && atoi(getenv("MPIT_CONTROLLER_SYNC")) > 0)
+		controller_sync_period = atoi(getenv("MPIT_CONTROLLER_SYNC"));
+	if(getenv("MPIT_CONTROLLER") != NULL && strlen(getenv("MPIT_CONTROLLER")) > 0){
+		controller_enabled = (controller_init(getenv("MPIT_CONTROLLER"), rank, get_watched_index_by_name) > 0);
+		if(controller_enabled && sample_interval <= 0)
+			sample_interval = DEFAULT_SAMPLE_INTERVAL;
+	}
+	/* MPI_T events, drained from the sampling path */
+	if(getenv("MPIT_EVENTS") != NULL && strlen(getenv("MPIT_EVENTS")) > 0){
+		events_enabled = (events_init(getenv("MPIT_EVENTS"), rank) > 0);
+		if(events_enabled && sample_interval <= 0)
+			sample_interval = DEFAULT_SAMPLE_INTERVAL;
+	}
+	/* Communication matrix, written in MPI_Finalize */
+	comm_matrix_file = getenv("MPIT_COMM_MATRIX");
+	if(comm_matrix_file != NULL && strlen(comm_matrix_file) == 0)
+		comm_matrix_file = NULL;
+	if(comm_matrix_file != NULL){
+		if(getenv("MPIT_COMM_MATRIX_DENSE") != NULL && atoi(getenv("MPIT_COMM_MATRIX_DENSE")) >= 0)
+			comm_matrix_setup(num_mpi_tasks, atoi(getenv("MPIT_COMM_MATRIX_DENSE")));
+		else
+			comm_matrix_setup(num_mpi_tasks, DEFAULT_COMM_MATRIX_DENSE);
+	}
+	/* Sparse top-K reduction of pvars with many elements */
+	if(getenv("MPIT_TOPK_THRESHOLD") != NULL && atoi(getenv("MPIT_TOPK_THRESHOLD")) >= 0)
+		topk_threshold = atoi(getenv("MPIT_TOPK_THRESHOLD"));
+	if(getenv("MPIT_TOPK") != NULL && atoi(getenv("MPIT_TOPK")) > 0)
+		topk_size = atoi(getenv("MPIT_TOPK"));
+	/* Time series of the sampled values, written with the report */
+	if(getenv("MPIT_SERIES") != NULL && atoi(getenv("MPIT_SERIES")) > 0){
+		series_capacity = atoi(getenv("MPIT_SERIES"));
+		if(sample_interval <= 0)
+			sample_interval = DEFAULT_SAMPLE_INTERVAL;
+	}
+	series_width = pvar_num_values;
+	series_pvars = pvar_num_watched;
+	/* Per-rank traces of the samples, for gyan_report */
+	if(getenv("MPIT_TRACE") != NULL && strlen(getenv("MPIT_TRACE")) > 0){
+		TRACE_PVAR *trace_pvars = (TRACE_PVAR*)calloc(series_pvars + 1, sizeof(TRACE_PVAR));
+		if(sample_interval <= 0)
+			sample_interval = DEFAULT_SAMPLE_INTERVAL;
+		for(i = 0; i < series_pvars; i++){
+			strncpy(trace_pvars[i].name, perf_var_all[pvar_index[i]].name, TRACE_NAME_SZ - 1);
+			strncpy(trace_pvars[i].var_class, get_pvar_class(perf_var_all[pvar_index[i]].var_class), TRACE_CLASS_SZ - 1);
+			trace_pvars[i].count = pvar_count[i];
+			trace_pvars[i].offset = pvar_offset[i];
+		}
+		trace_enabled = trace_open(getenv("MPIT_TRACE"), rank, num_mpi_tasks, trace_pvars,
+				series_pvars, series_width, sample_interval);
+		free(trace_pvars);
+	}
+	/* Adaptive per-pvar sampling within an overhead budget, around the
+	 * sample interval */
+	if(getenv("MPIT_SAMPLE_BUDGET") != NULL && sampler_parse_budget(getenv("MPIT_SAMPLE_BUDGET")) > 0){
+		if(sample_interval <= 0)
+			sample_interval = DEFAULT_SAMPLE_INTERVAL;
+		sampler_setup(sample_interval, sampler_parse_budget(getenv("MPIT_SAMPLE_BUDGET")));
+		adaptive_sampling = TRUE;
+	}
+	record_intervals = adaptive_sampling || periods_given;
+	/* the timer wheel ticks at the shortest interval a pvar can have */
+	wheel_tick = adaptive_sampling ? sample_interval / SAMPLER_RANGE : sample_interval;
+	for(i = 0; i < pvar_num_watched; i++)
+		if(pvar_period[i] > 0 && pvar_period[i] < wheel_tick)
+			wheel_tick = pvar_period[i];
+	/* Live export for node-local monitors, with room for as many new pvars
+	 * as the library exposes now. The metrics endpoint reads the same
+	 * segment and gets a per-job name when no export was requested. */
+	shm_name = getenv("MPIT_SHM_EXPORT");
+	if(getenv("MPIT_METRICS") != NULL && strlen(getenv("MPIT_METRICS")) > 0 &&
+			(shm_name == NULL || strlen(shm_name) == 0)){
+		int pid = getpid();
+		PMPI_Bcast(&pid, 1, MPI_INT, 0, MPI_COMM_WORLD);
+		snprintf(default_shm_name, sizeof(default_shm_name), "gyan.%d", pid);
+		shm_name = default_shm_name;
+	}
+	if(shm_name != NULL && strlen(shm_name) > 0){
+		if(sample_interval <= 0)
+			sample_interval = DEFAULT_SAMPLE_INTERVAL;
+		shm_enabled = shm_export_init(shm_name, rank, 2 * total_num_of_var,
+				pvar_num_values + total_num_of_var, sample_interval);
+		export_watched(0);
+	}
+	if(shm_enabled && getenv("MPIT_METRICS") != NULL && strlen(getenv("MPIT_METRICS")) > 0){
+		int node_rank;
+		void *segment = shm_export_segment(&node_rank);
+		metrics_enabled = metrics_init(getenv("MPIT_METRICS"), segment, node_rank, rank);
+	}
+	shard_reserve(get_shard());
 
 	assert(num >= pvar_num_watched);
-	assert(pvar_value_buffer != NULL);
 	/* iterate unit variable is found */
 	tool_enabled = TRUE;
-	num_send = 0;
-	num_isend = 0;
-	num_recv = 0;
-	num_irecv = 0;
+}
+
+int MPI_Init(int *argc, char ***argv){
+	int mpi_init_return;
+
+	if(DEBUG)printf("********** Interception starts **********\n");
+	/* Run MPI Initialization */
+	mpi_init_return = PMPI_Init(argc, argv);
+	if (mpi_init_return == MPI_SUCCESS)
+		gyan_init();
 	return mpi_init_return;
 }
 
+int MPI_Init_thread(int *argc, char ***argv, int required, int *provided){
+	int mpi_init_return;
+
+	if(DEBUG)printf("********** Interception starts **********\n");
+	mpi_init_return = PMPI_Init_thread(argc, argv, required, provided);
+	if (mpi_init_return == MPI_SUCCESS)
+		gyan_init();
+	return mpi_init_return;
+}
+
+int MPI_Send(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm){
+	THREAD_SHARD *shard = get_shard();
+	shard->calls[WRAP_SEND]++;
+	sample_tick(shard, FALSE);
+	if(comm_matrix_file != NULL)
+		comm_matrix_send(&shard->matrix, comm, dest, count, datatype);
+	return PMPI_Send(buf, count, datatype, dest, tag, comm);
+}
+
+int MPI_Isend(const void *buf, int count, MPI_Datatype datatype, int dest, int tag,
+		MPI_Comm comm, MPI_Request *request){
+	THREAD_SHARD *shard = get_shard();
+	shard->calls[WRAP_ISEND]++;
+	sample_tick(shard, FALSE);
+	if(comm_matrix_file != NULL)
+		comm_matrix_send(&shard->matrix, comm, dest, count, datatype);
+	return PMPI_Isend(buf, count, datatype, dest, tag, comm, request);
+}
+
+int MPI_Recv(void *buf, int count, MPI_Datatype datatype, int source, int tag,
+		MPI_Comm comm, MPI_Status *status){
+	THREAD_SHARD *shard = get_shard();
+	shard->calls[WRAP_RECV]++;
+	sample_tick(shard, FALSE);
+	return PMPI_Recv(buf, count, datatype, source, tag, comm, status);
+}
+
+int MPI_Irecv(void *buf, int count, MPI_Datatype datatype, int source, int tag,
+		MPI_Comm comm, MPI_Request *request){
+	THREAD_SHARD *shard = get_shard();
+	shard->calls[WRAP_IRECV]++;
+	sample_tick(shard, FALSE);
+	return PMPI_Irecv(buf, count, datatype, source, tag, comm, request);
+}
+
+int MPI_Barrier(MPI_Comm comm){
+	THREAD_SHARD *shard = get_shard();
+	shard->calls[WRAP_BARRIER]++;
+	sample_tick(shard, comm == MPI_COMM_WORLD);
+	return PMPI_Barrier(comm);
+}
+
+int MPI_Bcast(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm){
+	THREAD_SHARD *shard = get_shard();
+	shard->calls[WRAP_BCAST]++;
+	sample_tick(shard, comm == MPI_COMM_WORLD);
+	if(thread_level != MPI_THREAD_MULTIPLE)
+		tuning_switch(TUNED_BCAST, count, datatype, comm);
+	if(comm_matrix_file != NULL)
+		comm_matrix_collective(&shard->matrix, comm, root, count, datatype);
+	return PMPI_Bcast(buffer, count, datatype, root, comm);
+}
+
+int MPI_Allreduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		MPI_Op op, MPI_Comm comm){
+	THREAD_SHARD *shard = get_shard();
+	shard->calls[WRAP_ALLREDUCE]++;
+	sample_tick(shard, comm == MPI_COMM_WORLD);
+	if(thread_level != MPI_THREAD_MULTIPLE)
+		tuning_switch(TUNED_ALLREDUCE, count, datatype, comm);
+	if(comm_matrix_file != NULL)
+		comm_matrix_collective(&shard->matrix, comm, -1, count, datatype);
+	return PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm);
+}
+
+int MPI_Comm_free(MPI_Comm *comm){
+	if(comm_matrix_file != NULL)
+		comm_matrix_comm_freed(*comm);
+	return PMPI_Comm_free(comm);
+}
+
+/**
+ * With MPIT_TRACE, MPI_Pcontrol(1, "name") enters the region name and
+ * MPI_Pcontrol(-1, "name") leaves the innermost region of the calling
+ * thread. Both record a sample, so the values between them are
+ * attributed to the region. Other levels are passed on.
+ */
+int MPI_Pcontrol(const int level, ...){
+	THREAD_SHARD *shard;
+	va_list ap;
+	const char *name;
+
+	if(!tool_enabled || !trace_enabled || (level != 1 && level != -1))
+		return PMPI_Pcontrol(level);
+	shard = get_shard();
+	if(level == 1){
+		va_start(ap, level);
+		name = va_arg(ap, const char*);
+		va_end(ap);
+		if(shard->region_depth < TRACE_MAX_DEPTH)
+			shard->regions[shard->region_depth] = trace_region(name ? name : "");
+		shard->region_depth++;
+	}
+	else if(shard->region_depth > 0)
+		shard->region_depth--;
+	pvar_read_all(shard);
+	trace_sample(&shard->trace, PMPI_Wtime() - start_time, shard->thread, current_region(shard), shard->values);
+	return PMPI_Pcontrol(level);
+}
+
 int MPI_Finalize(void)
 {
-	pvar_read_all();
+	int i;
+	unsigned long long int calls[NUM_WRAPPED + 1];
+	THREAD_SHARD *shard = get_shard();
+	REPORT report;
+
+	/* all other threads are done with MPI, the shards can be merged */
+	refresh_watch_list();
+	pvar_read_all(shard);
+	if(trace_enabled){
+		THREAD_SHARD *s;
+		shard->region_depth = 0;
+		trace_sample(&shard->trace, PMPI_Wtime() - start_time, shard->thread, TRACE_NO_REGION, shard->values);
+		for(s = shards; s != NULL; s = s->next)
+			trace_flush(&s->trace);
+		trace_close();
+	}
+	if(shm_enabled)
+		shm_export_publish(shard->values, shard->num_read, pvar_num_values);
+	merge_shards(calls);
+	PMPI_Allreduce(&pvar_num_watched, &pvar_num_reduced, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	layout_reduced(shard->values);
 	/**
 	 * Collect statistics from all ranks onto root
 	 */
-	collect_range_with_loc_from_all_ranks(MPI_MINLOC);
-	collect_range_with_loc_from_all_ranks(MPI_MAXLOC);
-	collect_sum_from_all_ranks(MPI_SUM);
+	collect_from_all_ranks();
 
 	if(rank == 0){
-		print_filled("",88,'-');
-		printf("Performance profiling for the complete MPI job:\n");
-		print_filled("",88,'-');
-		print_pvar_buffer_all();
-		print_filled("",88,'-');
+		if(report_open(&report, getenv("MPIT_REPORT_FORMAT"), getenv("MPIT_REPORT_FILE")) != 0){
+			printf("Cannot write the report to the requested format or file, using text on stdout\n");
+			report_open(&report, NULL, NULL);
+		}
+		report_stats(&report);
+		if(num_node_rows > 0)
+			report_nodes(&report, node_rows, num_node_rows);
+		free(node_rows);
+		if(num_sparse > 0)
+			report_top_elements(&report);
 	}
+	if(series_capacity > 0)
+		report_all_series(&report);
+	if(rank == 0)
+		report_close(&report);
+	print_calls(calls);
+	if(comm_matrix_file != NULL)
+		write_comm_matrix();
 	stop_watching();
 	clean_up_perf_var_all(total_num_of_var);
-	clean_up_pvar_value_buffer(pvar_num_watched);
+	clean_up_shards();
 	clean_up_the_rest();
+	tuning_finalize();
+	if(controller_enabled)
+		controller_finalize();
+	if(events_enabled)
+		events_finalize();
+	if(metrics_enabled)
+		metrics_finalize();
+	if(shm_enabled)
+		shm_export_finalize();
+	enum_cache_free();
+	category_tree_free(&categories);
+	for(i = 0; i < num_watched_categories; i++)
+		free(watched_categories[i]);
+	free(watched_categories);
+	free(watched_category_period);
 	PMPI_Barrier(MPI_COMM_WORLD);
 	MPI_T_finalize();
 	return PMPI_Finalize();
@@ -0,0 +1,376 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * gyan_compare.c
+ *
+ * Compare the pvars of two sets of runs, e.g. before and after an MPI
+ * upgrade or a cvar change, from the per-rank traces Gyan writes with
+ * MPIT_TRACE. Each side is one or more runs; the final value of every
+ * rank of every run is one observation. Pvar elements are aligned by
+ * name, class and element index, so the runs need not watch the same
+ * pvars in the same order.
+ *
+ * Every element is tested with the Mann-Whitney rank-sum test (normal
+ * approximation with tie correction); the effect size is Cliff's delta,
+ * the probability that a new value is larger than a baseline value minus
+ * the probability that it is smaller. Elements are listed by the size of
+ * the effect. The exit status is 2 when an element changed significantly,
+ * so the comparison can gate an upgrade. Serial, does not call MPI.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace_layout.h"
+
+#define FALSE 0
+#define TRUE 1
+#define BASE 0
+#define NEW 1
+#define DEFAULT_ALPHA 0.01
+#define DEFAULT_EFFECT 0.147 // |Cliff's delta| below this is negligible
+
+/* observations of one pvar element on both sides */
+typedef struct{
+	char name[TRACE_NAME_SZ];
+	char var_class[TRACE_CLASS_SZ];
+	int element;
+	uint64_t *values[2];
+	int num[2], capacity[2];
+	double mean[2];
+	double delta; // Cliff's delta of NEW against BASE
+	double p; // two-sided
+}ELEMENT;
+
+/* a value with its side, for ranking both sides together */
+typedef struct{
+	uint64_t value;
+	int side;
+}OBSERVATION;
+
+static ELEMENT *elements = NULL;
+static int num_elements = 0, elements_capacity = 0;
+
+/* pvar table of the previous trace and its elements, reused for the
+ * other traces of the same run */
+static TRACE_PVAR *map_pvars = NULL;
+static int map_num_pvars = -1;
+static int *map = NULL; // first element of every pvar
+
+static int runs[2];
+
+static void usage(int e){
+	printf("Usage: gyan_compare [-a <alpha>] [-e <effect>] [-o <file>] -b <trace|prefix> [-b ...]\n");
+	printf("                    <trace|prefix>...\n");
+	printf("    -b = Baseline run, repeat for repeated runs\n");
+	printf("    -a = Significance level of the rank test (default: %.2lf)\n", DEFAULT_ALPHA);
+	printf("    -e = Smallest |Cliff's delta| reported as a change (default: %.3lf)\n", DEFAULT_EFFECT);
+	printf("    -o = Output file (default: stdout)\n");
+	printf("    -h = This help text\n");
+	printf("The remaining arguments are the new runs. Runs are given by their traces,\n");
+	printf("written with MPIT_TRACE=<prefix>; a prefix stands for <prefix>.0, <prefix>.1,\n");
+	printf("... up to the first missing rank. Exits with 2 if any pvar changed.\n");
+	exit(e);
+}
+
+static void line(FILE *fp){
+	int i;
+	for(i = 0; i < 88; i++)
+		fputc('-', fp);
+	fputc('\n', fp);
+}
+
+static int find_element(const TRACE_PVAR *p, int element){
+	int i;
+
+	for(i = 0; i < num_elements; i++)
+		if(elements[i].element == element && strncmp(elements[i].name, p->name, TRACE_NAME_SZ) == 0 &&
+				strncmp(elements[i].var_class, p->var_class, TRACE_CLASS_SZ) == 0)
+			return i;
+	if(num_elements == elements_capacity){
+		elements_capacity = (elements_capacity == 0) ? 64 : 2 * elements_capacity;
+		elements = (ELEMENT*)realloc(elements, sizeof(ELEMENT) * elements_capacity);
+	}
+	memset(&elements[num_elements], 0, sizeof(ELEMENT));
+	strncpy(elements[num_elements].name, p->name, TRACE_NAME_SZ - 1);
+	strncpy(elements[num_elements].var_class, p->var_class, TRACE_CLASS_SZ - 1);
+	elements[num_elements].element = element;
+	return num_elements++;
+}
+
+/**
+ * Map the elements of a trace's pvars to ELEMENTs. Consecutive traces of
+ * a run share their pvar table, so the map is only rebuilt when it differs.
+ */
+static void map_pvars_of(const TRACE_PVAR *pvars, int num_pvars){
+	int i, e, n = 0;
+
+	if(num_pvars == map_num_pvars && memcmp(pvars, map_pvars, sizeof(TRACE_PVAR) * num_pvars) == 0)
+		return;
+	map_pvars = (TRACE_PVAR*)realloc(map_pvars, sizeof(TRACE_PVAR) * (num_pvars + 1));
+	memcpy(map_pvars, pvars, sizeof(TRACE_PVAR) * num_pvars);
+	map_num_pvars = num_pvars;
+	for(i = 0; i < num_pvars; i++)
+		n += pvars[i].count;
+	map = (int*)realloc(map, sizeof(int) * (n + 1));
+	for(i = 0, n = 0; i < num_pvars; i++)
+		for(e = 0; e < pvars[i].count; e++)
+			map[n++] = find_element(&pvars[i], e);
+}
+
+static void add_value(ELEMENT *el, int side, uint64_t value){
+	if(el->num[side] == el->capacity[side]){
+		el->capacity[side] = (el->capacity[side] == 0) ? 256 : 2 * el->capacity[side];
+		el->values[side] = (uint64_t*)realloc(el->values[side], sizeof(uint64_t) * el->capacity[side]);
+	}
+	el->values[side][el->num[side]++] = value;
+}
+
+/**
+ * Add the final values of one rank, those of its latest sample, to side.
+ * The trace is streamed through a read-only mapping.
+ */
+static int read_trace(const char *path, int side){
+	const TRACE_HEADER *h;
+	const TRACE_PVAR *pvars;
+	const TRACE_RECORD *rec;
+	const uint64_t *last = NULL;
+	double last_time = -1;
+	size_t off, sample_size;
+	struct stat st;
+	char *base;
+	int fd, i, n = 0;
+
+	if((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TRACE_HEADER)){
+		fprintf(stderr, "Cannot read the trace %s\n", path);
+		if(fd >= 0)
+			close(fd);
+		return FALSE;
+	}
+	base = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(base == MAP_FAILED)
+		return FALSE;
+	madvise(base, st.st_size, MADV_SEQUENTIAL);
+	h = (const TRACE_HEADER*)base;
+	off = sizeof(TRACE_HEADER) + sizeof(TRACE_PVAR) * (size_t)h->num_pvars;
+	if(memcmp(h->magic, TRACE_MAGIC, sizeof(h->magic)) != 0 || h->num_pvars < 0 || off > (size_t)st.st_size){
+		fprintf(stderr, "%s is not a Gyan trace\n", path);
+		munmap(base, st.st_size);
+		return FALSE;
+	}
+	pvars = (const TRACE_PVAR*)(base + sizeof(TRACE_HEADER));
+	sample_size = sizeof(TRACE_SAMPLE) + sizeof(uint64_t) * h->num_values;
+	while(off + sizeof(TRACE_RECORD) <= (size_t)st.st_size){
+		rec = (const TRACE_RECORD*)(base + off);
+		off += sizeof(TRACE_RECORD);
+		if(off + rec->length > (size_t)st.st_size)
+			break;
+		if(rec->type == TRACE_REC_SAMPLE && rec->length >= sample_size &&
+				((const TRACE_SAMPLE*)(base + off))->time >= last_time){
+			last_time = ((const TRACE_SAMPLE*)(base + off))->time;
+			last = (const uint64_t*)(base + off + sizeof(TRACE_SAMPLE));
+		}
+		off += rec->length;
+	}
+	if(last != NULL){
+		map_pvars_of(pvars, h->num_pvars);
+		for(i = 0; i < h->num_pvars; i++)
+			n += pvars[i].count;
+		for(i = 0; i < n && i < h->num_values; i++)
+			add_value(&elements[map[i]], side, last[i]);
+	}
+	munmap(base, st.st_size);
+	return last != NULL;
+}
+
+/**
+ * Read the traces of one run, a trace file or a prefix.
+ */
+static void add_run(const char *name, int side){
+	char path[4096];
+	struct stat st;
+	int rank, num = 0;
+
+	if(stat(name, &st) == 0 && S_ISREG(st.st_mode))
+		num = read_trace(name, side);
+	else
+		for(rank = 0; ; rank++){
+			snprintf(path, sizeof(path), "%s.%d", name, rank);
+			if(stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+				break;
+			num += read_trace(path, side);
+		}
+	if(num == 0){
+		fprintf(stderr, "No samples in %s or %s.0, ...\n", name, name);
+		exit(1);
+	}
+	runs[side]++;
+}
+
+static int compare_observations(const void *a, const void *b){
+	uint64_t va = ((const OBSERVATION*)a)->value, vb = ((const OBSERVATION*)b)->value;
+	return (va > vb) - (va < vb);
+}
+
+/**
+ * Mann-Whitney test of the element with the normal approximation, a
+ * continuity correction and the variance corrected for ties.
+ */
+static void rank_test(ELEMENT *el, OBSERVATION *obs){
+	double n1 = el->num[BASE], n2 = el->num[NEW], n = n1 + n2;
+	double rank_sum = 0, ties = 0, u, mean, var, z, t;
+	int i, j, k, total = el->num[BASE] + el->num[NEW];
+
+	el->mean[BASE] = el->mean[NEW] = 0;
+	for(i = 0; i < el->num[BASE]; i++){
+		obs[i].value = el->values[BASE][i];
+		obs[i].side = BASE;
+		el->mean[BASE] += (double)obs[i].value / n1;
+	}
+	for(i = 0; i < el->num[NEW]; i++){
+		obs[el->num[BASE] + i].value = el->values[NEW][i];
+		obs[el->num[BASE] + i].side = NEW;
+		el->mean[NEW] += (double)el->values[NEW][i] / n2;
+	}
+	qsort(obs, total, sizeof(OBSERVATION), compare_observations);
+	for(i = 0; i < total; i = j){
+		for(j = i + 1; j < total && obs[j].value == obs[i].value; j++)
+			;
+		/* tied values share the average of their ranks i+1 .. j */
+		for(k = i; k < j; k++)
+			if(obs[k].side == BASE)
+				rank_sum += (i + 1 + j) / 2.0;
+		t = j - i;
+		ties += t * t * t - t;
+	}
+	u = rank_sum - n1 * (n1 + 1) / 2; // baseline values larger than new ones, ties count half
+	el->delta = 1 - 2 * u / (n1 * n2);
+	mean = n1 * n2 / 2;
+	var = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+	if(var <= 0){
+		el->p = 1;
+		return;
+	}
+	z = fabs(u - mean) - 0.5;
+	if(z < 0)
+		z = 0;
+	el->p = erfc(z / sqrt(var) / sqrt(2.0));
+}
+
+static int compare_impact(const void *a, const void *b){
+	const ELEMENT *ea = (const ELEMENT*)a, *eb = (const ELEMENT*)b;
+	if(fabs(ea->delta) != fabs(eb->delta))
+		return (fabs(ea->delta) < fabs(eb->delta)) ? 1 : -1;
+	return (ea->p > eb->p) - (ea->p < eb->p);
+}
+
+int main(int argc, char *argv[]){
+	FILE *fp = stdout;
+	char *out_file = NULL, name[TRACE_NAME_SZ + 16], change[32];
+	double alpha = DEFAULT_ALPHA, effect = DEFAULT_EFFECT;
+	int opt, errarg = FALSE, i, max_obs = 0, num_compared = 0, num_changed = 0;
+	OBSERVATION *obs;
+	ELEMENT *el;
+
+	while((opt = getopt(argc, argv, "ha:e:o:b:")) != -1){
+		switch(opt){
+		case 'a':
+			alpha = atof(optarg);
+			if(alpha <= 0 || alpha >= 1)
+				errarg = TRUE;
+			break;
+		case 'e':
+			effect = atof(optarg);
+			if(effect < 0 || effect > 1)
+				errarg = TRUE;
+			break;
+		case 'o':
+			out_file = optarg;
+			break;
+		case 'b':
+			add_run(optarg, BASE);
+			break;
+		case 'h':
+		default:
+			errarg = TRUE;
+			break;
+		}
+	}
+	if(errarg || runs[BASE] == 0 || optind == argc)
+		usage(1);
+	for(i = optind; i < argc; i++)
+		add_run(argv[i], NEW);
+
+	for(i = 0; i < num_elements; i++)
+		if(elements[i].num[BASE] + elements[i].num[NEW] > max_obs)
+			max_obs = elements[i].num[BASE] + elements[i].num[NEW];
+	obs = (OBSERVATION*)malloc(sizeof(OBSERVATION) * (max_obs + 1));
+	for(i = 0; i < num_elements; i++){
+		el = &elements[i];
+		if(el->num[BASE] == 0 || el->num[NEW] == 0)
+			continue;
+		rank_test(el, obs);
+		num_compared++;
+		if(el->p < alpha && fabs(el->delta) >= effect)
+			num_changed++;
+	}
+	free(obs);
+	qsort(elements, num_elements, sizeof(ELEMENT), compare_impact);
+
+	if(out_file != NULL && (fp = fopen(out_file, "w")) == NULL){
+		printf("Cannot write %s\n", out_file);
+		return 1;
+	}
+	line(fp);
+	fprintf(fp, "Pvar changes from %d baseline to %d new runs, by effect size (Cliff's delta):\n", runs[BASE], runs[NEW]);
+	line(fp);
+	fprintf(fp, "%-40s\tType   %14s %14s %9s %7s %9s\n", "Variable Name", "Baseline avg", "New avg", "Change", "Delta", "p-value");
+	line(fp);
+	for(i = 0; i < num_elements; i++){
+		el = &elements[i];
+		if(el->num[BASE] == 0 || el->num[NEW] == 0)
+			continue;
+		snprintf(name, sizeof(name), "%s[%d]", el->name, el->element);
+		if(el->mean[BASE] != 0)
+			snprintf(change, sizeof(change), "%+.1lf%%", 100 * (el->mean[NEW] - el->mean[BASE]) / el->mean[BASE]);
+		else
+			snprintf(change, sizeof(change), "%s", (el->mean[NEW] == 0) ? "0.0%" : "new");
+		fprintf(fp, "%-40s\t%-7s%14.2lf %14.2lf %9s %+7.3lf %9.2e%s\n", name, el->var_class,
+				el->mean[BASE], el->mean[NEW], change, el->delta, el->p,
+				(el->p < alpha && fabs(el->delta) >= effect) ? "  *" : "");
+	}
+	line(fp);
+	fprintf(fp, "%d of %d pvar elements changed (* p < %g and |delta| >= %.3lf)\n", num_changed, num_compared, alpha, effect);
+	for(i = 0; i < num_elements; i++)
+		if(elements[i].num[BASE] == 0 || elements[i].num[NEW] == 0)
+			fprintf(fp, "%s[%d] (%s) only in the %s runs\n", elements[i].name, elements[i].element,
+					elements[i].var_class, elements[i].num[BASE] ? "baseline" : "new");
+	if(fp != stdout)
+		fclose(fp);
+	return (num_changed > 0) ? 2 : 0;
+}
@@ -0,0 +1,595 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * gyan_place.c
+ *
+ * Offline rank placement from the communication matrix Gyan writes with
+ * MPIT_COMM_MATRIX. The ranks are partitioned over the nodes so that as
+ * few bytes as possible cross node boundaries: a greedy graph-growing
+ * pass fills one node at a time with the ranks most connected to it, then
+ * swap refinement (Kernighan-Lin style) exchanges pairs of ranks between
+ * nodes while that lowers the inter-node traffic. Block placement and
+ * partitions grown from several first ranks are refined, and the best
+ * one is kept. The result is written
+ * as an Open MPI rankfile or a Slurm hostfile for --distribution=arbitrary,
+ * together with the predicted traffic compared to block placement.
+ * Serial, does not call MPI.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "comm_matrix_layout.h"
+
+#define FALSE 0
+#define TRUE 1
+#define HOST_SZ 256
+#define DEFAULT_PASSES 10
+#define DEFAULT_ATTEMPTS 8 // grown partitions tried, each from another first rank
+
+#define FORMAT_OPENMPI 0
+#define FORMAT_SLURM 1
+
+/* undirected communication graph, bytes in both directions summed */
+typedef struct{
+	int num_ranks;
+	int64_t *adj_ptr; // neighbors of rank r: [adj_ptr[r], adj_ptr[r+1])
+	int *adj;
+	uint64_t *weight;
+}GRAPH;
+
+typedef struct{
+	char name[HOST_SZ];
+	int capacity; // slots
+	int fill;
+	int *members; // ranks placed on the node, capacity entries
+}NODE;
+
+typedef struct{
+	uint64_t conn;
+	int rank;
+}HEAP_ENTRY;
+
+typedef struct{
+	int64_t a, b;
+	uint64_t bytes;
+}EDGE;
+
+static void usage(int e){
+	printf("Usage: gyan_place [-H <hostfile> | -n <nodes>] [-r <ranks per node>] [-f openmpi|slurm]\n");
+	printf("                  [-o <file>] [-p <passes>] <matrix>\n");
+	printf("    -H = Hosts to place the ranks on, one per line as <host>, <host>:<slots>\n");
+	printf("         or <host> slots=<slots>\n");
+	printf("    -n = Number of nodes when no hostfile is given (rankfile uses +n<i>)\n");
+	printf("    -r = Ranks per node (default: as many as needed to fit all ranks)\n");
+	printf("    -f = Output format: Open MPI rankfile (default) or Slurm hostfile\n");
+	printf("    -o = Output file (default: gyan.rankfile or gyan.hostfile)\n");
+	printf("    -p = Maximum number of refinement passes (default: %d)\n", DEFAULT_PASSES);
+	printf("    -h = This help text\n");
+	printf("<matrix> is the file written by a job run with MPIT_COMM_MATRIX.\n");
+	exit(e);
+}
+
+static int compare_edges(const void *x, const void *y){
+	const EDGE *a = (const EDGE*)x, *b = (const EDGE*)y;
+	if(a->a != b->a)
+		return (a->a > b->a) - (a->a < b->a);
+	return (a->b > b->b) - (a->b < b->b);
+}
+
+/**
+ * Read the CSR matrix and fold it into an undirected graph.
+ * @return 0 on success
+ */
+static int load_graph(char *file, GRAPH *g){
+	COMM_MATRIX_HEADER header;
+	FILE *fp = fopen(file, "rb");
+	int64_t *row_ptr, *col, i, k, n, num_edges = 0;
+	uint64_t *messages, *bytes;
+	EDGE *edges;
+	int r, ok;
+
+	if(fp == NULL){
+		printf("Cannot open %s\n", file);
+		return -1;
+	}
+	if(fread(&header, sizeof(header), 1, fp) != 1 ||
+			memcmp(header.magic, COMM_MATRIX_MAGIC, sizeof(header.magic)) != 0 ||
+			header.num_ranks <= 0 || header.nnz < 0){
+		printf("%s is not a Gyan communication matrix\n", file);
+		fclose(fp);
+		return -1;
+	}
+	n = header.num_ranks;
+	row_ptr = (int64_t*)malloc(sizeof(int64_t) * (n + 1));
+	col = (int64_t*)malloc(sizeof(int64_t) * (header.nnz + 1));
+	messages = (uint64_t*)malloc(sizeof(uint64_t) * (header.nnz + 1));
+	bytes = (uint64_t*)malloc(sizeof(uint64_t) * (header.nnz + 1));
+	ok = fread(row_ptr, sizeof(int64_t), n + 1, fp) == (size_t)(n + 1) &&
+			fread(col, sizeof(int64_t), header.nnz, fp) == (size_t)header.nnz &&
+			fread(messages, sizeof(uint64_t), header.nnz, fp) == (size_t)header.nnz &&
+			fread(bytes, sizeof(uint64_t), header.nnz, fp) == (size_t)header.nnz;
+	fclose(fp);
+	if(!ok){
+		printf("%s is truncated\n", file);
+		return -1;
+	}
+
+	/* one edge per unordered pair, both directions summed */
+	edges = (EDGE*)malloc(sizeof(EDGE) * (header.nnz + 1));
+	for(r = 0; r < n; r++){
+		for(k = row_ptr[r]; k < row_ptr[r + 1] && k < header.nnz; k++){
+			if(col[k] == r || col[k] < 0 || col[k] >= n || bytes[k] == 0)
+				continue;
+			edges[num_edges].a = (r < col[k]) ? r : col[k];
+			edges[num_edges].b = (r < col[k]) ? col[k] : r;
+			edges[num_edges].bytes = bytes[k];
+			num_edges++;
+		}
+	}
+	qsort(edges, num_edges, sizeof(EDGE), compare_edges);
+	for(i = 0, k = 0; i < num_edges; i++){
+		if(k > 0 && edges[k - 1].a == edges[i].a && edges[k - 1].b == edges[i].b)
+			edges[k - 1].bytes += edges[i].bytes;
+		else
+			edges[k++] = edges[i];
+	}
+	num_edges = k;
+
+	g->num_ranks = (int)n;
+	g->adj_ptr = (int64_t*)calloc(n + 1, sizeof(int64_t));
+	g->adj = (int*)malloc(sizeof(int) * (2 * num_edges + 1));
+	g->weight = (uint64_t*)malloc(sizeof(uint64_t) * (2 * num_edges + 1));
+	for(i = 0; i < num_edges; i++){
+		g->adj_ptr[edges[i].a + 1]++;
+		g->adj_ptr[edges[i].b + 1]++;
+	}
+	for(r = 0; r < n; r++)
+		g->adj_ptr[r + 1] += g->adj_ptr[r];
+	memcpy(row_ptr, g->adj_ptr, sizeof(int64_t) * n); // next free entry per rank
+	for(i = 0; i < num_edges; i++){
+		k = row_ptr[edges[i].a]++;
+		g->adj[k] = (int)edges[i].b;
+		g->weight[k] = edges[i].bytes;
+		k = row_ptr[edges[i].b]++;
+		g->adj[k] = (int)edges[i].a;
+		g->weight[k] = edges[i].bytes;
+	}
+	free(edges);
+	free(row_ptr);
+	free(col);
+	free(messages);
+	free(bytes);
+	return 0;
+}
+
+/**
+ * Read the hosts and their slot counts; slots default to ranks_per_node.
+ * @return number of hosts
+ */
+static int load_hosts(char *file, int ranks_per_node, NODE **nodes){
+	FILE *fp = fopen(file, "r");
+	char line[HOST_SZ + 64], *p, *s;
+	int num = 0, max = 16;
+
+	if(fp == NULL){
+		printf("Cannot open %s\n", file);
+		return -1;
+	}
+	*nodes = (NODE*)calloc(max, sizeof(NODE));
+	while(fgets(line, sizeof(line), fp) != NULL){
+		for(p = line; isspace((unsigned char)*p); p++)
+			;
+		if(*p == 0 || *p == '#')
+			continue;
+		if(num == max){
+			max *= 2;
+			*nodes = (NODE*)realloc(*nodes, sizeof(NODE) * max);
+		}
+		memset(&(*nodes)[num], 0, sizeof(NODE));
+		(*nodes)[num].capacity = ranks_per_node;
+		for(s = p; *s != 0 && *s != ':' && !isspace((unsigned char)*s); s++)
+			;
+		if(*s == ':')
+			(*nodes)[num].capacity = atoi(s + 1);
+		else if((s = strstr(s, "slots=")) != NULL)
+			(*nodes)[num].capacity = atoi(s + strlen("slots="));
+		for(s = p; *s != 0 && *s != ':' && !isspace((unsigned char)*s); s++)
+			;
+		*s = 0;
+		strncpy((*nodes)[num].name, p, HOST_SZ - 1);
+		num++;
+	}
+	fclose(fp);
+	return num;
+}
+
+static void heap_push(HEAP_ENTRY *heap, int64_t *size, uint64_t conn, int rank){
+	int64_t i;
+	for(i = (*size)++; i > 0 && heap[(i - 1) / 2].conn < conn; i = (i - 1) / 2)
+		heap[i] = heap[(i - 1) / 2];
+	heap[i].conn = conn;
+	heap[i].rank = rank;
+}
+
+static HEAP_ENTRY heap_pop(HEAP_ENTRY *heap, int64_t *size){
+	HEAP_ENTRY top = heap[0], last = heap[--(*size)];
+	int64_t i = 0, child;
+	for(; (child = 2 * i + 1) < *size; i = child){
+		if(child + 1 < *size && heap[child + 1].conn > heap[child].conn)
+			child++;
+		if(last.conn >= heap[child].conn)
+			break;
+		heap[i] = heap[child];
+	}
+	heap[i] = last;
+	return top;
+}
+
+static void place(NODE *nodes, int *part, int rank, int node){
+	part[rank] = node;
+	nodes[node].members[nodes[node].fill++] = rank;
+}
+
+static void clear_nodes(NODE *nodes, int num_nodes){
+	int node;
+	for(node = 0; node < num_nodes; node++)
+		nodes[node].fill = 0;
+}
+
+/**
+ * Seed of the next node: the unplaced rank with the most bytes to ranks
+ * already placed, so that nodes grow next to each other and the ranks
+ * left for the last nodes stay compact. The lowest unplaced rank when no
+ * unplaced rank talks to a placed one.
+ * @return the rank or -1 if all ranks are placed
+ */
+static int next_seed(GRAPH *g, int *part, uint64_t *to_placed){
+	int r, seed = -1;
+	for(r = 0; r < g->num_ranks; r++)
+		if(part[r] < 0 && (seed < 0 || to_placed[r] > to_placed[seed]))
+			seed = r;
+	return seed;
+}
+
+/**
+ * Greedy graph growing: fill the nodes one after the other, each time
+ * adding the unplaced rank with the most bytes to the ranks already on
+ * the node. The first node starts from rank first.
+ */
+static void grow_partition(GRAPH *g, NODE *nodes, int num_nodes, int *part, int first){
+	HEAP_ENTRY *heap;
+	uint64_t *conn, *to_placed;
+	int64_t size, k;
+	int node, r, nb;
+
+	heap = (HEAP_ENTRY*)malloc(sizeof(HEAP_ENTRY) * (g->adj_ptr[g->num_ranks] + g->num_ranks + 1));
+	conn = (uint64_t*)calloc(g->num_ranks, sizeof(uint64_t));
+	to_placed = (uint64_t*)calloc(g->num_ranks, sizeof(uint64_t));
+	clear_nodes(nodes, num_nodes);
+	for(r = 0; r < g->num_ranks; r++)
+		part[r] = -1;
+	for(node = 0; node < num_nodes; node++){
+		size = 0;
+		while(nodes[node].fill < nodes[node].capacity){
+			/* stale entries are skipped, conn only grows while a node fills */
+			while(size > 0 && (part[heap[0].rank] >= 0 || heap[0].conn != conn[heap[0].rank]))
+				heap_pop(heap, &size);
+			if(size > 0)
+				r = heap_pop(heap, &size).rank;
+			else if(node == 0 && nodes[node].fill == 0)
+				r = first;
+			else if((r = next_seed(g, part, to_placed)) < 0)
+				break;
+			place(nodes, part, r, node);
+			for(k = g->adj_ptr[r]; k < g->adj_ptr[r + 1]; k++){
+				nb = g->adj[k];
+				if(part[nb] >= 0)
+					continue;
+				conn[nb] += g->weight[k];
+				to_placed[nb] += g->weight[k];
+				heap_push(heap, &size, conn[nb], nb);
+			}
+		}
+		/* conn is relative to the node just filled */
+		for(k = 0; k < size; k++)
+			conn[heap[k].rank] = 0;
+	}
+	free(heap);
+	free(conn);
+	free(to_placed);
+}
+
+/**
+ * Bytes rank r exchanges with the ranks on node a and on node b, and with
+ * rank other.
+ */
+static void connections(GRAPH *g, int *part, int r, int a, int b, int other,
+		int64_t *to_a, int64_t *to_b, int64_t *to_other){
+	int64_t k;
+	*to_a = *to_b = *to_other = 0;
+	for(k = g->adj_ptr[r]; k < g->adj_ptr[r + 1]; k++){
+		if(part[g->adj[k]] == a)
+			*to_a += (int64_t)g->weight[k];
+		else if(part[g->adj[k]] == b)
+			*to_b += (int64_t)g->weight[k];
+		if(g->adj[k] == other)
+			*to_other = (int64_t)g->weight[k];
+	}
+}
+
+/**
+ * Swap refinement: for every rank, look for the node it is most connected
+ * to and the partner on that node whose exchange lowers the inter-node
+ * bytes most; moves into free slots need no partner. Stops after a pass
+ * without improvement.
+ * @return number of swaps and moves
+ */
+static int refine_partition(GRAPH *g, NODE *nodes, int num_nodes, int *part, int passes){
+	int64_t *to_node, k, gain, best_gain, own, a_to_q, b_to_own, b_to_q, w_ab;
+	int *touched, num_touched, pass, a, b, q, i, best_q, best_b, best_i, changes = 0, improved;
+
+	to_node = (int64_t*)calloc(num_nodes, sizeof(int64_t));
+	touched = (int*)malloc(sizeof(int) * (num_nodes + 1));
+	for(pass = 0; pass < passes; pass++){
+		improved = 0;
+		for(a = 0; a < g->num_ranks; a++){
+			num_touched = 0;
+			for(k = g->adj_ptr[a]; k < g->adj_ptr[a + 1]; k++){
+				q = part[g->adj[k]];
+				if(to_node[q] == 0)
+					touched[num_touched++] = q;
+				to_node[q] += (int64_t)g->weight[k];
+			}
+			own = to_node[part[a]];
+			best_gain = 0;
+			best_q = best_b = best_i = -1;
+			for(i = 0; i < num_touched; i++){
+				q = touched[i];
+				if(q == part[a] || to_node[q] <= own)
+					continue;
+				if(nodes[q].fill < nodes[q].capacity && to_node[q] - own > best_gain){
+					best_gain = to_node[q] - own;
+					best_q = q;
+					best_b = -1;
+				}
+				for(b = 0; b < nodes[q].fill; b++){
+					connections(g, part, nodes[q].members[b], part[a], q, a, &b_to_own, &b_to_q, &w_ab);
+					a_to_q = to_node[q];
+					gain = (a_to_q - own) + (b_to_own - b_to_q) - 2 * w_ab;
+					if(gain > best_gain){
+						best_gain = gain;
+						best_q = q;
+						best_b = b;
+					}
+				}
+			}
+			for(i = 0; i < num_touched; i++)
+				to_node[touched[i]] = 0;
+			if(best_q < 0)
+				continue;
+			/* take a out of its node */
+			q = part[a];
+			for(best_i = 0; nodes[q].members[best_i] != a; best_i++)
+				;
+			if(best_b < 0){
+				nodes[q].members[best_i] = nodes[q].members[--nodes[q].fill];
+				place(nodes, part, a, best_q);
+			}
+			else{
+				b = nodes[best_q].members[best_b];
+				nodes[q].members[best_i] = b;
+				part[b] = q;
+				nodes[best_q].members[best_b] = a;
+				part[a] = best_q;
+			}
+			improved++;
+		}
+		changes += improved;
+		if(improved == 0)
+			break;
+	}
+	free(to_node);
+	free(touched);
+	return changes;
+}
+
+/**
+ * Bytes exchanged between ranks on different nodes.
+ */
+static uint64_t inter_node_bytes(GRAPH *g, int *part){
+	uint64_t total = 0;
+	int64_t k;
+	int r;
+	for(r = 0; r < g->num_ranks; r++)
+		for(k = g->adj_ptr[r]; k < g->adj_ptr[r + 1]; k++)
+			if(g->adj[k] > r && part[g->adj[k]] != part[r])
+				total += g->weight[k];
+	return total;
+}
+
+static int write_placement(char *file, int format, NODE *nodes, int num_nodes, int *part, int num_ranks){
+	FILE *fp = fopen(file, "w");
+	int *slot, node, i;
+
+	if(fp == NULL){
+		printf("Cannot write %s\n", file);
+		return -1;
+	}
+	slot = (int*)malloc(sizeof(int) * num_ranks);
+	for(node = 0; node < num_nodes; node++)
+		for(i = 0; i < nodes[node].fill; i++)
+			slot[nodes[node].members[i]] = i;
+	for(i = 0; i < num_ranks; i++){
+		if(format == FORMAT_SLURM)
+			fprintf(fp, "%s\n", nodes[part[i]].name);
+		else
+			fprintf(fp, "rank %d=%s slot=%d\n", i, nodes[part[i]].name, slot[i]);
+	}
+	free(slot);
+	fclose(fp);
+	return 0;
+}
+
+int main(int argc, char *argv[]){
+	GRAPH g;
+	NODE *nodes = NULL;
+	char *host_file = NULL, *out_file = NULL;
+	int opt, errarg = FALSE, num_nodes = 0, ranks_per_node = 0, format = FORMAT_OPENMPI;
+	int passes = DEFAULT_PASSES, total_slots, i, node, swaps, attempt, num_attempts, best_swaps = 0;
+	int *part, *block, *best;
+	uint64_t block_bytes, placed_bytes, best_bytes;
+
+	while((opt = getopt(argc, argv, "hH:n:r:f:o:p:")) != -1){
+		switch(opt){
+		case 'H':
+			host_file = optarg;
+			break;
+		case 'n':
+			num_nodes = atoi(optarg);
+			if(num_nodes <= 0)
+				errarg = TRUE;
+			break;
+		case 'r':
+			ranks_per_node = atoi(optarg);
+			if(ranks_per_node <= 0)
+				errarg = TRUE;
+			break;
+		case 'f':
+			if(strcmp(optarg, "openmpi") == 0)
+				format = FORMAT_OPENMPI;
+			else if(strcmp(optarg, "slurm") == 0)
+				format = FORMAT_SLURM;
+			else
+				errarg = TRUE;
+			break;
+		case 'o':
+			out_file = optarg;
+			break;
+		case 'p':
+			passes = atoi(optarg);
+			if(passes < 0)
+				errarg = TRUE;
+			break;
+		case 'h':
+		default:
+			errarg = TRUE;
+			break;
+		}
+	}
+	if(errarg || optind != argc - 1 || (host_file == NULL && num_nodes == 0) ||
+			(host_file == NULL && format == FORMAT_SLURM))
+		usage(1);
+	if(load_graph(argv[optind], &g) != 0)
+		return 1;
+
+	if(host_file != NULL){
+		num_nodes = load_hosts(host_file, ranks_per_node, &nodes);
+		if(num_nodes <= 0){
+			printf("No hosts in %s\n", host_file);
+			return 1;
+		}
+	}
+	else{
+		nodes = (NODE*)calloc(num_nodes, sizeof(NODE));
+		for(node = 0; node < num_nodes; node++){
+			snprintf(nodes[node].name, HOST_SZ, "+n%d", node);
+			nodes[node].capacity = ranks_per_node;
+		}
+	}
+	total_slots = 0;
+	for(node = 0; node < num_nodes; node++){
+		if(nodes[node].capacity <= 0)
+			nodes[node].capacity = (g.num_ranks + num_nodes - 1) / num_nodes;
+		total_slots += nodes[node].capacity;
+		nodes[node].members = (int*)malloc(sizeof(int) * nodes[node].capacity);
+	}
+	if(total_slots < g.num_ranks){
+		printf("%d ranks do not fit into %d slots on %d nodes\n", g.num_ranks, total_slots, num_nodes);
+		return 1;
+	}
+
+	/* block placement, as srun and mpirun place ranks by default */
+	block = (int*)malloc(sizeof(int) * g.num_ranks);
+	for(i = 0, node = 0; i < g.num_ranks; i++){
+		while(nodes[node].fill == nodes[node].capacity)
+			node++;
+		block[i] = node;
+		nodes[node].fill++;
+	}
+	block_bytes = inter_node_bytes(&g, block);
+
+	/* refine block placement and a few grown partitions with different
+	 * first ranks, keep the best; never worse than block placement */
+	part = (int*)malloc(sizeof(int) * g.num_ranks);
+	best = (int*)malloc(sizeof(int) * g.num_ranks);
+	num_attempts = (g.num_ranks < DEFAULT_ATTEMPTS) ? g.num_ranks : DEFAULT_ATTEMPTS;
+	memcpy(best, block, sizeof(int) * g.num_ranks);
+	best_bytes = block_bytes;
+	for(attempt = -1; attempt < num_attempts; attempt++){
+		if(attempt < 0){
+			clear_nodes(nodes, num_nodes);
+			for(i = 0; i < g.num_ranks; i++)
+				place(nodes, part, i, block[i]);
+		}
+		else
+			grow_partition(&g, nodes, num_nodes, part, (int)((int64_t)attempt * g.num_ranks / num_attempts));
+		swaps = refine_partition(&g, nodes, num_nodes, part, passes);
+		placed_bytes = inter_node_bytes(&g, part);
+		if(placed_bytes < best_bytes){
+			memcpy(best, part, sizeof(int) * g.num_ranks);
+			best_bytes = placed_bytes;
+			best_swaps = swaps;
+		}
+	}
+	clear_nodes(nodes, num_nodes);
+	for(i = 0; i < g.num_ranks; i++)
+		place(nodes, part, i, best[i]);
+	placed_bytes = best_bytes;
+	swaps = best_swaps;
+
+	if(out_file == NULL)
+		out_file = (format == FORMAT_SLURM) ? "gyan.hostfile" : "gyan.rankfile";
+	if(write_placement(out_file, format, nodes, num_nodes, part, g.num_ranks) != 0)
+		return 1;
+	printf("%d ranks on %d nodes (%d refinement moves)\n", g.num_ranks, num_nodes, swaps);
+	printf("Inter-node bytes with block placement: %20llu\n", (unsigned long long)block_bytes);
+	printf("Inter-node bytes with this placement:  %20llu\n", (unsigned long long)placed_bytes);
+	if(block_bytes > 0)
+		printf("Predicted reduction: %.1lf%%\n", 100.0 * (double)(block_bytes - placed_bytes) / (double)block_bytes);
+	if(format == FORMAT_SLURM)
+		printf("Run with: SLURM_HOSTFILE=%s srun --distribution=arbitrary ...\n", out_file);
+	else
+		printf("Run with: mpirun --rankfile %s ...\n", out_file);
+
+	for(node = 0; node < num_nodes; node++)
+		free(nodes[node].members);
+	free(nodes);
+	free(part);
+	free(best);
+	free(block);
+	free(g.adj_ptr);
+	free(g.adj);
+	free(g.weight);
+	return 0;
+}
@@ -0,0 +1,629 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * gyan_report.c
+ *
+ * Offline report over the per-rank traces Gyan writes with MPIT_TRACE.
+ * For every pvar element it computes the statistics Gyan prints in
+ * MPI_Finalize from the final values of all ranks, with percentiles over
+ * the ranks, and it breaks the change of every pvar down by MPI_Pcontrol
+ * region and by time window.
+ *
+ * The traces are processed in parallel by a pool of threads with work
+ * stealing: every thread starts with a contiguous block of traces and,
+ * once it runs out, takes half of the remaining block of another thread.
+ * A trace is mapped and read front to back; the pages behind the reader
+ * are released every RELEASE_CHUNK bytes, so memory does not grow with
+ * the length of the traces. Each thread accumulates into its own tables,
+ * which are summed at the end. Serial per trace, does not call MPI.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace_layout.h"
+
+#define FALSE 0
+#define TRUE 1
+#define DEFAULT_WINDOW 1.0 // seconds
+#define RELEASE_CHUNK (16 << 20) // bytes of a mapped trace read before they are released
+#define OUTSIDE 0 // region row of samples outside any region
+#define MAX_REGIONS 65536 // distinct region names over all traces
+
+/* change of one pvar (summed over its elements) in a region or window */
+typedef struct{
+	uint64_t samples;
+	double time; // seconds covered, summed over ranks and threads
+	double change; // increase from the previous sample of the same thread
+	double max; // largest value seen
+}ACC;
+
+/* num_pvars accumulators per row */
+typedef struct{
+	ACC *acc;
+	int rows;
+}TABLE;
+
+/* what a trace thread last sampled */
+typedef struct{
+	int valid;
+	double time;
+	int region; // row in the region table
+	double *sum; // per pvar
+}THREAD_STATE;
+
+typedef struct{
+	uint64_t min, max;
+	int min_rank, max_rank;
+	double average;
+	uint64_t p50, p90, p99;
+}ELEMENT_STATS;
+
+typedef struct worker{
+	int id;
+	pthread_t thread;
+	pthread_mutex_t lock; // guards top and bottom
+	int top, bottom; // tasks [top, bottom) not yet taken
+	TABLE regions, windows;
+	THREAD_STATE *threads;
+	int num_threads;
+	int *region_map; // region id of the current trace to region row
+	int map_size;
+	double *sum; // sums of the current sample
+	uint64_t *scratch; // values of one element over all ranks
+	uint64_t bytes; // trace bytes read
+}WORKER;
+
+static WORKER *workers;
+static int num_workers;
+static void (*run_task)(WORKER *w, int task);
+
+static char **files;
+static int num_files = 0;
+static double window = DEFAULT_WINDOW;
+
+/* taken from the first trace, the others must match */
+static TRACE_PVAR *pvars;
+static int num_pvars, num_values, num_ranks;
+static double sample_interval;
+
+static uint64_t *final_values; // [rank][value], the last sample of every rank
+static char *traced; // ranks whose trace was read
+static ELEMENT_STATS *stats;
+
+static pthread_mutex_t region_lock = PTHREAD_MUTEX_INITIALIZER;
+static char (*region_names)[TRACE_NAME_SZ]; // row r > 0 is region_names[r - 1]
+static int num_regions = 0;
+
+static void usage(int e){
+	printf("Usage: gyan_report [-j <threads>] [-w <seconds>] [-o <file>] <trace|prefix>...\n");
+	printf("    -j = Threads reading the traces (default: one per online CPU)\n");
+	printf("    -w = Length of the time windows (default: %.1lf seconds)\n", DEFAULT_WINDOW);
+	printf("    -o = Output file (default: stdout)\n");
+	printf("    -h = This help text\n");
+	printf("The traces are written by a job run with MPIT_TRACE=<prefix>. A prefix\n");
+	printf("stands for <prefix>.0, <prefix>.1, ... up to the first missing rank.\n");
+	exit(e);
+}
+
+static void line(FILE *fp){
+	int i;
+	for(i = 0; i < 88; i++)
+		fputc('-', fp);
+	fputc('\n', fp);
+}
+
+/**
+ * Accumulator of pvar p in row of a table, growing the table as needed.
+ */
+static ACC *table_acc(TABLE *t, int row, int p){
+	int rows = t->rows;
+
+	if(row >= rows){
+		while(row >= rows)
+			rows = (rows == 0) ? 16 : 2 * rows;
+		t->acc = (ACC*)realloc(t->acc, sizeof(ACC) * rows * num_pvars);
+		memset(t->acc + (size_t)t->rows * num_pvars, 0, sizeof(ACC) * (rows - t->rows) * num_pvars);
+		t->rows = rows;
+	}
+	return t->acc + (size_t)row * num_pvars + p;
+}
+
+static void table_merge(TABLE *into, TABLE *from){
+	int row, p;
+	ACC *a, *b;
+
+	for(row = from->rows - 1; row >= 0; row--)
+		for(p = 0; p < num_pvars; p++){
+			b = from->acc + (size_t)row * num_pvars + p;
+			if(b->samples == 0)
+				continue;
+			a = table_acc(into, row, p);
+			a->samples += b->samples;
+			a->time += b->time;
+			a->change += b->change;
+			if(b->max > a->max)
+				a->max = b->max;
+		}
+}
+
+/**
+ * Row of a region name shared by all traces.
+ */
+static int region_row(const char *name){
+	int r;
+
+	pthread_mutex_lock(&region_lock);
+	for(r = 0; r < num_regions; r++)
+		if(strncmp(region_names[r], name, TRACE_NAME_SZ) == 0)
+			break;
+	if(r == num_regions && num_regions < MAX_REGIONS)
+		strncpy(region_names[num_regions++], name, TRACE_NAME_SZ - 1);
+	pthread_mutex_unlock(&region_lock);
+	return (r < MAX_REGIONS) ? r + 1 : OUTSIDE;
+}
+
+/**
+ * Take the next task of worker w: its own last one, or else half of the
+ * tasks left to another worker, the first of which is returned. Returns
+ * -1 when no tasks are left anywhere.
+ */
+static int next_task(WORKER *w){
+	WORKER *v;
+	int i, task = -1, half;
+
+	pthread_mutex_lock(&w->lock);
+	if(w->top < w->bottom)
+		task = --w->bottom;
+	pthread_mutex_unlock(&w->lock);
+	for(i = 1; task < 0 && i < num_workers; i++){
+		v = &workers[(w->id + i) % num_workers];
+		pthread_mutex_lock(&v->lock);
+		if(v->top < v->bottom){
+			half = (v->bottom - v->top + 1) / 2;
+			task = v->top;
+			v->top += half;
+			pthread_mutex_lock(&w->lock);
+			w->top = task + 1;
+			w->bottom = task + half;
+			pthread_mutex_unlock(&w->lock);
+		}
+		pthread_mutex_unlock(&v->lock);
+	}
+	return task;
+}
+
+static void *worker_main(void *arg){
+	WORKER *w = (WORKER*)arg;
+	int task;
+
+	while((task = next_task(w)) >= 0)
+		run_task(w, task);
+	return NULL;
+}
+
+/**
+ * Run task(w, t) for t in [0, num_tasks) on all workers.
+ */
+static void pool_run(int num_tasks, void (*task)(WORKER *w, int t)){
+	int i;
+
+	run_task = task;
+	for(i = 0; i < num_workers; i++){
+		workers[i].top = (int)((long long)num_tasks * i / num_workers);
+		workers[i].bottom = (int)((long long)num_tasks * (i + 1) / num_workers);
+	}
+	for(i = 1; i < num_workers; i++)
+		pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+	worker_main(&workers[0]);
+	for(i = 1; i < num_workers; i++)
+		pthread_join(workers[i].thread, NULL);
+}
+
+static THREAD_STATE *thread_state(WORKER *w, int thread){
+	int i, num = w->num_threads;
+
+	if(thread >= num){
+		while(thread >= num)
+			num = (num == 0) ? 8 : 2 * num;
+		w->threads = (THREAD_STATE*)realloc(w->threads, sizeof(THREAD_STATE) * num);
+		for(i = w->num_threads; i < num; i++){
+			w->threads[i].sum = (double*)malloc(sizeof(double) * (num_pvars + 1));
+			w->threads[i].valid = FALSE;
+		}
+		w->num_threads = num;
+	}
+	return &w->threads[thread];
+}
+
+/**
+ * Account one sample: the time and change since the previous sample of
+ * the same thread go to the region that thread was in and to the window
+ * the sample falls in.
+ */
+static void add_sample(WORKER *w, const TRACE_SAMPLE *s, const uint64_t *values){
+	THREAD_STATE *ts;
+	ACC *a;
+	double dt = 0;
+	int p, e, region, row, win;
+
+	if(s->thread < 0)
+		return;
+	region = (s->region >= 0 && s->region < w->map_size) ? w->region_map[s->region] : OUTSIDE;
+	for(p = 0; p < num_pvars; p++){
+		w->sum[p] = 0;
+		for(e = pvars[p].offset; e < pvars[p].offset + pvars[p].count; e++)
+			w->sum[p] += (double)values[e];
+	}
+	ts = thread_state(w, s->thread);
+	row = ts->valid ? ts->region : region;
+	win = (s->time > 0) ? (int)(s->time / window) : 0;
+	if(ts->valid && s->time > ts->time)
+		dt = s->time - ts->time;
+	for(p = 0; p < num_pvars; p++){
+		a = table_acc(&w->regions, row, p);
+		a->samples++;
+		a->time += dt;
+		a->change += ts->valid ? w->sum[p] - ts->sum[p] : 0;
+		if(w->sum[p] > a->max)
+			a->max = w->sum[p];
+		a = table_acc(&w->windows, win, p);
+		a->samples++;
+		a->time += dt;
+		a->change += ts->valid ? w->sum[p] - ts->sum[p] : 0;
+		if(w->sum[p] > a->max)
+			a->max = w->sum[p];
+	}
+	ts->valid = TRUE;
+	ts->time = s->time;
+	ts->region = region;
+	memcpy(ts->sum, w->sum, sizeof(double) * num_pvars);
+}
+
+static int check_header(const TRACE_HEADER *h, const char *path){
+	if(memcmp(h->magic, TRACE_MAGIC, sizeof(h->magic)) != 0){
+		fprintf(stderr, "%s is not a Gyan trace\n", path);
+		return FALSE;
+	}
+	if(h->num_pvars != num_pvars || h->num_values != num_values || h->num_ranks != num_ranks ||
+			h->rank < 0 || h->rank >= num_ranks){
+		fprintf(stderr, "%s does not belong to the same job as %s, skipped\n", path, files[0]);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Stream one trace: read its records front to back, releasing the pages
+ * already read, and keep the values of its latest sample.
+ */
+static void read_trace(WORKER *w, int task){
+	const char *path = files[task];
+	const TRACE_HEADER *h;
+	const TRACE_RECORD *rec;
+	const TRACE_SAMPLE *s;
+	const TRACE_REGION *r;
+	const uint64_t *last = NULL;
+	double last_time = -1;
+	struct stat st;
+	char *base;
+	size_t off, released = 0, page = sysconf(_SC_PAGESIZE), sample_size;
+	int fd, i;
+
+	if((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) != 0 ||
+			(size_t)st.st_size < sizeof(TRACE_HEADER) + sizeof(TRACE_PVAR) * num_pvars){
+		fprintf(stderr, "Cannot read the trace %s\n", path);
+		if(fd >= 0)
+			close(fd);
+		return;
+	}
+	base = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(base == MAP_FAILED){
+		fprintf(stderr, "Cannot map the trace %s\n", path);
+		return;
+	}
+	madvise(base, st.st_size, MADV_SEQUENTIAL);
+	h = (const TRACE_HEADER*)base;
+	if(!check_header(h, path)){
+		munmap(base, st.st_size);
+		return;
+	}
+	for(i = 0; i < w->num_threads; i++)
+		w->threads[i].valid = FALSE;
+	for(i = 0; i < w->map_size; i++)
+		w->region_map[i] = OUTSIDE;
+	sample_size = sizeof(TRACE_SAMPLE) + sizeof(uint64_t) * num_values;
+	off = sizeof(TRACE_HEADER) + sizeof(TRACE_PVAR) * num_pvars;
+	/* a record cut short by a job that died ends the trace */
+	while(off + sizeof(TRACE_RECORD) <= (size_t)st.st_size){
+		rec = (const TRACE_RECORD*)(base + off);
+		if(off + sizeof(TRACE_RECORD) + rec->length > (size_t)st.st_size)
+			break;
+		off += sizeof(TRACE_RECORD);
+		if(rec->type == TRACE_REC_SAMPLE && rec->length >= sample_size){
+			s = (const TRACE_SAMPLE*)(base + off);
+			add_sample(w, s, (const uint64_t*)(base + off + sizeof(TRACE_SAMPLE)));
+			if(s->time >= last_time){
+				last_time = s->time;
+				last = (const uint64_t*)(base + off + sizeof(TRACE_SAMPLE));
+			}
+		}
+		else if(rec->type == TRACE_REC_REGION && rec->length >= sizeof(TRACE_REGION)){
+			r = (const TRACE_REGION*)(base + off);
+			if(r->id >= 0 && r->id < MAX_REGIONS){
+				if(r->id >= w->map_size){
+					w->region_map = (int*)realloc(w->region_map, sizeof(int) * (r->id + 1));
+					for(i = w->map_size; i <= r->id; i++)
+						w->region_map[i] = OUTSIDE;
+					w->map_size = r->id + 1;
+				}
+				w->region_map[r->id] = region_row(r->name);
+			}
+		}
+		off += rec->length;
+		if(off - released >= RELEASE_CHUNK){
+			madvise(base + released, (off - released) & ~(page - 1), MADV_DONTNEED);
+			released += (off - released) & ~(page - 1);
+		}
+	}
+	/* the pages of the last sample may have been released, they are read again */
+	if(last != NULL){
+		memcpy(final_values + (size_t)h->rank * num_values, last, sizeof(uint64_t) * num_values);
+		traced[h->rank] = TRUE;
+	}
+	w->bytes += st.st_size;
+	munmap(base, st.st_size);
+}
+
+static int compare_values(const void *a, const void *b){
+	uint64_t va = *(const uint64_t*)a, vb = *(const uint64_t*)b;
+	return (va > vb) - (va < vb);
+}
+
+/**
+ * Statistics of one element over the final values of the traced ranks.
+ */
+static void reduce_element(WORKER *w, int e){
+	ELEMENT_STATS *st = &stats[e];
+	uint64_t v;
+	double total = 0;
+	int rank, n = 0;
+
+	for(rank = 0; rank < num_ranks; rank++){
+		if(!traced[rank])
+			continue;
+		v = final_values[(size_t)rank * num_values + e];
+		if(n == 0 || v < st->min){
+			st->min = v;
+			st->min_rank = rank;
+		}
+		if(n == 0 || v > st->max){
+			st->max = v;
+			st->max_rank = rank;
+		}
+		total += (double)v;
+		w->scratch[n++] = v;
+	}
+	if(n == 0)
+		return;
+	st->average = total / n;
+	qsort(w->scratch, n, sizeof(uint64_t), compare_values);
+	/* nearest rank */
+	st->p50 = w->scratch[(n * 50 + 99) / 100 - 1];
+	st->p90 = w->scratch[(n * 90 + 99) / 100 - 1];
+	st->p99 = w->scratch[(n * 99 + 99) / 100 - 1];
+}
+
+/**
+ * Add name, or prefix.0, prefix.1, ... when no file has that name.
+ */
+static void add_files(const char *name){
+	char path[4096];
+	struct stat st;
+	int rank;
+
+	if(stat(name, &st) == 0 && S_ISREG(st.st_mode)){
+		files = (char**)realloc(files, sizeof(char*) * (num_files + 1));
+		files[num_files++] = strdup(name);
+		return;
+	}
+	for(rank = 0; ; rank++){
+		snprintf(path, sizeof(path), "%s.%d", name, rank);
+		if(stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+			break;
+		files = (char**)realloc(files, sizeof(char*) * (num_files + 1));
+		files[num_files++] = strdup(path);
+	}
+	if(rank == 0)
+		fprintf(stderr, "No trace %s or %s.0\n", name, name);
+}
+
+static int load_job(const char *path){
+	TRACE_HEADER h;
+	FILE *fp = fopen(path, "rb");
+
+	if(fp == NULL || fread(&h, sizeof(h), 1, fp) != 1 || memcmp(h.magic, TRACE_MAGIC, sizeof(h.magic)) != 0 ||
+			h.num_pvars < 0 || h.num_values < 0 || h.num_ranks <= 0){
+		fprintf(stderr, "%s is not a Gyan trace\n", path);
+		if(fp != NULL)
+			fclose(fp);
+		return FALSE;
+	}
+	num_pvars = h.num_pvars;
+	num_values = h.num_values;
+	num_ranks = h.num_ranks;
+	sample_interval = h.sample_interval;
+	pvars = (TRACE_PVAR*)calloc(num_pvars + 1, sizeof(TRACE_PVAR));
+	if(fread(pvars, sizeof(TRACE_PVAR), num_pvars, fp) != (size_t)num_pvars){
+		fprintf(stderr, "%s is truncated\n", path);
+		fclose(fp);
+		return FALSE;
+	}
+	fclose(fp);
+	return TRUE;
+}
+
+static void print_stats(FILE *fp, int num_traced){
+	char name[TRACE_NAME_SZ + 16];
+	ELEMENT_STATS *st;
+	int p, e;
+
+	line(fp);
+	fprintf(fp, "Performance profiling for the complete MPI job (%d of %d ranks traced):\n", num_traced, num_ranks);
+	line(fp);
+	fprintf(fp, "%-40s\tType   ", "Variable Name");
+	fprintf(fp, " Minimum(Rank)    Maximum(Rank)       Average           p50           p90           p99\n");
+	line(fp);
+	for(p = 0; p < num_pvars; p++)
+		for(e = 0; e < pvars[p].count; e++){
+			st = &stats[pvars[p].offset + e];
+			if(pvars[p].count > 1)
+				snprintf(name, sizeof(name), "%s[%d]", pvars[p].name, e);
+			else
+				snprintf(name, sizeof(name), "%s", pvars[p].name);
+			fprintf(fp, "%-40s\t%-7s\t%8llu(%3d)  %8llu(%3d)  %12.2lf  %12llu  %12llu  %12llu\n", name,
+					pvars[p].var_class, (unsigned long long)st->min, st->min_rank,
+					(unsigned long long)st->max, st->max_rank, st->average,
+					(unsigned long long)st->p50, (unsigned long long)st->p90, (unsigned long long)st->p99);
+		}
+}
+
+static void print_regions(FILE *fp, TABLE *t){
+	ACC *a;
+	int row, p;
+
+	line(fp);
+	fprintf(fp, "Per-region breakdown (summed over ranks and threads):\n");
+	line(fp);
+	fprintf(fp, "%-24s %-40s %10s %12s %16s %16s\n", "Region", "Variable Name", "Samples", "Time(s)", "Change", "Max");
+	line(fp);
+	for(row = 0; row < t->rows && row <= num_regions; row++)
+		for(p = 0; p < num_pvars; p++){
+			a = t->acc + (size_t)row * num_pvars + p;
+			if(a->samples == 0)
+				continue;
+			fprintf(fp, "%-24s %-40s %10llu %12.3lf %16.0lf %16.0lf\n", (row == OUTSIDE) ? "(outside)" : region_names[row - 1],
+					pvars[p].name, (unsigned long long)a->samples, a->time, a->change, a->max);
+		}
+}
+
+static void print_windows(FILE *fp, TABLE *t){
+	ACC *a;
+	int row, p;
+
+	line(fp);
+	fprintf(fp, "Per-window breakdown (%.3lf second windows, summed over ranks and threads):\n", window);
+	line(fp);
+	fprintf(fp, "%12s  %-40s %10s %16s %16s\n", "Start(s)", "Variable Name", "Samples", "Change", "Max");
+	line(fp);
+	for(row = 0; row < t->rows; row++)
+		for(p = 0; p < num_pvars; p++){
+			a = t->acc + (size_t)row * num_pvars + p;
+			if(a->samples == 0)
+				continue;
+			fprintf(fp, "%12.3lf  %-40s %10llu %16.0lf %16.0lf\n", row * window, pvars[p].name,
+					(unsigned long long)a->samples, a->change, a->max);
+		}
+	line(fp);
+}
+
+int main(int argc, char *argv[]){
+	FILE *fp = stdout;
+	char *out_file = NULL;
+	int opt, errarg = FALSE, i, rank, num_traced = 0;
+	uint64_t bytes = 0;
+	struct timespec start, end;
+
+	num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	while((opt = getopt(argc, argv, "hj:w:o:")) != -1){
+		switch(opt){
+		case 'j':
+			num_workers = atoi(optarg);
+			if(num_workers <= 0)
+				errarg = TRUE;
+			break;
+		case 'w':
+			window = atof(optarg);
+			if(window <= 0)
+				errarg = TRUE;
+			break;
+		case 'o':
+			out_file = optarg;
+			break;
+		case 'h':
+		default:
+			errarg = TRUE;
+			break;
+		}
+	}
+	if(errarg || optind == argc)
+		usage(1);
+	for(i = optind; i < argc; i++)
+		add_files(argv[i]);
+	if(num_files == 0 || !load_job(files[0]))
+		return 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	final_values = (uint64_t*)calloc((size_t)num_ranks * num_values + 1, sizeof(uint64_t));
+	traced = (char*)calloc(num_ranks, 1);
+	stats = (ELEMENT_STATS*)calloc(num_values + 1, sizeof(ELEMENT_STATS));
+	region_names = calloc(MAX_REGIONS, TRACE_NAME_SZ);
+	workers = (WORKER*)calloc(num_workers, sizeof(WORKER));
+	for(i = 0; i < num_workers; i++){
+		workers[i].id = i;
+		pthread_mutex_init(&workers[i].lock, NULL);
+		workers[i].sum = (double*)malloc(sizeof(double) * (num_pvars + 1));
+		workers[i].scratch = (uint64_t*)malloc(sizeof(uint64_t) * (num_ranks + 1));
+	}
+	pool_run(num_files, read_trace);
+	for(rank = 0; rank < num_ranks; rank++)
+		num_traced += traced[rank];
+	pool_run(num_values, reduce_element);
+	for(i = 1; i < num_workers; i++){
+		table_merge(&workers[0].regions, &workers[i].regions);
+		table_merge(&workers[0].windows, &workers[i].windows);
+	}
+	for(i = 0; i < num_workers; i++)
+		bytes += workers[i].bytes;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if(out_file != NULL && (fp = fopen(out_file, "w")) == NULL){
+		printf("Cannot write %s\n", out_file);
+		return 1;
+	}
+	fprintf(fp, "Read %d traces (%.1lf MB) of a %d rank job in %.2lf s with %d threads\n", num_files,
+			bytes / 1048576.0, num_ranks, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9,
+			num_workers);
+	print_stats(fp, num_traced);
+	print_regions(fp, &workers[0].regions);
+	print_windows(fp, &workers[0].windows);
+	if(fp != stdout)
+		fclose(fp);
+	return 0;
+}
@@ -0,0 +1,304 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * gyan_shm.c
+ *
+ * Node-local monitor for the shared-memory export of Gyan (MPIT_SHM_EXPORT).
+ * Prints the latest pvar values of every rank on the node, or aggregates
+ * them across ranks. Reads the segment only and never calls MPI, so it
+ * does not disturb the running job.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "shm_layout.h"
+
+#define FALSE 0
+#define TRUE 1
+#define SHM_NAME_SZ 256
+
+typedef struct{
+	GYAN_SHM_PVAR pvar;
+	int num_ranks;
+	uint64_t *min, *max, *sum;
+}AGGREGATE;
+
+static int aggregate = FALSE;
+static double interval = 0;
+static int count = 1;
+static char *filter = NULL;
+static double wait_time = 0;
+
+static void usage(int e){
+	printf("Usage: gyan_shm [-a] [-i <seconds>] [-n <count>] [-p <pattern>] [-w <seconds>] <segment>\n");
+	printf("    -a = Aggregate across the ranks of the node (min, max, sum, average)\n");
+	printf("    -i = Refresh every <seconds> (default: print once)\n");
+	printf("    -n = Number of refreshes with -i (default: until the job ends)\n");
+	printf("    -p = Only pvars whose name contains <pattern>\n");
+	printf("    -w = Wait up to <seconds> for the segment to appear\n");
+	printf("    -h = This help text\n");
+	printf("<segment> is the value of MPIT_SHM_EXPORT given to the job.\n");
+	exit(e);
+}
+
+static double now(){
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/**
+ * Map the segment read-only once its leader has published the header.
+ * @return the mapping or NULL
+ */
+static void *attach(char *name, size_t *size){
+	char shm_name[SHM_NAME_SZ];
+	struct stat st;
+	GYAN_SHM_HEADER *header;
+	double deadline = now() + wait_time;
+	void *base;
+	int fd;
+
+	if(name[0] == '/')
+		snprintf(shm_name, sizeof(shm_name), "%s", name);
+	else
+		snprintf(shm_name, sizeof(shm_name), "/%s", name);
+	for(;;){
+		fd = shm_open(shm_name, O_RDONLY, 0);
+		if(fd >= 0 && fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(GYAN_SHM_HEADER)){
+			base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			close(fd);
+			if(base == MAP_FAILED)
+				return NULL;
+			header = (GYAN_SHM_HEADER*)base;
+			while(__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != GYAN_SHM_MAGIC && now() < deadline)
+				usleep(10000);
+			if(header->magic == GYAN_SHM_MAGIC)
+				break;
+			munmap(base, st.st_size);
+		}
+		else if(fd >= 0)
+			close(fd);
+		if(now() >= deadline){
+			fprintf(stderr, "gyan_shm: %s is not available\n", shm_name);
+			return NULL;
+		}
+		usleep(100000);
+	}
+	if(header->version != GYAN_SHM_VERSION ||
+			sizeof(GYAN_SHM_HEADER) + header->slot_size * header->num_slots > (size_t)st.st_size){
+		fprintf(stderr, "gyan_shm: %s has an unsupported layout (version %u)\n", shm_name, header->version);
+		munmap(base, st.st_size);
+		return NULL;
+	}
+	*size = st.st_size;
+	return base;
+}
+
+static int selected(GYAN_SHM_PVAR *p){
+	return (filter == NULL || strstr(p->name, filter) != NULL);
+}
+
+/**
+ * TRUE if the rank of an active slot still exists; a rank that died
+ * without MPI_Finalize never marks its slot done.
+ */
+static int alive(GYAN_SHM_SLOT *copy){
+	return (copy->state != GYAN_SHM_SLOT_ACTIVE || kill(copy->pid, 0) == 0);
+}
+
+static const char *state_name(int state){
+	if(state == GYAN_SHM_SLOT_ACTIVE)
+		return "running";
+	if(state == GYAN_SHM_SLOT_DONE)
+		return "finalized";
+	return "not attached";
+}
+
+static void print_ranks(GYAN_SHM_HEADER *header, GYAN_SHM_SLOT *copy, int slot_index, int busy){
+	GYAN_SHM_PVAR *pvars = GYAN_SHM_SLOT_PVARS(copy);
+	uint64_t *values = GYAN_SHM_SLOT_VALUES(copy, header->max_pvars);
+	uint32_t i, j;
+
+	if(busy){
+		printf("Slot %d: busy (writer did not finish an update)\n", slot_index);
+		return;
+	}
+	if(copy->state == GYAN_SHM_SLOT_EMPTY){
+		printf("Slot %d: %s\n", slot_index, state_name(copy->state));
+		return;
+	}
+	printf("Rank %d (pid %d, %s): %llu samples, last %.3lfs ago\n", copy->rank, copy->pid,
+			alive(copy) ? state_name(copy->state) : "exited", (unsigned long long)copy->num_samples,
+			copy->num_samples ? now() - copy->timestamp : 0.0);
+	for(i = 0; i < copy->num_pvars && i < header->max_pvars; i++){
+		if(!gyan_shm_valid_pvar(header->max_values, copy, &pvars[i]) || !selected(&pvars[i]))
+			continue;
+		for(j = 0; j < pvars[i].count; j++)
+			printf("  %-40s\t%-8s\t%20llu\n", pvars[i].name, pvars[i].var_class,
+					(unsigned long long)values[pvars[i].offset + j]);
+	}
+}
+
+static AGGREGATE *find_aggregate(AGGREGATE *agg, int *num, GYAN_SHM_PVAR *p){
+	int i;
+	for(i = 0; i < *num; i++)
+		if(strcmp(agg[i].pvar.name, p->name) == 0 && strcmp(agg[i].pvar.var_class, p->var_class) == 0)
+			return (agg[i].pvar.count == p->count) ? &agg[i] : NULL;
+	agg[*num].pvar = *p;
+	agg[*num].num_ranks = 0;
+	agg[*num].min = (uint64_t*)malloc(sizeof(uint64_t) * (p->count + 1));
+	agg[*num].max = (uint64_t*)calloc(p->count + 1, sizeof(uint64_t));
+	agg[*num].sum = (uint64_t*)calloc(p->count + 1, sizeof(uint64_t));
+	memset(agg[*num].min, 0xff, sizeof(uint64_t) * (p->count + 1));
+	return &agg[(*num)++];
+}
+
+static void print_aggregate(GYAN_SHM_HEADER *header, GYAN_SHM_SLOT **copies, int *busy){
+	AGGREGATE *agg, *a;
+	GYAN_SHM_PVAR *pvars;
+	uint64_t *values, v;
+	int num = 0, active = 0, k;
+	uint32_t i, j;
+
+	agg = (AGGREGATE*)malloc(sizeof(AGGREGATE) * (header->max_pvars * header->num_slots + 1));
+	for(k = 0; k < header->num_slots; k++){
+		if(busy[k] || copies[k]->state == GYAN_SHM_SLOT_EMPTY)
+			continue;
+		active++;
+		pvars = GYAN_SHM_SLOT_PVARS(copies[k]);
+		values = GYAN_SHM_SLOT_VALUES(copies[k], header->max_pvars);
+		for(i = 0; i < copies[k]->num_pvars && i < header->max_pvars; i++){
+			if(!gyan_shm_valid_pvar(header->max_values, copies[k], &pvars[i]) || !selected(&pvars[i]))
+				continue;
+			if((a = find_aggregate(agg, &num, &pvars[i])) == NULL)
+				continue;
+			a->num_ranks++;
+			for(j = 0; j < pvars[i].count; j++){
+				v = values[pvars[i].offset + j];
+				if(v < a->min[j])
+					a->min[j] = v;
+				if(v > a->max[j])
+					a->max[j] = v;
+				a->sum[j] += v;
+			}
+		}
+	}
+	printf("%d of %u ranks reporting\n", active, header->num_slots);
+	printf("%-40s\t%-8s\t%5s\t%14s\t%14s\t%16s\t%14s\n", "Variable Name", "Type", "Ranks",
+			"Minimum", "Maximum", "Sum", "Average");
+	for(k = 0; k < num; k++){
+		for(j = 0; j < agg[k].pvar.count; j++)
+			printf("%-40s\t%-8s\t%5d\t%14llu\t%14llu\t%16llu\t%14.2lf\n", agg[k].pvar.name,
+					agg[k].pvar.var_class, agg[k].num_ranks, (unsigned long long)agg[k].min[j],
+					(unsigned long long)agg[k].max[j], (unsigned long long)agg[k].sum[j],
+					agg[k].sum[j] / (double)agg[k].num_ranks);
+		free(agg[k].min);
+		free(agg[k].max);
+		free(agg[k].sum);
+	}
+	free(agg);
+}
+
+int main(int argc, char *argv[]){
+	GYAN_SHM_HEADER *header;
+	GYAN_SHM_SLOT **copies;
+	void *base;
+	size_t size;
+	int opt, errarg = FALSE, k, n, done, *busy;
+
+	while((opt = getopt(argc, argv, "hai:n:p:w:")) != -1){
+		switch(opt){
+		case 'a':
+			aggregate = TRUE;
+			break;
+		case 'i':
+			interval = atof(optarg);
+			if(interval <= 0)
+				errarg = TRUE;
+			count = 0;
+			break;
+		case 'n':
+			count = atoi(optarg);
+			if(count <= 0)
+				errarg = TRUE;
+			break;
+		case 'p':
+			filter = optarg;
+			break;
+		case 'w':
+			wait_time = atof(optarg);
+			break;
+		case 'h':
+		default:
+			errarg = TRUE;
+			break;
+		}
+	}
+	if(errarg || optind != argc - 1)
+		usage(1);
+
+	base = attach(argv[optind], &size);
+	if(base == NULL)
+		return 1;
+	header = (GYAN_SHM_HEADER*)base;
+	copies = (GYAN_SHM_SLOT**)malloc(sizeof(GYAN_SHM_SLOT*) * header->num_slots);
+	busy = (int*)malloc(sizeof(int) * header->num_slots);
+	for(k = 0; k < header->num_slots; k++)
+		copies[k] = (GYAN_SHM_SLOT*)malloc(header->slot_size);
+
+	for(n = 0; count == 0 || n < count; n++){
+		if(n > 0)
+			usleep((useconds_t)(interval * 1e6));
+		done = TRUE;
+		for(k = 0; k < header->num_slots; k++){
+			busy[k] = gyan_shm_read_slot(GYAN_SHM_SLOT_AT(base, k), copies[k], header->slot_size);
+			if(busy[k] || (copies[k]->state != GYAN_SHM_SLOT_DONE && alive(copies[k])))
+				done = FALSE;
+		}
+		if(aggregate)
+			print_aggregate(header, copies, busy);
+		else
+			for(k = 0; k < header->num_slots; k++)
+				print_ranks(header, copies[k], k, busy[k]);
+		if(interval > 0)
+			printf("\n");
+		fflush(stdout);
+		/* keep refreshing until all ranks finalized or exited */
+		if(done)
+			break;
+	}
+
+	for(k = 0; k < header->num_slots; k++)
+		free(copies[k]);
+	free(copies);
+	free(busy);
+	munmap(base, size);
+	return 0;
+}
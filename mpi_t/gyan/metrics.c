@@ -0,0 +1,360 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * metrics.c
+ *
+ * Prometheus endpoint served by the node leader, see metrics.h.
+ */
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "metrics.h"
+#include "shm_layout.h"
+
+#define FALSE 0
+#define TRUE 1
+#define POLL_MS 200 // how often the server checks for shutdown
+#define REQUEST_SZ 4096
+#define LABEL_SZ 256
+
+typedef struct{
+	char *data;
+	size_t len, capacity;
+}TEXT;
+
+static pthread_t server;
+static int listen_fd = -1;
+static int stop = FALSE;
+static void *segment;
+static char unix_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+static GYAN_SHM_SLOT **copies;
+static int *busy;
+
+static void append(TEXT *t, const char *fmt, ...){
+	va_list ap;
+	int n;
+
+	for(;;){
+		va_start(ap, fmt);
+		n = vsnprintf(t->data + t->len, t->capacity - t->len, fmt, ap);
+		va_end(ap);
+		if(n >= 0 && t->len + n < t->capacity){
+			t->len += n;
+			return;
+		}
+		t->capacity = (t->capacity + n + 1) * 2;
+		t->data = (char*)realloc(t->data, t->capacity);
+	}
+}
+
+/**
+ * Copy a label value, escaping backslash, quote and newline.
+ */
+static const char *label(const char *in, char *out){
+	int i, j;
+	for(i = 0, j = 0; in[i] != 0 && j < LABEL_SZ - 3; i++){
+		if(in[i] == '\\' || in[i] == '"')
+			out[j++] = '\\';
+		if(in[i] == '\n'){
+			out[j++] = '\\';
+			out[j++] = 'n';
+			continue;
+		}
+		out[j++] = in[i];
+	}
+	out[j] = 0;
+	return out;
+}
+
+/**
+ * Index of the pvar called name in a snapshot, trying the same position
+ * first since ranks usually watch the same list.
+ */
+static int find_pvar(GYAN_SHM_HEADER *header, GYAN_SHM_SLOT *copy, GYAN_SHM_PVAR *p, uint32_t hint){
+	GYAN_SHM_PVAR *pvars = GYAN_SHM_SLOT_PVARS(copy);
+	uint32_t i, num = (copy->num_pvars < header->max_pvars) ? copy->num_pvars : header->max_pvars;
+
+	if(hint < num && strcmp(pvars[hint].name, p->name) == 0)
+		return gyan_shm_valid_pvar(header->max_values, copy, &pvars[hint]) ? (int)hint : -1;
+	for(i = 0; i < num; i++)
+		if(strcmp(pvars[i].name, p->name) == 0)
+			return gyan_shm_valid_pvar(header->max_values, copy, &pvars[i]) ? (int)i : -1;
+	return -1;
+}
+
+static int reporting(GYAN_SHM_SLOT *copy, int slot_busy){
+	return (!slot_busy && copy->state != GYAN_SHM_SLOT_EMPTY);
+}
+
+/**
+ * Node sum or maximum of every pvar, emitted once at its first occurrence.
+ */
+static void aggregate(TEXT *t, GYAN_SHM_HEADER *header, int want_max){
+	GYAN_SHM_PVAR *pvars, *other;
+	uint64_t *values, v, sum, max;
+	char name[LABEL_SZ], cls[LABEL_SZ];
+	uint32_t i, j, k, l;
+	int idx, first;
+
+	const char *family = want_max ? "gyan_pvar_node_max" : "gyan_pvar_node_sum";
+
+	append(t, "# HELP %s MPI_T pvar %s over the ranks of the node\n", family, want_max ? "maximum" : "sum");
+	append(t, "# TYPE %s gauge\n", family);
+	for(k = 0; k < header->num_slots; k++){
+		if(!reporting(copies[k], busy[k]))
+			continue;
+		pvars = GYAN_SHM_SLOT_PVARS(copies[k]);
+		for(i = 0; i < copies[k]->num_pvars && i < header->max_pvars; i++){
+			if(!gyan_shm_valid_pvar(header->max_values, copies[k], &pvars[i]))
+				continue;
+			for(first = TRUE, l = 0; l < k && first; l++)
+				if(reporting(copies[l], busy[l]) && find_pvar(header, copies[l], &pvars[i], i) >= 0)
+					first = FALSE;
+			if(!first)
+				continue;
+			label(pvars[i].name, name);
+			label(pvars[i].var_class, cls);
+			for(j = 0; j < pvars[i].count; j++){
+				sum = max = 0;
+				for(l = k; l < header->num_slots; l++){
+					if(!reporting(copies[l], busy[l]) || (idx = find_pvar(header, copies[l], &pvars[i], i)) < 0)
+						continue;
+					other = &GYAN_SHM_SLOT_PVARS(copies[l])[idx];
+					if(other->count != pvars[i].count)
+						continue;
+					values = GYAN_SHM_SLOT_VALUES(copies[l], header->max_pvars);
+					v = values[other->offset + j];
+					sum += v;
+					if(v > max)
+						max = v;
+				}
+				append(t, "%s{name=\"%s\",class=\"%s\",element=\"%u\"} %llu\n",
+						family, name, cls, j, (unsigned long long)(want_max ? max : sum));
+			}
+		}
+	}
+}
+
+/**
+ * Render the exposition text from fresh snapshots of all slots.
+ */
+static void render(TEXT *t){
+	GYAN_SHM_HEADER *header = (GYAN_SHM_HEADER*)segment;
+	GYAN_SHM_PVAR *pvars;
+	uint64_t *values;
+	char name[LABEL_SZ], cls[LABEL_SZ];
+	uint32_t i, j, k;
+	int num_reporting = 0;
+
+	for(k = 0; k < header->num_slots; k++){
+		busy[k] = gyan_shm_read_slot(GYAN_SHM_SLOT_AT(segment, k), copies[k], header->slot_size);
+		if(reporting(copies[k], busy[k]))
+			num_reporting++;
+	}
+	append(t, "# HELP gyan_ranks Ranks on this node publishing samples\n");
+	append(t, "# TYPE gyan_ranks gauge\n");
+	append(t, "gyan_ranks %d\n", num_reporting);
+	append(t, "# HELP gyan_samples_total Samples taken by each rank\n");
+	append(t, "# TYPE gyan_samples_total counter\n");
+	for(k = 0; k < header->num_slots; k++)
+		if(reporting(copies[k], busy[k]))
+			append(t, "gyan_samples_total{rank=\"%d\"} %llu\n", copies[k]->rank,
+					(unsigned long long)copies[k]->num_samples);
+	append(t, "# HELP gyan_sample_timestamp_seconds Wall-clock time of the latest sample of each rank\n");
+	append(t, "# TYPE gyan_sample_timestamp_seconds gauge\n");
+	for(k = 0; k < header->num_slots; k++)
+		if(reporting(copies[k], busy[k]) && copies[k]->num_samples > 0)
+			append(t, "gyan_sample_timestamp_seconds{rank=\"%d\"} %.3lf\n", copies[k]->rank, copies[k]->timestamp);
+
+	append(t, "# HELP gyan_pvar MPI_T pvar value of each rank\n");
+	append(t, "# TYPE gyan_pvar gauge\n");
+	for(k = 0; k < header->num_slots; k++){
+		if(!reporting(copies[k], busy[k]))
+			continue;
+		pvars = GYAN_SHM_SLOT_PVARS(copies[k]);
+		values = GYAN_SHM_SLOT_VALUES(copies[k], header->max_pvars);
+		for(i = 0; i < copies[k]->num_pvars && i < header->max_pvars; i++){
+			if(!gyan_shm_valid_pvar(header->max_values, copies[k], &pvars[i]))
+				continue;
+			label(pvars[i].name, name);
+			label(pvars[i].var_class, cls);
+			for(j = 0; j < pvars[i].count; j++)
+				append(t, "gyan_pvar{name=\"%s\",class=\"%s\",element=\"%u\",rank=\"%d\"} %llu\n",
+						name, cls, j, copies[k]->rank, (unsigned long long)values[pvars[i].offset + j]);
+		}
+	}
+	aggregate(t, header, FALSE);
+	aggregate(t, header, TRUE);
+}
+
+/**
+ * Answer one request. Any path returns the metrics.
+ */
+static void serve(int fd, TEXT *t){
+	char request[REQUEST_SZ];
+	char head[256];
+	struct pollfd pfd;
+	size_t got = 0, sent;
+	ssize_t n;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while(got < sizeof(request) - 1 && poll(&pfd, 1, 1000) > 0){
+		n = recv(fd, request + got, sizeof(request) - 1 - got, 0);
+		if(n <= 0)
+			break;
+		got += n;
+		request[got] = 0;
+		if(strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL)
+			break;
+	}
+	t->len = 0;
+	render(t);
+	n = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+			"Content-Length: %zu\r\nConnection: close\r\n\r\n", t->len);
+	if(send(fd, head, n, MSG_NOSIGNAL) != n)
+		return;
+	for(sent = 0; sent < t->len; sent += n)
+		if((n = send(fd, t->data + sent, t->len - sent, MSG_NOSIGNAL)) <= 0)
+			break;
+}
+
+static void *server_main(void *arg){
+	struct pollfd pfd;
+	TEXT t = { NULL, 0, 0 };
+	int fd;
+
+	pfd.fd = listen_fd;
+	pfd.events = POLLIN;
+	while(!__atomic_load_n(&stop, __ATOMIC_ACQUIRE)){
+		if(poll(&pfd, 1, POLL_MS) <= 0)
+			continue;
+		fd = accept(listen_fd, NULL, NULL);
+		if(fd < 0)
+			continue;
+		serve(fd, &t);
+		close(fd);
+	}
+	free(t.data);
+	return NULL;
+}
+
+static int open_socket(char *spec){
+	struct sockaddr_un un;
+	struct sockaddr_in in;
+	int fd, one = 1;
+
+	if(strncmp(spec, "unix:", 5) == 0){
+		memset(&un, 0, sizeof(un));
+		un.sun_family = AF_UNIX;
+		if(strlen(spec + 5) >= sizeof(un.sun_path))
+			return -1;
+		strcpy(un.sun_path, spec + 5);
+		unlink(un.sun_path); // left behind by an earlier job
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(fd < 0 || bind(fd, (struct sockaddr*)&un, sizeof(un)) != 0 || listen(fd, 16) != 0){
+			if(fd >= 0)
+				close(fd);
+			return -1;
+		}
+		strcpy(unix_path, un.sun_path);
+		return fd;
+	}
+	memset(&in, 0, sizeof(in));
+	in.sin_family = AF_INET;
+	in.sin_port = htons(atoi(spec));
+	in.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if(atoi(spec) <= 0 || atoi(spec) > 65535)
+		return -1;
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd >= 0)
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if(fd < 0 || bind(fd, (struct sockaddr*)&in, sizeof(in)) != 0 || listen(fd, 16) != 0){
+		if(fd >= 0)
+			close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * Start the endpoint on the node leader. Other ranks only publish into
+ * the segment.
+ * @return 1 if this rank serves the endpoint, 0 otherwise
+ */
+int metrics_init(char *spec, void *seg, int node_rank, int rank){
+	GYAN_SHM_HEADER *header = (GYAN_SHM_HEADER*)seg;
+	uint32_t k;
+
+	if(seg == NULL || node_rank != 0)
+		return 0;
+	segment = seg;
+	listen_fd = open_socket(spec);
+	if(listen_fd < 0){
+		printf("Metrics: rank %d cannot listen on %s, disabled\n", rank, spec);
+		return 0;
+	}
+	copies = (GYAN_SHM_SLOT**)malloc(sizeof(GYAN_SHM_SLOT*) * header->num_slots);
+	busy = (int*)malloc(sizeof(int) * header->num_slots);
+	for(k = 0; k < header->num_slots; k++)
+		copies[k] = (GYAN_SHM_SLOT*)malloc(header->slot_size);
+	stop = FALSE;
+	if(pthread_create(&server, NULL, server_main, NULL) != 0){
+		close(listen_fd);
+		listen_fd = -1;
+		return 0;
+	}
+	if(!rank){
+		printf("Metrics: serving node pvars on %s%s\n", (spec[0] == 'u') ? "" : "127.0.0.1:", (spec[0] == 'u') ? spec + 5 : spec);
+		print_filled("",88,'-');
+	}
+	return 1;
+}
+
+/**
+ * Stop the server thread. Must run before the segment is unmapped.
+ */
+void metrics_finalize(){
+	GYAN_SHM_HEADER *header = (GYAN_SHM_HEADER*)segment;
+	uint32_t k;
+
+	if(listen_fd < 0)
+		return;
+	__atomic_store_n(&stop, TRUE, __ATOMIC_RELEASE);
+	pthread_join(server, NULL);
+	close(listen_fd);
+	listen_fd = -1;
+	if(unix_path[0] != 0)
+		unlink(unix_path);
+	unix_path[0] = 0;
+	for(k = 0; k < header->num_slots; k++)
+		free(copies[k]);
+	free(copies);
+	free(busy);
+	segment = NULL;
+}
@@ -0,0 +1,40 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * metrics.h
+ *
+ * Prometheus endpoint for node-level scrapers (MPIT_METRICS). The first
+ * rank of every node starts a thread that serves the pvar values of all
+ * ranks on the node in the Prometheus text exposition format, read from
+ * the shared-memory export segment. The thread makes no MPI calls, and a
+ * scrape takes no lock the sampling path could wait for.
+ *
+ *   MPIT_METRICS=<port>           HTTP on 127.0.0.1:<port>
+ *   MPIT_METRICS=unix:<path>      HTTP on a UNIX domain socket
+ */
+#include "utility.h"
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+int metrics_init(char *spec, void *segment, int node_rank, int rank);
+void metrics_finalize();
+#endif /* METRICS_H_ */
@@ -0,0 +1,498 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * report.c
+ *
+ * Text, CSV, JSON and binary backends of the Gyan report, see report.h.
+ */
+
+#include "report.h"
+
+#define FALSE 0
+#define TRUE 1
+#define FILE_NAME_SZ 256
+
+/* text: the classic Gyan table, timers are not listed */
+
+static void text_line(REPORT *r){
+	int i;
+	for(i = 0; i < 88; i++)
+		fputc('-', r->fp);
+	fputc('\n', r->fp);
+}
+
+static void text_begin(REPORT *r, const REPORT_INFO *info){
+	text_line(r);
+	fprintf(r->fp, "Performance profiling for the complete MPI job:\n");
+	text_line(r);
+	fprintf(r->fp, "%-40s\tType   ", "Variable Name");
+	fprintf(r->fp, " Minimum(Rank)    Maximum(Rank)       Average\n");
+	text_line(r);
+}
+
+static void text_pvars(REPORT *r, const REPORT_PVAR *pvars, int num){
+}
+
+static void text_rows(REPORT *r, const REPORT_ROW *rows, int num){
+	const REPORT_PVAR *p;
+	int i;
+
+	for(i = 0; i < num; i++){
+		p = &r->pvars[rows[i].pvar];
+		if(strcmp(p->var_class, "TIMER") == 0)
+			continue;
+		if(rows[i].min_label[0] != 0){
+			/* states are enum values, print their names */
+			fprintf(r->fp, "%-40s\t%-7s\t%8s(%3d)  %8s(%3d)\n", p->name, p->var_class,
+					rows[i].min_label, rows[i].min_rank, rows[i].max_label, rows[i].max_rank);
+			continue;
+		}
+		fprintf(r->fp, "%-40s\t%-7s\t%8llu(%3d)  %8llu(%3d)  %12.2lf\n", p->name, p->var_class,
+				(unsigned long long)rows[i].min, rows[i].min_rank,
+				(unsigned long long)rows[i].max, rows[i].max_rank, rows[i].average);
+	}
+}
+
+static void text_nodes(REPORT *r, const REPORT_NODE_ROW *rows, int num){
+	const REPORT_PVAR *p;
+	int i;
+
+	if(r->section != REPORT_REC_NODES){
+		text_line(r);
+		fprintf(r->fp, "Per-node statistics:\n");
+		text_line(r);
+		fprintf(r->fp, "%-16s %-40s\t Minimum(Rank)    Maximum(Rank)       Average\n", "Host", "Variable Name");
+		text_line(r);
+		r->section = REPORT_REC_NODES;
+	}
+	for(i = 0; i < num; i++){
+		p = &r->pvars[rows[i].pvar];
+		if(strcmp(p->var_class, "TIMER") == 0)
+			continue;
+		fprintf(r->fp, "%-16s %-40s\t%8llu(%3d)  %8llu(%3d)  %12.2lf\n", rows[i].host, p->name,
+				(unsigned long long)rows[i].min, rows[i].min_rank,
+				(unsigned long long)rows[i].max, rows[i].max_rank, rows[i].average);
+	}
+}
+
+static void text_topk(REPORT *r, const REPORT_TOPK_ROW *rows, int num){
+	const REPORT_PVAR *p;
+	int i;
+
+	if(r->section != REPORT_REC_TOPK){
+		text_line(r);
+		fprintf(r->fp, "Largest elements of pvars with many elements:\n");
+		text_line(r);
+		fprintf(r->fp, "%-40s\t Element    Rank                 Value\n", "Variable Name");
+		text_line(r);
+		r->section = REPORT_REC_TOPK;
+	}
+	for(i = 0; i < num; i++){
+		p = &r->pvars[rows[i].pvar];
+		if(strcmp(p->var_class, "TIMER") == 0)
+			continue;
+		fprintf(r->fp, "%-40s\t%8d  %6d  %20llu\n", p->name, rows[i].element, rows[i].rank,
+				(unsigned long long)rows[i].value);
+	}
+}
+
+static void text_series(REPORT *r, int rank, const double *time, const uint64_t *values,
+		int num_rows, int num_values, const double *intervals, int num_pvars){
+	int i, j, k;
+
+	if(r->section != REPORT_REC_SERIES){
+		text_line(r);
+		fprintf(r->fp, "Time series (seconds since MPI_Init%s):\n",
+				(intervals != NULL) ? ", with the sampling interval of each pvar" : "");
+		text_line(r);
+		r->section = REPORT_REC_SERIES;
+	}
+	for(i = 0; i < num_rows; i++)
+		for(j = 0; j < r->num_pvars; j++)
+			for(k = 0; k < r->pvars[j].count && r->pvars[j].offset + k < num_values; k++){
+				fprintf(r->fp, "%4d %12.6lf  %-40s\t%20llu", rank, time[i], r->pvars[j].name,
+						(unsigned long long)values[(size_t)i * num_values + r->pvars[j].offset + k]);
+				if(intervals != NULL && j < num_pvars)
+					fprintf(r->fp, "  every %.4lfs", intervals[(size_t)i * num_pvars + j]);
+				fputc('\n', r->fp);
+			}
+}
+
+static void text_end(REPORT *r){
+	text_line(r);
+}
+
+/* csv: one line per record, the first column tells the record type */
+
+static void csv_string(FILE *fp, const char *s){
+	fputc('"', fp);
+	for(; *s != 0; s++){
+		if(*s == '"')
+			fputc('"', fp);
+		fputc(*s, fp);
+	}
+	fputc('"', fp);
+}
+
+static void csv_begin(REPORT *r, const REPORT_INFO *info){
+	fprintf(r->fp, "record,rank,time,name,class,element,min,min_rank,max,max_rank,total,average,value,host,interval\n");
+}
+
+static void csv_pvars(REPORT *r, const REPORT_PVAR *pvars, int num){
+}
+
+static void csv_rows(REPORT *r, const REPORT_ROW *rows, int num){
+	const REPORT_PVAR *p;
+	int i;
+
+	for(i = 0; i < num; i++){
+		p = &r->pvars[rows[i].pvar];
+		fprintf(r->fp, "stat,,,");
+		csv_string(r->fp, p->name);
+		fprintf(r->fp, ",%s,%d,", p->var_class, rows[i].element);
+		if(rows[i].min_label[0] != 0)
+			csv_string(r->fp, rows[i].min_label);
+		else
+			fprintf(r->fp, "%llu", (unsigned long long)rows[i].min);
+		fprintf(r->fp, ",%d,", rows[i].min_rank);
+		if(rows[i].max_label[0] != 0)
+			csv_string(r->fp, rows[i].max_label);
+		else
+			fprintf(r->fp, "%llu", (unsigned long long)rows[i].max);
+		fprintf(r->fp, ",%d,%llu,%.2lf,,,\n", rows[i].max_rank, (unsigned long long)rows[i].total, rows[i].average);
+	}
+}
+
+static void csv_nodes(REPORT *r, const REPORT_NODE_ROW *rows, int num){
+	const REPORT_PVAR *p;
+	int i;
+
+	for(i = 0; i < num; i++){
+		p = &r->pvars[rows[i].pvar];
+		fprintf(r->fp, "node,,,");
+		csv_string(r->fp, p->name);
+		fprintf(r->fp, ",%s,%d,%llu,%d,%llu,%d,%llu,%.2lf,,", p->var_class, rows[i].element,
+				(unsigned long long)rows[i].min, rows[i].min_rank, (unsigned long long)rows[i].max,
+				rows[i].max_rank, (unsigned long long)rows[i].total, rows[i].average);
+		csv_string(r->fp, rows[i].host);
+		fprintf(r->fp, ",\n");
+	}
+}
+
+static void csv_topk(REPORT *r, const REPORT_TOPK_ROW *rows, int num){
+	const REPORT_PVAR *p;
+	int i;
+
+	for(i = 0; i < num; i++){
+		p = &r->pvars[rows[i].pvar];
+		fprintf(r->fp, "topk,%d,,", rows[i].rank);
+		csv_string(r->fp, p->name);
+		fprintf(r->fp, ",%s,%d,,,,,,,%llu,,\n", p->var_class, rows[i].element, (unsigned long long)rows[i].value);
+	}
+}
+
+static void csv_series(REPORT *r, int rank, const double *time, const uint64_t *values,
+		int num_rows, int num_values, const double *intervals, int num_pvars){
+	int i, j, k;
+
+	for(i = 0; i < num_rows; i++)
+		for(j = 0; j < r->num_pvars; j++)
+			for(k = 0; k < r->pvars[j].count && r->pvars[j].offset + k < num_values; k++){
+				fprintf(r->fp, "sample,%d,%.6lf,", rank, time[i]);
+				csv_string(r->fp, r->pvars[j].name);
+				fprintf(r->fp, ",%s,%d,,,,,,,%llu,,", r->pvars[j].var_class, k,
+						(unsigned long long)values[(size_t)i * num_values + r->pvars[j].offset + k]);
+				if(intervals != NULL && j < num_pvars)
+					fprintf(r->fp, "%.6lf", intervals[(size_t)i * num_pvars + j]);
+				fputc('\n', r->fp);
+			}
+}
+
+static void csv_end(REPORT *r){
+}
+
+/* json: a single object with the pvars, stats and series arrays */
+
+static void json_string(FILE *fp, const char *s){
+	fputc('"', fp);
+	for(; *s != 0; s++){
+		if(*s == '"' || *s == '\\')
+			fputc('\\', fp);
+		if((unsigned char)*s < 0x20)
+			fprintf(fp, "\\u%04x", *s);
+		else
+			fputc(*s, fp);
+	}
+	fputc('"', fp);
+}
+
+/**
+ * Open the array of a new section, or separate from the previous element.
+ */
+static void json_section(REPORT *r, int section, const char *name){
+	if(r->section == section){
+		fprintf(r->fp, ",\n");
+		return;
+	}
+	if(r->section != REPORT_REC_INFO)
+		fprintf(r->fp, "\n  ]");
+	fprintf(r->fp, ",\n  \"%s\": [\n", name);
+	r->section = section;
+}
+
+static void json_begin(REPORT *r, const REPORT_INFO *info){
+	fprintf(r->fp, "{\n  \"ranks\": %d,\n  \"sample_interval\": %lf,\n  \"sample_intervals\": %s",
+			info->num_ranks, info->sample_interval, info->intervals ? "true" : "false");
+}
+
+static void json_pvars(REPORT *r, const REPORT_PVAR *pvars, int num){
+	int i;
+	for(i = 0; i < num; i++){
+		json_section(r, REPORT_REC_PVARS, "pvars");
+		fprintf(r->fp, "    {\"name\": ");
+		json_string(r->fp, pvars[i].name);
+		fprintf(r->fp, ", \"class\": \"%s\", \"count\": %d, \"offset\": %d}",
+				pvars[i].var_class, pvars[i].count, pvars[i].offset);
+	}
+}
+
+static void json_rows(REPORT *r, const REPORT_ROW *rows, int num){
+	int i;
+	for(i = 0; i < num; i++){
+		json_section(r, REPORT_REC_STATS, "stats");
+		fprintf(r->fp, "    {\"name\": ");
+		json_string(r->fp, r->pvars[rows[i].pvar].name);
+		fprintf(r->fp, ", \"element\": %d, \"min\": %llu, \"min_rank\": %d, \"max\": %llu, "
+				"\"max_rank\": %d, \"total\": %llu, \"average\": %.2lf", rows[i].element,
+				(unsigned long long)rows[i].min, rows[i].min_rank, (unsigned long long)rows[i].max,
+				rows[i].max_rank, (unsigned long long)rows[i].total, rows[i].average);
+		if(rows[i].min_label[0] != 0){
+			fprintf(r->fp, ", \"min_label\": ");
+			json_string(r->fp, rows[i].min_label);
+			fprintf(r->fp, ", \"max_label\": ");
+			json_string(r->fp, rows[i].max_label);
+		}
+		fprintf(r->fp, "}");
+	}
+}
+
+static void json_nodes(REPORT *r, const REPORT_NODE_ROW *rows, int num){
+	int i;
+	for(i = 0; i < num; i++){
+		json_section(r, REPORT_REC_NODES, "nodes");
+		fprintf(r->fp, "    {\"node\": %d, \"host\": ", rows[i].node);
+		json_string(r->fp, rows[i].host);
+		fprintf(r->fp, ", \"ranks\": %d, \"name\": ", rows[i].num_ranks);
+		json_string(r->fp, r->pvars[rows[i].pvar].name);
+		fprintf(r->fp, ", \"element\": %d, \"min\": %llu, \"min_rank\": %d, \"max\": %llu, "
+				"\"max_rank\": %d, \"total\": %llu, \"average\": %.2lf}", rows[i].element,
+				(unsigned long long)rows[i].min, rows[i].min_rank, (unsigned long long)rows[i].max,
+				rows[i].max_rank, (unsigned long long)rows[i].total, rows[i].average);
+	}
+}
+
+static void json_topk(REPORT *r, const REPORT_TOPK_ROW *rows, int num){
+	int i;
+	for(i = 0; i < num; i++){
+		json_section(r, REPORT_REC_TOPK, "topk");
+		fprintf(r->fp, "    {\"name\": ");
+		json_string(r->fp, r->pvars[rows[i].pvar].name);
+		fprintf(r->fp, ", \"element\": %d, \"rank\": %d, \"value\": %llu}", rows[i].element,
+				rows[i].rank, (unsigned long long)rows[i].value);
+	}
+}
+
+static void json_series(REPORT *r, int rank, const double *time, const uint64_t *values,
+		int num_rows, int num_values, const double *intervals, int num_pvars){
+	int i, j;
+
+	json_section(r, REPORT_REC_SERIES, "series");
+	fprintf(r->fp, "    {\"rank\": %d, \"time\": [", rank);
+	for(i = 0; i < num_rows; i++)
+		fprintf(r->fp, "%s%.6lf", i ? ", " : "", time[i]);
+	fprintf(r->fp, "],\n     \"values\": [");
+	for(i = 0; i < num_rows; i++){
+		fprintf(r->fp, "%s[", i ? ", " : "");
+		for(j = 0; j < num_values; j++)
+			fprintf(r->fp, "%s%llu", j ? ", " : "", (unsigned long long)values[(size_t)i * num_values + j]);
+		fprintf(r->fp, "]");
+	}
+	fprintf(r->fp, "]");
+	if(intervals != NULL){
+		fprintf(r->fp, ",\n     \"intervals\": [");
+		for(i = 0; i < num_rows; i++){
+			fprintf(r->fp, "%s[", i ? ", " : "");
+			for(j = 0; j < num_pvars; j++)
+				fprintf(r->fp, "%s%.6lf", j ? ", " : "", intervals[(size_t)i * num_pvars + j]);
+			fprintf(r->fp, "]");
+		}
+		fprintf(r->fp, "]");
+	}
+	fprintf(r->fp, "}");
+}
+
+static void json_end(REPORT *r){
+	if(r->section != REPORT_REC_INFO)
+		fprintf(r->fp, "\n  ]");
+	fprintf(r->fp, "\n}\n");
+}
+
+/* binary: the records are written as they are in memory */
+
+static void binary_record(REPORT *r, uint32_t type, uint64_t length){
+	REPORT_RECORD rec;
+	rec.type = type;
+	rec.reserved = 0;
+	rec.length = length;
+	fwrite(&rec, sizeof(rec), 1, r->fp);
+}
+
+static void binary_begin(REPORT *r, const REPORT_INFO *info){
+	fwrite(REPORT_MAGIC, 1, strlen(REPORT_MAGIC), r->fp);
+	binary_record(r, REPORT_REC_INFO, sizeof(REPORT_INFO));
+	fwrite(info, sizeof(REPORT_INFO), 1, r->fp);
+}
+
+static void binary_pvars(REPORT *r, const REPORT_PVAR *pvars, int num){
+	binary_record(r, REPORT_REC_PVARS, sizeof(REPORT_PVAR) * (uint64_t)num);
+	fwrite(pvars, sizeof(REPORT_PVAR), num, r->fp);
+}
+
+static void binary_rows(REPORT *r, const REPORT_ROW *rows, int num){
+	binary_record(r, REPORT_REC_STATS, sizeof(REPORT_ROW) * (uint64_t)num);
+	fwrite(rows, sizeof(REPORT_ROW), num, r->fp);
+}
+
+static void binary_nodes(REPORT *r, const REPORT_NODE_ROW *rows, int num){
+	binary_record(r, REPORT_REC_NODES, sizeof(REPORT_NODE_ROW) * (uint64_t)num);
+	fwrite(rows, sizeof(REPORT_NODE_ROW), num, r->fp);
+}
+
+static void binary_topk(REPORT *r, const REPORT_TOPK_ROW *rows, int num){
+	binary_record(r, REPORT_REC_TOPK, sizeof(REPORT_TOPK_ROW) * (uint64_t)num);
+	fwrite(rows, sizeof(REPORT_TOPK_ROW), num, r->fp);
+}
+
+static void binary_series(REPORT *r, int rank, const double *time, const uint64_t *values,
+		int num_rows, int num_values, const double *intervals, int num_pvars){
+	int32_t head[2];
+	int64_t rows = num_rows;
+
+	head[0] = rank;
+	head[1] = num_values;
+	binary_record(r, REPORT_REC_SERIES, sizeof(head) + sizeof(rows) +
+			sizeof(double) * (uint64_t)num_rows + sizeof(uint64_t) * (uint64_t)num_rows * num_values);
+	fwrite(head, sizeof(head), 1, r->fp);
+	fwrite(&rows, sizeof(rows), 1, r->fp);
+	fwrite(time, sizeof(double), num_rows, r->fp);
+	fwrite(values, sizeof(uint64_t), (size_t)num_rows * num_values, r->fp);
+	if(intervals == NULL)
+		return;
+	head[1] = num_pvars;
+	binary_record(r, REPORT_REC_INTERVALS, sizeof(head) + sizeof(rows) +
+			sizeof(double) * (uint64_t)num_rows * num_pvars);
+	fwrite(head, sizeof(head), 1, r->fp);
+	fwrite(&rows, sizeof(rows), 1, r->fp);
+	fwrite(intervals, sizeof(double), (size_t)num_rows * num_pvars, r->fp);
+}
+
+static void binary_end(REPORT *r){
+	binary_record(r, REPORT_REC_END, 0);
+}
+
+static const REPORT_BACKEND backends[] = {
+	{ "text", NULL, text_begin, text_pvars, text_rows, text_nodes, text_topk, text_series, text_end },
+	{ "csv", "csv", csv_begin, csv_pvars, csv_rows, csv_nodes, csv_topk, csv_series, csv_end },
+	{ "json", "json", json_begin, json_pvars, json_rows, json_nodes, json_topk, json_series, json_end },
+	{ "binary", "bin", binary_begin, binary_pvars, binary_rows, binary_nodes, binary_topk, binary_series, binary_end },
+};
+
+/**
+ * Select the backend by name and open the destination. Text goes to
+ * stdout unless a file is given, the other formats to
+ * gyan_report.<extension>.
+ * @return 0 on success, -1 for an unknown format or an unwritable file
+ */
+int report_open(REPORT *r, char *format, char *file){
+	char name[FILE_NAME_SZ];
+	int i;
+
+	memset(r, 0, sizeof(REPORT));
+	r->backend = &backends[0];
+	for(i = 0; format != NULL && format[0] != 0 && i < (int)(sizeof(backends) / sizeof(backends[0])); i++)
+		if(strcmp(format, backends[i].name) == 0)
+			break;
+	if(format != NULL && format[0] != 0){
+		if(i == (int)(sizeof(backends) / sizeof(backends[0])))
+			return -1;
+		r->backend = &backends[i];
+	}
+	if((file == NULL || file[0] == 0) && r->backend->extension != NULL){
+		snprintf(name, sizeof(name), "gyan_report.%s", r->backend->extension);
+		file = name;
+	}
+	r->fp = stdout;
+	if(file != NULL && file[0] != 0)
+		r->fp = fopen(file, "w");
+	return (r->fp == NULL) ? -1 : 0;
+}
+
+void report_begin(REPORT *r, const REPORT_INFO *info){
+	r->section = REPORT_REC_INFO;
+	r->backend->begin_report(r, info);
+}
+
+/**
+ * Hand the pvar metadata to the backend; rows and series refer to it.
+ */
+void report_pvars(REPORT *r, const REPORT_PVAR *pvars, int num){
+	r->pvars = (REPORT_PVAR*)realloc(r->pvars, sizeof(REPORT_PVAR) * (num + 1));
+	memcpy(r->pvars, pvars, sizeof(REPORT_PVAR) * num);
+	r->num_pvars = num;
+	r->backend->pvar_metadata(r, pvars, num);
+}
+
+void report_rows(REPORT *r, const REPORT_ROW *rows, int num){
+	r->backend->stats_row(r, rows, num);
+}
+
+void report_nodes(REPORT *r, const REPORT_NODE_ROW *rows, int num){
+	r->backend->node_row(r, rows, num);
+}
+
+void report_topk(REPORT *r, const REPORT_TOPK_ROW *rows, int num){
+	r->backend->topk_row(r, rows, num);
+}
+
+void report_series(REPORT *r, int rank, const double *time, const uint64_t *values,
+		int num_rows, int num_values, const double *intervals, int num_pvars){
+	r->backend->time_series_chunk(r, rank, time, values, num_rows, num_values, intervals, num_pvars);
+}
+
+void report_close(REPORT *r){
+	r->backend->end_report(r);
+	if(r->fp != stdout)
+		fclose(r->fp);
+	else
+		fflush(stdout);
+	free(r->pvars);
+	r->pvars = NULL;
+}
@@ -0,0 +1,155 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * report.h
+ *
+ * Output backends for the Gyan report. The aggregation code hands every
+ * backend contiguous arrays of fixed-layout records; a backend only
+ * formats them. MPIT_REPORT_FORMAT selects text (default), csv, json or
+ * binary, MPIT_REPORT_FILE the destination (default stdout for text,
+ * gyan_report.<csv|json|bin> otherwise).
+ *
+ * A report is written in this order: begin_report, pvar_metadata,
+ * stats_row (any number of calls), node_row (only with MPIT_NODE_REPORT),
+ * topk_row (only for pvars reduced as top-K lists), time_series_chunk (one
+ * per rank, only with MPIT_SERIES), end_report.
+ *
+ * The binary format is the magic "GYANRPT1" followed by records, each a
+ * REPORT_RECORD header and length bytes of payload written as in memory:
+ *   REPORT_REC_INFO    REPORT_INFO
+ *   REPORT_REC_PVARS   REPORT_PVAR[num_pvars]
+ *   REPORT_REC_STATS   REPORT_ROW[n]
+ *   REPORT_REC_NODES   REPORT_NODE_ROW[n]
+ *   REPORT_REC_TOPK    REPORT_TOPK_ROW[n]
+ *   REPORT_REC_SERIES  int32 rank, int32 num_values, int64 num_rows,
+ *                      double time[num_rows], uint64 values[num_rows][num_values]
+ *   REPORT_REC_INTERVALS  after a series when info.intervals is set: int32 rank,
+ *                      int32 num_pvars, int64 num_rows,
+ *                      double interval[num_rows][num_pvars], the seconds
+ *                      between samples of each pvar when the row was taken
+ *   REPORT_REC_END     no payload
+ */
+#include <stdint.h>
+#include "utility.h"
+
+#ifndef REPORT_H_
+#define REPORT_H_
+
+#define REPORT_NAME_SZ 64
+#define REPORT_CLASS_SZ 16
+#define REPORT_LABEL_SZ 24
+#define REPORT_MAGIC "GYANRPT1"
+
+#define REPORT_REC_INFO 1
+#define REPORT_REC_PVARS 2
+#define REPORT_REC_STATS 3
+#define REPORT_REC_SERIES 4
+#define REPORT_REC_END 5
+#define REPORT_REC_NODES 6
+#define REPORT_REC_TOPK 7
+#define REPORT_REC_INTERVALS 8
+
+typedef struct{
+	int32_t num_ranks;
+	int32_t num_pvars;
+	int32_t num_values; // elements of all pvars, the width of a series row
+	int32_t intervals; // series rows carry per-pvar sampling intervals (name@period, MPIT_SAMPLE_BUDGET)
+	double sample_interval; // default interval, the base one with adaptive sampling
+}REPORT_INFO;
+
+typedef struct{
+	char name[REPORT_NAME_SZ];
+	char var_class[REPORT_CLASS_SZ]; // as printed by Gyan, e.g. COUNTER
+	int32_t count; // elements
+	int32_t offset; // first element in a series row
+}REPORT_PVAR;
+
+typedef struct{
+	int32_t pvar; // index into the REPORT_PVAR array
+	int32_t element;
+	uint64_t min, max, total;
+	int32_t min_rank, max_rank;
+	double average;
+	char min_label[REPORT_LABEL_SZ]; // symbolic values of STATE pvars, empty otherwise
+	char max_label[REPORT_LABEL_SZ];
+}REPORT_ROW;
+
+/* statistics of one pvar element over the ranks of one node */
+typedef struct{
+	char host[REPORT_NAME_SZ];
+	int32_t node;
+	int32_t num_ranks;
+	int32_t pvar; // index into the REPORT_PVAR array
+	int32_t element;
+	uint64_t min, max, total;
+	int32_t min_rank, max_rank;
+	double average;
+}REPORT_NODE_ROW;
+
+/* one of the largest elements of a pvar over all ranks, largest first */
+typedef struct{
+	int32_t pvar; // index into the REPORT_PVAR array
+	int32_t element;
+	int32_t rank;
+	int32_t reserved;
+	uint64_t value;
+}REPORT_TOPK_ROW;
+
+typedef struct{
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t length;
+}REPORT_RECORD;
+
+struct report_backend;
+
+typedef struct{
+	const struct report_backend *backend;
+	FILE *fp;
+	int section; // last record type written, for the json backend
+	int num_pvars;
+	REPORT_PVAR *pvars; // copy of the metadata, rows refer to it
+}REPORT;
+
+typedef struct report_backend{
+	const char *name;
+	const char *extension;
+	void (*begin_report)(REPORT *r, const REPORT_INFO *info);
+	void (*pvar_metadata)(REPORT *r, const REPORT_PVAR *pvars, int num);
+	void (*stats_row)(REPORT *r, const REPORT_ROW *rows, int num);
+	void (*node_row)(REPORT *r, const REPORT_NODE_ROW *rows, int num);
+	void (*topk_row)(REPORT *r, const REPORT_TOPK_ROW *rows, int num);
+	void (*time_series_chunk)(REPORT *r, int rank, const double *time,
+			const uint64_t *values, int num_rows, int num_values,
+			const double *intervals, int num_pvars);
+	void (*end_report)(REPORT *r);
+}REPORT_BACKEND;
+
+int report_open(REPORT *r, char *format, char *file);
+void report_begin(REPORT *r, const REPORT_INFO *info);
+void report_pvars(REPORT *r, const REPORT_PVAR *pvars, int num);
+void report_rows(REPORT *r, const REPORT_ROW *rows, int num);
+void report_nodes(REPORT *r, const REPORT_NODE_ROW *rows, int num);
+void report_topk(REPORT *r, const REPORT_TOPK_ROW *rows, int num);
+void report_series(REPORT *r, int rank, const double *time, const uint64_t *values,
+		int num_rows, int num_values, const double *intervals, int num_pvars);
+void report_close(REPORT *r);
+#endif /* REPORT_H_ */
@@ -0,0 +1,178 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * sampler.c
+ *
+ * Adaptive sampling schedule, see sampler.h.
+ */
+
+#include "sampler.h"
+
+static double base_interval = 0.1; // MPIT_SAMPLE_INTERVAL
+static double overhead_budget = 0.005; // MPIT_SAMPLE_BUDGET, fraction of wall time
+
+static double moving(double average, double sample){
+	return average + SAMPLER_WEIGHT * (sample - average);
+}
+
+void sampler_setup(double base, double budget){
+	base_interval = base;
+	overhead_budget = budget;
+}
+
+/**
+ * MPIT_SAMPLE_BUDGET as a fraction of wall time, given either as a
+ * fraction (0.005) or as a percentage (0.5%). Returns 0 when invalid.
+ */
+double sampler_parse_budget(const char *value){
+	char *end;
+	double budget = strtod(value, &end);
+	if(end == value || budget <= 0)
+		return 0;
+	if(*end == '%')
+		budget /= 100;
+	return (budget < 1) ? budget : 0;
+}
+
+/**
+ * Grow the arrays to num pvars. New pvars start at the base interval.
+ */
+void sampler_reserve(SAMPLER *s, int num){
+	int i, old = s->capacity;
+
+	if(num <= old)
+		return;
+	s->interval = (double*)realloc(s->interval, sizeof(double) * num);
+	s->last_time = (double*)realloc(s->last_time, sizeof(double) * num);
+	s->last_value = (double*)realloc(s->last_value, sizeof(double) * num);
+	s->mean = (double*)realloc(s->mean, sizeof(double) * num);
+	s->var = (double*)realloc(s->var, sizeof(double) * num);
+	s->cost = (double*)realloc(s->cost, sizeof(double) * num);
+	s->fixed = (char*)realloc(s->fixed, num);
+	for(i = old; i < num; i++){
+		s->interval[i] = base_interval;
+		s->last_time[i] = 0;
+		s->last_value[i] = s->mean[i] = s->var[i] = s->cost[i] = 0;
+		s->fixed[i] = 0;
+	}
+	s->capacity = num;
+}
+
+/**
+ * Sample pvar i at the given period; its reads count towards the
+ * overhead but its interval is neither adapted nor stretched.
+ */
+void sampler_fix(SAMPLER *s, int i, double period){
+	s->interval[i] = period;
+	s->fixed[i] = 1;
+}
+
+/**
+ * Account a read of pvar i that returned value (summed over its elements)
+ * and took cost seconds, and adapt its interval. The rate of change is
+ * used rather than the difference between reads, so that a counter
+ * growing at a steady pace looks flat whatever the interval.
+ */
+void sampler_update(SAMPLER *s, int i, double value, double cost, double now){
+	double rate, diff;
+	double dt = now - s->last_time[i];
+	double before = (s->last_time[i] == 0) ? 0 : s->cost[i] / s->interval[i];
+
+	s->cost[i] = (s->last_time[i] == 0) ? cost : moving(s->cost[i], cost);
+	if(s->last_time[i] != 0 && dt > 0 && !s->fixed[i]){
+		rate = (value - s->last_value[i]) / dt;
+		diff = rate - s->mean[i];
+		s->mean[i] += SAMPLER_WEIGHT * diff;
+		s->var[i] = (1 - SAMPLER_WEIGHT) * (s->var[i] + SAMPLER_WEIGHT * diff * diff);
+		if(value != s->last_value[i] && s->var[i] > SAMPLER_ACTIVE_CV * SAMPLER_ACTIVE_CV * s->mean[i] * s->mean[i])
+			s->interval[i] /= SAMPLER_SPEEDUP;
+		else
+			s->interval[i] *= SAMPLER_BACKOFF;
+		if(s->interval[i] < base_interval / SAMPLER_RANGE)
+			s->interval[i] = base_interval / SAMPLER_RANGE;
+		if(s->interval[i] > base_interval * SAMPLER_RANGE)
+			s->interval[i] = base_interval * SAMPLER_RANGE;
+	}
+	s->overhead += s->cost[i] / s->interval[i] - before;
+	s->last_time[i] = now;
+	s->last_value[i] = value;
+}
+
+/**
+ * Stretch the adaptive intervals of the first num pvars when the
+ * predicted overhead, the read cost of every pvar at its rate plus the
+ * rest of the ticks at their measured rate, exceeds the budget. The
+ * pvars sampled faster than base*SAMPLER_RANGE are stretched first, so a
+ * burst on one pvar does not push the flat ones further out; only if the
+ * flat and fixed ones alone exceed the budget are all adaptive intervals
+ * stretched. tick_cost is the cost of the tick at now besides the reads.
+ * The overhead is kept up to date by sampler_update, so only a tick over
+ * the budget visits all pvars; a stretched interval applies from the
+ * pvar's next read on.
+ */
+void sampler_balance(SAMPLER *s, int num, double now, double tick_cost){
+	double overhead, fixed = 0, settled = 0, scale;
+	double longest = base_interval * SAMPLER_RANGE;
+	int i, adjustable = 0, all;
+
+	if(s->last_tick > 0 && now > s->last_tick)
+		s->tick_overhead = moving(s->tick_overhead, tick_cost / (now - s->last_tick));
+	s->last_tick = now;
+	overhead = s->overhead + s->tick_overhead;
+	if(overhead <= overhead_budget)
+		return;
+	for(i = 0; i < num; i++){
+		if(s->last_time[i] == 0)
+			continue;
+		if(s->fixed[i])
+			fixed += s->cost[i] / s->interval[i];
+		else if(s->interval[i] >= longest)
+			settled += s->cost[i] / s->interval[i];
+		else
+			adjustable++;
+	}
+	all = (adjustable == 0 || fixed + settled >= overhead_budget);
+	if(!all)
+		scale = (overhead - fixed - settled) / (overhead_budget - fixed - settled);
+	else if(fixed < overhead_budget)
+		scale = (overhead - fixed) / (overhead_budget - fixed);
+	else
+		scale = overhead / overhead_budget;
+	s->overhead = 0;
+	for(i = 0; i < num; i++){
+		if(s->last_time[i] == 0)
+			continue;
+		if(!s->fixed[i] && (all || s->interval[i] < longest))
+			s->interval[i] *= scale;
+		s->overhead += s->cost[i] / s->interval[i];
+	}
+}
+
+void sampler_free(SAMPLER *s){
+	free(s->interval);
+	free(s->last_time);
+	free(s->last_value);
+	free(s->mean);
+	free(s->var);
+	free(s->cost);
+	free(s->fixed);
+	memset(s, 0, sizeof(SAMPLER));
+}
@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * sampler.h
+ *
+ * Adaptive sampling schedule of one thread. Every watched pvar, with all
+ * its elements, is sampled at its own interval between base/SAMPLER_RANGE
+ * and base*SAMPLER_RANGE: the interval shrinks while the rate of change
+ * of the pvar varies and grows while the pvar is flat or changes at a
+ * steady rate. The measured cost of the reads and of the rest of a tick
+ * bounds the sampling rate, so that sampling takes at most a budget
+ * fraction of the thread's wall time. The timer wheel (wheel.h) decides
+ * when a pvar is read; the sampler only supplies its interval.
+ */
+#include "utility.h"
+
+#ifndef SAMPLER_H_
+#define SAMPLER_H_
+
+#define SAMPLER_RANGE 16.0 // intervals stay within base/RANGE and base*RANGE unless the budget needs more
+#define SAMPLER_SPEEDUP 4.0 // an active pvar divides its interval by this
+#define SAMPLER_BACKOFF 2.0 // a flat pvar multiplies its interval by this
+#define SAMPLER_ACTIVE_CV 0.1 // relative deviation of the rate of change above which a pvar is active
+#define SAMPLER_WEIGHT 0.25 // weight of the latest read in the moving averages
+
+typedef struct{
+	double *interval; // current sampling interval per watched pvar, seconds
+	double *last_time; // time of the latest read, 0 before the first one
+	double *last_value; // sum of the elements at the latest read
+	double *mean, *var; // moving mean and variance of the rate of change
+	double *cost; // moving average of the read cost, seconds
+	char *fixed; // period given in MPIT_VAR_TO_TRACE, not adapted
+	int capacity;
+	double overhead; // predicted fraction of wall time spent reading
+	double tick_overhead; // moving fraction of wall time spent in ticks besides the reads
+	double last_tick;
+}SAMPLER;
+
+void sampler_setup(double base, double budget);
+double sampler_parse_budget(const char *value);
+void sampler_reserve(SAMPLER *s, int num);
+void sampler_fix(SAMPLER *s, int i, double period);
+void sampler_update(SAMPLER *s, int i, double value, double cost, double now);
+void sampler_balance(SAMPLER *s, int num, double now, double tick_cost);
+void sampler_free(SAMPLER *s);
+#endif /* SAMPLER_H_ */
@@ -0,0 +1,224 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * shm_export.c
+ *
+ * Node-local shared-memory export of pvar values, see shm_export.h.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "shm_export.h"
+
+#define FALSE 0
+#define TRUE 1
+#define SHM_NAME_SZ 256
+
+static MPI_Comm node_comm = MPI_COMM_NULL;
+static int node_rank;
+static char shm_name[SHM_NAME_SZ];
+static void *base = NULL;
+static size_t segment_size;
+static GYAN_SHM_SLOT *slot;
+static GYAN_SHM_PVAR *slot_pvars;
+static uint64_t *slot_values;
+static uint32_t max_pvars, max_values;
+static uint32_t num_described; // pvar entries that fit into the slot
+static int publishing = FALSE; // a thread is updating the slot
+
+static void write_begin(){
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void write_end(){
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Create (node leader) or attach to the segment and claim the slot of this
+ * rank. Slot sizes are agreed on the node so the layout is uniform.
+ * Collective over MPI_COMM_WORLD.
+ * @return 1 if the export is active, 0 otherwise
+ */
+int shm_export_init(char *name, int rank, int max_pvars_local, int max_values_local, double sample_interval){
+	int local[2], node_max[2], num_slots, fd, ok, all_ok;
+	size_t slot_size;
+	GYAN_SHM_HEADER *header;
+
+	if(name[0] == '/')
+		snprintf(shm_name, sizeof(shm_name), "%s", name);
+	else
+		snprintf(shm_name, sizeof(shm_name), "/%s", name);
+	if(PMPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm) != MPI_SUCCESS)
+		return 0;
+	PMPI_Comm_rank(node_comm, &node_rank);
+	PMPI_Comm_size(node_comm, &num_slots);
+	local[0] = max_pvars_local;
+	local[1] = max_values_local;
+	PMPI_Allreduce(local, node_max, 2, MPI_INT, MPI_MAX, node_comm);
+	max_pvars = (node_max[0] > 0) ? node_max[0] : 1;
+	max_values = (node_max[1] > 0) ? node_max[1] : 1;
+	slot_size = sizeof(GYAN_SHM_SLOT) + sizeof(GYAN_SHM_PVAR) * max_pvars + sizeof(uint64_t) * max_values;
+	slot_size = (slot_size + 63) & ~(size_t)63; // slots do not share cache lines
+	segment_size = sizeof(GYAN_SHM_HEADER) + slot_size * num_slots;
+
+	/* the leader creates and sizes the segment, the others attach after it */
+	ok = TRUE;
+	if(node_rank == 0){
+		fd = shm_open(shm_name, O_CREAT | O_TRUNC | O_RDWR, 0644);
+		if(fd < 0 || ftruncate(fd, segment_size) != 0)
+			ok = FALSE;
+		if(fd >= 0)
+			close(fd);
+	}
+	PMPI_Bcast(&ok, 1, MPI_INT, 0, node_comm);
+	if(ok){
+		fd = shm_open(shm_name, O_RDWR, 0);
+		if(fd >= 0){
+			base = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			close(fd);
+		}
+		if(fd < 0 || base == MAP_FAILED){
+			base = NULL;
+			ok = FALSE;
+		}
+	}
+	PMPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, node_comm);
+	if(!all_ok){
+		if(base != NULL)
+			munmap(base, segment_size);
+		base = NULL;
+		if(node_rank == 0)
+			shm_unlink(shm_name);
+		if(!rank)
+			printf("Shared-memory export: cannot create %s, disabled\n", shm_name);
+		PMPI_Comm_free(&node_comm);
+		return 0;
+	}
+
+	slot = (GYAN_SHM_SLOT*)((char*)base + sizeof(GYAN_SHM_HEADER) + slot_size * node_rank);
+	slot_pvars = GYAN_SHM_SLOT_PVARS(slot);
+	slot_values = GYAN_SHM_SLOT_VALUES(slot, max_pvars);
+	write_begin();
+	slot->state = GYAN_SHM_SLOT_ACTIVE;
+	slot->rank = rank;
+	slot->pid = getpid();
+	write_end();
+
+	/* the magic is written last, readers wait for it */
+	PMPI_Barrier(node_comm);
+	if(node_rank == 0){
+		header = (GYAN_SHM_HEADER*)base;
+		header->version = GYAN_SHM_VERSION;
+		header->num_slots = num_slots;
+		header->max_pvars = max_pvars;
+		header->max_values = max_values;
+		header->slot_size = slot_size;
+		header->sample_interval = sample_interval;
+		__atomic_store_n(&header->magic, GYAN_SHM_MAGIC, __ATOMIC_RELEASE);
+	}
+	if(!rank){
+		printf("Shared-memory export: %s, %u pvars and %u values per rank\n", shm_name, max_pvars, max_values);
+		print_filled("",88,'-');
+	}
+	return 1;
+}
+
+/**
+ * Describe watched pvar number watched. Entries that do not fit into the
+ * slot are not exported.
+ */
+void shm_export_pvar(int watched, char *name, char *var_class, int count, int offset){
+	GYAN_SHM_PVAR *p;
+
+	if(base == NULL || watched >= max_pvars || offset + count > max_values)
+		return;
+	if(__atomic_exchange_n(&publishing, TRUE, __ATOMIC_ACQUIRE))
+		return;
+	p = &slot_pvars[watched];
+	write_begin();
+	memset(p->name, 0, GYAN_SHM_NAME_SZ);
+	strncpy(p->name, name, GYAN_SHM_NAME_SZ - 1);
+	memset(p->var_class, 0, GYAN_SHM_CLASS_SZ);
+	strncpy(p->var_class, var_class, GYAN_SHM_CLASS_SZ - 1);
+	p->count = count;
+	p->offset = offset;
+	if(watched >= num_described)
+		num_described = watched + 1;
+	slot->num_pvars = num_described;
+	write_end();
+	__atomic_store_n(&publishing, FALSE, __ATOMIC_RELEASE);
+}
+
+/**
+ * Publish the latest sample. A thread that finds another thread
+ * publishing skips this sample instead of waiting.
+ */
+void shm_export_publish(unsigned long long int *values, int num_pvars, int num_values){
+	struct timeval tv;
+	uint32_t i, n;
+
+	if(base == NULL || __atomic_exchange_n(&publishing, TRUE, __ATOMIC_ACQUIRE))
+		return;
+	n = (num_values < max_values) ? num_values : max_values;
+	gettimeofday(&tv, NULL);
+	write_begin();
+	for(i = 0; i < n; i++)
+		__atomic_store_n(&slot_values[i], values[i], __ATOMIC_RELAXED);
+	slot->num_values = n;
+	slot->num_pvars = ((uint32_t)num_pvars < num_described) ? (uint32_t)num_pvars : num_described;
+	slot->num_samples++;
+	slot->timestamp = tv.tv_sec + tv.tv_usec * 1e-6;
+	write_end();
+	__atomic_store_n(&publishing, FALSE, __ATOMIC_RELEASE);
+}
+
+/**
+ * Mapping of the whole segment and the rank on the node, for readers
+ * inside the job. NULL if the export is not active.
+ */
+void *shm_export_segment(int *node_rank_out){
+	*node_rank_out = node_rank;
+	return base;
+}
+
+/**
+ * Mark the slot final and unmap. The leader removes the segment name once
+ * all local ranks are done; monitors that still map it keep the final
+ * values. Collective over MPI_COMM_WORLD.
+ */
+void shm_export_finalize(){
+	if(base == NULL)
+		return;
+	write_begin();
+	slot->state = GYAN_SHM_SLOT_DONE;
+	write_end();
+	PMPI_Barrier(node_comm);
+	if(node_rank == 0)
+		shm_unlink(shm_name);
+	munmap(base, segment_size);
+	base = NULL;
+	PMPI_Comm_free(&node_comm);
+}
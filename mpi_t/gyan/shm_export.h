@@ -0,0 +1,41 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * shm_export.h
+ *
+ * Live export of the sampled pvar values into a node-local POSIX
+ * shared-memory segment named by MPIT_SHM_EXPORT (layout in shm_layout.h).
+ * Every rank owns one seqlock-protected slot; publishing a sample costs one
+ * store per value plus two stores of the sequence number, and never waits
+ * for readers. Monitors such as gyan_shm read the segment without MPI.
+ */
+#include "utility.h"
+#include "shm_layout.h"
+
+#ifndef SHM_EXPORT_H_
+#define SHM_EXPORT_H_
+
+int shm_export_init(char *name, int rank, int max_pvars, int max_values, double sample_interval);
+void shm_export_pvar(int watched, char *name, char *var_class, int count, int offset);
+void shm_export_publish(unsigned long long int *values, int num_pvars, int num_values);
+void *shm_export_segment(int *node_rank_out);
+void shm_export_finalize();
+#endif /* SHM_EXPORT_H_ */
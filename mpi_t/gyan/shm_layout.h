@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * shm_layout.h
+ *
+ * Layout of the node-local shared-memory segment Gyan publishes its
+ * sampled pvar values to (MPIT_SHM_EXPORT). The header does not depend on
+ * MPI so that monitors can read the segment without linking MPI.
+ *
+ * The segment starts with a GYAN_SHM_HEADER followed by num_slots slots of
+ * slot_size bytes, one per MPI rank on the node in node-local rank order.
+ * Each slot is a GYAN_SHM_SLOT followed by max_pvars GYAN_SHM_PVAR entries
+ * and max_values 64-bit values:
+ *
+ *   header | slot 0: GYAN_SHM_SLOT, pvars[max_pvars], values[max_values] | slot 1 ...
+ *
+ * Pvar i of a slot has count elements at values[offset .. offset+count-1].
+ * Only the first num_pvars entries and num_values values are valid.
+ *
+ * Every slot is protected by a sequence lock. The writer makes seq odd,
+ * updates the slot and makes seq even again; it never waits for readers.
+ * A reader copies the slot between two reads of seq and retries if seq was
+ * odd or changed. A seq that stays odd means the writer died mid-update.
+ */
+
+#ifndef SHM_LAYOUT_H_
+#define SHM_LAYOUT_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define GYAN_SHM_MAGIC 0x314d48534e415947ULL // "GYANSHM1"
+#define GYAN_SHM_VERSION 1
+#define GYAN_SHM_NAME_SZ 64
+#define GYAN_SHM_CLASS_SZ 16
+
+#define GYAN_SHM_SLOT_EMPTY 0 // rank has not attached yet
+#define GYAN_SHM_SLOT_ACTIVE 1
+#define GYAN_SHM_SLOT_DONE 2 // rank passed MPI_Finalize, values are final
+
+typedef struct{
+	uint64_t magic;
+	uint32_t version;
+	uint32_t num_slots;
+	uint32_t max_pvars; // pvar entries per slot
+	uint32_t max_values; // values per slot
+	uint64_t slot_size; // bytes per slot, a multiple of 64
+	double sample_interval; // seconds, 0 if values are only published in MPI_Finalize
+	char reserved[24];
+}GYAN_SHM_HEADER;
+
+typedef struct{
+	char name[GYAN_SHM_NAME_SZ];
+	char var_class[GYAN_SHM_CLASS_SZ]; // class name as printed by Gyan, e.g. COUNTER
+	uint32_t count;
+	uint32_t offset;
+}GYAN_SHM_PVAR;
+
+typedef struct{
+	uint64_t seq;
+	int32_t state; // GYAN_SHM_SLOT_*
+	int32_t rank; // rank in MPI_COMM_WORLD
+	int32_t pid;
+	uint32_t num_pvars;
+	uint32_t num_values;
+	uint32_t reserved;
+	uint64_t num_samples;
+	double timestamp; // wall-clock seconds of the latest sample
+	char pad[16];
+}GYAN_SHM_SLOT;
+
+#define GYAN_SHM_SLOT_PVARS(slot) ((GYAN_SHM_PVAR*)((char*)(slot) + sizeof(GYAN_SHM_SLOT)))
+#define GYAN_SHM_SLOT_VALUES(slot, max_pvars) \
+	((uint64_t*)((char*)(slot) + sizeof(GYAN_SHM_SLOT) + sizeof(GYAN_SHM_PVAR) * (max_pvars)))
+#define GYAN_SHM_SLOT_AT(base, i) \
+	((GYAN_SHM_SLOT*)((char*)(base) + sizeof(GYAN_SHM_HEADER) + ((GYAN_SHM_HEADER*)(base))->slot_size * (i)))
+
+#define GYAN_SHM_MAX_RETRIES 1000 // a slot still changing after this many reads is busy
+
+/**
+ * Copy a consistent snapshot of a slot of slot_size bytes.
+ * @return 0 on success, -1 if the writer kept the slot busy
+ */
+static inline int gyan_shm_read_slot(GYAN_SHM_SLOT *slot, GYAN_SHM_SLOT *copy, uint64_t slot_size){
+	uint64_t s1, s2;
+	int i;
+
+	for(i = 0; i < GYAN_SHM_MAX_RETRIES; i++){
+		s1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if(s1 & 1)
+			continue;
+		memcpy(copy, slot, slot_size);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		s2 = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+		if(s1 == s2)
+			return 0;
+	}
+	return -1;
+}
+
+/**
+ * TRUE if pvar entry p of a snapshot lies within the values of the slot,
+ * entries failing this are never dereferenced.
+ */
+static inline int gyan_shm_valid_pvar(uint32_t max_values, GYAN_SHM_SLOT *copy, GYAN_SHM_PVAR *p){
+	return (p->offset + (uint64_t)p->count <= copy->num_values && copy->num_values <= max_values);
+}
+
+#endif /* SHM_LAYOUT_H_ */
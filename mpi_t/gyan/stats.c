@@ -0,0 +1,167 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * stats.c
+ *
+ * Struct-of-arrays statistics of the watched pvars, see stats.h.
+ */
+
+#include "stats.h"
+
+static int op_num_values; // values per STATISTICS handed to stats_op
+
+static size_t line_align(size_t size){
+	return (size + STATS_CACHE_LINE - 1) & ~((size_t)STATS_CACHE_LINE - 1);
+}
+
+/**
+ * realloc for cache-line aligned buffers; the first old_size bytes are
+ * kept and the new ones are zeroed.
+ */
+void *stats_aligned_realloc(void *ptr, size_t old_size, size_t new_size){
+	void *p;
+	new_size = line_align(new_size ? new_size : 1);
+	if(posix_memalign(&p, STATS_CACHE_LINE, new_size) != 0)
+		return NULL;
+	if(ptr != NULL && old_size > 0)
+		memcpy(p, ptr, (old_size < new_size) ? old_size : new_size);
+	if(old_size < new_size)
+		memset((char*)p + old_size, 0, new_size - old_size);
+	free(ptr);
+	return p;
+}
+
+/**
+ * Bytes of the block holding num_values statistics: three value arrays
+ * followed by two rank arrays, each starting on a cache line.
+ */
+size_t stats_block_size(int num_values){
+	return 3 * line_align(sizeof(unsigned long long int) * num_values) +
+			2 * line_align(sizeof(int) * num_values);
+}
+
+/**
+ * Point the arrays of s into an existing block.
+ */
+void stats_view(STATISTICS *s, void *block, int num_values){
+	char *p = (char*)block;
+	size_t values = line_align(sizeof(unsigned long long int) * num_values);
+	size_t ranks = line_align(sizeof(int) * num_values);
+
+	s->block = block;
+	s->num_values = num_values;
+	s->min = (unsigned long long int*)p;
+	s->max = (unsigned long long int*)(p + values);
+	s->total = (unsigned long long int*)(p + 2 * values);
+	s->min_rank = (int*)(p + 3 * values);
+	s->max_rank = (int*)(p + 3 * values + ranks);
+}
+
+void stats_alloc(STATISTICS *s, int num_values){
+	stats_view(s, stats_aligned_realloc(NULL, 0, stats_block_size(num_values)), num_values);
+}
+
+/**
+ * Start the statistics from the values of one rank.
+ */
+void stats_set(STATISTICS *s, unsigned long long int *values, int rank){
+	int j;
+	memcpy(s->min, values, sizeof(unsigned long long int) * s->num_values);
+	memcpy(s->max, values, sizeof(unsigned long long int) * s->num_values);
+	memcpy(s->total, values, sizeof(unsigned long long int) * s->num_values);
+	for(j = 0; j < s->num_values; j++)
+		s->min_rank[j] = s->max_rank[j] = rank;
+}
+
+/**
+ * Add the values of one more rank. Ties keep the rank added first.
+ */
+void stats_add(STATISTICS *s, unsigned long long int *values, int rank){
+	int j;
+	for(j = 0; j < s->num_values; j++){
+		if(values[j] < s->min[j]){
+			s->min[j] = values[j];
+			s->min_rank[j] = rank;
+		}
+		if(values[j] > s->max[j]){
+			s->max[j] = values[j];
+			s->max_rank[j] = rank;
+		}
+		s->total[j] += values[j];
+	}
+}
+
+/**
+ * Combine two statistics blocks; ties go to the lower rank as with
+ * MPI_MINLOC/MPI_MAXLOC, so the operation commutes.
+ */
+static void combine(STATISTICS *in, STATISTICS *inout){
+	int j;
+	for(j = 0; j < in->num_values; j++){
+		if(in->min[j] < inout->min[j] ||
+				(in->min[j] == inout->min[j] && in->min_rank[j] < inout->min_rank[j])){
+			inout->min[j] = in->min[j];
+			inout->min_rank[j] = in->min_rank[j];
+		}
+		if(in->max[j] > inout->max[j] ||
+				(in->max[j] == inout->max[j] && in->max_rank[j] < inout->max_rank[j])){
+			inout->max[j] = in->max[j];
+			inout->max_rank[j] = in->max_rank[j];
+		}
+		inout->total[j] += in->total[j];
+	}
+}
+
+static void stats_op(void *invec, void *inoutvec, int *len, MPI_Datatype *datatype){
+	STATISTICS in, inout;
+	size_t size = stats_block_size(op_num_values);
+	int i;
+	for(i = 0; i < *len; i++){
+		stats_view(&in, (char*)invec + i * size, op_num_values);
+		stats_view(&inout, (char*)inoutvec + i * size, op_num_values);
+		combine(&in, &inout);
+	}
+}
+
+/**
+ * Reduce the statistics of all processes of comm onto root in a single
+ * message per process. out is only used on root and must have the same
+ * number of values as in. Collective over comm.
+ */
+void stats_reduce(STATISTICS *in, STATISTICS *out, int root, MPI_Comm comm){
+	MPI_Datatype type;
+	MPI_Op op;
+	int rank;
+
+	PMPI_Comm_rank(comm, &rank);
+	op_num_values = in->num_values;
+	PMPI_Type_contiguous((int)stats_block_size(in->num_values), MPI_BYTE, &type);
+	PMPI_Type_commit(&type);
+	PMPI_Op_create(stats_op, 1, &op);
+	PMPI_Reduce(in->block, (rank == root) ? out->block : NULL, 1, type, op, root, comm);
+	PMPI_Op_free(&op);
+	PMPI_Type_free(&type);
+}
+
+void stats_free(STATISTICS *s){
+	free(s->block);
+	memset(s, 0, sizeof(STATISTICS));
+}
@@ -0,0 +1,53 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * stats.h
+ *
+ * Statistics of the watched pvar elements as a struct of arrays. Every
+ * array is indexed like the sampled values (pvar_offset + element) and
+ * all arrays share one cache-line aligned block whose layout depends only
+ * on the number of values, so a whole STATISTICS can be combined, sent or
+ * reduced as one contiguous message.
+ */
+#include "utility.h"
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#define STATS_CACHE_LINE 64
+
+typedef struct{
+	unsigned long long int *min, *max; // the actual min and max values
+	unsigned long long int *total; // summation of values across all MPI ranks
+	int *min_rank, *max_rank; // ranks that resulted in the min and max values
+	int num_values;
+	void *block; // all arrays above
+}STATISTICS;
+
+void *stats_aligned_realloc(void *ptr, size_t old_size, size_t new_size);
+size_t stats_block_size(int num_values);
+void stats_alloc(STATISTICS *s, int num_values);
+void stats_view(STATISTICS *s, void *block, int num_values);
+void stats_set(STATISTICS *s, unsigned long long int *values, int rank);
+void stats_add(STATISTICS *s, unsigned long long int *values, int rank);
+void stats_reduce(STATISTICS *in, STATISTICS *out, int root, MPI_Comm comm);
+void stats_free(STATISTICS *s);
+#endif /* STATS_H_ */
@@ -0,0 +1,156 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * topk.c
+ *
+ * Top-K lists of large pvars, see topk.h.
+ */
+
+#include "topk.h"
+
+static int op_k, op_num_lists; // list shape handed to topk_op
+
+/**
+ * TRUE if entry a ranks before entry b in a list.
+ */
+static int before(const TOPK_ENTRY *a, const TOPK_ENTRY *b){
+	if(a->value != b->value)
+		return a->value > b->value;
+	if(a->rank != b->rank)
+		return a->rank < b->rank;
+	return a->element < b->element;
+}
+
+static int compare_entries(const void *a, const void *b){
+	if(before((const TOPK_ENTRY*)a, (const TOPK_ENTRY*)b))
+		return -1;
+	return before((const TOPK_ENTRY*)b, (const TOPK_ENTRY*)a);
+}
+
+/**
+ * Restore the heap property below position i of a heap whose root is the
+ * entry that ranks last.
+ */
+static void sift_down(TOPK_ENTRY *heap, int n, int i){
+	TOPK_ENTRY tmp;
+	int child;
+	for(; (child = 2 * i + 1) < n; i = child){
+		if(child + 1 < n && before(&heap[child], &heap[child + 1]))
+			child++;
+		if(!before(&heap[i], &heap[child]))
+			return;
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+	}
+}
+
+/**
+ * Fill list with the k largest non-zero values of one rank, in list order.
+ */
+void topk_select(TOPK_ENTRY *list, int k, unsigned long long int *values, int count, int rank){
+	TOPK_ENTRY e;
+	int i, j, n = 0;
+
+	for(i = 0; i < count; i++){
+		if(values[i] == 0)
+			continue;
+		e.value = values[i];
+		e.rank = rank;
+		e.element = i;
+		if(n < k){
+			/* heap insert, sifting the new entry up */
+			for(j = n++; j > 0 && before(&list[(j - 1) / 2], &e); j = (j - 1) / 2)
+				list[j] = list[(j - 1) / 2];
+			list[j] = e;
+		}
+		else if(before(&e, &list[0])){
+			list[0] = e;
+			sift_down(list, n, 0);
+		}
+	}
+	qsort(list, n, sizeof(TOPK_ENTRY), compare_entries);
+	for(i = n; i < k; i++){
+		list[i].value = 0;
+		list[i].rank = list[i].element = -1;
+	}
+}
+
+/**
+ * Number of used entries of a list.
+ */
+int topk_length(TOPK_ENTRY *list, int k){
+	int n = 0;
+	while(n < k && list[n].rank >= 0)
+		n++;
+	return n;
+}
+
+/**
+ * Merge two lists into b, keeping the first k entries.
+ */
+static void merge(TOPK_ENTRY *a, TOPK_ENTRY *b, TOPK_ENTRY *tmp, int k){
+	int na = topk_length(a, k), nb = topk_length(b, k);
+	int i = 0, j = 0, n;
+
+	for(n = 0; n < k && (i < na || j < nb); n++){
+		if(j >= nb || (i < na && before(&a[i], &b[j])))
+			tmp[n] = a[i++];
+		else
+			tmp[n] = b[j++];
+	}
+	for(; n < k; n++){
+		tmp[n].value = 0;
+		tmp[n].rank = tmp[n].element = -1;
+	}
+	memcpy(b, tmp, sizeof(TOPK_ENTRY) * k);
+}
+
+static void topk_op(void *invec, void *inoutvec, int *len, MPI_Datatype *datatype){
+	TOPK_ENTRY *in = (TOPK_ENTRY*)invec, *inout = (TOPK_ENTRY*)inoutvec;
+	TOPK_ENTRY *tmp = (TOPK_ENTRY*)malloc(sizeof(TOPK_ENTRY) * op_k);
+	int i;
+	for(i = 0; i < *len * op_num_lists; i++)
+		merge(in + (size_t)i * op_k, inout + (size_t)i * op_k, tmp, op_k);
+	free(tmp);
+}
+
+/**
+ * Merge num_lists top-K lists of every process of comm onto root. out is
+ * only used on root. Collective over comm.
+ */
+void topk_reduce(TOPK_ENTRY *in, TOPK_ENTRY *out, int num_lists, int k, int root, MPI_Comm comm){
+	MPI_Datatype type;
+	MPI_Op op;
+	int rank;
+
+	if(num_lists == 0 || k == 0)
+		return;
+	PMPI_Comm_rank(comm, &rank);
+	op_k = k;
+	op_num_lists = num_lists;
+	PMPI_Type_contiguous((int)(sizeof(TOPK_ENTRY) * num_lists * k), MPI_BYTE, &type);
+	PMPI_Type_commit(&type);
+	PMPI_Op_create(topk_op, 1, &op);
+	PMPI_Reduce(in, (rank == root) ? out : NULL, 1, type, op, root, comm);
+	PMPI_Op_free(&op);
+	PMPI_Type_free(&type);
+}
@@ -0,0 +1,45 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * topk.h
+ *
+ * Sparse reduction of pvars with many elements (per peer, per VC, ...).
+ * Every rank keeps only the K largest non-zero elements of such a pvar,
+ * and the lists of all ranks are merged by a reduction whose message size
+ * is K entries per pvar, whatever the element count and the rank count.
+ * Lists are sorted by descending value; ties go to the lower rank, then
+ * to the lower element. Unused entries have rank -1.
+ */
+#include "utility.h"
+
+#ifndef TOPK_H_
+#define TOPK_H_
+
+typedef struct{
+	unsigned long long int value;
+	int rank;
+	int element;
+}TOPK_ENTRY;
+
+void topk_select(TOPK_ENTRY *list, int k, unsigned long long int *values, int count, int rank);
+int topk_length(TOPK_ENTRY *list, int k);
+void topk_reduce(TOPK_ENTRY *in, TOPK_ENTRY *out, int num_lists, int k, int root, MPI_Comm comm);
+#endif /* TOPK_H_ */
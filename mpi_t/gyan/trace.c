@@ -0,0 +1,157 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * trace.c
+ *
+ * Writer of the per-rank traces, see trace.h.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "trace.h"
+
+#define FALSE 0
+#define TRUE 1
+
+static int fd = -1;
+static int num_values; // values per sample
+static size_t sample_size; // bytes of a sample record
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER; // file writes and the region table
+static char (*region_names)[TRACE_NAME_SZ];
+static int num_regions = 0;
+
+static void write_all(const void *data, size_t size){
+	const char *p = (const char*)data;
+	ssize_t n;
+
+	while(size > 0 && (n = write(fd, p, size)) > 0){
+		p += n;
+		size -= n;
+	}
+}
+
+/**
+ * Create <prefix>.<rank> and write the header and the pvar table.
+ * Returns TRUE on success.
+ */
+int trace_open(const char *prefix, int rank, int num_ranks, const TRACE_PVAR *pvars,
+		int num_pvars, int values, double sample_interval){
+	char path[4096];
+	TRACE_HEADER header;
+
+	snprintf(path, sizeof(path), "%s.%d", prefix, rank);
+	if((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0){
+		printf("Rank %d cannot create the trace %s\n", rank, path);
+		return FALSE;
+	}
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.rank = rank;
+	header.num_ranks = num_ranks;
+	header.num_pvars = num_pvars;
+	header.num_values = values;
+	header.sample_interval = sample_interval;
+	write_all(&header, sizeof(header));
+	write_all(pvars, sizeof(TRACE_PVAR) * num_pvars);
+	num_values = values;
+	sample_size = sizeof(TRACE_RECORD) + sizeof(TRACE_SAMPLE) + sizeof(uint64_t) * values;
+	region_names = malloc(sizeof(*region_names) * TRACE_MAX_REGIONS);
+	return TRUE;
+}
+
+/**
+ * Id of a region name; a new name is written to the trace first.
+ * Returns TRACE_NO_REGION when the table is full.
+ */
+int trace_region(const char *name){
+	TRACE_RECORD head;
+	TRACE_REGION region;
+	int id;
+
+	pthread_mutex_lock(&lock);
+	for(id = 0; id < num_regions; id++)
+		if(strncmp(region_names[id], name, TRACE_NAME_SZ - 1) == 0)
+			break;
+	if(id == num_regions){
+		if(num_regions == TRACE_MAX_REGIONS){
+			pthread_mutex_unlock(&lock);
+			return TRACE_NO_REGION;
+		}
+		memset(&region, 0, sizeof(region));
+		region.id = id;
+		strncpy(region.name, name, TRACE_NAME_SZ - 1);
+		memcpy(region_names[num_regions++], region.name, TRACE_NAME_SZ);
+		head.type = TRACE_REC_REGION;
+		head.length = sizeof(region);
+		write_all(&head, sizeof(head));
+		write_all(&region, sizeof(region));
+	}
+	pthread_mutex_unlock(&lock);
+	return id;
+}
+
+/**
+ * Append a sample of the first num_values values to the thread's buffer.
+ */
+void trace_sample(TRACE_BUFFER *b, double time, int thread, int region,
+		const unsigned long long int *values){
+	TRACE_RECORD head;
+	TRACE_SAMPLE sample;
+
+	if(fd < 0)
+		return;
+	if(b->data == NULL)
+		b->data = (char*)malloc(TRACE_BUFFER_SZ > sample_size ? TRACE_BUFFER_SZ : sample_size);
+	if(b->used + sample_size > TRACE_BUFFER_SZ)
+		trace_flush(b);
+	head.type = TRACE_REC_SAMPLE;
+	head.length = sample_size - sizeof(head);
+	sample.time = time;
+	sample.thread = thread;
+	sample.region = region;
+	memcpy(b->data + b->used, &head, sizeof(head));
+	memcpy(b->data + b->used + sizeof(head), &sample, sizeof(sample));
+	memcpy(b->data + b->used + sizeof(head) + sizeof(sample), values, sizeof(uint64_t) * num_values);
+	b->used += sample_size;
+}
+
+/**
+ * Write the buffered samples of a thread. Only whole records are
+ * buffered, so records of different threads never interleave.
+ */
+void trace_flush(TRACE_BUFFER *b){
+	if(fd < 0 || b->used == 0)
+		return;
+	pthread_mutex_lock(&lock);
+	write_all(b->data, b->used);
+	pthread_mutex_unlock(&lock);
+	b->used = 0;
+}
+
+void trace_close(void){
+	if(fd >= 0)
+		close(fd);
+	fd = -1;
+	free(region_names);
+	region_names = NULL;
+	num_regions = 0;
+}
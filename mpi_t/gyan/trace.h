@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * trace.h
+ *
+ * Per-rank trace files of the sampled pvar values (MPIT_TRACE), read
+ * offline by gyan_report. The layout is in trace_layout.h. Every thread
+ * appends its samples to its own buffer; full buffers are written to the
+ * rank's file under a lock, as are the region names.
+ */
+#include "utility.h"
+#include "trace_layout.h"
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#define TRACE_BUFFER_SZ 65536 // bytes buffered per thread between writes
+#define TRACE_MAX_DEPTH 16 // nesting of MPI_Pcontrol regions per thread
+#define TRACE_MAX_REGIONS 1024 // region names per rank
+
+typedef struct{
+	char *data;
+	size_t used;
+}TRACE_BUFFER;
+
+int trace_open(const char *prefix, int rank, int num_ranks, const TRACE_PVAR *pvars,
+		int num_pvars, int num_values, double sample_interval);
+int trace_region(const char *name);
+void trace_sample(TRACE_BUFFER *b, double time, int thread, int region,
+		const unsigned long long int *values);
+void trace_flush(TRACE_BUFFER *b);
+void trace_close(void);
+#endif /* TRACE_H_ */
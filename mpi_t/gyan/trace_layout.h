@@ -0,0 +1,88 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * trace_layout.h
+ *
+ * Layout of the per-rank trace files Gyan writes with MPIT_TRACE=<prefix>
+ * to <prefix>.<rank>. It does not depend on MPI so that offline tools
+ * such as gyan_report can read the traces without linking MPI.
+ *
+ * A trace is a TRACE_HEADER, num_pvars TRACE_PVAR entries, then a stream
+ * of records, each a TRACE_RECORD header and length bytes of payload, in
+ * the byte order of the machine that wrote it:
+ *
+ *   TRACE_REC_REGION  TRACE_REGION, the name of a region id; it precedes
+ *                     the first sample in the region
+ *   TRACE_REC_SAMPLE  TRACE_SAMPLE followed by uint64 values[num_values],
+ *                     the values of the pvars watched at MPI_Init
+ *
+ * Samples of one thread are in time order; those of different threads
+ * may interleave in blocks. The last sample of a rank is taken in
+ * MPI_Finalize and holds its final values. Readers skip records of
+ * unknown types.
+ */
+#include <stdint.h>
+
+#ifndef TRACE_LAYOUT_H_
+#define TRACE_LAYOUT_H_
+
+#define TRACE_MAGIC "GYANTRC1"
+#define TRACE_NAME_SZ 64
+#define TRACE_CLASS_SZ 16
+
+#define TRACE_REC_REGION 1
+#define TRACE_REC_SAMPLE 2
+
+#define TRACE_NO_REGION -1 // sample taken outside any MPI_Pcontrol region
+
+typedef struct{
+	char magic[8];
+	int32_t rank;
+	int32_t num_ranks;
+	int32_t num_pvars;
+	int32_t num_values; // elements of all pvars, the values per sample
+	double sample_interval; // seconds
+}TRACE_HEADER;
+
+typedef struct{
+	char name[TRACE_NAME_SZ];
+	char var_class[TRACE_CLASS_SZ]; // as printed by Gyan, e.g. COUNTER
+	int32_t count; // elements
+	int32_t offset; // first element in a sample
+}TRACE_PVAR;
+
+typedef struct{
+	uint32_t type;
+	uint32_t length; // payload bytes
+}TRACE_RECORD;
+
+typedef struct{
+	int32_t id;
+	int32_t reserved;
+	char name[TRACE_NAME_SZ];
+}TRACE_REGION;
+
+typedef struct{
+	double time; // seconds since MPI_Init
+	int32_t thread; // application thread of the rank, in order of their first MPI call
+	int32_t region; // innermost region, TRACE_NO_REGION outside
+}TRACE_SAMPLE;
+#endif /* TRACE_LAYOUT_H_ */
@@ -0,0 +1,341 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * tuning.c
+ *
+ * Runtime side of the tuning database, see tuning.h.
+ */
+
+#include "tuning.h"
+
+#define FALSE 0
+#define TRUE 1
+#define MAX_TUNED_CVARS 32
+#define SIZE_BUCKETS 65 // bucket 0 holds 0 bytes, bucket b holds [2^(b-1), 2^b - 1]
+#define NO_SET -1
+
+typedef struct{
+	char name[TUNING_DB_NAME_SZ];
+	MPI_T_cvar_handle handle;
+	MPI_Datatype datatype;
+	MPI_T_enum enumtype;
+	int writable; // FALSE once the library rejected a write from a wrapper
+}TUNED_CVAR;
+
+/* The settings of one database entry, pre-parsed for the wrappers */
+typedef struct{
+	TUNING_ENTRY *entry;
+	int num;
+	int cvar[TUNING_DB_MAX_CVARS];
+	double value[TUNING_DB_MAX_CVARS]; // binary cvar value, see cvar_parse_string
+	int parsed[TUNING_DB_MAX_CVARS];
+}SETTING_SET;
+
+typedef struct{
+	int enabled;
+	int ranks; // communicator size the selected entries were tuned for, 0 if none
+	short table[SIZE_BUCKETS];
+	int current;
+}TUNED_COLLECTIVE;
+
+static TUNING_DB db;
+static TUNED_CVAR tuned_cvars[MAX_TUNED_CVARS];
+static int num_tuned_cvars = 0;
+static SETTING_SET *setting_sets;
+static int num_setting_sets = 0;
+static TUNED_COLLECTIVE tuned_coll[NUM_TUNED_COLL];
+static char *coll_kernel[NUM_TUNED_COLL] = { "bcast", "allreduce" };
+
+/**
+ * Find or allocate the handle for a tuned cvar. Cvars bound to a
+ * communicator are bound to MPI_COMM_WORLD.
+ * @return index into tuned_cvars or -1
+ */
+static int get_tuned_cvar(char *name){
+	int i, index, count, err;
+	int namelen, desclen, verb, bind, scope;
+	char cname[TUNING_DB_NAME_SZ];
+	char desc[256];
+	MPI_Comm comm = MPI_COMM_WORLD;
+	TUNED_CVAR *cv;
+
+	for(i = 0; i < num_tuned_cvars; i++)
+		if(strcmp(tuned_cvars[i].name, name) == 0)
+			return i;
+	if(num_tuned_cvars == MAX_TUNED_CVARS)
+		return -1;
+	index = cvar_get_index_by_name(name);
+	if(index < 0)
+		return -1;
+	cv = &tuned_cvars[num_tuned_cvars];
+	namelen = TUNING_DB_NAME_SZ;
+	desclen = sizeof(desc);
+	MPI_T_cvar_get_info(index, cname, &namelen, &verb, &cv->datatype, &cv->enumtype,
+			desc, &desclen, &bind, &scope);
+	if(bind == MPI_T_BIND_NO_OBJECT)
+		err = MPI_T_cvar_handle_alloc(index, NULL, &cv->handle, &count);
+	else if(bind == MPI_T_BIND_MPI_COMM)
+		err = MPI_T_cvar_handle_alloc(index, &comm, &cv->handle, &count);
+	else
+		err = MPI_T_ERR_INVALID;
+	if(err != MPI_SUCCESS)
+		return -1;
+	strcpy(cv->name, name);
+	cv->writable = TRUE;
+	return num_tuned_cvars++;
+}
+
+static int build_setting_set(TUNING_ENTRY *e){
+	SETTING_SET *set = &setting_sets[num_setting_sets];
+	int i, cv;
+
+	set->entry = e;
+	set->num = 0;
+	for(i = 0; i < e->num_settings; i++){
+		cv = get_tuned_cvar(e->settings[i].name);
+		if(cv < 0)
+			continue;
+		set->cvar[set->num] = cv;
+		set->parsed[set->num] = (tuned_cvars[cv].datatype != MPI_CHAR) &&
+				(cvar_parse_string(tuned_cvars[cv].datatype, tuned_cvars[cv].enumtype,
+						e->settings[i].value, &set->value[set->num]) == MPI_SUCCESS);
+		set->num++;
+	}
+	return num_setting_sets++;
+}
+
+/**
+ * Write all settings of a set from their textual value.
+ * @return number of settings the library accepted
+ */
+static int apply_setting_set(SETTING_SET *set){
+	int i, applied = 0;
+	TUNED_CVAR *cv;
+	for(i = 0; i < set->num; i++){
+		cv = &tuned_cvars[set->cvar[i]];
+		if(cvar_write_string(cv->handle, cv->datatype, cv->enumtype,
+				set->entry->settings[i].value) == MPI_SUCCESS)
+			applied++;
+	}
+	return applied;
+}
+
+static int get_coll_index(char *kernel){
+	int i;
+	for(i = 0; i < NUM_TUNED_COLL; i++)
+		if(strcmp(kernel, coll_kernel[i]) == 0)
+			return i;
+	return -1;
+}
+
+/**
+ * Distance of a message size from the range of a set, 0 if inside.
+ */
+static unsigned long long int range_distance(SETTING_SET *set, unsigned long long int size){
+	if(size < set->entry->min_size)
+		return set->entry->min_size - size;
+	if(size > set->entry->max_size)
+		return size - set->entry->max_size;
+	return 0;
+}
+
+/**
+ * Build the size lookup table of a collective from the entries tuned for
+ * the largest communicator size not above world_size, or the smallest one
+ * if all are larger.
+ */
+static void build_lookup_table(int coll, int first_set, int last_set, int world_size){
+	TUNED_COLLECTIVE *tc = &tuned_coll[coll];
+	int s, b, ranks, best;
+	unsigned long long int lower, dist, best_dist;
+
+	tc->ranks = 0;
+	for(s = first_set; s < last_set; s++){
+		if(get_coll_index(setting_sets[s].entry->kernel) != coll)
+			continue;
+		ranks = setting_sets[s].entry->ranks;
+		if(tc->ranks == 0 || (ranks <= world_size && (ranks > tc->ranks || tc->ranks > world_size)) ||
+				(ranks > world_size && tc->ranks > world_size && ranks < tc->ranks))
+			tc->ranks = ranks;
+	}
+
+	/* Every size bucket maps to the set whose range contains (or is closest to) its lower bound */
+	for(b = 0; b < SIZE_BUCKETS; b++){
+		lower = (b == 0) ? 0 : (1ULL << (b - 1));
+		best = NO_SET;
+		best_dist = 0;
+		for(s = first_set; s < last_set; s++){
+			if(get_coll_index(setting_sets[s].entry->kernel) != coll ||
+					setting_sets[s].entry->ranks != tc->ranks)
+				continue;
+			dist = range_distance(&setting_sets[s], lower);
+			if(best == NO_SET || dist < best_dist){
+				best = s;
+				best_dist = dist;
+			}
+		}
+		tc->table[b] = best;
+	}
+	/* Switching is only needed if the table selects more than one set */
+	tc->current = NO_SET;
+	tc->enabled = FALSE;
+	for(b = 0; b < SIZE_BUCKETS; b++)
+		if(tc->table[b] != tc->table[0])
+			tc->enabled = TRUE;
+}
+
+static int get_size_bucket(unsigned long long int bytes){
+#ifdef __GNUC__
+	return (bytes == 0) ? 0 : 64 - __builtin_clzll(bytes);
+#else
+	int b = 0;
+	while(bytes != 0){
+		bytes >>= 1;
+		b++;
+	}
+	return b;
+#endif
+}
+
+/**
+ * Load the tuning database and apply the settings for this library,
+ * node count and MPI_COMM_WORLD size. Collective over MPI_COMM_WORLD.
+ * @return number of settings applied, -1 if the database was not usable
+ */
+int tuning_init(char *db_file, int rank){
+	char libversion[MPI_MAX_LIBRARY_VERSION_STRING];
+	int libversionlen, nodes, world_size, best_nodes = -1;
+	int i, coll, widest, applied = 0, switching = 0;
+	unsigned long long int lib_hash, range, widest_range = 0;
+	TUNING_ENTRY *e;
+
+	PMPI_Get_library_version(libversion, &libversionlen);
+	lib_hash = tuning_db_library_hash(libversion, libversionlen);
+	nodes = tuning_db_count_nodes(MPI_COMM_WORLD);
+	PMPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+	tuning_db_init(&db);
+	if(tuning_db_load(db_file, &db) < 0){
+		if(!rank)
+			printf("Cannot read tuning database %s\n", db_file);
+		return -1;
+	}
+
+	/* Use the entries tuned on the node count closest to this run */
+	for(i = 0; i < db.num; i++){
+		e = &db.entries[i];
+		if(e->lib_hash != lib_hash)
+			continue;
+		if(best_nodes < 0 || abs(e->nodes - nodes) < abs(best_nodes - nodes))
+			best_nodes = e->nodes;
+	}
+	if(best_nodes < 0){
+		if(!rank)
+			printf("Tuning database %s has no entries for this MPI library\n", db_file);
+		tuning_db_free(&db);
+		return -1;
+	}
+
+	setting_sets = (SETTING_SET*)malloc(sizeof(SETTING_SET) * (db.num + 1));
+	for(i = 0; i < db.num; i++){
+		e = &db.entries[i];
+		if(e->lib_hash == lib_hash && e->nodes == best_nodes)
+			build_setting_set(e);
+	}
+
+	/* Point-to-point settings cannot follow the message size, use the widest range */
+	widest = NO_SET;
+	for(i = 0; i < num_setting_sets; i++){
+		e = setting_sets[i].entry;
+		range = e->max_size - e->min_size;
+		if(strcmp(e->kernel, "bw") == 0 && (widest == NO_SET || range > widest_range ||
+				(range == widest_range && abs(e->ranks - world_size) < abs(setting_sets[widest].entry->ranks - world_size)))){
+			widest = i;
+			widest_range = range;
+		}
+	}
+	if(widest != NO_SET)
+		applied += apply_setting_set(&setting_sets[widest]);
+
+	/* Collectives start with the settings for small messages on MPI_COMM_WORLD */
+	for(coll = 0; coll < NUM_TUNED_COLL; coll++){
+		TUNED_COLLECTIVE *tc = &tuned_coll[coll];
+		build_lookup_table(coll, 0, num_setting_sets, world_size);
+		if(tc->ranks == 0)
+			continue;
+		tc->current = tc->table[1];
+		applied += apply_setting_set(&setting_sets[tc->current]);
+		if(tc->enabled)
+			switching++;
+	}
+
+	if(!rank){
+		printf("Tuning database %s: applied %d cvar settings (%d nodes), %d collectives switch per message size\n",
+				db_file, applied, best_nodes, switching);
+		print_filled("",88,'-');
+	}
+	return applied;
+}
+
+/**
+ * Called by the collective wrappers before entering the library. Writes
+ * the cvars recorded for this message size if they differ from what was
+ * applied last. A cvar whose write is rejected here is not written again.
+ *
+ * Only collectives on MPI_COMM_WORLD switch: the handles are bound to it,
+ * and a collective on it is entered by every rank with the same message
+ * size, so cvars that must be equal on all ranks stay equal. A collective
+ * on another communicator would rewrite the settings of the world
+ * communicator on a subset of the ranks.
+ */
+void tuning_switch(int coll, int count, MPI_Datatype datatype, MPI_Comm comm){
+	TUNED_COLLECTIVE *tc = &tuned_coll[coll];
+	SETTING_SET *set;
+	int type_size, s, i;
+	TUNED_CVAR *cv;
+
+	if(!tc->enabled || comm != MPI_COMM_WORLD)
+		return;
+	PMPI_Type_size(datatype, &type_size);
+	s = tc->table[get_size_bucket((unsigned long long int)count * type_size)];
+	if(s == tc->current || s == NO_SET)
+		return;
+	tc->current = s;
+	set = &setting_sets[s];
+	for(i = 0; i < set->num; i++){
+		cv = &tuned_cvars[set->cvar[i]];
+		if(cv->writable && set->parsed[i] && MPI_T_cvar_write(cv->handle, &set->value[i]) != MPI_SUCCESS)
+			cv->writable = FALSE;
+	}
+}
+
+void tuning_finalize(){
+	int i;
+	for(i = 0; i < num_tuned_cvars; i++)
+		MPI_T_cvar_handle_free(&tuned_cvars[i].handle);
+	num_tuned_cvars = 0;
+	for(i = 0; i < NUM_TUNED_COLL; i++)
+		tuned_coll[i].enabled = FALSE;
+	free(setting_sets);
+	setting_sets = NULL;
+	num_setting_sets = 0;
+	tuning_db_free(&db);
+}
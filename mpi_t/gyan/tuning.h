@@ -0,0 +1,43 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * tuning.h
+ *
+ * Applies a tuning database written by cvar_tuner inside Gyan. Settings
+ * are written once at MPI_Init; cvars whose best value depends on the
+ * message size are switched by the wrappers of collectives on
+ * MPI_COMM_WORLD through a lookup table indexed by log2 of the message
+ * size, built from the entries tuned for the communicator size closest to
+ * MPI_COMM_WORLD.
+ */
+#include "tuning_db.h"
+
+#ifndef TUNING_H_
+#define TUNING_H_
+
+#define TUNED_BCAST 0
+#define TUNED_ALLREDUCE 1
+#define NUM_TUNED_COLL 2
+
+int tuning_init(char *db_file, int rank);
+void tuning_switch(int coll, int count, MPI_Datatype datatype, MPI_Comm comm);
+void tuning_finalize();
+#endif /* TUNING_H_ */
@@ -0,0 +1,317 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * tuning_db.c
+ *
+ * Reading and writing of the cvar tuning database shared by cvar_tuner
+ * and Gyan, plus helpers to write control variables from strings.
+ */
+
+#include "tuning_db.h"
+
+#ifndef MPI_COUNT
+#define MPI_COUNT MPI_INT
+typedef int MPI_Count;
+#endif
+
+#define STR_SZ 256
+
+/**
+ * FNV-1a hash of the library version string. The string returned by
+ * MPI_Get_library_version contains blanks and newlines, so the database
+ * keys on this hash instead.
+ */
+unsigned long long int tuning_db_library_hash(char *libversion, int len){
+	unsigned long long int hash = 14695981039346656037ULL;
+	int i;
+	for(i = 0; i < len && libversion[i] != 0; i++){
+		hash ^= (unsigned char)libversion[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+void tuning_db_init(TUNING_DB *db){
+	db->num = 0;
+	db->capacity = 0;
+	db->entries = NULL;
+}
+
+int tuning_db_add(TUNING_DB *db, TUNING_ENTRY *entry){
+	if(db->num == db->capacity){
+		int capacity = (db->capacity == 0) ? 32 : db->capacity * 2;
+		TUNING_ENTRY *entries = (TUNING_ENTRY*)realloc(db->entries, sizeof(TUNING_ENTRY) * capacity);
+		if(entries == NULL)
+			return -1;
+		db->entries = entries;
+		db->capacity = capacity;
+	}
+	db->entries[db->num++] = *entry;
+	return 0;
+}
+
+void tuning_db_remove_key(TUNING_DB *db, unsigned long long int lib_hash,
+		int nodes, int ranks, char *kernel){
+	int i, j;
+	for(i = 0, j = 0; i < db->num; i++){
+		TUNING_ENTRY *e = &db->entries[i];
+		if(e->lib_hash == lib_hash && e->nodes == nodes && e->ranks == ranks &&
+				strcmp(e->kernel, kernel) == 0)
+			continue;
+		if(i != j)
+			db->entries[j] = *e;
+		j++;
+	}
+	db->num = j;
+}
+
+void tuning_db_free(TUNING_DB *db){
+	free(db->entries);
+	tuning_db_init(db);
+}
+
+/**
+ * Parse one database line into an entry.
+ * @return 0 on success, -1 for comments, blank or malformed lines
+ */
+static int parse_line(char *line, TUNING_ENTRY *e){
+	char *p, *save, *eq;
+	int n;
+
+	while(*line == ' ' || *line == '\t')
+		line++;
+	if(*line == '#' || *line == '\n' || *line == 0)
+		return -1;
+
+	memset(e, 0, sizeof(TUNING_ENTRY));
+	n = sscanf(line, "%llx %d %d %15s %llu %llu %lf", &e->lib_hash, &e->nodes, &e->ranks,
+			e->kernel, &e->min_size, &e->max_size, &e->metric);
+	if(n != 7)
+		return -1;
+
+	/* skip the seven fixed fields, the rest are name=value pairs */
+	p = strtok_r(line, " \t\n", &save);
+	for(n = 1; n < 7 && p != NULL; n++)
+		p = strtok_r(NULL, " \t\n", &save);
+	while((p = strtok_r(NULL, " \t\n", &save)) != NULL && e->num_settings < TUNING_DB_MAX_CVARS){
+		eq = strchr(p, '=');
+		if(eq == NULL)
+			continue;
+		*eq = 0;
+		strncpy(e->settings[e->num_settings].name, p, TUNING_DB_NAME_SZ - 1);
+		strncpy(e->settings[e->num_settings].value, eq + 1, TUNING_DB_VALUE_SZ - 1);
+		e->num_settings++;
+	}
+	return 0;
+}
+
+/**
+ * Append all entries of a database file to db.
+ * @return number of entries read, -1 if the file cannot be opened
+ */
+int tuning_db_load(const char *file, TUNING_DB *db){
+	FILE *fp;
+	char line[TUNING_DB_LINE_SZ];
+	TUNING_ENTRY entry;
+	int num = 0;
+
+	fp = fopen(file, "r");
+	if(fp == NULL)
+		return -1;
+	while(fgets(line, sizeof(line), fp) != NULL){
+		if(parse_line(line, &entry) == 0){
+			if(tuning_db_add(db, &entry) != 0)
+				break;
+			num++;
+		}
+	}
+	fclose(fp);
+	return num;
+}
+
+int tuning_db_save(const char *file, TUNING_DB *db, char *libversion){
+	FILE *fp;
+	int i, j;
+	char *c;
+
+	fp = fopen(file, "w");
+	if(fp == NULL)
+		return -1;
+	fprintf(fp, "# Gyan cvar tuning database\n");
+	fprintf(fp, "# lib_hash nodes ranks kernel min_size max_size metric cvar=value ...\n");
+	if(libversion != NULL){
+		/* keep the human readable version string on a single comment line */
+		fprintf(fp, "# lib %016llx ", tuning_db_library_hash(libversion, strlen(libversion)));
+		for(c = libversion; *c != 0; c++)
+			fputc((*c == '\n') ? ' ' : *c, fp);
+		fputc('\n', fp);
+	}
+	for(i = 0; i < db->num; i++){
+		TUNING_ENTRY *e = &db->entries[i];
+		fprintf(fp, "%016llx %d %d %s %llu %llu %.3lf", e->lib_hash, e->nodes, e->ranks,
+				e->kernel, e->min_size, e->max_size, e->metric);
+		for(j = 0; j < e->num_settings; j++)
+			fprintf(fp, " %s=%s", e->settings[j].name, e->settings[j].value);
+		fprintf(fp, "\n");
+	}
+	fclose(fp);
+	return 0;
+}
+
+/**
+ * Count the number of shared-memory nodes spanned by comm.
+ * Collective over comm.
+ */
+int tuning_db_count_nodes(MPI_Comm comm){
+	MPI_Comm node_comm;
+	int node_rank, is_leader, nodes = 1;
+
+	if(PMPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm) != MPI_SUCCESS)
+		return 1;
+	PMPI_Comm_rank(node_comm, &node_rank);
+	is_leader = (node_rank == 0);
+	PMPI_Allreduce(&is_leader, &nodes, 1, MPI_INT, MPI_SUM, comm);
+	PMPI_Comm_free(&node_comm);
+	return nodes;
+}
+
+/**
+ * Find a control variable index by its name.
+ * @return the index or -1 if the library does not expose it
+ */
+int cvar_get_index_by_name(char *name){
+	int num, i, namelen, desclen, verb, bind, scope;
+	char cname[STR_SZ + 1];
+	char desc[STR_SZ + 1];
+	MPI_Datatype datatype;
+	MPI_T_enum enumtype;
+
+	if(MPI_T_cvar_get_num(&num) != MPI_SUCCESS)
+		return -1;
+	for(i = 0; i < num; i++){
+		namelen = desclen = STR_SZ;
+		if(MPI_T_cvar_get_info(i, cname, &namelen, &verb, &datatype, &enumtype,
+				desc, &desclen, &bind, &scope) != MPI_SUCCESS)
+			continue;
+		if(strcmp(cname, name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * Convert the textual value of a single-element cvar into its binary
+ * representation. Enumerated integer cvars also accept the symbolic name
+ * of an enum item. buffer must hold at least sizeof(double) bytes.
+ */
+int cvar_parse_string(MPI_Datatype datatype, MPI_T_enum enumtype, char *value, void *buffer){
+	char *end;
+
+	if(datatype == MPI_INT){
+		int v = (int)strtol(value, &end, 0);
+		if(*end != 0 && enumtype != MPI_T_ENUM_NULL){
+			int i, num, len, item;
+			char name[STR_SZ + 1];
+			len = STR_SZ;
+			MPI_T_enum_get_info(enumtype, &num, name, &len);
+			for(i = 0; i < num; i++){
+				len = STR_SZ;
+				if(MPI_T_enum_get_item(enumtype, i, &item, name, &len) == MPI_SUCCESS &&
+						strcmp(name, value) == 0){
+					v = item;
+					end = value + strlen(value);
+					break;
+				}
+			}
+		}
+		if(*end != 0)
+			return MPI_T_ERR_INVALID;
+		*(int*)buffer = v;
+	}
+	else if(datatype == MPI_UNSIGNED)
+		*(unsigned int*)buffer = (unsigned int)strtoul(value, NULL, 0);
+	else if(datatype == MPI_UNSIGNED_LONG)
+		*(unsigned long*)buffer = strtoul(value, NULL, 0);
+	else if(datatype == MPI_UNSIGNED_LONG_LONG)
+		*(unsigned long long*)buffer = strtoull(value, NULL, 0);
+	else if(datatype == MPI_COUNT)
+		*(MPI_Count*)buffer = (MPI_Count)strtoll(value, NULL, 0);
+	else if(datatype == MPI_DOUBLE)
+		*(double*)buffer = strtod(value, NULL);
+	else
+		return MPI_T_ERR_INVALID;
+	return MPI_SUCCESS;
+}
+
+/**
+ * Write a control variable from its textual value.
+ */
+int cvar_write_string(MPI_T_cvar_handle handle, MPI_Datatype datatype,
+		MPI_T_enum enumtype, char *value){
+	double buffer[2];
+	int err;
+
+	if(datatype == MPI_CHAR)
+		return MPI_T_cvar_write(handle, value);
+	err = cvar_parse_string(datatype, enumtype, value, buffer);
+	if(err != MPI_SUCCESS)
+		return err;
+	return MPI_T_cvar_write(handle, buffer);
+}
+
+/**
+ * Read a single-element control variable into a string.
+ */
+int cvar_read_string(MPI_T_cvar_handle handle, MPI_Datatype datatype, char *value, int len){
+	int err = MPI_T_ERR_INVALID;
+
+	if(datatype == MPI_INT){
+		int v;
+		if((err = MPI_T_cvar_read(handle, &v)) == MPI_SUCCESS)
+			snprintf(value, len, "%d", v);
+	}
+	else if(datatype == MPI_UNSIGNED){
+		unsigned int v;
+		if((err = MPI_T_cvar_read(handle, &v)) == MPI_SUCCESS)
+			snprintf(value, len, "%u", v);
+	}
+	else if(datatype == MPI_UNSIGNED_LONG){
+		unsigned long v;
+		if((err = MPI_T_cvar_read(handle, &v)) == MPI_SUCCESS)
+			snprintf(value, len, "%lu", v);
+	}
+	else if(datatype == MPI_UNSIGNED_LONG_LONG){
+		unsigned long long v;
+		if((err = MPI_T_cvar_read(handle, &v)) == MPI_SUCCESS)
+			snprintf(value, len, "%llu", v);
+	}
+	else if(datatype == MPI_COUNT){
+		MPI_Count v;
+		if((err = MPI_T_cvar_read(handle, &v)) == MPI_SUCCESS)
+			snprintf(value, len, "%lld", (long long)v);
+	}
+	else if(datatype == MPI_DOUBLE){
+		double v;
+		if((err = MPI_T_cvar_read(handle, &v)) == MPI_SUCCESS)
+			snprintf(value, len, "%lf", v);
+	}
+	return err;
+}
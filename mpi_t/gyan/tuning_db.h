@@ -0,0 +1,82 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * tuning_db.h
+ *
+ * A tuning database holds the best control variable settings found by
+ * cvar_tuner. Every entry is keyed by the MPI library version (hashed),
+ * the node and rank count of the run, the benchmark kernel and an
+ * inclusive message-size range. The file format is one entry per line:
+ *
+ *   <lib_hash> <nodes> <ranks> <kernel> <min_size> <max_size> <metric> <cvar>=<value> ...
+ *
+ * Lines starting with '#' are comments; the tuner records the full library
+ * version string in a "# lib" comment next to its hash.
+ */
+#include "utility.h"
+
+#ifndef TUNING_DB_H_
+#define TUNING_DB_H_
+
+#define TUNING_DB_MAX_CVARS 8
+#define TUNING_DB_NAME_SZ 128
+#define TUNING_DB_VALUE_SZ 64
+#define TUNING_DB_KERNEL_SZ 16
+#define TUNING_DB_LINE_SZ 2048
+
+typedef struct{
+	char name[TUNING_DB_NAME_SZ];
+	char value[TUNING_DB_VALUE_SZ];
+}TUNING_SETTING;
+
+typedef struct{
+	unsigned long long int lib_hash;
+	int nodes;
+	int ranks;
+	char kernel[TUNING_DB_KERNEL_SZ];
+	unsigned long long int min_size, max_size; // inclusive range in bytes
+	double metric; // latency (us) or bandwidth (MB/s) measured by the tuner
+	int num_settings;
+	TUNING_SETTING settings[TUNING_DB_MAX_CVARS];
+}TUNING_ENTRY;
+
+typedef struct{
+	int num;
+	int capacity;
+	TUNING_ENTRY *entries;
+}TUNING_DB;
+
+unsigned long long int tuning_db_library_hash(char *libversion, int len);
+void tuning_db_init(TUNING_DB *db);
+int tuning_db_load(const char *file, TUNING_DB *db);
+int tuning_db_save(const char *file, TUNING_DB *db, char *libversion);
+int tuning_db_add(TUNING_DB *db, TUNING_ENTRY *entry);
+void tuning_db_remove_key(TUNING_DB *db, unsigned long long int lib_hash,
+		int nodes, int ranks, char *kernel);
+void tuning_db_free(TUNING_DB *db);
+int tuning_db_count_nodes(MPI_Comm comm);
+
+int cvar_get_index_by_name(char *name);
+int cvar_parse_string(MPI_Datatype datatype, MPI_T_enum enumtype, char *value, void *buffer);
+int cvar_write_string(MPI_T_cvar_handle handle, MPI_Datatype datatype,
+		MPI_T_enum enumtype, char *value);
+int cvar_read_string(MPI_T_cvar_handle handle, MPI_Datatype datatype, char *value, int len);
+#endif /* TUNING_DB_H_ */
@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * wheel.c
+ *
+ * Timer wheel of the sampling scheduler, see wheel.h.
+ */
+
+#include "wheel.h"
+
+#define SLOT(t) ((int)((t) & (WHEEL_SLOTS - 1)))
+
+void wheel_init(TIMER_WHEEL *w, unsigned long long int now){
+	int i;
+
+	memset(w, 0, sizeof(TIMER_WHEEL));
+	for(i = 0; i < WHEEL_SLOTS; i++)
+		w->head[i] = -1;
+	w->now = now;
+}
+
+void wheel_reserve(TIMER_WHEEL *w, int num){
+	if(num <= w->capacity)
+		return;
+	w->next = (int*)realloc(w->next, sizeof(int) * num);
+	w->due = (unsigned long long int*)realloc(w->due, sizeof(unsigned long long int) * num);
+	w->capacity = num;
+}
+
+/**
+ * Put pvar on the wheel, due at a tick after the last one expired.
+ */
+void wheel_insert(TIMER_WHEEL *w, int pvar, unsigned long long int due){
+	int slot;
+
+	if(due <= w->now)
+		due = w->now + 1;
+	slot = SLOT(due);
+	w->due[pvar] = due;
+	w->next[pvar] = w->head[slot];
+	w->head[slot] = pvar;
+	w->occupied[slot / 64] |= 1ULL << (slot % 64);
+	w->num++;
+}
+
+/**
+ * Take the pvars due at or before tick off the wheel and store them in
+ * due. Returns their number.
+ */
+int wheel_expire(TIMER_WHEEL *w, unsigned long long int tick, int *due){
+	unsigned long long int t, first;
+	int *link, pvar, slot, n = 0;
+
+	if(tick <= w->now)
+		return 0;
+	/* after a gap of a whole turn every slot is visited once */
+	first = (tick - w->now >= WHEEL_SLOTS) ? tick - WHEEL_SLOTS + 1 : w->now + 1;
+	for(t = first; t <= tick; t++){
+		slot = SLOT(t);
+		if(!(w->occupied[slot / 64] & (1ULL << (slot % 64))))
+			continue;
+		for(link = &w->head[slot]; (pvar = *link) >= 0; ){
+			if(w->due[pvar] <= tick){
+				*link = w->next[pvar];
+				due[n++] = pvar;
+				w->num--;
+			}
+			else
+				link = &w->next[pvar];
+		}
+		if(w->head[slot] < 0)
+			w->occupied[slot / 64] &= ~(1ULL << (slot % 64));
+	}
+	w->now = tick;
+	return n;
+}
+
+/**
+ * Tick of the next non-empty slot after the last one expired, or 0 when
+ * the wheel is empty. Pvars in that slot may belong to a later round.
+ */
+unsigned long long int wheel_next(TIMER_WHEEL *w){
+	int slot = SLOT(w->now + 1), word, bit, d;
+	unsigned long long int bits;
+
+	if(w->num == 0)
+		return 0;
+	for(d = 0; d <= WHEEL_WORDS; d++){
+		word = (slot / 64 + d) % WHEEL_WORDS;
+		bits = w->occupied[word];
+		if(d == 0)
+			bits &= ~0ULL << (slot % 64);
+		else if(d == WHEEL_WORDS)
+			bits &= (slot % 64) ? ~0ULL >> (64 - slot % 64) : 0;
+		if(bits == 0)
+			continue;
+		bit = word * 64 + __builtin_ctzll(bits);
+		return w->now + 1 + (unsigned long long int)((bit - slot + WHEEL_SLOTS) % WHEEL_SLOTS);
+	}
+	return 0;
+}
+
+void wheel_free(TIMER_WHEEL *w){
+	free(w->next);
+	free(w->due);
+	w->next = NULL;
+	w->due = NULL;
+	w->capacity = w->num = 0;
+}
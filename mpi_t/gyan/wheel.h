@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * wheel.h
+ *
+ * Hashed timer wheel of the watched pvars of one thread. Time is counted
+ * in ticks of a fixed length; a pvar due at tick t sits in the list of
+ * slot t % WHEEL_SLOTS, so pvars sharing a period and a phase share a
+ * slot and are read together. Expiring a tick only visits the slots
+ * passed since the previous one, and the occupancy bitmap finds the next
+ * non-empty slot, so the cost of a tick grows with the number of pvars
+ * due rather than with the number watched. Pvars due more than
+ * WHEEL_SLOTS ticks ahead stay in their slot until their round comes.
+ */
+#include "utility.h"
+
+#ifndef WHEEL_H_
+#define WHEEL_H_
+
+#define WHEEL_SLOTS 256 // a power of two
+#define WHEEL_WORDS (WHEEL_SLOTS / 64)
+
+typedef struct{
+	int head[WHEEL_SLOTS]; // first pvar of every slot, -1 when empty
+	unsigned long long int occupied[WHEEL_WORDS]; // bitmap of non-empty slots
+	int *next; // next pvar in the same slot, indexed by watched pvar
+	unsigned long long int *due; // tick each pvar is due at
+	int capacity;
+	int num; // pvars on the wheel
+	unsigned long long int now; // last tick expired
+}TIMER_WHEEL;
+
+void wheel_init(TIMER_WHEEL *w, unsigned long long int now);
+void wheel_reserve(TIMER_WHEEL *w, int num);
+void wheel_insert(TIMER_WHEEL *w, int pvar, unsigned long long int due);
+int wheel_expire(TIMER_WHEEL *w, unsigned long long int tick, int *due);
+unsigned long long int wheel_next(TIMER_WHEEL *w);
+void wheel_free(TIMER_WHEEL *w);
+#endif /* WHEEL_H_ */
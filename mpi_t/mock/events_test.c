@@ -0,0 +1,196 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * events_test.c
+ *
+ * Drives Gyan's MPI_T event capture (../gyan/events.c) with the event
+ * types of the mock built for MPI 4. Producer threads raise events while
+ * the main thread drains the rings, one event type reports drops on the
+ * MPI side, and the trace is checked afterwards:
+ *   - every recorded event is in the trace, and recorded plus dropped
+ *     events add up to the events raised
+ *   - each producer's sequence numbers are increasing in the trace
+ *   - events too large for a ring slot are marked as truncated
+ *   - the drops reported by MPI are counted
+ * Run with fewer rings than producers and small rings (make events) to
+ * exercise both kinds of drops.
+ */
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+#include "mock.h"
+#include "../gyan/events.h"
+
+#define MAX_PRODUCERS 64
+#define MPI_DROPS 5
+#define YIELD_EVERY 64 // events between yields, lets the drain run on few cores
+#define LINE_SZ 1024
+
+static int num_events = 100000; // per producer
+static int num_types;
+static int producers_left;
+static unsigned long long int raised[MAX_PRODUCERS];
+
+static void usage(int e){
+	printf("Usage: events_test [-p <producers>] [-n <events>]\n");
+	printf("    -p = Producer threads (default: 4)\n");
+	printf("    -n = Events raised by every producer (default: 100000)\n");
+	printf("    -h = This help text\n");
+	printf("Rings are set up with MPIT_EVENT_THREADS and MPIT_EVENT_RING_SIZE, the\n");
+	printf("trace goes to <MPIT_EVENT_TRACE>.0.\n");
+	exit(e);
+}
+
+static void *produce(void *arg){
+	int id = (int)(long)arg;
+	int i;
+	for(i = 0; i < num_events; i++){
+		raised[id] += mock_event_raise(i % num_types, (unsigned long long int)i, id);
+		if(i % YIELD_EVERY == YIELD_EVERY - 1)
+			sched_yield();
+	}
+	__atomic_sub_fetch(&producers_left, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/**
+ * Check the trace against the events raised.
+ * @return number of failed checks
+ */
+static int check_trace(char *file, unsigned long long int total, int num_producers){
+	char line[LINE_SZ], name[LINE_SZ];
+	long long last[MAX_PRODUCERS];
+	unsigned long long int recorded = 0, dropped = 0, dropped_by_mpi = 0, lines = 0, seq;
+	int i, type, producer, truncated, out_of_order = 0, wrong_truncation = 0, failed = 0;
+	FILE *fp = fopen(file, "r");
+
+	if(fp == NULL){
+		printf("FAILED: cannot open %s\n", file);
+		return 1;
+	}
+	for(i = 0; i < MAX_PRODUCERS; i++)
+		last[i] = -1;
+	while(fgets(line, sizeof(line), fp) != NULL){
+		if(line[0] == '#'){
+			sscanf(line, "# recorded %llu dropped %llu dropped_by_mpi %llu", &recorded, &dropped, &dropped_by_mpi);
+			continue;
+		}
+		if(sscanf(line, "%*s %*s %s %llu %d", name, &seq, &producer) != 3 ||
+				sscanf(name, "mock_event_%d", &type) != 1 || producer < 0 || producer >= num_producers){
+			printf("FAILED: malformed trace line: %s", line);
+			failed++;
+			continue;
+		}
+		lines++;
+		if((long long)seq <= last[producer])
+			out_of_order++;
+		last[producer] = (long long)seq;
+		/* 16 bytes of header and 4 * (type % 4) doubles in a 64-byte slot */
+		truncated = (strstr(line, " ...") != NULL);
+		if(truncated != (16 + 32 * (type % 4) > 64))
+			wrong_truncation++;
+	}
+	fclose(fp);
+
+	printf("events raised    %12llu\n", total);
+	printf("recorded         %12llu (%llu in the trace)\n", recorded, lines);
+	printf("dropped          %12llu\n", dropped);
+	printf("dropped by MPI   %12llu\n", dropped_by_mpi);
+	if(lines != recorded){
+		printf("FAILED: the trace holds %llu events, %llu were recorded\n", lines, recorded);
+		failed++;
+	}
+	if(recorded + dropped != total){
+		printf("FAILED: %llu recorded + %llu dropped != %llu raised\n", recorded, dropped, total);
+		failed++;
+	}
+	if(dropped_by_mpi != MPI_DROPS){
+		printf("FAILED: %llu drops reported by MPI were counted, expected %d\n", dropped_by_mpi, MPI_DROPS);
+		failed++;
+	}
+	if(out_of_order > 0){
+		printf("FAILED: %d events out of order within their producer\n", out_of_order);
+		failed++;
+	}
+	if(wrong_truncation > 0){
+		printf("FAILED: %d events with a wrong truncation mark\n", wrong_truncation);
+		failed++;
+	}
+	return failed;
+}
+
+int main(int argc, char *argv[]){
+	pthread_t threads[MAX_PRODUCERS];
+	char file[LINE_SZ];
+	int opt, i, provided, num_producers = 4, failed;
+	unsigned long long int total = 0;
+
+	while((opt = getopt(argc, argv, "hp:n:")) != -1){
+		switch(opt){
+		case 'p':
+			num_producers = atoi(optarg);
+			if(num_producers < 1 || num_producers > MAX_PRODUCERS)
+				usage(1);
+			break;
+		case 'n':
+			num_events = atoi(optarg);
+			if(num_events < 0)
+				usage(1);
+			break;
+		case 'h':
+		default:
+			usage(1);
+		}
+	}
+
+	MPI_Init(&argc, &argv);
+	MPI_T_init_thread(MPI_THREAD_MULTIPLE, &provided);
+	num_types = events_init("all", 0);
+	if(num_types <= 0){
+		printf("FAILED: no event types registered\n");
+		return 1;
+	}
+
+	producers_left = num_producers;
+	for(i = 0; i < num_producers; i++)
+		pthread_create(&threads[i], NULL, produce, (void*)(long)i);
+	while(__atomic_load_n(&producers_left, __ATOMIC_ACQUIRE) > 0){
+		events_drain();
+		sched_yield();
+	}
+	for(i = 0; i < num_producers; i++){
+		pthread_join(threads[i], NULL);
+		total += raised[i];
+	}
+	mock_event_drop(0, MPI_DROPS);
+	events_finalize();
+	MPI_T_finalize();
+	MPI_Finalize();
+
+	snprintf(file, sizeof(file), "%s.0", (getenv("MPIT_EVENT_TRACE") != NULL) ? getenv("MPIT_EVENT_TRACE") : "gyan_events");
+	failed = check_trace(file, total, num_producers);
+	printf("%s\n", failed ? "events_test FAILED" : "events_test passed");
+	return failed ? 1 : 0;
+}
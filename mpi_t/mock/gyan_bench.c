@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * gyan_bench.c
+ *
+ * Times MPI_Init, a loop of small MPI_Allreduce calls and MPI_Finalize
+ * on the mock MPI. Linked with Gyan (gyan_bench) the times include the
+ * tool; linked without it (mpi_bench) they are those of the mock alone.
+ * The times go to stderr, so Gyan's report can be discarded.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <mpi.h>
+
+static double now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static void usage(int e){
+	printf("Usage: gyan_bench [-n <calls>]\n");
+	printf("    -n = MPI_Allreduce calls between MPI_Init and MPI_Finalize (default: 100000)\n");
+	printf("    -h = This help text\n");
+	printf("The mock library is configured with MPIT_MOCK_PVARS, MPIT_MOCK_CVARS,\n");
+	printf("MPIT_MOCK_CATEGORIES, MPIT_MOCK_COUNT, MPIT_MOCK_BOUND and MPIT_MOCK_READ_COST.\n");
+	exit(e);
+}
+
+int main(int argc, char *argv[]){
+	double init_time, loop_time, finalize_time, t;
+	int opt, i, calls = 100000, in = 1, out;
+	int num_pvars = 0, provided;
+
+	while((opt = getopt(argc, argv, "hn:")) != -1){
+		switch(opt){
+		case 'n':
+			calls = atoi(optarg);
+			if(calls < 0)
+				usage(1);
+			break;
+		case 'h':
+		default:
+			usage(1);
+		}
+	}
+
+	t = now();
+	MPI_Init(&argc, &argv);
+	init_time = now() - t;
+
+	t = now();
+	for(i = 0; i < calls; i++)
+		MPI_Allreduce(&in, &out, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+	loop_time = now() - t;
+
+	MPI_T_init_thread(MPI_THREAD_SINGLE, &provided);
+	MPI_T_pvar_get_num(&num_pvars);
+	MPI_T_finalize();
+
+	t = now();
+	MPI_Finalize();
+	finalize_time = now() - t;
+
+	fprintf(stderr, "pvars            %12d\n", num_pvars);
+	fprintf(stderr, "MPI_Init         %12.6lf s\n", init_time);
+	fprintf(stderr, "MPI_Allreduce    %12.1lf ns/call (%d calls)\n", (calls > 0) ? 1e9 * loop_time / calls : 0, calls);
+	fprintf(stderr, "MPI_Finalize     %12.6lf s\n", finalize_time);
+	return 0;
+}
@@ -0,0 +1,40 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * mock.h
+ *
+ * Internals shared by the two halves of the mock library: mock_mpi.c, a
+ * single-process MPI, and mock_mpit.c, the synthetic MPI_T interface.
+ */
+#include "mpi.h"
+
+#ifndef MOCK_H_
+#define MOCK_H_
+
+int mock_type_size(MPI_Datatype datatype);
+
+#if MPI_VERSION >= 4
+/* Event producers for test drivers: raise one instance of an event type
+ * on the calling thread, or report count instances as dropped. */
+int mock_event_raise(int event_index, unsigned long long int sequence, int producer);
+void mock_event_drop(int event_index, MPI_Count count);
+#endif
+#endif /* MOCK_H_ */
@@ -0,0 +1,632 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * mock_mpi.c
+ *
+ * A single-process MPI: every communicator holds one rank, collectives
+ * copy the send buffer, messages to self are queued, windows are plain
+ * memory and files are written with POSIX I/O. It is just enough to run
+ * Gyan's MPI_Init and MPI_Finalize, and a tool's own point-to-point and
+ * collective calls, without an MPI library or launcher.
+ *
+ * Every PMPI_ function has a weak MPI_ alias, so a tool defining MPI_Init
+ * and friends interposes on them as it does on a real MPI.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mock.h"
+
+#define MOCK_ALIAS(name) _Pragma(MOCK_STR(weak MPI_##name = PMPI_##name))
+#define MOCK_STR(s) #s
+
+#define NUM_PREDEFINED_TYPES 18
+
+/* a message sent to self and not yet received */
+typedef struct mock_message{
+	int tag;
+	MPI_Comm comm;
+	int size;
+	struct mock_message *next;
+	char data[];
+}MOCK_MESSAGE;
+
+/* a receive posted before the matching send */
+typedef struct{
+	void *buf;
+	int size;
+	int tag;
+	MPI_Comm comm;
+	MPI_Request request;
+}MOCK_RECEIVE;
+
+static const int predefined_size[NUM_PREDEFINED_TYPES] = {
+	0, sizeof(char), 1, sizeof(int), sizeof(unsigned), sizeof(long), sizeof(unsigned long),
+	sizeof(long long), sizeof(unsigned long long), sizeof(float), sizeof(double),
+	8, 8, sizeof(MPI_Aint), sizeof(MPI_Offset), sizeof(MPI_Count), 2 * sizeof(int),
+	sizeof(double) + sizeof(int)
+};
+
+static int initialized = 0;
+static int thread_level = MPI_THREAD_SINGLE;
+static double start_time = 0;
+static int next_comm = MPI_COMM_SELF + 1;
+static int next_op = MPI_MINLOC + 1;
+
+/* derived datatypes are numbered after the predefined ones */
+static int *type_size = NULL;
+static int num_types = 0;
+
+static MOCK_MESSAGE *messages = NULL;
+static MOCK_RECEIVE *receives = NULL;
+static int num_receives = 0;
+static MPI_Request next_request = MPI_REQUEST_NULL + 1;
+
+/* windows and files are numbered from 1 */
+static void **windows = NULL;
+static int num_windows = 0;
+static int *files = NULL;
+static int num_files = 0;
+
+int mock_type_size(MPI_Datatype datatype){
+	if(datatype > 0 && datatype < NUM_PREDEFINED_TYPES)
+		return predefined_size[datatype];
+	if(datatype >= NUM_PREDEFINED_TYPES && datatype < NUM_PREDEFINED_TYPES + num_types)
+		return type_size[datatype - NUM_PREDEFINED_TYPES];
+	return -1;
+}
+
+static int valid_comm(MPI_Comm comm){
+	return comm != MPI_COMM_NULL && comm < next_comm;
+}
+
+static double now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/**
+ * Copy count elements of datatype from sendbuf to recvbuf, the result of
+ * any reduction over a single rank.
+ */
+static int copy_buffer(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype){
+	int size = mock_type_size(datatype);
+
+	if(size < 0)
+		return MPI_ERR_TYPE;
+	if(count < 0)
+		return MPI_ERR_COUNT;
+	if(sendbuf != MPI_IN_PLACE && sendbuf != recvbuf && count > 0)
+		memcpy(recvbuf, sendbuf, (size_t)size * count);
+	return MPI_SUCCESS;
+}
+
+int PMPI_Init_thread(int *argc, char ***argv, int required, int *provided){
+	if(initialized)
+		return MPI_ERR_OTHER;
+	initialized = 1;
+	thread_level = (required > MPI_THREAD_MULTIPLE) ? MPI_THREAD_MULTIPLE : required;
+	if(provided != NULL)
+		*provided = thread_level;
+	start_time = now();
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Init_thread)
+
+int PMPI_Init(int *argc, char ***argv){
+	return PMPI_Init_thread(argc, argv, MPI_THREAD_SINGLE, NULL);
+}
+MOCK_ALIAS(Init)
+
+int PMPI_Initialized(int *flag){
+	*flag = initialized;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Initialized)
+
+int PMPI_Finalize(void){
+	MOCK_MESSAGE *m;
+	int i;
+
+	while(messages != NULL){
+		m = messages;
+		messages = m->next;
+		free(m);
+	}
+	for(i = 0; i < num_windows; i++)
+		free(windows[i]);
+	for(i = 0; i < num_files; i++)
+		if(files[i] >= 0)
+			close(files[i]);
+	free(windows);
+	free(files);
+	free(receives);
+	free(type_size);
+	windows = NULL;
+	files = NULL;
+	receives = NULL;
+	type_size = NULL;
+	num_windows = num_files = num_receives = num_types = 0;
+	initialized = 0;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Finalize)
+
+int PMPI_Query_thread(int *provided){
+	*provided = thread_level;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Query_thread)
+
+int PMPI_Abort(MPI_Comm comm, int errorcode){
+	exit(errorcode);
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Abort)
+
+double PMPI_Wtime(void){
+	return now() - start_time;
+}
+MOCK_ALIAS(Wtime)
+
+int PMPI_Pcontrol(const int level, ...){
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Pcontrol)
+
+int PMPI_Error_string(int errorcode, char *string, int *resultlen){
+	*resultlen = snprintf(string, MPI_MAX_ERROR_STRING, "mock MPI error %d", errorcode);
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Error_string)
+
+int PMPI_Get_processor_name(char *name, int *resultlen){
+	if(gethostname(name, MPI_MAX_PROCESSOR_NAME) != 0)
+		strcpy(name, "localhost");
+	name[MPI_MAX_PROCESSOR_NAME - 1] = 0;
+	*resultlen = strlen(name);
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Get_processor_name)
+
+int PMPI_Get_library_version(char *version, int *resultlen){
+	*resultlen = snprintf(version, MPI_MAX_LIBRARY_VERSION_STRING, "Gyan mock MPI %d.%d, single process",
+			MPI_VERSION, MPI_SUBVERSION);
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Get_library_version)
+
+int PMPI_Get_version(int *version, int *subversion){
+	*version = MPI_VERSION;
+	*subversion = MPI_SUBVERSION;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Get_version)
+
+int PMPI_Comm_rank(MPI_Comm comm, int *rank){
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	*rank = 0;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Comm_rank)
+
+int PMPI_Comm_size(MPI_Comm comm, int *size){
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	*size = 1;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Comm_size)
+
+int PMPI_Comm_dup(MPI_Comm comm, MPI_Comm *newcomm){
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	*newcomm = next_comm++;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Comm_dup)
+
+int PMPI_Comm_split(MPI_Comm comm, int color, int key, MPI_Comm *newcomm){
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	*newcomm = (color == MPI_UNDEFINED) ? MPI_COMM_NULL : next_comm++;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Comm_split)
+
+int PMPI_Comm_split_type(MPI_Comm comm, int split_type, int key, MPI_Info info, MPI_Comm *newcomm){
+	return PMPI_Comm_split(comm, split_type, key, newcomm);
+}
+MOCK_ALIAS(Comm_split_type)
+
+int PMPI_Comm_free(MPI_Comm *comm){
+	if(!valid_comm(*comm) || *comm == MPI_COMM_WORLD || *comm == MPI_COMM_SELF)
+		return MPI_ERR_COMM;
+	*comm = MPI_COMM_NULL;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Comm_free)
+
+int PMPI_Comm_test_inter(MPI_Comm comm, int *flag){
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	*flag = 0;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Comm_test_inter)
+
+int PMPI_Comm_group(MPI_Comm comm, MPI_Group *group){
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	*group = 1;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Comm_group)
+
+int PMPI_Comm_remote_group(MPI_Comm comm, MPI_Group *group){
+	return MPI_ERR_COMM; // no intercommunicators
+}
+MOCK_ALIAS(Comm_remote_group)
+
+int PMPI_Group_size(MPI_Group group, int *size){
+	*size = 1;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Group_size)
+
+int PMPI_Group_translate_ranks(MPI_Group group1, int n, const int ranks1[], MPI_Group group2, int ranks2[]){
+	int i;
+	for(i = 0; i < n; i++)
+		ranks2[i] = (ranks1[i] == 0) ? 0 : MPI_UNDEFINED;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Group_translate_ranks)
+
+int PMPI_Group_free(MPI_Group *group){
+	*group = MPI_GROUP_NULL;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Group_free)
+
+int PMPI_Info_free(MPI_Info *info){
+	*info = MPI_INFO_NULL;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Info_free)
+
+int PMPI_Type_size(MPI_Datatype datatype, int *size){
+	if((*size = mock_type_size(datatype)) < 0)
+		return MPI_ERR_TYPE;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Type_size)
+
+int PMPI_Type_contiguous(int count, MPI_Datatype oldtype, MPI_Datatype *newtype){
+	int size = mock_type_size(oldtype);
+
+	if(size < 0)
+		return MPI_ERR_TYPE;
+	if(count < 0)
+		return MPI_ERR_COUNT;
+	type_size = (int*)realloc(type_size, sizeof(int) * (num_types + 1));
+	type_size[num_types] = size * count;
+	*newtype = NUM_PREDEFINED_TYPES + num_types++;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Type_contiguous)
+
+int PMPI_Type_commit(MPI_Datatype *datatype){
+	return (mock_type_size(*datatype) < 0) ? MPI_ERR_TYPE : MPI_SUCCESS;
+}
+MOCK_ALIAS(Type_commit)
+
+int PMPI_Type_free(MPI_Datatype *datatype){
+	if(*datatype < NUM_PREDEFINED_TYPES || mock_type_size(*datatype) < 0)
+		return MPI_ERR_TYPE;
+	*datatype = MPI_DATATYPE_NULL; // numbers are not reused
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Type_free)
+
+int PMPI_Op_create(MPI_User_function *function, int commute, MPI_Op *op){
+	*op = next_op++; // never called, a reduction over one rank is a copy
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Op_create)
+
+int PMPI_Op_free(MPI_Op *op){
+	*op = MPI_OP_NULL;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Op_free)
+
+/**
+ * Deliver a message to the oldest matching posted receive, or queue it.
+ */
+static int deliver(const void *buf, int size, int tag, MPI_Comm comm){
+	MOCK_MESSAGE *m, **last;
+	int i;
+
+	for(i = 0; i < num_receives; i++)
+		if(receives[i].comm == comm && (receives[i].tag == tag || receives[i].tag == MPI_ANY_TAG)){
+			if(size > receives[i].size)
+				return MPI_ERR_TRUNCATE;
+			memcpy(receives[i].buf, buf, size);
+			memmove(&receives[i], &receives[i + 1], sizeof(MOCK_RECEIVE) * (--num_receives - i));
+			return MPI_SUCCESS;
+		}
+	m = (MOCK_MESSAGE*)malloc(sizeof(MOCK_MESSAGE) + size);
+	m->tag = tag;
+	m->comm = comm;
+	m->size = size;
+	m->next = NULL;
+	memcpy(m->data, buf, size);
+	for(last = &messages; *last != NULL; last = &(*last)->next);
+	*last = m;
+	return MPI_SUCCESS;
+}
+
+/**
+ * Take the oldest queued message matching tag and comm into buf.
+ * @return MPI_ERR_PENDING if no message matches
+ */
+static int match(void *buf, int size, int tag, MPI_Comm comm, MPI_Status *status){
+	MOCK_MESSAGE *m, **prev;
+
+	for(prev = &messages; (m = *prev) != NULL; prev = &m->next)
+		if(m->comm == comm && (m->tag == tag || tag == MPI_ANY_TAG)){
+			if(m->size > size)
+				return MPI_ERR_TRUNCATE;
+			memcpy(buf, m->data, m->size);
+			if(status != MPI_STATUS_IGNORE){
+				status->MPI_SOURCE = 0;
+				status->MPI_TAG = m->tag;
+				status->MPI_ERROR = MPI_SUCCESS;
+				status->count = m->size;
+			}
+			*prev = m->next;
+			free(m);
+			return MPI_SUCCESS;
+		}
+	return MPI_ERR_PENDING;
+}
+
+int PMPI_Send(const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm){
+	int size = mock_type_size(datatype);
+
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	if(size < 0)
+		return MPI_ERR_TYPE;
+	if(dest == MPI_PROC_NULL)
+		return MPI_SUCCESS;
+	if(dest != 0)
+		return MPI_ERR_RANK;
+	return deliver(buf, size * count, tag, comm);
+}
+MOCK_ALIAS(Send)
+
+int PMPI_Isend(const void *buf, int count, MPI_Datatype datatype, int dest, int tag,
+		MPI_Comm comm, MPI_Request *request){
+	*request = MPI_REQUEST_NULL; // buffered, complete at once
+	return PMPI_Send(buf, count, datatype, dest, tag, comm);
+}
+MOCK_ALIAS(Isend)
+
+int PMPI_Recv(void *buf, int count, MPI_Datatype datatype, int source, int tag,
+		MPI_Comm comm, MPI_Status *status){
+	int size = mock_type_size(datatype);
+
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	if(size < 0)
+		return MPI_ERR_TYPE;
+	if(source == MPI_PROC_NULL)
+		return MPI_SUCCESS;
+	if(source != 0 && source != MPI_ANY_SOURCE)
+		return MPI_ERR_RANK;
+	return match(buf, size * count, tag, comm, status); // a real MPI would block forever
+}
+MOCK_ALIAS(Recv)
+
+int PMPI_Irecv(void *buf, int count, MPI_Datatype datatype, int source, int tag,
+		MPI_Comm comm, MPI_Request *request){
+	int err = PMPI_Recv(buf, count, datatype, source, tag, comm, MPI_STATUS_IGNORE);
+
+	*request = MPI_REQUEST_NULL;
+	if(err != MPI_ERR_PENDING)
+		return err;
+	/* posted until a send to self delivers into it */
+	receives = (MOCK_RECEIVE*)realloc(receives, sizeof(MOCK_RECEIVE) * (num_receives + 1));
+	receives[num_receives].buf = buf;
+	receives[num_receives].size = mock_type_size(datatype) * count;
+	receives[num_receives].tag = tag;
+	receives[num_receives].comm = comm;
+	receives[num_receives].request = *request = next_request++;
+	num_receives++;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Irecv)
+
+int PMPI_Wait(MPI_Request *request, MPI_Status *status){
+	return PMPI_Waitall(1, request, status);
+}
+MOCK_ALIAS(Wait)
+
+int PMPI_Waitall(int count, MPI_Request requests[], MPI_Status statuses[]){
+	int i, j;
+
+	/* a receive still posted could only be matched by a send from another rank */
+	for(i = 0; i < count; i++)
+		for(j = 0; j < num_receives; j++)
+			if(requests[i] == receives[j].request)
+				return MPI_ERR_PENDING;
+	for(i = 0; i < count; i++)
+		requests[i] = MPI_REQUEST_NULL;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Waitall)
+
+int PMPI_Barrier(MPI_Comm comm){
+	return valid_comm(comm) ? MPI_SUCCESS : MPI_ERR_COMM;
+}
+MOCK_ALIAS(Barrier)
+
+int PMPI_Bcast(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm){
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	return (root == 0) ? MPI_SUCCESS : MPI_ERR_RANK;
+}
+MOCK_ALIAS(Bcast)
+
+int PMPI_Reduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		MPI_Op op, int root, MPI_Comm comm){
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	if(root != 0)
+		return MPI_ERR_RANK;
+	return copy_buffer(sendbuf, recvbuf, count, datatype);
+}
+MOCK_ALIAS(Reduce)
+
+int PMPI_Allreduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		MPI_Op op, MPI_Comm comm){
+	return PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, 0, comm);
+}
+MOCK_ALIAS(Allreduce)
+
+int PMPI_Exscan(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		MPI_Op op, MPI_Comm comm){
+	/* recvbuf of rank 0 is undefined, leave it alone */
+	return valid_comm(comm) ? MPI_SUCCESS : MPI_ERR_COMM;
+}
+MOCK_ALIAS(Exscan)
+
+int PMPI_Gather(const void *sendbuf, int sendcount, MPI_Datatype sendtype,
+		void *recvbuf, int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm){
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	if(root != 0)
+		return MPI_ERR_RANK;
+	if(mock_type_size(sendtype) * sendcount != mock_type_size(recvtype) * recvcount)
+		return MPI_ERR_TRUNCATE;
+	return copy_buffer(sendbuf, recvbuf, sendcount, sendtype);
+}
+MOCK_ALIAS(Gather)
+
+int PMPI_Win_allocate_shared(MPI_Aint size, int disp_unit, MPI_Info info, MPI_Comm comm,
+		void *baseptr, MPI_Win *win){
+	if(!valid_comm(comm))
+		return MPI_ERR_COMM;
+	windows = (void**)realloc(windows, sizeof(void*) * (num_windows + 1));
+	windows[num_windows] = calloc(1, (size > 0) ? size : 1);
+	*(void**)baseptr = windows[num_windows];
+	*win = ++num_windows;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Win_allocate_shared)
+
+int PMPI_Win_shared_query(MPI_Win win, int rank, MPI_Aint *size, int *disp_unit, void *baseptr){
+	if(win <= 0 || win > num_windows || windows[win - 1] == NULL)
+		return MPI_ERR_ARG;
+	*(void**)baseptr = windows[win - 1];
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Win_shared_query)
+
+int PMPI_Win_fence(int assert, MPI_Win win){
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Win_fence)
+
+int PMPI_Win_free(MPI_Win *win){
+	if(*win <= 0 || *win > num_windows)
+		return MPI_ERR_ARG;
+	free(windows[*win - 1]);
+	windows[*win - 1] = NULL;
+	*win = MPI_WIN_NULL;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(Win_free)
+
+int PMPI_File_open(MPI_Comm comm, const char *filename, int amode, MPI_Info info, MPI_File *fh){
+	int flags = (amode & MPI_MODE_RDWR) ? O_RDWR : (amode & MPI_MODE_WRONLY) ? O_WRONLY : O_RDONLY;
+	int fd;
+
+	if(amode & MPI_MODE_CREATE)
+		flags |= O_CREAT;
+	if(amode & MPI_MODE_EXCL)
+		flags |= O_EXCL;
+	if((fd = open(filename, flags, 0644)) < 0)
+		return MPI_ERR_FILE;
+	files = (int*)realloc(files, sizeof(int) * (num_files + 1));
+	files[num_files] = fd;
+	*fh = ++num_files;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(File_open)
+
+static int file_fd(MPI_File fh){
+	return (fh > 0 && fh <= num_files) ? files[fh - 1] : -1;
+}
+
+int PMPI_File_set_size(MPI_File fh, MPI_Offset size){
+	return (file_fd(fh) >= 0 && ftruncate(file_fd(fh), size) == 0) ? MPI_SUCCESS : MPI_ERR_IO;
+}
+MOCK_ALIAS(File_set_size)
+
+int PMPI_File_write_at(MPI_File fh, MPI_Offset offset, const void *buf, int count,
+		MPI_Datatype datatype, MPI_Status *status){
+	size_t size = (size_t)mock_type_size(datatype) * count;
+
+	if(file_fd(fh) < 0)
+		return MPI_ERR_FILE;
+	if(pwrite(file_fd(fh), buf, size, offset) != (ssize_t)size)
+		return MPI_ERR_IO;
+	if(status != MPI_STATUS_IGNORE){
+		status->MPI_ERROR = MPI_SUCCESS;
+		status->count = size;
+	}
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(File_write_at)
+
+int PMPI_File_write_at_all(MPI_File fh, MPI_Offset offset, const void *buf, int count,
+		MPI_Datatype datatype, MPI_Status *status){
+	return PMPI_File_write_at(fh, offset, buf, count, datatype, status);
+}
+MOCK_ALIAS(File_write_at_all)
+
+int PMPI_File_close(MPI_File *fh){
+	if(file_fd(*fh) < 0)
+		return MPI_ERR_FILE;
+	close(files[*fh - 1]);
+	files[*fh - 1] = -1;
+	*fh = MPI_FILE_NULL;
+	return MPI_SUCCESS;
+}
+MOCK_ALIAS(File_close)
@@ -0,0 +1,864 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * mock_mpit.c
+ *
+ * A synthetic MPI_T interface. The variables are generated from their
+ * index when MPI_T is first initialized; their number and shape are set
+ * with environment variables:
+ *   MPIT_MOCK_PVARS       pvars (default 1000)
+ *   MPIT_MOCK_CVARS       cvars (default 100)
+ *   MPIT_MOCK_CATEGORIES  categories (default 16), a binary tree over
+ *                         contiguous ranges of the pvars and cvars
+ *   MPIT_MOCK_COUNT       largest number of elements of a pvar (default 4)
+ *   MPIT_MOCK_BOUND       every n-th pvar and cvar is bound to a
+ *                         communicator (default 16, 0 for none)
+ *   MPIT_MOCK_READ_COST   microseconds spent in every MPI_T_pvar_read
+ *                         (default 0)
+ *   MPIT_MOCK_EVENTS      event types when built for MPI 4 (default 4)
+ * Pvars cycle through the classes and datatypes. Their values are a
+ * function of the index, the element and the number of reads of the
+ * handle, shaped after the class: counters grow, levels go up and down,
+ * watermarks only move one way, timers follow the clock and states cycle
+ * through their enumeration.
+ *
+ * Event types carry a sequence number, the producer and 0, 4, 8 or 12
+ * doubles. Instances are only raised by mock_event_raise, on the thread
+ * that calls it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mock.h"
+
+#define NUM_ENUMS 4
+#define CVAR_STRING_SZ 32
+#define DEFAULT_PVARS 1000
+#define DEFAULT_CVARS 100
+#define DEFAULT_CATEGORIES 16
+#define DEFAULT_COUNT 4
+#define DEFAULT_BOUND 16
+#define DEFAULT_EVENTS 4
+
+struct mock_pvar_session{
+	int num_handles;
+};
+
+struct mock_pvar_handle{
+	struct mock_pvar_session *session;
+	int index;
+	int count;
+	int started;
+	unsigned long long int reads;
+	double start_time;
+};
+
+struct mock_cvar_handle{
+	int index;
+};
+
+typedef union{
+	int i;
+	unsigned u;
+	unsigned long long int ull;
+	double d;
+	char s[CVAR_STRING_SZ];
+}CVAR_VALUE;
+
+static const int pvar_classes[] = {
+	MPI_T_PVAR_CLASS_COUNTER, MPI_T_PVAR_CLASS_LEVEL, MPI_T_PVAR_CLASS_STATE,
+	MPI_T_PVAR_CLASS_SIZE, MPI_T_PVAR_CLASS_TIMER, MPI_T_PVAR_CLASS_HIGHWATERMARK,
+	MPI_T_PVAR_CLASS_PERCENTAGE, MPI_T_PVAR_CLASS_LOWWATERMARK, MPI_T_PVAR_CLASS_AGGREGATE,
+	MPI_T_PVAR_CLASS_GENERIC
+};
+static const char *class_names[] = {
+	"state", "level", "size", "percentage", "highwatermark", "lowwatermark",
+	"counter", "aggregate", "timer", "generic"
+};
+static const MPI_Datatype integer_types[] = {
+	MPI_UNSIGNED_LONG_LONG, MPI_UNSIGNED_LONG, MPI_UNSIGNED, MPI_COUNT
+};
+static const MPI_Datatype cvar_types[] = {
+	MPI_INT, MPI_UNSIGNED, MPI_UNSIGNED_LONG_LONG, MPI_DOUBLE, MPI_CHAR
+};
+static const int cvar_scopes[] = {
+	MPI_T_SCOPE_LOCAL, MPI_T_SCOPE_READONLY, MPI_T_SCOPE_ALL_EQ, MPI_T_SCOPE_CONSTANT, MPI_T_SCOPE_GROUP
+};
+
+static int init_count = 0;
+static int num_pvars = 0, num_cvars = 0, num_categories = 0;
+static int max_count = DEFAULT_COUNT, bound = DEFAULT_BOUND;
+static double read_cost = 0;
+static CVAR_VALUE *cvar_values = NULL;
+#if MPI_VERSION >= 4
+static int num_events = 0;
+#endif
+
+static int env_int(const char *name, int value){
+	if(getenv(name) != NULL && atoi(getenv(name)) >= 0)
+		return atoi(getenv(name));
+	return value;
+}
+
+static double now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/**
+ * 64-bit mix of x (splitmix64 finalizer), the source of all synthetic values.
+ */
+static unsigned long long int mix(unsigned long long int x){
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+/**
+ * Copy src into dst of *len bytes as MPI_T does: truncated to fit, and
+ * *len set to the length of src including the terminator.
+ */
+static void copy_string(char *dst, int *len, const char *src){
+	if(dst != NULL && len != NULL && *len > 0){
+		strncpy(dst, src, *len - 1);
+		dst[*len - 1] = 0;
+	}
+	if(len != NULL)
+		*len = strlen(src) + 1;
+}
+
+static int pvar_class(int index){
+	return pvar_classes[index % 10];
+}
+
+static MPI_Datatype pvar_datatype(int index){
+	switch(pvar_class(index)){
+	case MPI_T_PVAR_CLASS_STATE:
+		return MPI_INT;
+	case MPI_T_PVAR_CLASS_PERCENTAGE:
+		return MPI_DOUBLE;
+	case MPI_T_PVAR_CLASS_TIMER:
+		return (index / 10 % 2) ? MPI_UNSIGNED_LONG_LONG : MPI_DOUBLE;
+	default:
+		return integer_types[index / 10 % 4];
+	}
+}
+
+static int pvar_count(int index){
+	return 1 + (int)(mix(index) % max_count);
+}
+
+static int is_bound(int index){
+	return bound > 0 && index % bound == bound - 1;
+}
+
+/* enumerations have 2, 3, ... items */
+static int enum_items(MPI_T_enum e){
+	return e + 2;
+}
+
+/**
+ * The value of element j of pvar index after reads reads; timers use the
+ * seconds elapsed since the handle was started.
+ */
+static double pvar_value(int index, int j, unsigned long long int reads, double elapsed){
+	unsigned long long int seed = mix(((unsigned long long int)index << 16) + j);
+	unsigned long long int k = reads;
+
+	switch(pvar_class(index)){
+	case MPI_T_PVAR_CLASS_COUNTER:
+	case MPI_T_PVAR_CLASS_AGGREGATE:
+		return (double)((1 + seed % 97) * k);
+	case MPI_T_PVAR_CLASS_LEVEL:
+	case MPI_T_PVAR_CLASS_SIZE:
+		return (double)(mix(seed + k) % 1000);
+	case MPI_T_PVAR_CLASS_HIGHWATERMARK:
+		return (double)(seed % 500 + 500 * k / (k + 8));
+	case MPI_T_PVAR_CLASS_LOWWATERMARK:
+		return (double)(1000 - seed % 500 - 500 * k / (k + 8));
+	case MPI_T_PVAR_CLASS_PERCENTAGE:
+		return (double)(mix(seed + k) % 1001) / 1000;
+	case MPI_T_PVAR_CLASS_STATE:
+		return (double)((seed + k) % enum_items(index % NUM_ENUMS));
+	case MPI_T_PVAR_CLASS_TIMER:
+		return elapsed * (1 + seed % 10) / 10 * ((pvar_datatype(index) == MPI_DOUBLE) ? 1 : 1e6);
+	default:
+		return (double)(mix(seed + k) >> 32);
+	}
+}
+
+static void store(void *buf, MPI_Datatype datatype, int j, double value){
+	switch(datatype){
+	case MPI_INT:
+		((int*)buf)[j] = (int)value;
+		break;
+	case MPI_UNSIGNED:
+		((unsigned*)buf)[j] = (unsigned)value;
+		break;
+	case MPI_UNSIGNED_LONG:
+		((unsigned long*)buf)[j] = (unsigned long)value;
+		break;
+	case MPI_COUNT:
+		((MPI_Count*)buf)[j] = (MPI_Count)value;
+		break;
+	case MPI_DOUBLE:
+		((double*)buf)[j] = value;
+		break;
+	default:
+		((unsigned long long int*)buf)[j] = (unsigned long long int)value;
+	}
+}
+
+/* pvars [first, last) and cvars of category c, and its subcategories 2c+1 and 2c+2 */
+static void category_range(int c, int num, int *first, int *last){
+	*first = (int)((long long)num * c / num_categories);
+	*last = (int)((long long)num * (c + 1) / num_categories);
+}
+
+static int num_subcategories(int c){
+	return (2 * c + 1 < num_categories) + (2 * c + 2 < num_categories);
+}
+
+int MPI_T_init_thread(int required, int *provided){
+	int i;
+
+	*provided = (required > MPI_THREAD_MULTIPLE) ? MPI_THREAD_MULTIPLE : required;
+	if(init_count++ > 0)
+		return MPI_SUCCESS;
+	num_pvars = env_int("MPIT_MOCK_PVARS", DEFAULT_PVARS);
+	num_cvars = env_int("MPIT_MOCK_CVARS", DEFAULT_CVARS);
+	num_categories = env_int("MPIT_MOCK_CATEGORIES", DEFAULT_CATEGORIES);
+	max_count = env_int("MPIT_MOCK_COUNT", DEFAULT_COUNT);
+	if(max_count < 1)
+		max_count = 1;
+	bound = env_int("MPIT_MOCK_BOUND", DEFAULT_BOUND);
+	read_cost = 1e-6 * env_int("MPIT_MOCK_READ_COST", 0);
+#if MPI_VERSION >= 4
+	num_events = env_int("MPIT_MOCK_EVENTS", DEFAULT_EVENTS);
+#endif
+	cvar_values = (CVAR_VALUE*)calloc(num_cvars + 1, sizeof(CVAR_VALUE));
+	for(i = 0; i < num_cvars; i++){
+		switch(cvar_types[i % 5]){
+		case MPI_CHAR:
+			snprintf(cvar_values[i].s, CVAR_STRING_SZ, "value_%d", i);
+			break;
+		case MPI_DOUBLE:
+			cvar_values[i].d = i / 4.0;
+			break;
+		case MPI_UNSIGNED_LONG_LONG:
+			cvar_values[i].ull = 1ULL << (i % 20);
+			break;
+		default:
+			cvar_values[i].i = (i % 10 == 0) ? 0 : i;
+		}
+	}
+	return MPI_SUCCESS;
+}
+
+int MPI_T_finalize(void){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(--init_count == 0){
+		free(cvar_values);
+		cvar_values = NULL;
+	}
+	return MPI_SUCCESS;
+}
+
+int MPI_T_enum_get_info(MPI_T_enum enumtype, int *num, char *name, int *name_len){
+	char buf[32];
+
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(enumtype < 0 || enumtype >= NUM_ENUMS)
+		return MPI_T_ERR_INVALID_HANDLE;
+	*num = enum_items(enumtype);
+	snprintf(buf, sizeof(buf), "mock_enum_%d", enumtype);
+	copy_string(name, name_len, buf);
+	return MPI_SUCCESS;
+}
+
+int MPI_T_enum_get_item(MPI_T_enum enumtype, int index, int *value, char *name, int *name_len){
+	char buf[32];
+
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(enumtype < 0 || enumtype >= NUM_ENUMS)
+		return MPI_T_ERR_INVALID_HANDLE;
+	if(index < 0 || index >= enum_items(enumtype))
+		return MPI_T_ERR_INVALID_ITEM;
+	*value = index;
+	snprintf(buf, sizeof(buf), "state_%d", index);
+	copy_string(name, name_len, buf);
+	return MPI_SUCCESS;
+}
+
+int MPI_T_cvar_get_num(int *num_cvar){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	*num_cvar = num_cvars;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_cvar_get_info(int cvar_index, char *name, int *name_len, int *verbosity,
+		MPI_Datatype *datatype, MPI_T_enum *enumtype, char *desc, int *desc_len,
+		int *bind, int *scope){
+	char buf[64];
+
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(cvar_index < 0 || cvar_index >= num_cvars)
+		return MPI_T_ERR_INVALID_INDEX;
+	snprintf(buf, sizeof(buf), "mock_cvar_%d", cvar_index);
+	copy_string(name, name_len, buf);
+	snprintf(buf, sizeof(buf), "Synthetic control variable %d", cvar_index);
+	copy_string(desc, desc_len, buf);
+	if(verbosity != NULL)
+		*verbosity = MPI_T_VERBOSITY_USER_BASIC + cvar_index % 9;
+	if(datatype != NULL)
+		*datatype = cvar_types[cvar_index % 5];
+	if(enumtype != NULL)
+		*enumtype = (cvar_index % 10 == 0) ? cvar_index / 10 % NUM_ENUMS : MPI_T_ENUM_NULL;
+	if(bind != NULL)
+		*bind = is_bound(cvar_index) ? MPI_T_BIND_MPI_COMM : MPI_T_BIND_NO_OBJECT;
+	if(scope != NULL)
+		*scope = cvar_scopes[cvar_index % 5];
+	return MPI_SUCCESS;
+}
+
+int MPI_T_cvar_get_index(const char *name, int *cvar_index){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(sscanf(name, "mock_cvar_%d", cvar_index) != 1 || *cvar_index < 0 || *cvar_index >= num_cvars)
+		return MPI_T_ERR_INVALID_NAME;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_cvar_handle_alloc(int cvar_index, void *obj_handle, MPI_T_cvar_handle *handle, int *count){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(cvar_index < 0 || cvar_index >= num_cvars)
+		return MPI_T_ERR_INVALID_INDEX;
+	if(is_bound(cvar_index) && obj_handle == NULL)
+		return MPI_T_ERR_INVALID_HANDLE;
+	*handle = (MPI_T_cvar_handle)malloc(sizeof(struct mock_cvar_handle));
+	(*handle)->index = cvar_index;
+	*count = (cvar_types[cvar_index % 5] == MPI_CHAR) ? CVAR_STRING_SZ : 1;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_cvar_handle_free(MPI_T_cvar_handle *handle){
+	if(*handle == MPI_T_CVAR_HANDLE_NULL)
+		return MPI_T_ERR_INVALID_HANDLE;
+	free(*handle);
+	*handle = MPI_T_CVAR_HANDLE_NULL;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_cvar_read(MPI_T_cvar_handle handle, void *buf){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(handle == MPI_T_CVAR_HANDLE_NULL)
+		return MPI_T_ERR_INVALID_HANDLE;
+	if(cvar_types[handle->index % 5] == MPI_CHAR)
+		memcpy(buf, cvar_values[handle->index].s, CVAR_STRING_SZ);
+	else
+		memcpy(buf, &cvar_values[handle->index], mock_type_size(cvar_types[handle->index % 5]));
+	return MPI_SUCCESS;
+}
+
+int MPI_T_cvar_write(MPI_T_cvar_handle handle, const void *buf){
+	int scope;
+
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(handle == MPI_T_CVAR_HANDLE_NULL)
+		return MPI_T_ERR_INVALID_HANDLE;
+	scope = cvar_scopes[handle->index % 5];
+	if(scope == MPI_T_SCOPE_CONSTANT || scope == MPI_T_SCOPE_READONLY)
+		return MPI_T_ERR_CVAR_SET_NEVER;
+	if(cvar_types[handle->index % 5] == MPI_CHAR){
+		strncpy(cvar_values[handle->index].s, (const char*)buf, CVAR_STRING_SZ - 1);
+		cvar_values[handle->index].s[CVAR_STRING_SZ - 1] = 0;
+	}
+	else
+		memcpy(&cvar_values[handle->index], buf, mock_type_size(cvar_types[handle->index % 5]));
+	return MPI_SUCCESS;
+}
+
+int MPI_T_pvar_get_num(int *num_pvar){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	*num_pvar = num_pvars;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_pvar_get_info(int pvar_index, char *name, int *name_len, int *verbosity,
+		int *var_class, MPI_Datatype *datatype, MPI_T_enum *enumtype, char *desc,
+		int *desc_len, int *bind, int *readonly, int *continuous, int *atomic){
+	char buf[96];
+	int c;
+
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(pvar_index < 0 || pvar_index >= num_pvars)
+		return MPI_T_ERR_INVALID_INDEX;
+	c = pvar_class(pvar_index);
+	snprintf(buf, sizeof(buf), "mock_%s_%d", class_names[c], pvar_index);
+	copy_string(name, name_len, buf);
+	snprintf(buf, sizeof(buf), "Synthetic %s %d with %d elements", class_names[c], pvar_index,
+			pvar_count(pvar_index));
+	copy_string(desc, desc_len, buf);
+	if(verbosity != NULL)
+		*verbosity = MPI_T_VERBOSITY_USER_BASIC + pvar_index % 9;
+	if(var_class != NULL)
+		*var_class = c;
+	if(datatype != NULL)
+		*datatype = pvar_datatype(pvar_index);
+	if(enumtype != NULL)
+		*enumtype = (c == MPI_T_PVAR_CLASS_STATE) ? pvar_index % NUM_ENUMS : MPI_T_ENUM_NULL;
+	if(bind != NULL)
+		*bind = is_bound(pvar_index) ? MPI_T_BIND_MPI_COMM : MPI_T_BIND_NO_OBJECT;
+	if(readonly != NULL)
+		*readonly = 1;
+	if(continuous != NULL)
+		*continuous = (pvar_index % 3 != 0);
+	if(atomic != NULL)
+		*atomic = 0;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_pvar_get_index(const char *name, int var_class, int *pvar_index){
+	char class_name[32];
+
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(sscanf(name, "mock_%31[a-z]_%d", class_name, pvar_index) != 2 ||
+			*pvar_index < 0 || *pvar_index >= num_pvars ||
+			strcmp(class_name, class_names[pvar_class(*pvar_index)]) != 0 ||
+			var_class != pvar_class(*pvar_index))
+		return MPI_T_ERR_INVALID_NAME;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_pvar_session_create(MPI_T_pvar_session *session){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	*session = (MPI_T_pvar_session)calloc(1, sizeof(struct mock_pvar_session));
+	return MPI_SUCCESS;
+}
+
+int MPI_T_pvar_session_free(MPI_T_pvar_session *session){
+	if(*session == MPI_T_PVAR_SESSION_NULL)
+		return MPI_T_ERR_INVALID_SESSION;
+	free(*session);
+	*session = MPI_T_PVAR_SESSION_NULL;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_pvar_handle_alloc(MPI_T_pvar_session session, int pvar_index, void *obj_handle,
+		MPI_T_pvar_handle *handle, int *count){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(session == MPI_T_PVAR_SESSION_NULL)
+		return MPI_T_ERR_INVALID_SESSION;
+	if(pvar_index < 0 || pvar_index >= num_pvars)
+		return MPI_T_ERR_INVALID_INDEX;
+	if(is_bound(pvar_index) && obj_handle == NULL)
+		return MPI_T_ERR_INVALID_HANDLE;
+	*handle = (MPI_T_pvar_handle)calloc(1, sizeof(struct mock_pvar_handle));
+	(*handle)->session = session;
+	(*handle)->index = pvar_index;
+	(*handle)->count = *count = pvar_count(pvar_index);
+	(*handle)->started = (pvar_index % 3 != 0); // continuous pvars are always started
+	(*handle)->start_time = now();
+	session->num_handles++;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_pvar_handle_free(MPI_T_pvar_session session, MPI_T_pvar_handle *handle){
+	if(session == MPI_T_PVAR_SESSION_NULL)
+		return MPI_T_ERR_INVALID_SESSION;
+	if(*handle == MPI_T_PVAR_HANDLE_NULL || (*handle)->session != session)
+		return MPI_T_ERR_INVALID_HANDLE;
+	session->num_handles--;
+	free(*handle);
+	*handle = MPI_T_PVAR_HANDLE_NULL;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_pvar_start(MPI_T_pvar_session session, MPI_T_pvar_handle handle){
+	if(handle == MPI_T_PVAR_HANDLE_NULL || handle == MPI_T_PVAR_ALL_HANDLES || handle->session != session)
+		return MPI_T_ERR_INVALID_HANDLE;
+	if(handle->index % 3 != 0)
+		return MPI_T_ERR_PVAR_NO_STARTSTOP;
+	if(!handle->started)
+		handle->start_time = now();
+	handle->started = 1;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_pvar_stop(MPI_T_pvar_session session, MPI_T_pvar_handle handle){
+	if(handle == MPI_T_PVAR_HANDLE_NULL || handle == MPI_T_PVAR_ALL_HANDLES || handle->session != session)
+		return MPI_T_ERR_INVALID_HANDLE;
+	if(handle->index % 3 != 0)
+		return MPI_T_ERR_PVAR_NO_STARTSTOP;
+	handle->started = 0;
+	return MPI_SUCCESS;
+}
+
+/**
+ * Read the current values of the handle; every read of a started pvar
+ * advances its generator by one step. Handles may be read from several
+ * threads at once.
+ */
+int MPI_T_pvar_read(MPI_T_pvar_session session, MPI_T_pvar_handle handle, void *buf){
+	unsigned long long int reads;
+	double elapsed, start;
+	int j;
+
+	if(handle == MPI_T_PVAR_HANDLE_NULL || handle == MPI_T_PVAR_ALL_HANDLES || handle->session != session)
+		return MPI_T_ERR_INVALID_HANDLE;
+	start = now();
+	if(handle->started)
+		reads = __atomic_add_fetch(&handle->reads, 1, __ATOMIC_RELAXED);
+	else
+		reads = __atomic_load_n(&handle->reads, __ATOMIC_RELAXED);
+	elapsed = handle->started ? start - handle->start_time : 0;
+	for(j = 0; j < handle->count; j++)
+		store(buf, pvar_datatype(handle->index), j, pvar_value(handle->index, j, reads, elapsed));
+	while(read_cost > 0 && now() - start < read_cost);
+	return MPI_SUCCESS;
+}
+
+int MPI_T_pvar_reset(MPI_T_pvar_session session, MPI_T_pvar_handle handle){
+	if(handle == MPI_T_PVAR_HANDLE_NULL || handle == MPI_T_PVAR_ALL_HANDLES || handle->session != session)
+		return MPI_T_ERR_INVALID_HANDLE;
+	__atomic_store_n(&handle->reads, 0, __ATOMIC_RELAXED);
+	handle->start_time = now();
+	return MPI_SUCCESS;
+}
+
+int MPI_T_category_get_num(int *num_cat){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	*num_cat = num_categories;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_category_get_info(int cat_index, char *name, int *name_len, char *desc, int *desc_len,
+		int *num_cvars_out, int *num_pvars_out, int *num_categories_out){
+	char buf[64];
+	int first, last;
+
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(cat_index < 0 || cat_index >= num_categories)
+		return MPI_T_ERR_INVALID_INDEX;
+	snprintf(buf, sizeof(buf), "mock_category_%d", cat_index);
+	copy_string(name, name_len, buf);
+	snprintf(buf, sizeof(buf), "Synthetic category %d", cat_index);
+	copy_string(desc, desc_len, buf);
+	category_range(cat_index, num_cvars, &first, &last);
+	*num_cvars_out = last - first;
+	category_range(cat_index, num_pvars, &first, &last);
+	*num_pvars_out = last - first;
+	*num_categories_out = num_subcategories(cat_index);
+	return MPI_SUCCESS;
+}
+
+int MPI_T_category_get_index(const char *name, int *cat_index){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(sscanf(name, "mock_category_%d", cat_index) != 1 || *cat_index < 0 || *cat_index >= num_categories)
+		return MPI_T_ERR_INVALID_NAME;
+	return MPI_SUCCESS;
+}
+
+static int category_members(int cat_index, int num, int len, int indices[]){
+	int first, last, i;
+
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(cat_index < 0 || cat_index >= num_categories)
+		return MPI_T_ERR_INVALID_INDEX;
+	category_range(cat_index, num, &first, &last);
+	for(i = 0; i < len && first + i < last; i++)
+		indices[i] = first + i;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_category_get_cvars(int cat_index, int len, int indices[]){
+	return category_members(cat_index, num_cvars, len, indices);
+}
+
+int MPI_T_category_get_pvars(int cat_index, int len, int indices[]){
+	return category_members(cat_index, num_pvars, len, indices);
+}
+
+int MPI_T_category_get_categories(int cat_index, int len, int indices[]){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(cat_index < 0 || cat_index >= num_categories)
+		return MPI_T_ERR_INVALID_INDEX;
+	if(len > 0 && num_subcategories(cat_index) > 0)
+		indices[0] = 2 * cat_index + 1;
+	if(len > 1 && num_subcategories(cat_index) > 1)
+		indices[1] = 2 * cat_index + 2;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_category_changed(int *stamp){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	*stamp = 0; // the variables never change after MPI_T_init_thread
+	return MPI_SUCCESS;
+}
+
+#if MPI_VERSION >= 4
+
+struct mock_event_instance{
+	int index;
+	MPI_Count timestamp;
+	unsigned long long int sequence;
+	int producer;
+};
+
+/* Registrations must not be allocated or freed while events are raised */
+struct mock_event_registration{
+	int index;
+	MPI_T_cb_safety safety;
+	void *user_data;
+	MPI_T_event_cb_function *callback;
+	MPI_T_event_dropped_cb_function *dropped;
+	struct mock_event_registration *next;
+};
+
+static struct mock_event_registration *registrations = NULL;
+
+/* sequence (unsigned long long), producer (int), then 0, 4, 8 or 12 doubles */
+static int event_elements(int index){
+	return 2 + 4 * (index % 4);
+}
+
+static MPI_Aint event_displacement(int j){
+	return (j < 2) ? 8 * j : 16 + 8 * (j - 2);
+}
+
+static MPI_Datatype event_datatype(int j){
+	return (j == 0) ? MPI_UNSIGNED_LONG_LONG : (j == 1) ? MPI_INT : MPI_DOUBLE;
+}
+
+int MPI_T_source_get_num(int *num_sources){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	*num_sources = 1;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_source_get_info(int source_index, char *name, int *name_len, char *desc, int *desc_len,
+		MPI_T_source_order *ordering, MPI_Count *ticks_per_second, MPI_Count *max_ticks, MPI_Info *info){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(source_index != 0)
+		return MPI_T_ERR_INVALID_INDEX;
+	copy_string(name, name_len, "mock_clock");
+	copy_string(desc, desc_len, "CLOCK_MONOTONIC in nanoseconds, read by the raising thread");
+	*ordering = MPI_T_SOURCE_UNORDERED;
+	*ticks_per_second = 1000000000LL;
+	*max_ticks = 0x7fffffffffffffffLL;
+	*info = MPI_INFO_NULL;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_source_get_timestamp(int source_index, MPI_Count *timestamp){
+	if(source_index != 0)
+		return MPI_T_ERR_INVALID_INDEX;
+	*timestamp = (MPI_Count)(now() * 1e9);
+	return MPI_SUCCESS;
+}
+
+int MPI_T_event_get_num(int *num){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	*num = num_events;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_event_get_info(int event_index, char *name, int *name_len, int *verbosity,
+		MPI_Datatype array_of_datatypes[], MPI_Aint array_of_displacements[], int *num_elements,
+		MPI_T_enum *enumtype, MPI_Info *info, char *desc, int *desc_len, int *bind){
+	char buf[64];
+	int j, n;
+
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(event_index < 0 || event_index >= num_events)
+		return MPI_T_ERR_INVALID_INDEX;
+	n = event_elements(event_index);
+	snprintf(buf, sizeof(buf), "mock_event_%d", event_index);
+	copy_string(name, name_len, buf);
+	snprintf(buf, sizeof(buf), "Sequence number, producer and %d doubles", n - 2);
+	copy_string(desc, desc_len, buf);
+	if(verbosity != NULL)
+		*verbosity = MPI_T_VERBOSITY_USER_BASIC;
+	for(j = 0; j < n && j < *num_elements; j++){
+		if(array_of_datatypes != NULL)
+			array_of_datatypes[j] = event_datatype(j);
+		if(array_of_displacements != NULL)
+			array_of_displacements[j] = event_displacement(j);
+	}
+	*num_elements = n;
+	if(enumtype != NULL)
+		*enumtype = MPI_T_ENUM_NULL;
+	if(info != NULL)
+		*info = MPI_INFO_NULL;
+	if(bind != NULL)
+		*bind = is_bound(event_index) ? MPI_T_BIND_MPI_COMM : MPI_T_BIND_NO_OBJECT;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_event_get_index(const char *name, int *event_index){
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(sscanf(name, "mock_event_%d", event_index) != 1 || *event_index < 0 || *event_index >= num_events)
+		return MPI_T_ERR_INVALID_NAME;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_event_handle_alloc(int event_index, void *obj_handle, MPI_Info info,
+		MPI_T_event_registration *event_registration){
+	struct mock_event_registration *r;
+
+	if(init_count == 0)
+		return MPI_T_ERR_NOT_INITIALIZED;
+	if(event_index < 0 || event_index >= num_events)
+		return MPI_T_ERR_INVALID_INDEX;
+	if(is_bound(event_index) && obj_handle == NULL)
+		return MPI_T_ERR_INVALID_HANDLE;
+	r = (struct mock_event_registration*)calloc(1, sizeof(struct mock_event_registration));
+	r->index = event_index;
+	r->next = registrations;
+	registrations = r;
+	*event_registration = r;
+	return MPI_SUCCESS;
+}
+
+/**
+ * Unlink the registration and call free_cb_function right away: the mock
+ * never has callbacks in flight on other threads.
+ */
+int MPI_T_event_handle_free(MPI_T_event_registration event_registration, void *user_data,
+		MPI_T_event_free_cb_function *free_cb_function){
+	struct mock_event_registration **p;
+
+	for(p = &registrations; *p != NULL && *p != event_registration; p = &(*p)->next)
+		;
+	if(*p == NULL)
+		return MPI_T_ERR_INVALID_HANDLE;
+	*p = event_registration->next;
+	if(free_cb_function != NULL)
+		free_cb_function(event_registration, MPI_T_CB_REQUIRE_NONE, user_data);
+	free(event_registration);
+	return MPI_SUCCESS;
+}
+
+int MPI_T_event_register_callback(MPI_T_event_registration event_registration, MPI_T_cb_safety cb_safety,
+		MPI_Info info, void *user_data, MPI_T_event_cb_function *event_cb_function){
+	if(event_registration == NULL)
+		return MPI_T_ERR_INVALID_HANDLE;
+	event_registration->safety = cb_safety;
+	event_registration->user_data = user_data;
+	event_registration->callback = event_cb_function;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_event_set_dropped_handler(MPI_T_event_registration event_registration,
+		MPI_T_event_dropped_cb_function *dropped_cb_function){
+	if(event_registration == NULL)
+		return MPI_T_ERR_INVALID_HANDLE;
+	event_registration->dropped = dropped_cb_function;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_event_read(MPI_T_event_instance event_instance, int element_index, void *buffer){
+	if(element_index < 0 || element_index >= event_elements(event_instance->index))
+		return MPI_T_ERR_INVALID_INDEX;
+	if(element_index == 0)
+		*(unsigned long long int*)buffer = event_instance->sequence;
+	else if(element_index == 1)
+		*(int*)buffer = event_instance->producer;
+	else
+		*(double*)buffer = (double)event_instance->sequence + element_index;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_event_copy(MPI_T_event_instance event_instance, void *buffer){
+	int j;
+	for(j = 0; j < event_elements(event_instance->index); j++)
+		MPI_T_event_read(event_instance, j, (char*)buffer + event_displacement(j));
+	return MPI_SUCCESS;
+}
+
+int MPI_T_event_get_timestamp(MPI_T_event_instance event_instance, MPI_Count *event_timestamp){
+	*event_timestamp = event_instance->timestamp;
+	return MPI_SUCCESS;
+}
+
+int MPI_T_event_get_source(MPI_T_event_instance event_instance, int *source_index){
+	*source_index = 0;
+	return MPI_SUCCESS;
+}
+
+/**
+ * Invoke the callbacks of all registrations of the event type.
+ * @return number of callbacks invoked
+ */
+int mock_event_raise(int event_index, unsigned long long int sequence, int producer){
+	struct mock_event_instance instance;
+	struct mock_event_registration *r;
+	int n = 0;
+
+	instance.index = event_index;
+	instance.sequence = sequence;
+	instance.producer = producer;
+	MPI_T_source_get_timestamp(0, &instance.timestamp);
+	for(r = registrations; r != NULL; r = r->next){
+		if(r->index != event_index || r->callback == NULL)
+			continue;
+		r->callback(&instance, r, r->safety, r->user_data);
+		n++;
+	}
+	return n;
+}
+
+void mock_event_drop(int event_index, MPI_Count count){
+	struct mock_event_registration *r;
+	for(r = registrations; r != NULL; r = r->next)
+		if(r->index == event_index && r->dropped != NULL)
+			r->dropped(count, r, 0, r->safety, r->user_data);
+}
+
+#endif /* MPI_VERSION >= 4 */
@@ -0,0 +1,385 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * mpi.h
+ *
+ * The subset of the MPI 3.1 interface used by Gyan and varlist, for
+ * building them against the mock library instead of a real MPI. Handles
+ * are small integers, MPI_T handles point into the mock's tables. Only
+ * code compiled with this header may be linked with libmpi_mock; the
+ * types are not those of any real MPI.
+ *
+ * Compiled with -DMOCK_MPI_VERSION=4 the header claims MPI 4.0 and adds
+ * the MPI_T event interface.
+ */
+#include <stddef.h>
+
+#ifndef MOCK_MPI_H_
+#define MOCK_MPI_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MOCK_MPI_VERSION
+#define MOCK_MPI_VERSION 3
+#endif
+#if MOCK_MPI_VERSION >= 4
+#define MPI_VERSION 4
+#define MPI_SUBVERSION 0
+#else
+#define MPI_VERSION 3
+#define MPI_SUBVERSION 1
+#endif
+
+typedef int MPI_Comm;
+typedef int MPI_Datatype;
+typedef int MPI_Op;
+typedef int MPI_Group;
+typedef int MPI_Info;
+typedef int MPI_Request;
+typedef int MPI_Win;
+typedef int MPI_File;
+typedef long MPI_Aint;
+typedef long long MPI_Offset;
+typedef long long MPI_Count;
+
+typedef struct{
+	int MPI_SOURCE;
+	int MPI_TAG;
+	int MPI_ERROR;
+	int count; // bytes received
+}MPI_Status;
+
+typedef void (MPI_User_function)(void *invec, void *inoutvec, int *len, MPI_Datatype *datatype);
+
+#define MPI_SUCCESS 0
+#define MPI_ERR_BUFFER 1
+#define MPI_ERR_COUNT 2
+#define MPI_ERR_TYPE 3
+#define MPI_ERR_TAG 4
+#define MPI_ERR_COMM 5
+#define MPI_ERR_RANK 6
+#define MPI_ERR_ARG 12
+#define MPI_ERR_TRUNCATE 15
+#define MPI_ERR_OTHER 16
+#define MPI_ERR_PENDING 18
+#define MPI_ERR_FILE 27
+#define MPI_ERR_IO 32
+#define MPI_ERR_LASTCODE 92
+
+#define MPI_MAX_PROCESSOR_NAME 256
+#define MPI_MAX_ERROR_STRING 256
+#define MPI_MAX_LIBRARY_VERSION_STRING 256
+
+#define MPI_UNDEFINED (-32766)
+#define MPI_ANY_SOURCE (-1)
+#define MPI_ANY_TAG (-1)
+#define MPI_PROC_NULL (-2)
+#define MPI_ROOT (-3)
+
+#define MPI_THREAD_SINGLE 0
+#define MPI_THREAD_FUNNELED 1
+#define MPI_THREAD_SERIALIZED 2
+#define MPI_THREAD_MULTIPLE 3
+
+#define MPI_COMM_NULL 0
+#define MPI_COMM_WORLD 1
+#define MPI_COMM_SELF 2
+#define MPI_COMM_TYPE_SHARED 1
+
+#define MPI_GROUP_NULL 0
+#define MPI_INFO_NULL 0
+#define MPI_REQUEST_NULL 0
+#define MPI_WIN_NULL 0
+#define MPI_FILE_NULL 0
+#define MPI_OP_NULL 0
+
+#define MPI_DATATYPE_NULL 0
+#define MPI_CHAR 1
+#define MPI_BYTE 2
+#define MPI_INT 3
+#define MPI_UNSIGNED 4
+#define MPI_LONG 5
+#define MPI_UNSIGNED_LONG 6
+#define MPI_LONG_LONG 7
+#define MPI_UNSIGNED_LONG_LONG 8
+#define MPI_FLOAT 9
+#define MPI_DOUBLE 10
+#define MPI_INT64_T 11
+#define MPI_UINT64_T 12
+#define MPI_AINT 13
+#define MPI_OFFSET 14
+#define MPI_COUNT 15
+#define MPI_2INT 16
+#define MPI_DOUBLE_INT 17
+#define MPI_LONG_LONG_INT MPI_LONG_LONG
+
+#define MPI_MAX 1
+#define MPI_MIN 2
+#define MPI_SUM 3
+#define MPI_PROD 4
+#define MPI_LAND 5
+#define MPI_LOR 6
+#define MPI_BAND 7
+#define MPI_BOR 8
+#define MPI_MAXLOC 9
+#define MPI_MINLOC 10
+
+#define MPI_MODE_RDONLY 2
+#define MPI_MODE_RDWR 8
+#define MPI_MODE_WRONLY 4
+#define MPI_MODE_CREATE 1
+#define MPI_MODE_EXCL 64
+
+#define MPI_IN_PLACE ((void*)1)
+#define MPI_STATUS_IGNORE ((MPI_Status*)0)
+#define MPI_STATUSES_IGNORE ((MPI_Status*)0)
+
+/* MPI_T */
+typedef int MPI_T_enum;
+typedef struct mock_cvar_handle *MPI_T_cvar_handle;
+typedef struct mock_pvar_handle *MPI_T_pvar_handle;
+typedef struct mock_pvar_session *MPI_T_pvar_session;
+
+#define MPI_T_ENUM_NULL (-1)
+#define MPI_T_CVAR_HANDLE_NULL ((MPI_T_cvar_handle)0)
+#define MPI_T_PVAR_HANDLE_NULL ((MPI_T_pvar_handle)0)
+#define MPI_T_PVAR_ALL_HANDLES ((MPI_T_pvar_handle)-1)
+#define MPI_T_PVAR_SESSION_NULL ((MPI_T_pvar_session)0)
+
+#define MPI_T_VERBOSITY_USER_BASIC 221
+#define MPI_T_VERBOSITY_USER_DETAIL 222
+#define MPI_T_VERBOSITY_USER_ALL 223
+#define MPI_T_VERBOSITY_TUNER_BASIC 224
+#define MPI_T_VERBOSITY_TUNER_DETAIL 225
+#define MPI_T_VERBOSITY_TUNER_ALL 226
+#define MPI_T_VERBOSITY_MPIDEV_BASIC 227
+#define MPI_T_VERBOSITY_MPIDEV_DETAIL 228
+#define MPI_T_VERBOSITY_MPIDEV_ALL 229
+
+#define MPI_T_BIND_NO_OBJECT 0
+#define MPI_T_BIND_MPI_COMM 1
+#define MPI_T_BIND_MPI_DATATYPE 2
+#define MPI_T_BIND_MPI_ERRHANDLER 3
+#define MPI_T_BIND_MPI_FILE 4
+#define MPI_T_BIND_MPI_GROUP 5
+#define MPI_T_BIND_MPI_OP 6
+#define MPI_T_BIND_MPI_REQUEST 7
+#define MPI_T_BIND_MPI_WIN 8
+#define MPI_T_BIND_MPI_MESSAGE 9
+#define MPI_T_BIND_MPI_INFO 10
+
+#define MPI_T_SCOPE_CONSTANT 0
+#define MPI_T_SCOPE_READONLY 1
+#define MPI_T_SCOPE_LOCAL 2
+#define MPI_T_SCOPE_GROUP 3
+#define MPI_T_SCOPE_GROUP_EQ 4
+#define MPI_T_SCOPE_ALL 5
+#define MPI_T_SCOPE_ALL_EQ 6
+
+#define MPI_T_PVAR_CLASS_STATE 0
+#define MPI_T_PVAR_CLASS_LEVEL 1
+#define MPI_T_PVAR_CLASS_SIZE 2
+#define MPI_T_PVAR_CLASS_PERCENTAGE 3
+#define MPI_T_PVAR_CLASS_HIGHWATERMARK 4
+#define MPI_T_PVAR_CLASS_LOWWATERMARK 5
+#define MPI_T_PVAR_CLASS_COUNTER 6
+#define MPI_T_PVAR_CLASS_AGGREGATE 7
+#define MPI_T_PVAR_CLASS_TIMER 8
+#define MPI_T_PVAR_CLASS_GENERIC 9
+
+#define MPI_T_ERR_MEMORY 54
+#define MPI_T_ERR_NOT_INITIALIZED 55
+#define MPI_T_ERR_CANNOT_INIT 56
+#define MPI_T_ERR_INVALID_INDEX 57
+#define MPI_T_ERR_INVALID_ITEM 58
+#define MPI_T_ERR_INVALID_HANDLE 59
+#define MPI_T_ERR_OUT_OF_HANDLES 60
+#define MPI_T_ERR_OUT_OF_SESSIONS 61
+#define MPI_T_ERR_INVALID_SESSION 62
+#define MPI_T_ERR_CVAR_SET_NOT_NOW 63
+#define MPI_T_ERR_CVAR_SET_NEVER 64
+#define MPI_T_ERR_PVAR_NO_STARTSTOP 65
+#define MPI_T_ERR_PVAR_NO_WRITE 66
+#define MPI_T_ERR_PVAR_NO_ATOMIC 67
+#define MPI_T_ERR_INVALID_NAME 68
+#define MPI_T_ERR_INVALID 69
+
+/*
+ * Every function exists as PMPI_ and as a weak MPI_ alias, except the
+ * MPI_T functions, which tools call directly.
+ */
+#define MOCK_DECLARE(ret, name, args) ret MPI_##name args; ret PMPI_##name args
+
+MOCK_DECLARE(int, Init, (int *argc, char ***argv));
+MOCK_DECLARE(int, Init_thread, (int *argc, char ***argv, int required, int *provided));
+MOCK_DECLARE(int, Initialized, (int *flag));
+MOCK_DECLARE(int, Finalize, (void));
+MOCK_DECLARE(int, Query_thread, (int *provided));
+MOCK_DECLARE(int, Abort, (MPI_Comm comm, int errorcode));
+MOCK_DECLARE(double, Wtime, (void));
+MOCK_DECLARE(int, Pcontrol, (const int level, ...));
+MOCK_DECLARE(int, Error_string, (int errorcode, char *string, int *resultlen));
+MOCK_DECLARE(int, Get_processor_name, (char *name, int *resultlen));
+MOCK_DECLARE(int, Get_library_version, (char *version, int *resultlen));
+MOCK_DECLARE(int, Get_version, (int *version, int *subversion));
+
+MOCK_DECLARE(int, Comm_rank, (MPI_Comm comm, int *rank));
+MOCK_DECLARE(int, Comm_size, (MPI_Comm comm, int *size));
+MOCK_DECLARE(int, Comm_dup, (MPI_Comm comm, MPI_Comm *newcomm));
+MOCK_DECLARE(int, Comm_split, (MPI_Comm comm, int color, int key, MPI_Comm *newcomm));
+MOCK_DECLARE(int, Comm_split_type, (MPI_Comm comm, int split_type, int key, MPI_Info info, MPI_Comm *newcomm));
+MOCK_DECLARE(int, Comm_free, (MPI_Comm *comm));
+MOCK_DECLARE(int, Comm_test_inter, (MPI_Comm comm, int *flag));
+MOCK_DECLARE(int, Comm_group, (MPI_Comm comm, MPI_Group *group));
+MOCK_DECLARE(int, Comm_remote_group, (MPI_Comm comm, MPI_Group *group));
+MOCK_DECLARE(int, Group_size, (MPI_Group group, int *size));
+MOCK_DECLARE(int, Group_translate_ranks, (MPI_Group group1, int n, const int ranks1[], MPI_Group group2, int ranks2[]));
+MOCK_DECLARE(int, Group_free, (MPI_Group *group));
+MOCK_DECLARE(int, Info_free, (MPI_Info *info));
+
+MOCK_DECLARE(int, Type_size, (MPI_Datatype datatype, int *size));
+MOCK_DECLARE(int, Type_contiguous, (int count, MPI_Datatype oldtype, MPI_Datatype *newtype));
+MOCK_DECLARE(int, Type_commit, (MPI_Datatype *datatype));
+MOCK_DECLARE(int, Type_free, (MPI_Datatype *datatype));
+MOCK_DECLARE(int, Op_create, (MPI_User_function *function, int commute, MPI_Op *op));
+MOCK_DECLARE(int, Op_free, (MPI_Op *op));
+
+MOCK_DECLARE(int, Send, (const void *buf, int count, MPI_Datatype datatype, int dest, int tag, MPI_Comm comm));
+MOCK_DECLARE(int, Isend, (const void *buf, int count, MPI_Datatype datatype, int dest, int tag,
+		MPI_Comm comm, MPI_Request *request));
+MOCK_DECLARE(int, Recv, (void *buf, int count, MPI_Datatype datatype, int source, int tag,
+		MPI_Comm comm, MPI_Status *status));
+MOCK_DECLARE(int, Irecv, (void *buf, int count, MPI_Datatype datatype, int source, int tag,
+		MPI_Comm comm, MPI_Request *request));
+MOCK_DECLARE(int, Wait, (MPI_Request *request, MPI_Status *status));
+MOCK_DECLARE(int, Waitall, (int count, MPI_Request requests[], MPI_Status statuses[]));
+
+MOCK_DECLARE(int, Barrier, (MPI_Comm comm));
+MOCK_DECLARE(int, Bcast, (void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm));
+MOCK_DECLARE(int, Reduce, (const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		MPI_Op op, int root, MPI_Comm comm));
+MOCK_DECLARE(int, Allreduce, (const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		MPI_Op op, MPI_Comm comm));
+MOCK_DECLARE(int, Exscan, (const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype,
+		MPI_Op op, MPI_Comm comm));
+MOCK_DECLARE(int, Gather, (const void *sendbuf, int sendcount, MPI_Datatype sendtype,
+		void *recvbuf, int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm));
+
+MOCK_DECLARE(int, Win_allocate_shared, (MPI_Aint size, int disp_unit, MPI_Info info, MPI_Comm comm,
+		void *baseptr, MPI_Win *win));
+MOCK_DECLARE(int, Win_shared_query, (MPI_Win win, int rank, MPI_Aint *size, int *disp_unit, void *baseptr));
+MOCK_DECLARE(int, Win_fence, (int assert, MPI_Win win));
+MOCK_DECLARE(int, Win_free, (MPI_Win *win));
+
+MOCK_DECLARE(int, File_open, (MPI_Comm comm, const char *filename, int amode, MPI_Info info, MPI_File *fh));
+MOCK_DECLARE(int, File_set_size, (MPI_File fh, MPI_Offset size));
+MOCK_DECLARE(int, File_write_at, (MPI_File fh, MPI_Offset offset, const void *buf, int count,
+		MPI_Datatype datatype, MPI_Status *status));
+MOCK_DECLARE(int, File_write_at_all, (MPI_File fh, MPI_Offset offset, const void *buf, int count,
+		MPI_Datatype datatype, MPI_Status *status));
+MOCK_DECLARE(int, File_close, (MPI_File *fh));
+
+int MPI_T_init_thread(int required, int *provided);
+int MPI_T_finalize(void);
+int MPI_T_enum_get_info(MPI_T_enum enumtype, int *num, char *name, int *name_len);
+int MPI_T_enum_get_item(MPI_T_enum enumtype, int index, int *value, char *name, int *name_len);
+int MPI_T_cvar_get_num(int *num_cvar);
+int MPI_T_cvar_get_info(int cvar_index, char *name, int *name_len, int *verbosity,
+		MPI_Datatype *datatype, MPI_T_enum *enumtype, char *desc, int *desc_len,
+		int *bind, int *scope);
+int MPI_T_cvar_get_index(const char *name, int *cvar_index);
+int MPI_T_cvar_handle_alloc(int cvar_index, void *obj_handle, MPI_T_cvar_handle *handle, int *count);
+int MPI_T_cvar_handle_free(MPI_T_cvar_handle *handle);
+int MPI_T_cvar_read(MPI_T_cvar_handle handle, void *buf);
+int MPI_T_cvar_write(MPI_T_cvar_handle handle, const void *buf);
+int MPI_T_pvar_get_num(int *num_pvar);
+int MPI_T_pvar_get_info(int pvar_index, char *name, int *name_len, int *verbosity,
+		int *var_class, MPI_Datatype *datatype, MPI_T_enum *enumtype, char *desc,
+		int *desc_len, int *bind, int *readonly, int *continuous, int *atomic);
+int MPI_T_pvar_get_index(const char *name, int var_class, int *pvar_index);
+int MPI_T_pvar_session_create(MPI_T_pvar_session *session);
+int MPI_T_pvar_session_free(MPI_T_pvar_session *session);
+int MPI_T_pvar_handle_alloc(MPI_T_pvar_session session, int pvar_index, void *obj_handle,
+		MPI_T_pvar_handle *handle, int *count);
+int MPI_T_pvar_handle_free(MPI_T_pvar_session session, MPI_T_pvar_handle *handle);
+int MPI_T_pvar_start(MPI_T_pvar_session session, MPI_T_pvar_handle handle);
+int MPI_T_pvar_stop(MPI_T_pvar_session session, MPI_T_pvar_handle handle);
+int MPI_T_pvar_read(MPI_T_pvar_session session, MPI_T_pvar_handle handle, void *buf);
+int MPI_T_pvar_reset(MPI_T_pvar_session session, MPI_T_pvar_handle handle);
+int MPI_T_category_get_num(int *num_cat);
+int MPI_T_category_get_info(int cat_index, char *name, int *name_len, char *desc, int *desc_len,
+		int *num_cvars, int *num_pvars, int *num_categories);
+int MPI_T_category_get_index(const char *name, int *cat_index);
+int MPI_T_category_get_cvars(int cat_index, int len, int indices[]);
+int MPI_T_category_get_pvars(int cat_index, int len, int indices[]);
+int MPI_T_category_get_categories(int cat_index, int len, int indices[]);
+int MPI_T_category_changed(int *stamp);
+
+#if MPI_VERSION >= 4
+typedef struct mock_event_instance *MPI_T_event_instance;
+typedef struct mock_event_registration *MPI_T_event_registration;
+typedef int MPI_T_cb_safety;
+typedef int MPI_T_source_order;
+
+#define MPI_T_CB_REQUIRE_NONE 0
+#define MPI_T_CB_REQUIRE_MPI_RESTRICTED 1
+#define MPI_T_CB_REQUIRE_THREAD_SAFE 2
+#define MPI_T_CB_REQUIRE_ASYNC_SIGNAL_SAFE 3
+
+#define MPI_T_SOURCE_ORDERED 0
+#define MPI_T_SOURCE_UNORDERED 1
+
+typedef void (MPI_T_event_cb_function)(MPI_T_event_instance event_instance,
+		MPI_T_event_registration event_registration, MPI_T_cb_safety cb_safety, void *user_data);
+typedef void (MPI_T_event_free_cb_function)(MPI_T_event_registration event_registration,
+		MPI_T_cb_safety cb_safety, void *user_data);
+typedef void (MPI_T_event_dropped_cb_function)(MPI_Count count, MPI_T_event_registration event_registration,
+		int source_index, MPI_T_cb_safety cb_safety, void *user_data);
+
+int MPI_T_source_get_num(int *num_sources);
+int MPI_T_source_get_info(int source_index, char *name, int *name_len, char *desc, int *desc_len,
+		MPI_T_source_order *ordering, MPI_Count *ticks_per_second, MPI_Count *max_ticks, MPI_Info *info);
+int MPI_T_source_get_timestamp(int source_index, MPI_Count *timestamp);
+int MPI_T_event_get_num(int *num_events);
+int MPI_T_event_get_info(int event_index, char *name, int *name_len, int *verbosity,
+		MPI_Datatype array_of_datatypes[], MPI_Aint array_of_displacements[], int *num_elements,
+		MPI_T_enum *enumtype, MPI_Info *info, char *desc, int *desc_len, int *bind);
+int MPI_T_event_get_index(const char *name, int *event_index);
+int MPI_T_event_handle_alloc(int event_index, void *obj_handle, MPI_Info info,
+		MPI_T_event_registration *event_registration);
+int MPI_T_event_handle_free(MPI_T_event_registration event_registration, void *user_data,
+		MPI_T_event_free_cb_function *free_cb_function);
+int MPI_T_event_register_callback(MPI_T_event_registration event_registration, MPI_T_cb_safety cb_safety,
+		MPI_Info info, void *user_data, MPI_T_event_cb_function *event_cb_function);
+int MPI_T_event_set_dropped_handler(MPI_T_event_registration event_registration,
+		MPI_T_event_dropped_cb_function *dropped_cb_function);
+int MPI_T_event_read(MPI_T_event_instance event_instance, int element_index, void *buffer);
+int MPI_T_event_copy(MPI_T_event_instance event_instance, void *buffer);
+int MPI_T_event_get_timestamp(MPI_T_event_instance event_instance, MPI_Count *event_timestamp);
+int MPI_T_event_get_source(MPI_T_event_instance event_instance, int *source_index);
+#endif /* MPI_VERSION >= 4 */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* MOCK_MPI_H_ */
@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2014, Lawrence Livermore National Security,
+//  LLC. Produced at the Lawrence Livermore National Laboratory. Written
+//  by Tanzima Z. Islam (islam3@llnl.gov).
+// CODE-LLNL-CODE-647221. All rights reserved.
+// This file is part of mpi_T-tools. For details, see
+//  https://computation-rnd.llnl.gov/mpi_t/gyan.php.
+// Please also read this file - FULL-LICENSE.txt.
+// This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License (as published by
+//  the Free Software Foundation) version 2.1 dated February 1999.
+// This program is distributed in the hope that it will be useful, but
+//  WITHOUT ANY WARRANTY; without even the IMPLIED WARRANTY OF
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the terms
+//  and conditions of the GNU General Public License for more
+//  details. You should have received a copy of the GNU Lesser General
+//  Public License along with this program; if not, write to the Free
+//  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+//  02111-1307 USA
+//////////////////////////////////////////////////////////////////////////////
+/*
+ * mpit_bench.cpp
+ *
+ * Samples all unsigned long long pvars of the mock with the C++ layer in
+ * ../common/mpit.hpp, as a C++ application embedding MPI_T would, and
+ * prints the time per pvar read and the sum of the last sample.
+ */
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <mpi.h>
+#include "mpit.hpp"
+
+static double now(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static void usage(int e){
+	printf("Usage: mpit_bench [-n <samples>]\n");
+	printf("    -n = Samples of all pvars (default: 1000)\n");
+	printf("    -h = This help text\n");
+	exit(e);
+}
+
+int main(int argc, char *argv[]){
+	int opt, i, samples = 1000;
+	unsigned long long int sum = 0;
+	double t;
+
+	while((opt = getopt(argc, argv, "hn:")) != -1){
+		switch(opt){
+		case 'n':
+			samples = atoi(optarg);
+			if(samples <= 0)
+				usage(1);
+			break;
+		case 'h':
+		default:
+			usage(1);
+		}
+	}
+	MPI_Init(&argc, &argv);
+	try{
+		mpit::Library mpit;
+		mpit::Session session;
+		mpit::PvarBatch<unsigned long long> batch(session);
+		int num = mpit::num_pvars();
+
+		for(i = 0; i < num; i++){
+			mpit::PvarInfo info = mpit::pvar_info(i);
+			if(mpit::Datatype<unsigned long long>::matches(info.datatype) && info.bind == MPI_T_BIND_NO_OBJECT)
+				batch.add(i);
+		}
+		t = now();
+		for(i = 0; i < samples; i++)
+			batch.read();
+		t = now() - t;
+		for(i = 0; i < (int)batch.num_values(); i++)
+			sum += batch.values()[i];
+		printf("pvars            %12zu of %d (%zu values)\n", batch.size(), num, batch.num_values());
+		printf("pvar read        %12.1lf ns\n", batch.size() ? 1e9 * t / samples / batch.size() : 0);
+		printf("sum              %12llu\n", sum);
+	}
+	catch(const mpit::Error &e){
+		fprintf(stderr, "%s\n", e.what());
+		MPI_Finalize();
+		return 1;
+	}
+	MPI_Finalize();
+	return 0;
+}
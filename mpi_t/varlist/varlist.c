@@ -22,10 +22,17 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <string.h>
+#include <sys/ioctl.h>
 
 #include <mpi.h>
 
+#include "enum_cache.h"
+#include "category_tree.h"
+
 #define SCREENLEN 78
+#define CVAR_NAME_LEN 1024
+#define CVAR_VALUE_LEN 257
+#define CVAR_STRING_LEN 4097
 
 #ifndef MPI_COUNT
 #define MPI_COUNT MPI_INT
@@ -37,9 +44,15 @@ typedef int MPI_Count;
 #endif
 char errMsg[1000];
 int errMsgLen;
-#define CHECKERR(errstr,err) if (err!=MPI_SUCCESS) { printf("ERROR: %s: MPI error code %i: ",errstr,err); MPI_Error_string(err, errMsg, &errMsgLen); errMsg[errMsgLen]=0; printf("%s\n", errMsg); /*usage(1);*/ } 
+/* Errors go to stderr in JSON/CSV mode to keep the output parseable */
+#define CHECKERR(errstr,err) if (err!=MPI_SUCCESS) { FILE *errf=outformat ? stderr : stdout; fprintf(errf,"ERROR: %s: MPI error code %i: ",errstr,err); MPI_Error_string(err, errMsg, &errMsgLen); errMsg[errMsgLen]=0; fprintf(errf,"%s\n", errMsg); /*usage(1);*/ } 
 
-int list_pvar,list_cvar,longlist,verbosity,runmpi; 
+int list_pvar,list_cvar,list_event,longlist,verbosity,runmpi; 
+char *snapshot_file,*restore_file;
+int diffmode,checkmode,outformat,categorymode;
+double top_interval;
+int top_refreshes,top_workload;
+char *top_selection;
 
 #define RUNMPI 1
 
@@ -47,12 +60,27 @@ int list_pvar,list_cvar,longlist,verbosity,runmpi;
 
 void usage(int e)
 {
-	printf("Usage: varlist [-c] [-p] [-v <VL>] [-l] [-m]\n");
+	printf("Usage: varlist [-c] [-p] [-e] [-v <VL>] [-l] [-g] [-m] [-f <format>]\n");
+	printf("       varlist [-r <file>] [-s <file>]\n");
+	printf("       varlist -d <file A> <file B>\n");
+	printf("       varlist -x\n");
+	printf("       varlist -t <sec> [-n <num>] [-P <names>] [-w <bytes>]\n");
 	printf("    -c = List only Control Variables\n");
 	printf("    -p = List only Performance Variables\n");
+	printf("    -e = List only Event Types (MPI 4.0)\n");
 	printf("    -v = List up to verbosity level <VL> (1=U/B to 9=D/D)\n");
 	printf("    -l = Long list with all information, incl. descriptions\n");
+	printf("    -g = Print the category tree (with -l: incl. member variables)\n");
 	printf("    -m = Do not call MPI_Init before listing variables\n");
+	printf("    -f = Output format: text (default), json or csv\n");
+	printf("    -s = Save all control variable values to a snapshot file\n");
+	printf("    -r = Restore a snapshot by writing all writable control variables\n");
+	printf("    -d = Compare two snapshot files\n");
+	printf("    -x = Check that GROUP_EQ/ALL_EQ control variables match on all ranks\n");
+	printf("    -t = Monitor performance variables, refreshing every <sec> seconds\n");
+	printf("    -n = Stop monitoring after <num> refreshes (default: run until killed)\n");
+	printf("    -P = Monitor only variables containing one of the comma separated <names>\n");
+	printf("    -w = Run allreduces of <bytes> on all ranks while monitoring\n");
 	printf("    -h = This help text\n");
 	exit(e);
 }
@@ -218,10 +246,10 @@ void print_scope(int s)
 		printf("GROUP-EQ");
 		break;
 	case MPI_T_SCOPE_ALL:
-		printf("ALL-EQ  ");
+		printf("ALL     ");
 		break;
 	case MPI_T_SCOPE_ALL_EQ:
-		printf("ALL     ");
+		printf("ALL-EQ  ");
 		break;
 	default:
 		printf("UNKNOWN ");
@@ -466,6 +494,128 @@ void list_pvars()
 }
 
 
+/* Read the value of a single CVAR into a string, returns 0 if the
+   value cannot be read. Enumerated values are decoded if symbolic is set */
+
+int read_cvar_value(int index, int bind, MPI_Datatype dt, MPI_T_enum et, int symbolic, char *value, int len)
+{
+	int err;
+	int v_int;
+	unsigned int v_uint;
+	unsigned long v_ulong;
+	unsigned long long v_ullong;
+	MPI_Count v_count;
+	char v_char[CVAR_STRING_LEN];
+	double v_double;
+	int value_sup;
+	MPI_T_cvar_handle handle=MPI_T_CVAR_HANDLE_NULL;
+	int count;
+
+	value_sup=1;
+	if (bind==MPI_T_BIND_NO_OBJECT)
+	{
+		err=MPI_T_cvar_handle_alloc(index,NULL,&handle,&count);
+		CHECKERR("CVAR-ALLOC",err);
+	}
+	else if (bind==MPI_T_BIND_MPI_COMM)
+	{
+		MPI_Comm comm=MPI_COMM_WORLD;
+		err=MPI_T_cvar_handle_alloc(index,&comm,&handle,&count);
+		CHECKERR("CVAR-ALLOC",err);
+	}
+	else
+	{
+		value_sup=0;
+		snprintf(value,len,"unsupported");
+		return value_sup;
+	}
+
+	if (err!=MPI_SUCCESS)
+	{
+		snprintf(value,len,"unsupported");
+		return 0;
+	}
+
+	if ((count==1 && dt!=MPI_CHAR) || (dt==MPI_CHAR && count<CVAR_STRING_LEN))
+	{
+		if (dt==MPI_INT)
+		{
+			err=MPI_T_cvar_read(handle,&v_int);
+			CHECKERR("CVARREAD",err);
+			if (et==MPI_T_ENUM_NULL || !symbolic)
+			{
+				snprintf(value,len,"%i",v_int);
+			}
+			else
+			{
+				const char *etname=enum_cache_lookup(et,v_int);
+				snprintf(value,len,"%s",etname!=NULL ? etname : "unknown");
+			}
+		}
+		else if (dt==MPI_UNSIGNED)
+		{
+			err=MPI_T_cvar_read(handle,&v_uint);
+			CHECKERR("CVARREAD",err);
+			snprintf(value,len,"%u",v_uint);
+		}
+		else if (dt==MPI_UNSIGNED_LONG)
+		{
+			err=MPI_T_cvar_read(handle,&v_ulong);
+			CHECKERR("CVARREAD",err);
+			snprintf(value,len,"%lu",v_ulong);
+		}
+		else if (dt==MPI_UNSIGNED_LONG_LONG)
+		{
+			err=MPI_T_cvar_read(handle,&v_ullong);
+			CHECKERR("CVARREAD",err);
+			snprintf(value,len,"%llu",v_ullong);
+		}
+		else if (dt==MPI_COUNT)
+		{
+			err=MPI_T_cvar_read(handle,&v_count);
+			CHECKERR("CVARREAD",err);
+			snprintf(value,len,"%lld",(long long)v_count);
+		}
+		else if (dt==MPI_CHAR)
+		{
+			err=MPI_T_cvar_read(handle,v_char);
+			CHECKERR("CVARREAD",err);
+			v_char[count]=0;
+			snprintf(value,len,"%s",v_char);
+		}
+		else if (dt==MPI_DOUBLE)
+		{
+			err=MPI_T_cvar_read(handle,&v_double);
+			CHECKERR("CVARREAD",err);
+			snprintf(value,len,"%g",v_double);
+		}
+		else
+		{
+			value_sup=0;
+			snprintf(value,len,"unsupported");
+		}
+		if (err!=MPI_SUCCESS)
+		{
+			value_sup=0;
+			snprintf(value,len,"unsupported");
+		}
+	}
+	else
+	{
+		value_sup=0;
+		snprintf(value,len,"unsupported");
+	}
+
+	if (handle!=MPI_T_CVAR_HANDLE_NULL)
+	{
+		err=MPI_T_cvar_handle_free(&handle);
+		CHECKERR("CVAR-FREE",err);
+	}
+
+	return value_sup;
+}
+
+
 /* Print all Control Variables */
 
 void list_cvars()
@@ -480,17 +630,7 @@ void list_cvars()
 	int prtlen;
 	int namelen,desclen;
 
-	int v_int;
-	unsigned int v_uint;
-	unsigned long v_ulong;
-	unsigned long long v_ullong;
-	MPI_Count v_count;
-	char v_char[4097];
-	double v_double;
-	char value[257];
-	int value_sup;
-	MPI_T_cvar_handle handle=MPI_T_CVAR_HANDLE_NULL;
-	int count;
+	char value[CVAR_VALUE_LEN];
 
 	/* Get number of variables */
 
@@ -566,115 +706,7 @@ void list_cvars()
 
 		CHECKERR("CVARINFO",err);
 
-		value_sup=1;
-		if (bind==MPI_T_BIND_NO_OBJECT)
-		{
-			err=MPI_T_cvar_handle_alloc(i,NULL,&handle,&count);
-			CHECKERR("CVAR-ALLOC",err);
-		}
-		else if (bind==MPI_T_BIND_MPI_COMM)
-		{
-			MPI_Comm comm=MPI_COMM_WORLD;
-			err=MPI_T_cvar_handle_alloc(i,&comm,&handle,&count);
-			CHECKERR("CVAR-ALLOC",err);
-		}
-		else
-		{
-			value_sup=0;
-			sprintf(value,"unsupported");
-		}
-
-		if (value_sup)
-		{
-			if (count==1 || dt==MPI_CHAR)
-			{
-				if (dt==MPI_INT)
-				{
-					err=MPI_T_cvar_read(handle,&v_int);
-					
-					CHECKERR("CVARREAD",err);
-					if (et==MPI_T_ENUM_NULL)
-					{
-						sprintf(value,"%i",v_int);
-					}
-					else
-					{
-						int i,etnum;
-						char etname[20];
-						int etlen=20;
-						int done=0;
-						int newval;
-						err=MPI_T_enum_get_info(et,&etnum,etname,&etlen);
-						for (i=0; i<etnum; i++)
-						{
-							etlen=12;
-							err=MPI_T_enum_get_item(et,i,&newval,etname,&etlen);
-							if (newval==v_int)
-							{
-								sprintf(value, "%s",etname);
-								done=1;
-							}
-						}
-						if (!done)
-						{
-							sprintf(value, "unknown");
-						}
-					}
-				}
-				else if (dt==MPI_UNSIGNED)
-				{
-					err=MPI_T_cvar_read(handle,&v_uint);
-					CHECKERR("CVARREAD",err);
-					sprintf(value,"%u",v_uint);
-				}
-				else if (dt==MPI_UNSIGNED_LONG)
-				{
-					err=MPI_T_cvar_read(handle,&v_ulong);
-					CHECKERR("CVARREAD",err);
-					sprintf(value,"%lu",v_ulong);
-				}
-				else if (dt==MPI_UNSIGNED_LONG_LONG)
-				{
-					err=MPI_T_cvar_read(handle,&v_ullong);
-					CHECKERR("CVARREAD",err);
-					sprintf(value,"%llu",v_ullong);
-				}
-				else if (dt==MPI_COUNT)
-				{
-					err=MPI_T_cvar_read(handle,&v_count);
-					CHECKERR("CVARREAD",err);
-					sprintf(value,"%lu",v_count);
-				}
-				else if (dt==MPI_CHAR)
-				{
-					err=MPI_T_cvar_read(handle,v_char);
-					CHECKERR("CVARREAD",err);
-					sprintf(value,"%s",v_char);
-				}
-				else if (dt==MPI_DOUBLE)
-				{
-					err=MPI_T_cvar_read(handle,&v_double);
-					CHECKERR("CVARREAD",err);
-					sprintf(value,"%d",v_double);
-				}
-				else
-				{
-					value_sup=0;
-					sprintf(value,"unsupported");
-				}
-			}
-			else
-			{
-				value_sup=0;
-				sprintf(value,"unsupported");
-			}
-		}
-
-		if (handle!=MPI_T_CVAR_HANDLE_NULL)
-		{
-			MPI_T_cvar_handle_free(&handle);
-			CHECKERR("CVAR-FREE",err);
-		}
+		read_cvar_value(i,bind,dt,et,1,value,sizeof(value));
 
 		if (verbos<=verbosity)
 		{
@@ -727,118 +759,1759 @@ void list_cvars()
 }
 
 
-/* Main */
+/* CVAR snapshots
 
-int main(int argc, char *argv[])
+   A snapshot holds one line per readable CVAR with its name, type,
+   scope and value, separated by tabs. Tabs, newlines and backslashes
+   inside values are escaped. Enumerated values are stored numerically. */
+
+typedef struct
 {
-	int err,errarg;
-	int threadsupport,threadsupport_t;
-	int rank;
-	int opt,erropt;
-	int reqthread=MPI_THREAD_MULTIPLE;
-    
-    int minor,major;
-    
-    char libversion[MPI_MAX_LIBRARY_VERSION_STRING];
-    int libversionlen;
-    
+	char *name;
+	char *type;
+	char *scope;
+	char *value;
+} snapshot_entry;
 
-	/* Read options */
+typedef struct
+{
+	char *library;
+	int num;
+	snapshot_entry *entries;
+	char *data;
+} snapshot;
 
-	verbosity=MPI_T_VERBOSITY_MPIDEV_ALL;
-	list_pvar=1;
-	list_cvar=1;
-	longlist=0;
-	runmpi=1;
-	errarg=0;
 
-	while ((opt=getopt(argc,argv, "hv:pclim")) != -1 ) {
-		switch (opt) {
-		case 'h':
-			errarg=-1;
-			break;
-		case 'v':
-			switch (atoi(optarg)) {
-			case 1: verbosity=MPI_T_VERBOSITY_USER_BASIC; break;
-			case 2: verbosity=MPI_T_VERBOSITY_USER_DETAIL; break;
-			case 3: verbosity=MPI_T_VERBOSITY_USER_ALL; break;
-			case 4: verbosity=MPI_T_VERBOSITY_TUNER_BASIC; break;
-			case 5: verbosity=MPI_T_VERBOSITY_TUNER_DETAIL; break;
-			case 6: verbosity=MPI_T_VERBOSITY_TUNER_ALL; break;
-			case 7: verbosity=MPI_T_VERBOSITY_MPIDEV_BASIC; break;
-			case 8: verbosity=MPI_T_VERBOSITY_MPIDEV_DETAIL; break;
-			case 9: verbosity=MPI_T_VERBOSITY_MPIDEV_ALL; break;
-			}
-			break;
-			case 'p':
-				list_pvar=1;
-				list_cvar=0;
-				break;
-			case 'c':
-				list_cvar=1;
-				list_pvar=0;
-				break;
-			case 'l':
-				longlist=1;
-				break;
-			case 'm':
-				runmpi=0;
-				break;
-			default:
-				errarg=1;
-				erropt=opt;
-				break;
-		}
+/* Type and scope names used in snapshots */
+
+char *type_name(MPI_Datatype t)
+{
+	if (t==MPI_INT) return "INT";
+	if (t==MPI_UNSIGNED) return "UINT";
+	if (t==MPI_UNSIGNED_LONG) return "ULONG";
+	if (t==MPI_UNSIGNED_LONG_LONG) return "ULLONG";
+	if (t==MPI_COUNT) return "COUNT";
+	if (t==MPI_CHAR) return "CHAR";
+	if (t==MPI_DOUBLE) return "DOUBLE";
+	return "UNKNOWN";
+}
+
+char *scope_name(int s)
+{
+	switch (s) {
+	case MPI_T_SCOPE_CONSTANT: return "CONST";
+	case MPI_T_SCOPE_READONLY: return "READONLY";
+	case MPI_T_SCOPE_LOCAL: return "LOCAL";
+	case MPI_T_SCOPE_GROUP: return "GROUP";
+	case MPI_T_SCOPE_GROUP_EQ: return "GROUP-EQ";
+	case MPI_T_SCOPE_ALL: return "ALL";
+	case MPI_T_SCOPE_ALL_EQ: return "ALL-EQ";
+	default: return "UNKNOWN";
 	}
+}
 
-	/* Initialize */
 
-	if (runmpi)
+/* Write a value with tabs, newlines and backslashes escaped */
+
+void write_escaped(FILE *f, char *s)
+{
+	for (; *s; s++)
 	{
-		err=MPI_Init_thread(&argc,&argv,reqthread,&threadsupport);
-		CHECKERR("Init",err);
+		if (*s=='\\')
+			fputs("\\\\",f);
+		else if (*s=='\t')
+			fputs("\\t",f);
+		else if (*s=='\n')
+			fputs("\\n",f);
+		else
+			fputc(*s,f);
+	}
+}
 
-		err=MPI_Comm_rank(MPI_COMM_WORLD,&rank);
-		CHECKERR("Rank",err);
+void unescape(char *s)
+{
+	char *d=s;
+	for (; *s; s++)
+	{
+		if (*s=='\\' && s[1]!=0)
+		{
+			s++;
+			*d++=(*s=='t') ? '\t' : (*s=='n') ? '\n' : *s;
+		}
+		else
+			*d++=*s;
 	}
-	else
-		rank=0;
+	*d=0;
+}
 
 
-	/* ONLY FOR RANK 0 */
+/* Dump all readable CVAR values into a snapshot file */
 
-	if (rank==0)
+int write_snapshot(char *filename)
+{
+	int num,err,i,numvars;
+	char name[CVAR_NAME_LEN];
+	char desc[CVAR_VALUE_LEN];
+	char value[CVAR_STRING_LEN];
+	int namelen,desclen,bind,verbos,scope;
+	MPI_Datatype dt;
+	MPI_T_enum et;
+	char libversion[MPI_MAX_LIBRARY_VERSION_STRING];
+	int libversionlen;
+	FILE *f;
+
+	f=fopen(filename,"w");
+	if (f==NULL)
 	{
-		err=MPI_T_init_thread(reqthread, &threadsupport_t);
-		CHECKERR("T_Init",err);
+		printf("ERROR: Cannot open snapshot file %s\n",filename);
+		return -1;
+	}
 
-		if (errarg)
-		{
-			if (errarg>0)
-				printf("Argument error: %c\n",erropt);
-			usage(errarg!=-1);
-		}
+	err=MPI_Get_library_version(libversion,&libversionlen);
+	CHECKERR("Library Version",err);
+	fprintf(f,"# varlist cvar snapshot\n");
+	fprintf(f,"# library: ");
+	for (i=0; i<libversionlen && libversion[i]!=0; i++)
+		fputc((libversion[i]=='\n') ? ' ' : libversion[i],f);
+	fprintf(f,"\n");
 
+	err=MPI_T_cvar_get_num(&num);
+	CHECKERR("CVARNUM",err);
 
-		/* Header */
+	numvars=0;
+	for (i=0; i<num; i++)
+	{
+		namelen=CVAR_NAME_LEN;
+		desclen=CVAR_VALUE_LEN;
+		err=MPI_T_cvar_get_info(i,name,&namelen,&verbos,&dt,&et,desc,&desclen,&bind,&scope);
+		if (err!=MPI_SUCCESS)
+			continue;
+		if (!read_cvar_value(i,bind,dt,et,0,value,sizeof(value)))
+			continue;
+		fprintf(f,"%s\t%s\t%s\t",name,type_name(dt),scope_name(scope));
+		write_escaped(f,value);
+		fprintf(f,"\n");
+		numvars++;
+	}
 
-		printf("MPI_T Variable List\n\n");
-        
-        /* Print Version */
-        
-        err=MPI_Get_version(&major,&minor);
-        CHECKERR("T_Init",err);
-        printf("  MPI Version: %i.%i\n",major,minor);
-        
-        err=MPI_Get_library_version(libversion,&libversionlen);
-        CHECKERR("T_Init",err);
-        printf("  MPI Library Version: %s\n\n",libversion);
+	fclose(f);
+	printf("Wrote %i of %i control variables to snapshot %s\n",numvars,num,filename);
+	return numvars;
+}
 
-        /* Print thread support */
 
-		if (runmpi)
+int compare_snapshot_entries(const void *a, const void *b)
+{
+	return strcmp(((snapshot_entry*)a)->name,((snapshot_entry*)b)->name);
+}
+
+
+/* Read a snapshot file, entries are sorted by name */
+
+int read_snapshot(char *filename, snapshot *snap)
+{
+	FILE *f;
+	long size;
+	char *line,*next,*field[4];
+	int i,lines;
+
+	snap->library="unknown";
+	snap->num=0;
+	snap->entries=NULL;
+	snap->data=NULL;
+
+	f=fopen(filename,"r");
+	if (f==NULL)
+	{
+		printf("ERROR: Cannot open snapshot file %s\n",filename);
+		return -1;
+	}
+	fseek(f,0,SEEK_END);
+	size=ftell(f);
+	fseek(f,0,SEEK_SET);
+	snap->data=(char*)malloc(size+1);
+	CHECKERR("Malloc Snapshot",snap->data==NULL);
+	size=fread(snap->data,1,size,f);
+	snap->data[size]=0;
+	fclose(f);
+
+	lines=1;
+	for (i=0; i<size; i++)
+		if (snap->data[i]=='\n') lines++;
+	snap->entries=(snapshot_entry*)malloc(sizeof(snapshot_entry)*lines);
+	CHECKERR("Malloc Snapshot",snap->entries==NULL);
+
+	for (line=snap->data; line!=NULL && *line!=0; line=next)
+	{
+		next=strchr(line,'\n');
+		if (next!=NULL)
+			*next++=0;
+		if (strncmp(line,"# library: ",11)==0)
 		{
-			/* Print thread support for MPI */
+			snap->library=line+11;
+			continue;
+		}
+		if (line[0]=='#')
+			continue;
+
+		field[0]=line;
+		for (i=1; i<4 && field[i-1]!=NULL; i++)
+		{
+			field[i]=strchr(field[i-1],'\t');
+			if (field[i]!=NULL)
+				*field[i]++=0;
+		}
+		if (field[3]==NULL)
+			continue;
+		unescape(field[3]);
+		snap->entries[snap->num].name=field[0];
+		snap->entries[snap->num].type=field[1];
+		snap->entries[snap->num].scope=field[2];
+		snap->entries[snap->num].value=field[3];
+		snap->num++;
+	}
+
+	qsort(snap->entries,snap->num,sizeof(snapshot_entry),compare_snapshot_entries);
+	return snap->num;
+}
+
+void free_snapshot(snapshot *snap)
+{
+	free(snap->entries);
+	free(snap->data);
+}
+
+
+/* Write a single CVAR from its textual value */
+
+int write_cvar_value(int index, int bind, MPI_Datatype dt, char *value)
+{
+	int err,count;
+	MPI_T_cvar_handle handle=MPI_T_CVAR_HANDLE_NULL;
+	MPI_Comm comm=MPI_COMM_WORLD;
+	int v_int;
+	unsigned int v_uint;
+	unsigned long v_ulong;
+	unsigned long long v_ullong;
+	MPI_Count v_count;
+	double v_double;
+
+	if (bind==MPI_T_BIND_NO_OBJECT)
+		err=MPI_T_cvar_handle_alloc(index,NULL,&handle,&count);
+	else if (bind==MPI_T_BIND_MPI_COMM)
+		err=MPI_T_cvar_handle_alloc(index,&comm,&handle,&count);
+	else
+		return MPI_T_ERR_INVALID;
+	if (err!=MPI_SUCCESS)
+		return err;
+
+	if (dt==MPI_INT)
+	{
+		v_int=(int)strtol(value,NULL,0);
+		err=MPI_T_cvar_write(handle,&v_int);
+	}
+	else if (dt==MPI_UNSIGNED)
+	{
+		v_uint=(unsigned int)strtoul(value,NULL,0);
+		err=MPI_T_cvar_write(handle,&v_uint);
+	}
+	else if (dt==MPI_UNSIGNED_LONG)
+	{
+		v_ulong=strtoul(value,NULL,0);
+		err=MPI_T_cvar_write(handle,&v_ulong);
+	}
+	else if (dt==MPI_UNSIGNED_LONG_LONG)
+	{
+		v_ullong=strtoull(value,NULL,0);
+		err=MPI_T_cvar_write(handle,&v_ullong);
+	}
+	else if (dt==MPI_COUNT)
+	{
+		v_count=(MPI_Count)strtoll(value,NULL,0);
+		err=MPI_T_cvar_write(handle,&v_count);
+	}
+	else if (dt==MPI_DOUBLE)
+	{
+		v_double=strtod(value,NULL);
+		err=MPI_T_cvar_write(handle,&v_double);
+	}
+	else if (dt==MPI_CHAR && (int)strlen(value)<count)
+	{
+		err=MPI_T_cvar_write(handle,value);
+	}
+	else
+		err=MPI_T_ERR_INVALID;
+
+	MPI_T_cvar_handle_free(&handle);
+	return err;
+}
+
+
+/* Restore a snapshot by writing all writable CVARs whose value differs */
+
+int restore_snapshot(char *filename, int rank)
+{
+	snapshot snap;
+	snapshot_entry key,*entry;
+	int num,err,i;
+	char name[CVAR_NAME_LEN];
+	char desc[CVAR_VALUE_LEN];
+	char value[CVAR_STRING_LEN];
+	int namelen,desclen,bind,verbos,scope;
+	MPI_Datatype dt;
+	MPI_T_enum et;
+	int found=0,unchanged=0,written=0,readonly=0,failed=0;
+
+	if (read_snapshot(filename,&snap)<0)
+		return -1;
+
+	err=MPI_T_cvar_get_num(&num);
+	CHECKERR("CVARNUM",err);
+
+	for (i=0; i<num; i++)
+	{
+		namelen=CVAR_NAME_LEN;
+		desclen=CVAR_VALUE_LEN;
+		err=MPI_T_cvar_get_info(i,name,&namelen,&verbos,&dt,&et,desc,&desclen,&bind,&scope);
+		if (err!=MPI_SUCCESS)
+			continue;
+		key.name=name;
+		entry=(snapshot_entry*)bsearch(&key,snap.entries,snap.num,sizeof(snapshot_entry),compare_snapshot_entries);
+		if (entry==NULL)
+			continue;
+		found++;
+
+		if (read_cvar_value(i,bind,dt,et,0,value,sizeof(value)) && strcmp(value,entry->value)==0)
+		{
+			unchanged++;
+			continue;
+		}
+		if (scope==MPI_T_SCOPE_CONSTANT || scope==MPI_T_SCOPE_READONLY)
+		{
+			if (rank==0)
+				printf("  read-only: %s = %s (snapshot: %s)\n",name,value,entry->value);
+			readonly++;
+			continue;
+		}
+		err=write_cvar_value(i,bind,dt,entry->value);
+		if (err==MPI_SUCCESS)
+			written++;
+		else
+		{
+			if (rank==0)
+				printf("  failed:    %s = %s (snapshot: %s, MPI error code %i)\n",name,value,entry->value,err);
+			failed++;
+		}
+	}
+
+	if (rank==0)
+	{
+		printf("Restored snapshot %s (%s)\n",filename,snap.library);
+		printf("  %i variables in snapshot, %i found in this library\n",snap.num,found);
+		printf("  %i unchanged, %i written, %i read-only and different, %i failed\n",
+				unchanged,written,readonly,failed);
+	}
+
+	free_snapshot(&snap);
+	return failed;
+}
+
+
+/* Compare two snapshots */
+
+void print_diff_line(char *name, int namelen, char *a, char *b)
+{
+	print_filled(name,namelen,' ');
+	printf(" %-24s %s\n",a,b);
+}
+
+int diff_snapshots(char *file_a, char *file_b)
+{
+	snapshot a,b;
+	int i,j,c,maxnamelen;
+	int changed=0,only_a=0,only_b=0,same=0;
+
+	if (read_snapshot(file_a,&a)<0)
+		return -1;
+	if (read_snapshot(file_b,&b)<0)
+	{
+		free_snapshot(&a);
+		return -1;
+	}
+
+	printf("A: %s (%s)\n",file_a,a.library);
+	printf("B: %s (%s)\n\n",file_b,b.library);
+
+	maxnamelen=strlen("Variable");
+	for (i=0; i<a.num; i++)
+		if ((int)strlen(a.entries[i].name)>maxnamelen) maxnamelen=strlen(a.entries[i].name);
+	for (i=0; i<b.num; i++)
+		if ((int)strlen(b.entries[i].name)>maxnamelen) maxnamelen=strlen(b.entries[i].name);
+
+	print_diff_line("Variable",maxnamelen,"A","B");
+	print_filled("",maxnamelen+50,'-');printf("\n");
+
+	/* Both lists are sorted, walk them in parallel */
+
+	i=0; j=0;
+	while (i<a.num || j<b.num)
+	{
+		if (i==a.num)
+			c=1;
+		else if (j==b.num)
+			c=-1;
+		else
+			c=strcmp(a.entries[i].name,b.entries[j].name);
+
+		if (c<0)
+		{
+			print_diff_line(a.entries[i].name,maxnamelen,a.entries[i].value,"<missing>");
+			only_a++;
+			i++;
+		}
+		else if (c>0)
+		{
+			print_diff_line(b.entries[j].name,maxnamelen,"<missing>",b.entries[j].value);
+			only_b++;
+			j++;
+		}
+		else
+		{
+			if (strcmp(a.entries[i].value,b.entries[j].value)!=0)
+			{
+				print_diff_line(a.entries[i].name,maxnamelen,a.entries[i].value,b.entries[j].value);
+				changed++;
+			}
+			else
+				same++;
+			i++;
+			j++;
+		}
+	}
+
+	print_filled("",maxnamelen+50,'-');printf("\n");
+	printf("%i different, %i only in A, %i only in B, %i identical\n",changed,only_a,only_b,same);
+
+	free_snapshot(&a);
+	free_snapshot(&b);
+	return changed+only_a+only_b;
+}
+
+
+/* Print all Event Types (MPI 4.0) */
+
+void list_events()
+{
+#if MPI_VERSION >= 4
+	int num,err,i,j,numvars,numelem,maxnamelen;
+	char name[CVAR_NAME_LEN];
+	char desc[CVAR_STRING_LEN];
+	int namelen,desclen,verbos,bind;
+	MPI_Datatype dt[CVAR_VALUE_LEN];
+	MPI_Aint displ[CVAR_VALUE_LEN];
+	MPI_T_enum et;
+	MPI_Info info;
+
+	err=MPI_T_event_get_num(&num);
+	CHECKERR("EVENTNUM",err);
+	if (err!=MPI_SUCCESS)
+		return;
+	printf("Found %i event types\n",num);
+
+	/* Find name length */
+
+	numvars=0;
+	maxnamelen=strlen("Event");
+	for (i=0; i<num; i++)
+	{
+		namelen=CVAR_NAME_LEN;
+		desclen=0;
+		numelem=0;
+		err=MPI_T_event_get_info(i,name,&namelen,&verbos,dt,displ,&numelem,&et,&info,desc,&desclen,&bind);
+		if (err!=MPI_SUCCESS)
+			continue;
+		if (info!=MPI_INFO_NULL)
+			MPI_Info_free(&info);
+		if (namelen>maxnamelen) maxnamelen=namelen;
+		if (verbos<=verbosity) numvars++;
+	}
+	printf("Found %i event types with verbosity <= ",numvars);
+	print_verbosity_short(verbosity);
+	printf("\n\n");
+
+	if (!longlist)
+	{
+		print_filled("Event",maxnamelen,' ');
+		printf(" VRB   Bind     Elements\n");
+		print_filled("",maxnamelen+27,'-');printf("\n");
+	}
+
+	for (i=0; i<num; i++)
+	{
+		namelen=CVAR_NAME_LEN;
+		desclen=CVAR_STRING_LEN;
+		numelem=CVAR_VALUE_LEN;
+		err=MPI_T_event_get_info(i,name,&namelen,&verbos,dt,displ,&numelem,&et,&info,desc,&desclen,&bind);
+		if (err!=MPI_SUCCESS)
+			continue;
+		if (info!=MPI_INFO_NULL)
+			MPI_Info_free(&info);
+		if (verbos>verbosity)
+			continue;
+		if (numelem>CVAR_VALUE_LEN)
+			numelem=CVAR_VALUE_LEN;
+
+		if (!longlist)
+		{
+			print_filled(name,maxnamelen,' ');
+			printf(" ");
+			print_verbosity_short(verbos);
+			printf(" ");
+			print_bind(bind);
+			printf(" ");
+			for (j=0; j<numelem; j++)
+				printf("%s%s",j ? "," : "",type_name(dt[j]));
+			printf("\n");
+		}
+		else
+		{
+			print_filled("",SCREENLEN,'-');printf("\n");
+			printf("Name: %s (",name); print_verbosity(verbos);printf(")\n");
+			printf("Bind:  "); print_bind(bind); printf("\n");
+			printf("Elements:");
+			for (j=0; j<numelem; j++)
+				printf(" %s@%li",type_name(dt[j]),(long)displ[j]);
+			printf("\n\n");
+			if (desc[0]!=0)
+				printf("%s\n\n",desc);
+		}
+	}
+	if (numvars>0)
+	{
+		if (!longlist)
+			print_filled("",maxnamelen+27,'-');
+		else
+			print_filled("",SCREENLEN,'-');
+		printf("\n");
+	}
+#else
+	printf("MPI_T events require an MPI 4.0 library\n");
+#endif
+}
+
+
+/* Cross-rank consistency check of CVARs with GROUP_EQ or ALL_EQ scope
+
+   Every rank hashes name and value of each such CVAR and adds the hash to
+   a slot selected by the name, so all ranks use the same table layout even
+   if they expose different variables. One MAX reduction over the pairs
+   (hash, ~hash) yields maximum and minimum of every slot, and only slots
+   that differ are gathered to rank 0. */
+
+#define CHECK_SLOTS 16384
+#define CHECK_VALUE_LEN 64
+
+typedef struct
+{
+	unsigned long long hash;
+	int numvars;
+	char value[CHECK_VALUE_LEN];
+} check_record;
+
+unsigned long long hash_string(unsigned long long hash, char *s)
+{
+	for (; *s; s++)
+	{
+		hash^=(unsigned char)*s;
+		hash*=1099511628211ULL;
+	}
+	return hash;
+}
+
+
+/* Print a list of ranks with ranges compressed, e.g. 0-3,7 */
+
+void print_rank_list(int *ranks, int num)
+{
+	int i,j;
+	for (i=0; i<num; i=j)
+	{
+		for (j=i+1; j<num && ranks[j]==ranks[j-1]+1; j++);
+		if (i>0) printf(",");
+		if (j-1>i)
+			printf("%i-%i",ranks[i],ranks[j-1]);
+		else
+			printf("%i",ranks[i]);
+	}
+}
+
+int check_consistency(int rank, int size)
+{
+	int num,err,i,s,r,m,nummismatch,numchecked;
+	char name[CVAR_NAME_LEN];
+	char desc[CVAR_VALUE_LEN];
+	char value[CVAR_STRING_LEN];
+	int namelen,desclen,bind,verbos,scope;
+	MPI_Datatype dt;
+	MPI_T_enum et;
+	unsigned long long *slothash,*reduced,varhash;
+	int *slotcount,*slotfirst,*next,*mismatch,*groupranks,*done;
+	check_record *records,*allrecords=NULL;
+
+	err=MPI_T_cvar_get_num(&num);
+	CHECKERR("CVARNUM",err);
+
+	slothash=(unsigned long long*)calloc(2*CHECK_SLOTS,sizeof(unsigned long long));
+	reduced=(unsigned long long*)malloc(2*CHECK_SLOTS*sizeof(unsigned long long));
+	slotcount=(int*)calloc(CHECK_SLOTS,sizeof(int));
+	slotfirst=(int*)malloc(CHECK_SLOTS*sizeof(int));
+	next=(int*)malloc((num+1)*sizeof(int));
+	for (s=0; s<CHECK_SLOTS; s++)
+		slotfirst[s]=-1;
+
+	/* Hash local values */
+
+	numchecked=0;
+	for (i=0; i<num; i++)
+	{
+		namelen=CVAR_NAME_LEN;
+		desclen=CVAR_VALUE_LEN;
+		err=MPI_T_cvar_get_info(i,name,&namelen,&verbos,&dt,&et,desc,&desclen,&bind,&scope);
+		if (err!=MPI_SUCCESS || (scope!=MPI_T_SCOPE_GROUP_EQ && scope!=MPI_T_SCOPE_ALL_EQ))
+			continue;
+		read_cvar_value(i,bind,dt,et,0,value,sizeof(value));
+		s=(int)(hash_string(14695981039346656037ULL,name)&(CHECK_SLOTS-1));
+		varhash=hash_string(hash_string(14695981039346656037ULL,name),value);
+		slothash[2*s]+=varhash;
+		slotcount[s]++;
+		next[i]=slotfirst[s];
+		slotfirst[s]=i;
+		numchecked++;
+	}
+	for (s=0; s<CHECK_SLOTS; s++)
+		slothash[2*s+1]=~slothash[2*s];
+
+	/* Collective 1: maximum and minimum of every slot */
+
+	err=MPI_Allreduce(slothash,reduced,2*CHECK_SLOTS,MPI_UNSIGNED_LONG_LONG,MPI_MAX,MPI_COMM_WORLD);
+	CHECKERR("Allreduce",err);
+
+	mismatch=(int*)malloc(CHECK_SLOTS*sizeof(int));
+	nummismatch=0;
+	for (s=0; s<CHECK_SLOTS; s++)
+		if (reduced[2*s]!=~reduced[2*s+1])
+			mismatch[nummismatch++]=s;
+
+	if (nummismatch==0)
+	{
+		if (rank==0)
+			printf("All %i GROUP_EQ/ALL_EQ control variables are consistent across %i ranks\n",numchecked,size);
+	}
+	else
+	{
+		/* Collective 2: gather the differing slots only */
+
+		records=(check_record*)calloc(nummismatch,sizeof(check_record));
+		for (m=0; m<nummismatch; m++)
+		{
+			s=mismatch[m];
+			records[m].hash=slothash[2*s];
+			records[m].numvars=slotcount[s];
+			if (slotcount[s]==1)
+			{
+				i=slotfirst[s];
+				namelen=CVAR_NAME_LEN;
+				desclen=CVAR_VALUE_LEN;
+				MPI_T_cvar_get_info(i,name,&namelen,&verbos,&dt,&et,desc,&desclen,&bind,&scope);
+				read_cvar_value(i,bind,dt,et,1,value,sizeof(value));
+				strncpy(records[m].value,value,CHECK_VALUE_LEN-1);
+			}
+		}
+		if (rank==0)
+			allrecords=(check_record*)malloc((size_t)size*nummismatch*sizeof(check_record));
+		err=MPI_Gather(records,nummismatch*sizeof(check_record),MPI_BYTE,
+				allrecords,nummismatch*sizeof(check_record),MPI_BYTE,0,MPI_COMM_WORLD);
+		CHECKERR("Gather",err);
+
+		if (rank==0)
+		{
+			printf("%i of %i GROUP_EQ/ALL_EQ control variables differ across %i ranks\n\n",
+					nummismatch,numchecked,size);
+			groupranks=(int*)malloc(size*sizeof(int));
+			done=(int*)malloc(size*sizeof(int));
+			for (m=0; m<nummismatch; m++)
+			{
+				s=mismatch[m];
+				printf("Variable: ");
+				if (slotfirst[s]<0)
+					printf("(not exposed on rank 0)");
+				for (i=slotfirst[s]; i>=0; i=next[i])
+				{
+					namelen=CVAR_NAME_LEN;
+					desclen=CVAR_VALUE_LEN;
+					MPI_T_cvar_get_info(i,name,&namelen,&verbos,&dt,&et,desc,&desclen,&bind,&scope);
+					printf("%s%s",name,next[i]>=0 ? ", " : "");
+				}
+				printf("\n");
+
+				/* Group ranks by value */
+
+				memset(done,0,size*sizeof(int));
+				for (r=0; r<size; r++)
+				{
+					check_record *rec=&allrecords[(size_t)r*nummismatch+m];
+					int numgroup=0,r2;
+					if (done[r])
+						continue;
+					for (r2=r; r2<size; r2++)
+					{
+						if (!done[r2] && allrecords[(size_t)r2*nummismatch+m].hash==rec->hash)
+						{
+							done[r2]=1;
+							groupranks[numgroup++]=r2;
+						}
+					}
+					if (rec->numvars==0)
+						printf("    <missing>");
+					else if (rec->numvars==1)
+					{
+						snprintf(value,sizeof(value),"\"%s\"",rec->value);
+						printf("    %-24s",value);
+					}
+					else
+						printf("    <%i variables, hash %016llx>",rec->numvars,rec->hash);
+					printf(" on ranks ");
+					print_rank_list(groupranks,numgroup);
+					printf("\n");
+				}
+				printf("\n");
+			}
+			free(groupranks);
+			free(done);
+			free(allrecords);
+		}
+		free(records);
+	}
+
+	free(mismatch);
+	free(slothash);
+	free(reduced);
+	free(slotcount);
+	free(slotfirst);
+	free(next);
+	return nummismatch;
+}
+
+
+/* Structured output (JSON and CSV)
+
+   All metadata is collected in a single MPI_T_*_get_info call per
+   variable into an in-memory table, which is then serialized into one
+   growing buffer and written with a single fwrite. */
+
+#define FORMAT_TEXT 0
+#define FORMAT_JSON 1
+#define FORMAT_CSV  2
+
+#define KIND_CVAR 0
+#define KIND_PVAR 1
+
+typedef struct
+{
+	int kind;
+	int index;
+	int verbos;
+	MPI_Datatype dt;
+	int bind;
+	int scope;
+	int varclass;
+	int ro,ct,at;
+	int readable;
+	char *name;
+	char *desc;
+	char *value;
+} var_record;
+
+typedef struct
+{
+	int num;
+	int max;
+	var_record *records;
+} var_table;
+
+typedef struct
+{
+	char *data;
+	size_t len;
+	size_t max;
+} out_buffer;
+
+
+/* Names used in structured output */
+
+char *class_name(int c)
+{
+	switch (c) {
+	case MPI_T_PVAR_CLASS_STATE: return "STATE";
+	case MPI_T_PVAR_CLASS_LEVEL: return "LEVEL";
+	case MPI_T_PVAR_CLASS_SIZE: return "SIZE";
+	case MPI_T_PVAR_CLASS_PERCENTAGE: return "PERCENTAGE";
+	case MPI_T_PVAR_CLASS_HIGHWATERMARK: return "HIGHWATERMARK";
+	case MPI_T_PVAR_CLASS_LOWWATERMARK: return "LOWWATERMARK";
+	case MPI_T_PVAR_CLASS_COUNTER: return "COUNTER";
+	case MPI_T_PVAR_CLASS_AGGREGATE: return "AGGREGATE";
+	case MPI_T_PVAR_CLASS_TIMER: return "TIMER";
+	case MPI_T_PVAR_CLASS_GENERIC: return "GENERIC";
+	default: return "UNKNOWN";
+	}
+}
+
+char *bind_name(int b)
+{
+	switch (b) {
+	case MPI_T_BIND_NO_OBJECT: return "NO_OBJECT";
+	case MPI_T_BIND_MPI_COMM: return "COMM";
+	case MPI_T_BIND_MPI_DATATYPE: return "DATATYPE";
+	case MPI_T_BIND_MPI_ERRHANDLER: return "ERRHANDLER";
+	case MPI_T_BIND_MPI_FILE: return "FILE";
+	case MPI_T_BIND_MPI_GROUP: return "GROUP";
+	case MPI_T_BIND_MPI_OP: return "OP";
+	case MPI_T_BIND_MPI_REQUEST: return "REQUEST";
+	case MPI_T_BIND_MPI_WIN: return "WINDOW";
+	case MPI_T_BIND_MPI_MESSAGE: return "MESSAGE";
+	case MPI_T_BIND_MPI_INFO: return "INFO";
+	default: return "UNKNOWN";
+	}
+}
+
+int verbosity_level(int verbos)
+{
+	switch (verbos) {
+	case MPI_T_VERBOSITY_USER_BASIC: return 1;
+	case MPI_T_VERBOSITY_USER_DETAIL: return 2;
+	case MPI_T_VERBOSITY_USER_ALL: return 3;
+	case MPI_T_VERBOSITY_TUNER_BASIC: return 4;
+	case MPI_T_VERBOSITY_TUNER_DETAIL: return 5;
+	case MPI_T_VERBOSITY_TUNER_ALL: return 6;
+	case MPI_T_VERBOSITY_MPIDEV_BASIC: return 7;
+	case MPI_T_VERBOSITY_MPIDEV_DETAIL: return 8;
+	case MPI_T_VERBOSITY_MPIDEV_ALL: return 9;
+	default: return 0;
+	}
+}
+
+
+/* Collect metadata of all CVARs and PVARs up to the selected verbosity */
+
+var_record *add_record(var_table *t)
+{
+	if (t->num==t->max)
+	{
+		t->max=(t->max==0) ? 256 : 2*t->max;
+		t->records=(var_record*)realloc(t->records,t->max*sizeof(var_record));
+		CHECKERR("Malloc Table",t->records==NULL);
+	}
+	memset(&t->records[t->num],0,sizeof(var_record));
+	return &t->records[t->num++];
+}
+
+void collect_vars(var_table *t)
+{
+	int num,err,i;
+	char name[CVAR_NAME_LEN];
+	char desc[CVAR_STRING_LEN];
+	char value[CVAR_STRING_LEN];
+	int namelen,desclen,verbos,bind,scope,vc,ro,ct,at;
+	MPI_Datatype dt;
+	MPI_T_enum et;
+	var_record *r;
+
+	t->num=0;
+	t->max=0;
+	t->records=NULL;
+
+	if (list_cvar)
+	{
+		err=MPI_T_cvar_get_num(&num);
+		CHECKERR("CVARNUM",err);
+		for (i=0; i<num; i++)
+		{
+			namelen=CVAR_NAME_LEN;
+			desclen=CVAR_STRING_LEN;
+			err=MPI_T_cvar_get_info(i,name,&namelen,&verbos,&dt,&et,desc,&desclen,&bind,&scope);
+			if (err!=MPI_SUCCESS || verbos>verbosity)
+				continue;
+			r=add_record(t);
+			r->kind=KIND_CVAR;
+			r->index=i;
+			r->verbos=verbos;
+			r->dt=dt;
+			r->bind=bind;
+			r->scope=scope;
+			r->readable=read_cvar_value(i,bind,dt,et,1,value,sizeof(value));
+			r->name=strdup(name);
+			r->desc=strdup(desc);
+			r->value=r->readable ? strdup(value) : NULL;
+		}
+	}
+
+	if (list_pvar)
+	{
+		err=MPI_T_pvar_get_num(&num);
+		CHECKERR("PVARNUM",err);
+		for (i=0; i<num; i++)
+		{
+			namelen=CVAR_NAME_LEN;
+			desclen=CVAR_STRING_LEN;
+			err=MPI_T_pvar_get_info(i,name,&namelen,&verbos,&vc,&dt,&et,desc,&desclen,&bind,&ro,&ct,&at);
+			if (err!=MPI_SUCCESS || verbos>verbosity)
+				continue;
+			r=add_record(t);
+			r->kind=KIND_PVAR;
+			r->index=i;
+			r->verbos=verbos;
+			r->dt=dt;
+			r->bind=bind;
+			r->varclass=vc;
+			r->ro=ro;
+			r->ct=ct;
+			r->at=at;
+			r->name=strdup(name);
+			r->desc=strdup(desc);
+		}
+	}
+}
+
+void free_vars(var_table *t)
+{
+	int i;
+	for (i=0; i<t->num; i++)
+	{
+		free(t->records[i].name);
+		free(t->records[i].desc);
+		free(t->records[i].value);
+	}
+	free(t->records);
+	t->num=0;
+	t->max=0;
+	t->records=NULL;
+}
+
+
+/* Buffered writer */
+
+void out_append(out_buffer *o, const char *s, size_t len)
+{
+	if (o->len+len+1>o->max)
+	{
+		while (o->len+len+1>o->max)
+			o->max=(o->max==0) ? 65536 : 2*o->max;
+		o->data=(char*)realloc(o->data,o->max);
+		CHECKERR("Malloc Output",o->data==NULL);
+	}
+	memcpy(o->data+o->len,s,len);
+	o->len+=len;
+}
+
+void out_str(out_buffer *o, const char *s)
+{
+	out_append(o,s,strlen(s));
+}
+
+void out_int(out_buffer *o, int v)
+{
+	char num[16];
+	out_append(o,num,snprintf(num,sizeof(num),"%i",v));
+}
+
+void out_json_string(out_buffer *o, const char *s)
+{
+	char esc[8];
+	out_append(o,"\"",1);
+	for (; *s; s++)
+	{
+		if (*s=='"' || *s=='\\')
+		{
+			esc[0]='\\';
+			esc[1]=*s;
+			out_append(o,esc,2);
+		}
+		else if (*s=='\n')
+			out_append(o,"\\n",2);
+		else if (*s=='\t')
+			out_append(o,"\\t",2);
+		else if ((unsigned char)*s<0x20)
+			out_append(o,esc,snprintf(esc,sizeof(esc),"\\u%04x",(unsigned char)*s));
+		else
+			out_append(o,s,1);
+	}
+	out_append(o,"\"",1);
+}
+
+void out_csv_string(out_buffer *o, const char *s)
+{
+	out_append(o,"\"",1);
+	for (; *s; s++)
+	{
+		if (*s=='"')
+			out_append(o,"\"\"",2);
+		else
+			out_append(o,s,1);
+	}
+	out_append(o,"\"",1);
+}
+
+void out_json_field(out_buffer *o, const char *key, const char *value, int last)
+{
+	out_json_string(o,key);
+	out_str(o,": ");
+	out_json_string(o,value);
+	if (!last)
+		out_str(o,", ");
+}
+
+void out_json_bool(out_buffer *o, const char *key, int value)
+{
+	out_json_string(o,key);
+	out_str(o,value ? ": true, " : ": false, ");
+}
+
+
+/* Serialize the table */
+
+void write_json(out_buffer *o, var_table *t, int major, int minor, char *libversion)
+{
+	int i,kind;
+	char version[16];
+	var_record *r;
+
+	snprintf(version,sizeof(version),"%i.%i",major,minor);
+	out_str(o,"{\n  ");
+	out_json_field(o,"mpi_version",version,1);
+	out_str(o,",\n  ");
+	out_json_field(o,"library_version",libversion,1);
+
+	for (kind=KIND_CVAR; kind<=KIND_PVAR; kind++)
+	{
+		int first=1;
+		if ((kind==KIND_CVAR && !list_cvar) || (kind==KIND_PVAR && !list_pvar))
+			continue;
+		out_str(o,kind==KIND_CVAR ? ",\n  \"cvars\": [" : ",\n  \"pvars\": [");
+		for (i=0; i<t->num; i++)
+		{
+			r=&t->records[i];
+			if (r->kind!=kind)
+				continue;
+			out_str(o,first ? "\n    {" : ",\n    {");
+			first=0;
+			out_str(o,"\"index\": ");
+			out_int(o,r->index);
+			out_str(o,", ");
+			out_json_field(o,"name",r->name,0);
+			out_str(o,"\"verbosity\": ");
+			out_int(o,verbosity_level(r->verbos));
+			out_str(o,", ");
+			if (kind==KIND_PVAR)
+				out_json_field(o,"class",class_name(r->varclass),0);
+			out_json_field(o,"type",type_name(r->dt),0);
+			out_json_field(o,"bind",bind_name(r->bind),0);
+			if (kind==KIND_CVAR)
+			{
+				out_json_field(o,"scope",scope_name(r->scope),0);
+				out_str(o,"\"value\": ");
+				if (r->value!=NULL)
+					out_json_string(o,r->value);
+				else
+					out_str(o,"null");
+				out_str(o,", ");
+			}
+			else
+			{
+				out_json_bool(o,"readonly",r->ro);
+				out_json_bool(o,"continuous",r->ct);
+				out_json_bool(o,"atomic",r->at);
+			}
+			out_json_field(o,"description",r->desc,1);
+			out_str(o,"}");
+		}
+		out_str(o,first ? "]" : "\n  ]");
+	}
+	out_str(o,"\n}\n");
+}
+
+void write_csv(out_buffer *o, var_table *t)
+{
+	int i;
+	var_record *r;
+
+	out_str(o,"kind,index,name,verbosity,class,type,bind,scope,readonly,continuous,atomic,value,description\n");
+	for (i=0; i<t->num; i++)
+	{
+		r=&t->records[i];
+		out_str(o,r->kind==KIND_CVAR ? "cvar," : "pvar,");
+		out_int(o,r->index);
+		out_str(o,",");
+		out_csv_string(o,r->name);
+		out_str(o,",");
+		out_int(o,verbosity_level(r->verbos));
+		out_str(o,",");
+		if (r->kind==KIND_PVAR)
+			out_str(o,class_name(r->varclass));
+		out_str(o,",");
+		out_str(o,type_name(r->dt));
+		out_str(o,",");
+		out_str(o,bind_name(r->bind));
+		out_str(o,",");
+		if (r->kind==KIND_CVAR)
+		{
+			out_str(o,scope_name(r->scope));
+			out_str(o,",,,,");
+			if (r->value!=NULL)
+				out_csv_string(o,r->value);
+		}
+		else
+		{
+			out_str(o,",");
+			out_str(o,r->ro ? "1," : "0,");
+			out_str(o,r->ct ? "1," : "0,");
+			out_str(o,r->at ? "1," : "0,");
+		}
+		out_str(o,",");
+		out_csv_string(o,r->desc);
+		out_str(o,"\n");
+	}
+}
+
+void list_structured(int format, int major, int minor, char *libversion)
+{
+	var_table table;
+	out_buffer out={NULL,0,0};
+
+	collect_vars(&table);
+	if (format==FORMAT_JSON)
+		write_json(&out,&table,major,minor,libversion);
+	else
+		write_csv(&out,&table);
+	fwrite(out.data,1,out.len,stdout);
+	fflush(stdout);
+	free(out.data);
+	free_vars(&table);
+}
+
+
+/* Live PVAR monitor ("top" mode)
+
+   Rank 0 allocates handles for the selected PVARs once, starts them and
+   redraws a table sorted by the change since the last refresh at a fixed
+   interval. All buffers, including the screen buffer, are allocated up
+   front. On a terminal the screen is redrawn in place, otherwise frames
+   are printed one after another. With a workload all ranks run allreduce
+   operations between refreshes so that library counters move. */
+
+#define TOP_LINE_LEN 160
+#define TOP_NAME_LEN 48
+#define TOP_DEFAULT_ROWS 24
+
+typedef struct
+{
+	char *name;
+	int varclass;
+	int continuous;
+	MPI_Datatype dt;
+	int count;
+	MPI_T_pvar_handle handle;
+	double value;
+	double last;
+	double delta;
+	double rate;
+} top_entry;
+
+int compare_top_entries(const void *a, const void *b)
+{
+	const top_entry *ea=*(const top_entry**)a;
+	const top_entry *eb=*(const top_entry**)b;
+	double da=ea->delta<0 ? -ea->delta : ea->delta;
+	double db=eb->delta<0 ? -eb->delta : eb->delta;
+	if (da!=db)
+		return (da<db) ? 1 : -1;
+	if (ea->value!=eb->value)
+		return (ea->value<eb->value) ? 1 : -1;
+	return strcmp(ea->name,eb->name);
+}
+
+
+/* Check a PVAR name against the comma separated list of substrings */
+
+int top_selected(char *name, char *selection)
+{
+	char *p,*end;
+	size_t len;
+
+	if (selection==NULL)
+		return 1;
+	for (p=selection; *p; p=(*end) ? end+1 : end)
+	{
+		end=strchr(p,',');
+		if (end==NULL)
+			end=p+strlen(p);
+		len=end-p;
+		if (len>0)
+		{
+			char *s;
+			for (s=name; *s; s++)
+				if (strncmp(s,p,len)==0)
+					return 1;
+		}
+	}
+	return 0;
+}
+
+
+/* Sum of all elements of a PVAR */
+
+double top_value(MPI_Datatype dt, void *buf, int count)
+{
+	double sum=0;
+	int i;
+	for (i=0; i<count; i++)
+	{
+		if (dt==MPI_INT)
+			sum+=((int*)buf)[i];
+		else if (dt==MPI_UNSIGNED)
+			sum+=((unsigned int*)buf)[i];
+		else if (dt==MPI_UNSIGNED_LONG)
+			sum+=((unsigned long*)buf)[i];
+		else if (dt==MPI_UNSIGNED_LONG_LONG)
+			sum+=((unsigned long long*)buf)[i];
+		else if (dt==MPI_COUNT)
+			sum+=((MPI_Count*)buf)[i];
+		else if (dt==MPI_DOUBLE)
+			sum+=((double*)buf)[i];
+	}
+	return sum;
+}
+
+int top_supported_type(MPI_Datatype dt)
+{
+	return dt==MPI_INT || dt==MPI_UNSIGNED || dt==MPI_UNSIGNED_LONG ||
+		dt==MPI_UNSIGNED_LONG_LONG || dt==MPI_COUNT || dt==MPI_DOUBLE;
+}
+
+int top_format(char *s, int len, double v, MPI_Datatype dt)
+{
+	if (dt==MPI_DOUBLE)
+		return snprintf(s,len,"%14.6g",v);
+	return snprintf(s,len,"%14.0f",v);
+}
+
+void monitor_pvars(int rank, double interval, int refreshes, char *selection, int workload)
+{
+	int num,err,i,k,rows,numentries,maxcount,namewidth,tty,pos;
+	char name[CVAR_NAME_LEN];
+	char desc[CVAR_STRING_LEN];
+	int namelen,desclen,verbos,vc,bind,ro,ct,at,count;
+	MPI_Datatype dt;
+	MPI_T_enum et;
+	MPI_Comm comm=MPI_COMM_WORLD;
+	MPI_T_pvar_session session;
+	MPI_T_pvar_handle handle;
+	top_entry *entries=NULL,**order=NULL;
+	void *readbuf=NULL;
+	char *frame=NULL;
+	double *wbuf=NULL,*wres=NULL;
+	int wcount=0;
+	double now,last,tend;
+	struct winsize ws;
+
+	/* Setup on rank 0 */
+
+	numentries=0;
+	if (rank==0)
+	{
+		err=MPI_T_pvar_session_create(&session);
+		CHECKERR("SESSION",err);
+		err=MPI_T_pvar_get_num(&num);
+		CHECKERR("PVARNUM",err);
+		entries=(top_entry*)calloc(num>0 ? num : 1,sizeof(top_entry));
+		maxcount=1;
+		namewidth=strlen("Variable");
+		for (i=0; i<num; i++)
+		{
+			namelen=CVAR_NAME_LEN;
+			desclen=CVAR_STRING_LEN;
+			err=MPI_T_pvar_get_info(i,name,&namelen,&verbos,&vc,&dt,&et,desc,&desclen,&bind,&ro,&ct,&at);
+			if (err!=MPI_SUCCESS || verbos>verbosity || !top_supported_type(dt) ||
+					!top_selected(name,selection))
+				continue;
+			if (bind==MPI_T_BIND_NO_OBJECT)
+				err=MPI_T_pvar_handle_alloc(session,i,NULL,&handle,&count);
+			else if (bind==MPI_T_BIND_MPI_COMM)
+				err=MPI_T_pvar_handle_alloc(session,i,&comm,&handle,&count);
+			else
+				continue;
+			if (err!=MPI_SUCCESS || count<1)
+				continue;
+			if (!ct)
+				MPI_T_pvar_start(session,handle);
+			entries[numentries].name=strdup(name);
+			entries[numentries].varclass=vc;
+			entries[numentries].continuous=ct;
+			entries[numentries].dt=dt;
+			entries[numentries].count=count;
+			entries[numentries].handle=handle;
+			if (count>maxcount) maxcount=count;
+			if (namelen>namewidth) namewidth=namelen;
+			numentries++;
+		}
+		if (namewidth>TOP_NAME_LEN)
+			namewidth=TOP_NAME_LEN;
+
+		readbuf=malloc((size_t)maxcount*sizeof(double));
+		order=(top_entry**)malloc((numentries>0 ? numentries : 1)*sizeof(top_entry*));
+		for (i=0; i<numentries; i++)
+		{
+			order[i]=&entries[i];
+			if (MPI_T_pvar_read(session,entries[i].handle,readbuf)==MPI_SUCCESS)
+				entries[i].last=top_value(entries[i].dt,readbuf,entries[i].count);
+		}
+
+		tty=isatty(STDOUT_FILENO);
+		rows=numentries;
+		if (tty)
+		{
+			rows=TOP_DEFAULT_ROWS;
+			if (ioctl(STDOUT_FILENO,TIOCGWINSZ,&ws)==0 && ws.ws_row>0)
+				rows=ws.ws_row;
+			rows-=4;
+			if (rows>numentries) rows=numentries;
+			if (rows<0) rows=0;
+			fputs("\033[2J",stdout);
+		}
+		frame=(char*)malloc((size_t)(rows+3)*TOP_LINE_LEN+16);
+	}
+
+	if (workload>0)
+	{
+		wcount=(workload+sizeof(double)-1)/sizeof(double);
+		wbuf=(double*)calloc(wcount,sizeof(double));
+		wres=(double*)calloc(wcount,sizeof(double));
+	}
+
+	/* Refresh loop */
+
+	last=MPI_Wtime();
+	for (k=0; refreshes<=0 || k<refreshes; k++)
+	{
+		if (workload>0)
+		{
+			/* rank 0 decides when the interval is over, everyone sees it in the result */
+			tend=MPI_Wtime()+interval;
+			do
+			{
+				wbuf[0]=(rank==0 && MPI_Wtime()>=tend) ? 1.0 : 0.0;
+				err=MPI_Allreduce(wbuf,wres,wcount,MPI_DOUBLE,MPI_MAX,MPI_COMM_WORLD);
+				CHECKERR("Allreduce",err);
+			} while (wres[0]==0.0);
+		}
+		else
+		{
+			/* without a workload the other ranks only keep pace with rank 0 */
+			usleep((useconds_t)(interval*1e6));
+		}
+
+		if (rank!=0)
+			continue;
+
+		now=MPI_Wtime();
+		for (i=0; i<numentries; i++)
+		{
+			top_entry *e=&entries[i];
+			if (MPI_T_pvar_read(session,e->handle,readbuf)!=MPI_SUCCESS)
+				continue;
+			e->value=top_value(e->dt,readbuf,e->count);
+			e->delta=e->value-e->last;
+			e->rate=(now>last) ? e->delta/(now-last) : 0;
+			e->last=e->value;
+		}
+		last=now;
+		qsort(order,numentries,sizeof(top_entry*),compare_top_entries);
+
+		/* Render the frame into the preallocated buffer */
+
+		pos=0;
+		if (tty)
+			pos+=snprintf(frame+pos,TOP_LINE_LEN,"\033[H");
+		pos+=snprintf(frame+pos,TOP_LINE_LEN,"varlist top - refresh %i, interval %.2fs, %i pvars%s\n",
+				k+1,interval,numentries,tty ? "\033[K" : "");
+		pos+=snprintf(frame+pos,TOP_LINE_LEN,"%-*.*s Class   %14s %14s %14s%s\n",
+				namewidth,namewidth,"Variable","Value","Delta","Rate/s",tty ? "\033[K" : "");
+		for (i=0; i<rows; i++)
+		{
+			top_entry *e=order[i];
+			pos+=snprintf(frame+pos,TOP_LINE_LEN,"%-*.*s %-7.7s ",namewidth,namewidth,e->name,class_name(e->varclass));
+			pos+=top_format(frame+pos,TOP_LINE_LEN,e->value,e->dt);
+			frame[pos++]=' ';
+			pos+=top_format(frame+pos,TOP_LINE_LEN,e->delta,e->dt);
+			frame[pos++]=' ';
+			pos+=snprintf(frame+pos,TOP_LINE_LEN,"%14.6g%s\n",e->rate,tty ? "\033[K" : "");
+		}
+		if (tty)
+			pos+=snprintf(frame+pos,TOP_LINE_LEN,"\033[J");
+		else
+			frame[pos++]='\n';
+		fwrite(frame,1,pos,stdout);
+		fflush(stdout);
+	}
+
+	/* Clean up */
+
+	if (rank==0)
+	{
+		for (i=0; i<numentries; i++)
+		{
+			if (!entries[i].continuous)
+				MPI_T_pvar_stop(session,entries[i].handle);
+			MPI_T_pvar_handle_free(session,&entries[i].handle);
+			free(entries[i].name);
+		}
+		MPI_T_pvar_session_free(&session);
+		free(entries);
+		free(order);
+		free(readbuf);
+		free(frame);
+	}
+	free(wbuf);
+	free(wres);
+}
+
+
+/* Category tree
+
+   Categories not contained in any other category are printed as roots,
+   subcategories are indented below their parents. With -l the
+   description and the member variables are listed as well. */
+
+void print_category(CATEGORY_TREE *tree, int cat, int depth, BITSET *onpath, BITSET *reached)
+{
+	CATEGORY *c=&tree->categories[cat];
+	int i,err,namelen,desclen,verbos,bind,scope,vc,ro,ct,at;
+	char name[CVAR_NAME_LEN];
+	char desc[CVAR_STRING_LEN];
+	MPI_Datatype dt;
+	MPI_T_enum et;
+
+	/* deregistered components leave unnamed, empty categories behind */
+
+	if (c->name[0]==0 && c->num_sub==0 && bitset_count(&c->cvars)==0 && bitset_count(&c->pvars)==0)
+		return;
+
+	print_filled("",2*depth,' ');
+	if (bitset_test(onpath,cat))
+	{
+		printf("%s (cycle)\n",c->name);
+		return;
+	}
+	bitset_set(onpath,cat);
+	bitset_set(reached,cat);
+	printf("%s (%i cvars, %i pvars)\n",c->name,bitset_count(&c->cvars),bitset_count(&c->pvars));
+
+	if (longlist)
+	{
+		if (c->desc[0]!=0)
+		{
+			print_filled("",2*depth+4,' ');
+			printf("%s\n",c->desc);
+		}
+		for (i=bitset_next(&c->cvars,0); list_cvar && i>=0; i=bitset_next(&c->cvars,i+1))
+		{
+			namelen=CVAR_NAME_LEN;
+			desclen=0;
+			err=MPI_T_cvar_get_info(i,name,&namelen,&verbos,&dt,&et,desc,&desclen,&bind,&scope);
+			if (err!=MPI_SUCCESS || verbos>verbosity)
+				continue;
+			print_filled("",2*depth+4,' ');
+			printf("cvar: %s\n",name);
+		}
+		for (i=bitset_next(&c->pvars,0); list_pvar && i>=0; i=bitset_next(&c->pvars,i+1))
+		{
+			namelen=CVAR_NAME_LEN;
+			desclen=0;
+			err=MPI_T_pvar_get_info(i,name,&namelen,&verbos,&vc,&dt,&et,desc,&desclen,&bind,&ro,&ct,&at);
+			if (err!=MPI_SUCCESS || verbos>verbosity)
+				continue;
+			print_filled("",2*depth+4,' ');
+			printf("pvar: %s\n",name);
+		}
+	}
+
+	for (i=0; i<c->num_sub; i++)
+		print_category(tree,c->sub[i],depth+1,onpath,reached);
+	bitset_clear(onpath,cat);
+}
+
+void list_categories()
+{
+	CATEGORY_TREE tree;
+	BITSET onpath,reached,cvars,pvars;
+	int i;
+
+	if (category_tree_load(&tree)<0)
+	{
+		printf("ERROR: cannot query categories\n");
+		return;
+	}
+	printf("Found %i categories\n\n",tree.num);
+
+	bitset_init(&onpath,tree.num);
+	bitset_init(&reached,tree.num);
+	for (i=0; i<tree.num; i++)
+		if (!bitset_test(&tree.is_sub,i))
+			print_category(&tree,i,0,&onpath,&reached);
+
+	/* categories that are only part of cycles have no root */
+
+	for (i=0; i<tree.num; i++)
+		if (!bitset_test(&reached,i))
+			print_category(&tree,i,0,&onpath,&reached);
+
+	bitset_init(&cvars,tree.num_cvars);
+	bitset_init(&pvars,tree.num_pvars);
+	for (i=0; i<tree.num; i++)
+	{
+		bitset_or(&cvars,&tree.categories[i].cvars);
+		bitset_or(&pvars,&tree.categories[i].pvars);
+	}
+	printf("\nNot in any category: %i cvars, %i pvars\n",
+			tree.num_cvars-bitset_count(&cvars),tree.num_pvars-bitset_count(&pvars));
+
+	bitset_free(&onpath);
+	bitset_free(&reached);
+	bitset_free(&cvars);
+	bitset_free(&pvars);
+	category_tree_free(&tree);
+}
+
+
+/* Main */
+
+int main(int argc, char *argv[])
+{
+	int err,errarg;
+	int threadsupport,threadsupport_t;
+	int rank,size;
+	int opt,erropt;
+	int reqthread=MPI_THREAD_MULTIPLE;
+    
+    int minor,major;
+    
+    char libversion[MPI_MAX_LIBRARY_VERSION_STRING];
+    int libversionlen;
+    
+
+	/* Read options */
+
+	verbosity=MPI_T_VERBOSITY_MPIDEV_ALL;
+	list_pvar=1;
+	list_cvar=1;
+	list_event=1;
+	longlist=0;
+	runmpi=1;
+	snapshot_file=NULL;
+	restore_file=NULL;
+	diffmode=0;
+	checkmode=0;
+	categorymode=0;
+	outformat=FORMAT_TEXT;
+	top_interval=0;
+	top_refreshes=0;
+	top_workload=0;
+	top_selection=NULL;
+	errarg=0;
+
+	while ((opt=getopt(argc,argv, "hv:pceglims:r:dxf:t:n:P:w:")) != -1 ) {
+		switch (opt) {
+		case 'h':
+			errarg=-1;
+			break;
+		case 'v':
+			switch (atoi(optarg)) {
+			case 1: verbosity=MPI_T_VERBOSITY_USER_BASIC; break;
+			case 2: verbosity=MPI_T_VERBOSITY_USER_DETAIL; break;
+			case 3: verbosity=MPI_T_VERBOSITY_USER_ALL; break;
+			case 4: verbosity=MPI_T_VERBOSITY_TUNER_BASIC; break;
+			case 5: verbosity=MPI_T_VERBOSITY_TUNER_DETAIL; break;
+			case 6: verbosity=MPI_T_VERBOSITY_TUNER_ALL; break;
+			case 7: verbosity=MPI_T_VERBOSITY_MPIDEV_BASIC; break;
+			case 8: verbosity=MPI_T_VERBOSITY_MPIDEV_DETAIL; break;
+			case 9: verbosity=MPI_T_VERBOSITY_MPIDEV_ALL; break;
+			}
+			break;
+			case 'p':
+				list_pvar=1;
+				list_cvar=0;
+				list_event=0;
+				break;
+			case 'c':
+				list_cvar=1;
+				list_pvar=0;
+				list_event=0;
+				break;
+			case 'l':
+				longlist=1;
+				break;
+			case 'e':
+				list_event=1;
+				list_cvar=0;
+				list_pvar=0;
+				break;
+			case 'g':
+				categorymode=1;
+				break;
+			case 'm':
+				runmpi=0;
+				break;
+			case 's':
+				snapshot_file=optarg;
+				break;
+			case 'r':
+				restore_file=optarg;
+				break;
+			case 'd':
+				diffmode=1;
+				break;
+			case 'x':
+				checkmode=1;
+				break;
+			case 't':
+				top_interval=atof(optarg);
+				if (top_interval<=0)
+				{
+					errarg=1;
+					erropt=opt;
+				}
+				break;
+			case 'n':
+				top_refreshes=atoi(optarg);
+				break;
+			case 'P':
+				top_selection=optarg;
+				break;
+			case 'w':
+				top_workload=atoi(optarg);
+				break;
+			case 'f':
+				if (strcmp(optarg,"json")==0)
+					outformat=FORMAT_JSON;
+				else if (strcmp(optarg,"csv")==0)
+					outformat=FORMAT_CSV;
+				else if (strcmp(optarg,"text")==0)
+					outformat=FORMAT_TEXT;
+				else
+				{
+					errarg=1;
+					erropt=opt;
+				}
+				break;
+			default:
+				errarg=1;
+				erropt=opt;
+				break;
+		}
+	}
+
+	/* Initialize */
+
+	if (runmpi)
+	{
+		err=MPI_Init_thread(&argc,&argv,reqthread,&threadsupport);
+		CHECKERR("Init",err);
+
+		err=MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+		CHECKERR("Rank",err);
+	}
+	else
+		rank=0;
+
+
+	if (diffmode && argc-optind!=2)
+		errarg=1;
+	if (checkmode && !runmpi)
+		errarg=1;
+
+	/* Restoring a snapshot and the consistency check need MPI_T on all ranks */
+
+	if (rank==0 || restore_file!=NULL || checkmode)
+	{
+		err=MPI_T_init_thread(reqthread, &threadsupport_t);
+		CHECKERR("T_Init",err);
+	}
+
+	if (restore_file!=NULL && !errarg)
+		restore_snapshot(restore_file,rank);
+
+	if (top_interval>0 && !errarg)
+		monitor_pvars(rank,top_interval,top_refreshes,top_selection,runmpi ? top_workload : 0);
+
+	if (checkmode && !errarg)
+	{
+		err=MPI_Comm_size(MPI_COMM_WORLD,&size);
+		CHECKERR("Size",err);
+		check_consistency(rank,size);
+	}
+
+	/* ONLY FOR RANK 0 */
+
+	if (rank==0)
+	{
+		if (errarg)
+		{
+			if (errarg>0)
+				printf("Argument error: %c\n",erropt);
+			usage(errarg!=-1);
+		}
+
+		if (diffmode)
+		{
+			diff_snapshots(argv[optind],argv[optind+1]);
+		}
+		else if (snapshot_file!=NULL)
+		{
+			write_snapshot(snapshot_file);
+		}
+	}
+
+	if (rank==0 && outformat!=FORMAT_TEXT && !diffmode && !checkmode && top_interval<=0 && snapshot_file==NULL && restore_file==NULL)
+	{
+		err=MPI_Get_version(&major,&minor);
+		CHECKERR("Version",err);
+		err=MPI_Get_library_version(libversion,&libversionlen);
+		CHECKERR("Version",err);
+		list_structured(outformat,major,minor,libversion);
+	}
+
+	if (rank==0 && outformat==FORMAT_TEXT && !diffmode && !checkmode && top_interval<=0 && snapshot_file==NULL && restore_file==NULL)
+	{
+
+
+		/* Header */
+
+		printf("MPI_T Variable List\n\n");
+        
+        /* Print Version */
+        
+        err=MPI_Get_version(&major,&minor);
+        CHECKERR("T_Init",err);
+        printf("  MPI Version: %i.%i\n",major,minor);
+        
+        err=MPI_Get_library_version(libversion,&libversionlen);
+        CHECKERR("T_Init",err);
+        printf("  MPI Library Version: %s\n\n",libversion);
+
+        /* Print thread support */
+
+		if (runmpi)
+		{
+			/* Print thread support for MPI */
 
 			printf("  MPI Thread support: ");
 			switch (threadsupport) {
@@ -882,7 +2555,15 @@ int main(int argc, char *argv[])
 		/* Start MPI_T */
 
 
-		if (list_cvar)
+		if (categorymode)
+		{
+			printf("\n===============================\n");
+			printf("Categories");
+			printf("\n===============================\n\n");
+			list_categories();
+			printf("\n");
+		}
+		else if (list_cvar)
 		{
 			printf("\n===============================\n");
 			printf("Control Variables");
@@ -891,7 +2572,7 @@ int main(int argc, char *argv[])
 			printf("\n");
 		}
 
-		if (list_pvar)
+		if (list_pvar && !categorymode)
 		{
 			printf("\n===============================\n");
 			printf("Performance Variables");
@@ -899,6 +2580,15 @@ int main(int argc, char *argv[])
 			list_pvars();
 			printf("\n");
 		}
+
+		if (list_event && !categorymode)
+		{
+			printf("\n===============================\n");
+			printf("Event Types");
+			printf("\n===============================\n\n");
+			list_events();
+			printf("\n");
+		}
 	}
 
 	/* Clean up */
@@ -909,13 +2599,16 @@ int main(int argc, char *argv[])
 		CHECKERR("Barrier",err);
 	}
 
-	if (rank==0)
+	if (rank==0 || restore_file!=NULL || checkmode)
+	{
+		enum_cache_free();
 		MPI_T_finalize();
+	}
 
 	if (runmpi)
 		MPI_Finalize();
 
-	if (rank==0)
+	if (rank==0 && outformat==FORMAT_TEXT)
 		printf("Done.\n");
 
 	return 0;